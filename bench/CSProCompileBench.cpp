@@ -0,0 +1,1050 @@
+/*
+ * CSProCompileBench - Benchmark harness for the compile pipeline
+ *
+ * Runs each stage of the pipeline repeatedly and reports latency
+ * percentiles and heap allocations per iteration. Without the CSPro SDK
+ * the stages are driven by SyntheticEngine, so regressions in our own
+ * code (conversion, diagnostic storage, reports, JSON) show up anywhere.
+ *
+ * Usage:
+ *   CSProCompileBench [options]
+ *
+ * Options:
+ *   -n <count>            Measured iterations per scenario (default 20)
+ *   --warmup <count>      Unmeasured iterations first (default 2)
+ *   --diagnostics <count> Diagnostics per compile (default 50000)
+ *   --units <count>       Distinct compilation units (default 4)
+ *   --procs <count>       Distinct PROC names (default 32)
+ *   --message-length <n>  Approximate characters per message (default 48)
+ *   --scenario <name>     Run only this scenario (repeatable)
+ *   --fixture <app>       Also compile this application with the real engine
+ *   --messages <mgf>      Message file for the catalog scenarios (default synthetic)
+ *   --json                Write results as JSON
+ *   --list                List scenarios and exit
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/CompileScheduler.h"
+#include "../include/CompilerInterface.h"
+#include "../include/CorpusGenerator.h"
+#include "../include/DiagnosticConverter.h"
+#include "../include/DiagnosticDelta.h"
+#include "../include/DistributedCompiler.h"
+#include "../include/EnginePool.h"
+#include "../include/IncrementalCompiler.h"
+#include "../include/JsonValue.h"
+#include "../include/JsonWriter.h"
+#include "../include/LogicScanner.h"
+#include "../include/MessageCatalog.h"
+#include "../include/ReportWriter.h"
+#include "../include/ResultCodec.h"
+#include "../include/ResultStore.h"
+#include "../include/ScriptedEngine.h"
+#include "../include/SharedObjectCache.h"
+#include "../include/SyntheticEngine.h"
+#include "../include/TextEncoding.h"
+#include "../include/WorkingDirectory.h"
+#include "../include/WorkspaceGraph.h"
+
+namespace fs = std::filesystem;
+using namespace CSProCompiler;
+
+// Every heap allocation in the process is counted, so a scenario's figures
+// include whatever the standard library allocates on its behalf
+namespace {
+    std::atomic<unsigned long long> allocationCount{ 0 };
+    std::atomic<unsigned long long> allocatedBytes{ 0 };
+
+    void* countedAllocate(std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+            return memory;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAllocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAllocate(size); } catch (...) { return nullptr; }
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+namespace {
+
+struct BenchSettings {
+    int iterations = 20;
+    int warmup = 2;
+    SyntheticEngineConfig engine;
+    std::vector<std::string> scenarios;     // Empty runs all
+    std::string fixture;
+    std::string messageFile;
+    bool jsonOutput = false;
+
+    BenchSettings() {
+        engine.diagnosticCount = 50000;
+    }
+
+    bool wants(const std::string& name) const {
+        return scenarios.empty() || std::find(scenarios.begin(), scenarios.end(), name) != scenarios.end();
+    }
+};
+
+struct Sample {
+    double ms;
+    unsigned long long allocations;
+    unsigned long long bytes;
+};
+
+struct ScenarioResult {
+    std::string name;
+    std::string description;
+    double itemsPerIteration = 0;           // Zero when throughput is not meaningful
+    std::vector<Sample> samples;
+    std::string skippedReason;
+
+    double percentile(double p) const {
+        std::vector<double> times;
+        times.reserve(samples.size());
+        for (const auto& sample : samples) times.push_back(sample.ms);
+        std::sort(times.begin(), times.end());
+        size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(times.size())));
+        return times[std::min(std::max<size_t>(rank, 1), times.size()) - 1];
+    }
+
+    double meanAllocations() const {
+        double total = 0;
+        for (const auto& sample : samples) total += static_cast<double>(sample.allocations);
+        return total / static_cast<double>(samples.size());
+    }
+
+    double meanBytes() const {
+        double total = 0;
+        for (const auto& sample : samples) total += static_cast<double>(sample.bytes);
+        return total / static_cast<double>(samples.size());
+    }
+
+    double itemsPerSecond() const {
+        double median = percentile(0.5);
+        return (itemsPerIteration > 0 && median > 0) ? itemsPerIteration * 1000.0 / median : 0;
+    }
+};
+
+// One pipeline stage. setup runs before every iteration and is not measured.
+struct Scenario {
+    std::string name;
+    std::string description;
+    double itemsPerIteration;
+    std::function<void()> setup;
+    std::function<void()> body;
+};
+
+ScenarioResult runScenario(const Scenario& scenario, const BenchSettings& settings) {
+    ScenarioResult result;
+    result.name = scenario.name;
+    result.description = scenario.description;
+    result.itemsPerIteration = scenario.itemsPerIteration;
+    result.samples.reserve(static_cast<size_t>(settings.iterations));
+
+    for (int i = 0; i < settings.warmup + settings.iterations; i++) {
+        if (scenario.setup) {
+            scenario.setup();
+        }
+
+        unsigned long long allocationsBefore = allocationCount.load();
+        unsigned long long bytesBefore = allocatedBytes.load();
+        auto start = std::chrono::steady_clock::now();
+
+        scenario.body();
+
+        auto end = std::chrono::steady_clock::now();
+        if (i >= settings.warmup) {
+            result.samples.push_back({ std::chrono::duration<double, std::milli>(end - start).count(),
+                                       allocationCount.load() - allocationsBefore,
+                                       allocatedBytes.load() - bytesBefore });
+        }
+    }
+    return result;
+}
+
+// Wide parser-message fields held the way the SDK holds them, for the conversion scenarios
+struct WideMessage {
+    std::wstring text;
+    std::wstring procName;
+    std::wstring unitName;
+    int line;
+    int column;
+};
+
+std::vector<WideMessage> makeWideMessages(const SyntheticEngineConfig& config) {
+    std::vector<WideMessage> messages;
+    messages.reserve(static_cast<size_t>(config.diagnosticCount));
+    for (int i = 0; i < config.diagnosticCount; i++) {
+        std::wstring text = L"Variable 'DÉPARTEMENT_" + std::to_wstring(i % 97) + L"' is not declared";
+        text.resize(std::max<size_t>(text.size(), static_cast<size_t>(config.messageLength)), L'.');
+        messages.push_back({ std::move(text),
+                             L"HH_Q" + std::to_wstring((i / 8) % std::max(config.procCount, 1)),
+                             L"C:/Surveys/Household/Unit" + std::to_wstring((i / 64) % std::max(config.compilationUnitCount, 1)) + L".apc",
+                             1 + i % 5000, 1 + i % 120 });
+    }
+    return messages;
+}
+
+// Well-formed logic of about one line per diagnostic, for the pre-scan
+std::string makeLogicSource(const SyntheticEngineConfig& config, int& lineCount) {
+    static const char* const body =
+        "    if HH_AGE > 120 then\n"
+        "        errmsg(\"Age %d is out of range (max 120)\", HH_AGE);\n"
+        "    elseif HH_AGE < 0 then\n"
+        "        HH_AGE = notappl; { reset before reentry }\n"
+        "    endif;\n"
+        "    do varying numeric i = 1 until i > count(PERSON)\n"
+        "        total = total + (PERSON_INCOME(i) * 12); // annual\n"
+        "    enddo;\n";
+    constexpr int bodyLines = 8;
+
+    std::string text = "PROC GLOBAL\nnumeric total;\n";
+    lineCount = 2;
+    int procs = std::max(config.procCount, 1);
+    for (int proc = 0; lineCount < config.diagnosticCount; proc++) {
+        text += "\nPROC HH_Q" + std::to_string(proc % procs) + "\npostproc\n";
+        lineCount += 3;
+        for (int block = 0; block < 4 && lineCount < config.diagnosticCount; block++) {
+            text += body;
+            lineCount += bodyLines;
+        }
+    }
+    return text;
+}
+
+// A message file shaped like CSProDesigner.mgf: ~625 messages in ~44 KB
+std::string makeMessageFile() {
+    std::string text = "\xEF\xBB\xBF/* --- Synthetic System Messages */\n\nLanguage=EN\n\n";
+    for (int i = 0; i < 625; i++) {
+        if (i % 40 == 0) {
+            text += "/* --- Section " + std::to_string(i / 40) + " */\n";
+        }
+        std::string number = std::to_string(i < 300 ? i + 1 : 100000 + i * 7);
+        std::string message = "Expecting '%s' after the " + std::to_string(i) + "th argument of '%s'";
+        message.resize(40 + (i * 37) % 60, '.');
+        text += number + std::string(std::max<size_t>(1, 7 - number.size()), ' ') + message + "\n";
+    }
+    return text;
+}
+
+std::string formatCount(double value) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(0);
+    if (value >= 1e6) out << value / 1e6 << "M";
+    else if (value >= 1e4) out << value / 1e3 << "K";
+    else out << value;
+    return out.str();
+}
+
+void printTable(const std::vector<ScenarioResult>& results, const BenchSettings& settings) {
+    std::cout << "CSProCompileBench: " << settings.iterations << " iterations (+" << settings.warmup << " warmup), "
+              << settings.engine.diagnosticCount << " diagnostics, "
+              << settings.engine.compilationUnitCount << " units, " << settings.engine.procCount << " procs\n\n";
+
+    std::cout << std::left << std::setw(16) << "scenario" << std::right
+              << std::setw(10) << "min ms" << std::setw(10) << "median" << std::setw(10) << "p95" << std::setw(10) << "p99"
+              << std::setw(12) << "allocs/it" << std::setw(12) << "bytes/it" << std::setw(12) << "items/s" << "\n";
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(16) << result.name << std::right;
+        if (!result.skippedReason.empty()) {
+            std::cout << "  skipped: " << result.skippedReason << "\n";
+            continue;
+        }
+        std::cout << std::setw(10) << result.percentile(0.0) << std::setw(10) << result.percentile(0.5)
+                  << std::setw(10) << result.percentile(0.95) << std::setw(10) << result.percentile(0.99)
+                  << std::setw(12) << formatCount(result.meanAllocations())
+                  << std::setw(12) << formatCount(result.meanBytes())
+                  << std::setw(12) << (result.itemsPerIteration > 0 ? formatCount(result.itemsPerSecond()) : "-") << "\n";
+    }
+}
+
+void printJson(const std::vector<ScenarioResult>& results, const BenchSettings& settings) {
+    std::string out;
+    JsonWriter writer(out, true);
+    writer.beginObject();
+    writer.member("iterations", settings.iterations);
+    writer.member("warmup", settings.warmup);
+    writer.member("diagnostics", settings.engine.diagnosticCount);
+    writer.member("units", settings.engine.compilationUnitCount);
+    writer.member("procs", settings.engine.procCount);
+    writer.key("scenarios").beginArray();
+    for (const auto& result : results) {
+        writer.beginObject();
+        writer.member("name", result.name);
+        writer.member("description", result.description);
+        if (!result.skippedReason.empty()) {
+            writer.member("skipped", result.skippedReason);
+        } else {
+            writer.member("minMs", result.percentile(0.0));
+            writer.member("medianMs", result.percentile(0.5));
+            writer.member("p95Ms", result.percentile(0.95));
+            writer.member("p99Ms", result.percentile(0.99));
+            writer.member("allocationsPerIteration", result.meanAllocations());
+            writer.member("bytesPerIteration", result.meanBytes());
+            if (result.itemsPerIteration > 0) {
+                writer.member("itemsPerSecond", result.itemsPerSecond());
+            }
+        }
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+    out += '\n';
+    std::cout << out;
+}
+
+void printUsage(const char* programName) {
+    std::cout << "CSProCompileBench - Benchmark harness for the compile pipeline\n\n";
+    std::cout << "Usage: " << programName << " [options]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  -n <count>            Measured iterations per scenario (default 20)\n";
+    std::cout << "  --warmup <count>      Unmeasured iterations first (default 2)\n";
+    std::cout << "  --diagnostics <count> Diagnostics per compile (default 50000)\n";
+    std::cout << "  --units <count>       Distinct compilation units (default 4)\n";
+    std::cout << "  --procs <count>       Distinct PROC names (default 32)\n";
+    std::cout << "  --message-length <n>  Approximate characters per message (default 48)\n";
+    std::cout << "  --scenario <name>     Run only this scenario (repeatable)\n";
+    std::cout << "  --fixture <app>       Also compile this application with the real engine\n";
+    std::cout << "  --messages <mgf>      Message file for the catalog scenarios (default synthetic)\n";
+    std::cout << "  --json                Write results as JSON\n";
+    std::cout << "  --list                List scenarios and exit\n";
+}
+
+bool parseCount(int argc, char* argv[], int& i, int minimum, int& value) {
+    if (i + 1 >= argc) {
+        std::cerr << "Error: " << argv[i] << " requires a number\n";
+        return false;
+    }
+    int parsed = std::atoi(argv[i + 1]);
+    if (parsed < minimum) {
+        std::cerr << "Error: " << argv[i] << " must be at least " << minimum << "\n";
+        return false;
+    }
+    value = parsed;
+    i++;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchSettings settings;
+    bool listOnly = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-n") ok = parseCount(argc, argv, i, 1, settings.iterations);
+        else if (arg == "--warmup") ok = parseCount(argc, argv, i, 0, settings.warmup);
+        else if (arg == "--diagnostics") ok = parseCount(argc, argv, i, 0, settings.engine.diagnosticCount);
+        else if (arg == "--units") ok = parseCount(argc, argv, i, 1, settings.engine.compilationUnitCount);
+        else if (arg == "--procs") ok = parseCount(argc, argv, i, 1, settings.engine.procCount);
+        else if (arg == "--message-length") ok = parseCount(argc, argv, i, 1, settings.engine.messageLength);
+        else if (arg == "--json") settings.jsonOutput = true;
+        else if (arg == "--list") listOnly = true;
+        else if (arg == "--scenario" && i + 1 < argc) settings.scenarios.emplace_back(argv[++i]);
+        else if (arg == "--fixture" && i + 1 < argc) settings.fixture = argv[++i];
+        else if (arg == "--messages" && i + 1 < argc) settings.messageFile = argv[++i];
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        if (!ok) {
+            return 1;
+        }
+    }
+
+    std::error_code ec;
+    fs::path workDirectory = fs::temp_directory_path(ec) / ("csprocompile-bench-" + std::to_string(
+        std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(workDirectory, ec);
+    std::string applicationFile = (workDirectory / "Bench.ent").u8string();
+
+    CompilerOptions options;
+    options.inputFile = applicationFile;
+    options.checkSyntaxOnly = true;
+
+    // Shared state for the stages downstream of the engine
+    SyntheticEngine engine(settings.engine);
+    engine.initialize();
+    CompilationResult compiled = engine.compile(options);
+    std::vector<WideMessage> wideMessages = makeWideMessages(settings.engine);
+
+    int logicLineCount;
+    std::string logicText = makeLogicSource(settings.engine, logicLineCount);
+    std::string logicFile = (workDirectory / "Bench.apc").lexically_normal().u8string();
+    std::ofstream(workDirectory / "Bench.apc", std::ios::binary) << logicText;
+    std::ofstream(workDirectory / "Bench.ent", std::ios::binary) << "[Files]\nApplication=Bench.apc\n";
+    double diagnosticCount = static_cast<double>(settings.engine.diagnosticCount);
+
+    std::vector<Scenario> scenarios;
+
+    scenarios.push_back({ "engine-init", "Create, initialize and shut down a synthetic engine", 0, nullptr, [&]() {
+        SyntheticEngine freshEngine(settings.engine);
+        freshEngine.initialize();
+        freshEngine.shutdown();
+    } });
+
+    scenarios.push_back({ "convert", "DiagnosticConverter into one reused message", diagnosticCount, nullptr, [&]() {
+        DiagnosticConverter converter(applicationFile);
+        DiagnosticMessage msg;
+        for (const auto& wide : wideMessages) {
+            ParserMessageFields fields;
+            fields.formattedText = "Logic - Parser Message";
+            fields.messageText = wide.text;
+            fields.procName = wide.procName;
+            fields.compilationUnitName = wide.unitName;
+            fields.line = wide.line;
+            fields.column = wide.column;
+            converter.convert(fields, msg);
+        }
+    } });
+
+    // The per-field wide copies and fresh strings the engine loop used to make
+    scenarios.push_back({ "convert-naive", "Per-field wide copies and fresh UTF-8 strings", diagnosticCount, nullptr, [&]() {
+        std::vector<DiagnosticMessage> messages;
+        for (const auto& wide : wideMessages) {
+            std::wstring text = wide.text;
+            std::wstring procName = wide.procName;
+            std::wstring unitName = wide.unitName;
+            DiagnosticMessage msg;
+            msg.message = toUtf8(text);
+            msg.file = toUtf8(unitName);
+            msg.procName = toUtf8(procName);
+            msg.line = wide.line;
+            msg.column = wide.column;
+            messages.push_back(msg);
+        }
+    } });
+
+    scenarios.push_back({ "compile", "Synthetic compile into a DiagnosticList", diagnosticCount, nullptr, [&]() {
+        CompilationResult result = engine.compile(options);
+    } });
+
+    // Reports are removed first so every iteration writes them; unchanged reports are only compared
+    auto removeReports = [&]() {
+        fs::remove(workDirectory / "compileErrors.txt", ec);
+        fs::remove(workDirectory / "compileErrorsFormatted.txt", ec);
+    };
+
+    scenarios.push_back({ "report", "compileErrors.txt and compileErrorsFormatted.txt", diagnosticCount, removeReports, [&]() {
+        ReportWriter::writeReports(applicationFile, compiled);
+    } });
+
+    scenarios.push_back({ "report-same", "Reports identical to those on disk", diagnosticCount, nullptr, [&]() {
+        ReportWriter::writeReports(applicationFile, compiled);
+    } });
+
+    scenarios.push_back({ "prescan", "Native structural scan of the mapped logic file (items = lines)",
+                          static_cast<double>(logicLineCount), nullptr, [&]() {
+        CompilationResult result = prescanApplication(options);
+    } });
+
+    // One PROC in the middle of the logic is edited before every iteration. The
+    // scripted engine charges 20 ms per full compile, and a unit compile its
+    // share of that by size, standing in for the engine's per-PROC cost.
+    ScriptedEngine scriptedEngine(20);
+    scriptedEngine.initialize();
+    IncrementalCompiler incremental(scriptedEngine);
+    CompilerOptions unitOptions = options;
+    int editCount = 0;
+    auto editOneProc = [&]() {
+        std::string edited = logicText;
+        size_t proc = edited.find("\nPROC ", edited.size() / 2);
+        size_t lineEnd = (proc == std::string::npos) ? std::string::npos : edited.find('\n', proc + 1);
+        if (lineEnd != std::string::npos) {
+            edited.insert(lineEnd + 1, "    { @warning edit " + std::to_string(++editCount) + " }\n");
+        }
+        unitOptions.sourceOverlays[logicFile] = std::move(edited);
+    };
+    incremental.compile(unitOptions);
+
+    scenarios.push_back({ "units-full", "Scripted engine recompiling every PROC after a one-PROC edit (items = lines)",
+                          static_cast<double>(logicLineCount), editOneProc, [&]() {
+        CompilationResult result = scriptedEngine.compile(unitOptions);
+    } });
+
+    scenarios.push_back({ "units-changed", "IncrementalCompiler recompiling only the edited PROC (items = lines)",
+                          static_cast<double>(logicLineCount), editOneProc, [&]() {
+        CompilationResult result = incremental.compile(unitOptions);
+    } });
+
+    // The same message file with and without its precompiled catalog beside it
+    fs::path messageFile = workDirectory / "Messages.mgf";
+    fs::path textOnlyMessageFile = workDirectory / "text" / "Messages.mgf";
+    fs::create_directories(textOnlyMessageFile.parent_path(), ec);
+    if (settings.messageFile.empty()) {
+        std::ofstream(messageFile, std::ios::binary) << makeMessageFile();
+    } else {
+        fs::copy_file(fs::u8path(settings.messageFile), messageFile, fs::copy_options::overwrite_existing, ec);
+    }
+    fs::copy_file(messageFile, textOnlyMessageFile, fs::copy_options::overwrite_existing, ec);
+    size_t catalogCount = 0;
+    std::string catalogError;
+    MessageCatalog::compile(messageFile, MessageCatalog::catalogPathFor(messageFile), "EN", catalogCount, catalogError);
+
+    std::vector<int> messageNumbers;
+    {
+        MessageCatalog catalog;
+        catalog.open(messageFile);
+        for (int number = 0; number < 200000 && messageNumbers.size() < catalog.size(); number++) {
+            if (!catalog.lookup(number).empty()) messageNumbers.push_back(number);
+        }
+    }
+    constexpr int lookupPasses = 100;
+
+    scenarios.push_back({ "messages-text", "Load the message file by parsing its text (items = messages)",
+                          static_cast<double>(catalogCount), nullptr, [&]() {
+        MessageCatalog catalog;
+        catalog.open(textOnlyMessageFile);
+    } });
+
+    scenarios.push_back({ "messages-mapped", "Load the message file through its mapped .mgc (items = messages)",
+                          static_cast<double>(catalogCount), nullptr, [&]() {
+        MessageCatalog catalog;
+        catalog.open(messageFile);
+    } });
+
+    MessageCatalog lookupCatalog;
+    lookupCatalog.open(messageFile);
+    size_t lookedUpBytes = 0;
+    scenarios.push_back({ "messages-lookup", "Resolve every message number in the mapped catalog (items = lookups)",
+                          static_cast<double>(messageNumbers.size() * lookupPasses), nullptr, [&]() {
+        lookedUpBytes = 0;
+        for (int pass = 0; pass < lookupPasses; pass++) {
+            for (int number : messageNumbers) {
+                lookedUpBytes += lookupCatalog.lookup(number).size();
+            }
+        }
+    } });
+
+    // Stand-in engines on separate threads compile applications named by the
+    // same relative path against different base directories, and read them
+    // back through the CWD guard the SDK path uses (checked for cross-talk
+    // by tests/ConcurrencyTests.cpp)
+    constexpr int stressApplications = 8;
+    constexpr int stressCompilesPerThread = 16;
+    int stressThreads = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    std::vector<fs::path> stressDirectories;
+    for (int a = 0; a < stressApplications; a++) {
+        fs::path directory = workDirectory / ("stress" + std::to_string(a));
+        fs::create_directories(directory, ec);
+        std::string logic = "PROC GLOBAL\n";
+        for (int w = 0; w <= a; w++) {
+            logic += "{ @warning application " + std::to_string(a) + " }\n";
+        }
+        std::ofstream(directory / "App.apc", std::ios::binary) << logic;
+        std::ofstream(directory / "App.ent", std::ios::binary) << "[Files]\nApplication=App.apc\n";
+        stressDirectories.push_back(directory);
+    }
+
+    scenarios.push_back({ "concurrent", "Parallel stand-in compiles by relative path and CWD guard (items = compiles)",
+                          static_cast<double>(stressThreads * stressCompilesPerThread), nullptr, [&]() {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < stressThreads; t++) {
+            threads.emplace_back([&, t]() {
+                ScriptedEngine threadEngine;
+                threadEngine.initialize();
+                for (int i = 0; i < stressCompilesPerThread; i++) {
+                    int a = (t + i) % stressApplications;
+                    CompilerOptions stressOptions;
+                    stressOptions.inputFile = "App.ent";
+                    stressOptions.baseDirectory = stressDirectories[a].u8string();
+                    CompilationResult result = threadEngine.compile(stressOptions);
+
+                    ScopedWorkingDirectory workingDirectory(stressDirectories[a]);
+                    std::ifstream logic("App.apc");
+                    std::string contents((std::istreambuf_iterator<char>(logic)), std::istreambuf_iterator<char>());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    } });
+
+    // A workspace of applications sharing a few dictionaries: a cold graph
+    // parses and hashes everything, a warm one only stats the files
+    constexpr int workspaceApplications = 200;
+    constexpr int workspaceDictionaries = 10;
+    fs::path workspaceDirectory = workDirectory / "workspace";
+    std::vector<std::string> workspaceFiles;
+    for (int d = 0; d < workspaceDictionaries; d++) {
+        fs::create_directories(workspaceDirectory / "shared", ec);
+        std::ofstream(workspaceDirectory / "shared" / ("Dict" + std::to_string(d) + ".dcf"), std::ios::binary)
+            << std::string(4096, 'd');
+    }
+    for (int a = 0; a < workspaceApplications; a++) {
+        fs::path directory = workspaceDirectory / ("app" + std::to_string(a));
+        fs::create_directories(directory, ec);
+        std::ofstream(directory / "App.apc", std::ios::binary) << logicText.substr(0, 4096);
+        std::ofstream(directory / "App.ent", std::ios::binary)
+            << "[Files]\nApplication=App.apc\nDictionary=../shared/Dict" << a % workspaceDictionaries << ".dcf\n";
+        workspaceFiles.push_back((directory / "App.ent").u8string());
+    }
+    fs::path workspaceGraphFile = workspaceDirectory / "workspace.graph";
+    {
+        WorkspaceGraph graph;
+        graph.refresh(workspaceFiles);
+        graph.save(workspaceGraphFile);
+    }
+
+    scenarios.push_back({ "graph-cold", "Workspace graph built from scratch (items = applications)",
+                          static_cast<double>(workspaceApplications), nullptr, [&]() {
+        WorkspaceGraph graph;
+        graph.refresh(workspaceFiles);
+    } });
+
+    scenarios.push_back({ "graph-warm", "Saved workspace graph loaded and refreshed, nothing changed (items = applications)",
+                          static_cast<double>(workspaceApplications), nullptr, [&]() {
+        WorkspaceGraph graph;
+        graph.load(workspaceGraphFile);
+        graph.refresh(workspaceFiles);
+    } });
+
+    // A survey suite: applications sharing three large dictionaries,
+    // compiled as one batch. With the shared cache each dictionary is
+    // parsed once per batch; without it, once per application.
+    constexpr int suiteApplications = 24;
+    constexpr int suiteDictionaries = 3;
+    constexpr int suiteItems = 2000;
+    fs::path suiteDirectory = workDirectory / "suite";
+    fs::create_directories(suiteDirectory / "dicts", ec);
+    for (int d = 0; d < suiteDictionaries; d++) {
+        std::ostringstream dictionary;
+        dictionary << "{\"software\":\"CSPro\",\"version\":8.0,\"fileType\":\"dictionary\",\"name\":\"DICT" << d
+                   << "\",\"levels\":[{\"name\":\"LEVEL1\",\"records\":[{\"name\":\"RECORD1\",\"items\":[";
+        for (int i = 0; i < suiteItems; i++) {
+            dictionary << (i ? "," : "") << "{\"name\":\"ITEM" << i << "\",\"labels\":[{\"text\":\"Item " << i
+                       << "\"}],\"contentType\":\"numeric\",\"start\":" << i * 2 + 1 << ",\"length\":2,"
+                       << "\"valueSets\":[{\"name\":\"ITEM" << i << "_VS1\",\"values\":[";
+            for (int v = 0; v < 6; v++) {
+                dictionary << (v ? "," : "") << "{\"labels\":[{\"text\":\"Value " << v << "\"}],\"pairs\":[{\"from\":" << v << "}]}";
+            }
+            dictionary << "]}]}";
+        }
+        dictionary << "]}]}]}";
+        std::ofstream(suiteDirectory / "dicts" / ("Dict" + std::to_string(d) + ".dcf"), std::ios::binary) << dictionary.str();
+    }
+    std::vector<std::string> suiteFiles;
+    for (int a = 0; a < suiteApplications; a++) {
+        fs::path directory = suiteDirectory / ("app" + std::to_string(a));
+        fs::create_directories(directory, ec);
+        std::ofstream(directory / "App.apc", std::ios::binary) << "PROC GLOBAL\n";
+        std::ofstream entry(directory / "App.ent", std::ios::binary);
+        entry << "[Files]\nApplication=App.apc\n";
+        for (int d = 0; d < suiteDictionaries; d++) {
+            entry << "Dictionary=../dicts/Dict" << d << ".dcf\n";
+        }
+        suiteFiles.push_back((directory / "App.ent").u8string());
+    }
+    SharedObjectCache suiteDictionaryCache;
+    std::atomic<int> dictionaryMismatches(0);
+    auto runSuite = [&](SharedObjectCache* cache) {
+        BatchOptions batchOptions;
+        batchOptions.jobs = 4;
+        BatchCompiler batch([cache]() { return std::make_unique<ScriptedEngine>(0, cache); },
+            [](const std::string& application, WorkerEngine& engine) {
+                CompilerOptions suiteOptions;
+                suiteOptions.inputFile = application;
+                return engine.get()->compile(suiteOptions);
+            });
+        BatchReport report = batch.run(suiteFiles, batchOptions);
+        if (!report.allSucceeded()) dictionaryMismatches++;
+    };
+
+    scenarios.push_back({ "dicts-shared", "Batch of 24 applications, dictionaries parsed once (items = applications)",
+                          static_cast<double>(suiteApplications), [&]() { suiteDictionaryCache.clear(); }, [&]() {
+        runSuite(&suiteDictionaryCache);
+    } });
+
+    scenarios.push_back({ "dicts-unshared", "The same batch parsing each application's dictionaries (items = applications)",
+                          static_cast<double>(suiteApplications), nullptr, [&]() {
+        runSuite(nullptr);
+    } });
+
+    // A generated corpus compiled as one batch; the stand-in engine must
+    // report exactly the markers the generator placed
+    CorpusOptions corpusOptions;
+    corpusOptions.applications = 40;
+    corpusOptions.linesPerApplication = 5000;
+    corpusOptions.procsPerApplication = 200;
+    corpusOptions.errorsPerThousandLines = 0.5;
+    fs::path corpusDirectory = workDirectory / "corpus";
+    CorpusStats corpusStats;
+    std::string corpusError;
+    std::atomic<int> corpusMismatches(0);
+    if (!generateCorpus(corpusDirectory, corpusOptions, corpusStats, corpusError)) {
+        corpusMismatches++;
+    }
+    std::vector<std::string> corpusFiles;
+    for (const auto& application : corpusStats.applications) {
+        corpusFiles.push_back(application.applicationFile);
+    }
+
+    scenarios.push_back({ "corpus-generate", "Regenerating the 40-application corpus, files unchanged (items = lines)",
+                          static_cast<double>(corpusStats.lines), nullptr, [&]() {
+        CorpusStats stats;
+        std::string error;
+        if (!generateCorpus(corpusDirectory, corpusOptions, stats, error) || stats.filesWritten != 0) corpusMismatches++;
+    } });
+
+    scenarios.push_back({ "corpus-batch", "Stand-in batch compile of the corpus on 4 workers (items = lines)",
+                          static_cast<double>(corpusStats.lines), nullptr, [&]() {
+        BatchOptions batchOptions;
+        batchOptions.jobs = 4;
+        BatchCompiler batch([]() { return std::make_unique<ScriptedEngine>(); },
+            [](const std::string& application, WorkerEngine& engine) {
+                CompilerOptions corpusCompileOptions;
+                corpusCompileOptions.inputFile = application;
+                return engine.get()->compile(corpusCompileOptions);
+            });
+        BatchReport report = batch.run(corpusFiles, batchOptions);
+        for (size_t i = 0; i < report.items.size(); i++) {
+            const CompilationResult& result = report.items[i].result;
+            if (result.errorCount != corpusStats.applications[i].errors ||
+                result.warningCount != corpusStats.applications[i].warnings) {
+                corpusMismatches++;
+            }
+        }
+    } });
+
+    // The same batch on 4 build workers in this process, over loopback TCP;
+    // the first iteration mirrors the corpus, later ones only send jobs
+    struct BuildWorkerFarm {
+        std::vector<std::unique_ptr<BuildWorker>> workers;
+        std::vector<std::thread> threads;
+
+        ~BuildWorkerFarm() {
+            for (auto& worker : workers) worker->stop();
+            for (auto& thread : threads) thread.join();
+        }
+    } farm;
+    DistributedOptions distributedOptions;
+    for (int w = 0; w < 4; w++) {
+        auto worker = std::make_unique<BuildWorker>([]() { return std::make_unique<ScriptedEngine>(); },
+                                                    workDirectory / ("worker" + std::to_string(w)));
+        std::string error;
+        if (!worker->listen({ "127.0.0.1", 0 }, error)) {
+            corpusMismatches++;
+            continue;
+        }
+        distributedOptions.workers.push_back({ "127.0.0.1", worker->getPort() });
+        farm.threads.emplace_back([raw = worker.get()]() { raw->serve(); });
+        farm.workers.push_back(std::move(worker));
+    }
+    CompileTimeHistory distributedHistory;
+
+    scenarios.push_back({ "corpus-distributed", "The corpus batch on 4 loopback build workers (items = lines)",
+                          static_cast<double>(corpusStats.lines), nullptr, [&]() {
+        DistributedCompiler distributed(distributedOptions);
+        BatchReport report = distributed.run(corpusFiles, distributedHistory);
+        for (size_t i = 0; i < report.items.size(); i++) {
+            const CompilationResult& result = report.items[i].result;
+            if (result.errorCount != corpusStats.applications[i].errors ||
+                result.warningCount != corpusStats.applications[i].warnings) {
+                corpusMismatches++;
+            }
+        }
+    } });
+
+    // Engines retired every 4 compiles, with a 20 ms start-up: the pool
+    // warms replacements in the background, the inline variant waits for them
+    SyntheticEngineConfig recycledConfig = settings.engine;
+    recycledConfig.diagnosticCount = 200;
+    recycledConfig.initializeDelayMs = 20;
+    EngineFactory recycledFactory = [&]() { return std::make_unique<SyntheticEngine>(recycledConfig); };
+    constexpr int recycleAfter = 4;
+    constexpr int recycledCompiles = 16;
+    EnginePoolOptions poolOptions;
+    poolOptions.size = 2;
+    poolOptions.maxCompilesPerEngine = recycleAfter;
+    EnginePool enginePool(recycledFactory, poolOptions);
+    enginePool.start();
+
+    scenarios.push_back({ "pool-recycle", "EnginePool retiring engines after 4 compiles (items = compiles)",
+                          static_cast<double>(recycledCompiles), nullptr, [&]() {
+        for (int i = 0; i < recycledCompiles; i++) {
+            CompilationResult result = enginePool.compile(options);
+        }
+    } });
+
+    scenarios.push_back({ "recycle-inline", "Recreating the engine in line after 4 compiles (items = compiles)",
+                          static_cast<double>(recycledCompiles), nullptr, [&]() {
+        std::unique_ptr<ICompilerEngine> inlineEngine;
+        for (int i = 0; i < recycledCompiles; i++) {
+            if (i % recycleAfter == 0) {
+                if (inlineEngine) inlineEngine->shutdown();
+                inlineEngine = recycledFactory();
+                inlineEngine->initialize();
+            }
+            CompilationResult result = inlineEngine->compile(options);
+        }
+        inlineEngine->shutdown();
+    } });
+
+    // A burst of edits to one application against a 20 ms compile: the
+    // scheduler keeps only the newest request, the plain variant runs them all
+    SyntheticEngineConfig slowConfig = settings.engine;
+    slowConfig.diagnosticCount = 200;
+    slowConfig.compileDelayMs = 20;
+    SyntheticEngine slowEngine(slowConfig);
+    slowEngine.initialize();
+    CompileScheduler scheduler(slowEngine);
+    constexpr int burstRequests = 10;
+    std::atomic<int> supersedeMismatches(0);
+
+    scenarios.push_back({ "supersede", "CompileScheduler superseding a burst of 10 requests (items = requests)",
+                          static_cast<double>(burstRequests), nullptr, [&]() {
+        std::vector<std::future<CompilationResult>> futures;
+        for (int i = 0; i < burstRequests; i++) {
+            futures.push_back(scheduler.submit(options));
+        }
+        for (int i = 0; i < burstRequests; i++) {
+            CompilationResult result = futures[i].get();
+            if (result.cancelled != (i + 1 < burstRequests)) supersedeMismatches++;
+        }
+    } });
+
+    scenarios.push_back({ "no-supersede", "Running every request of the same burst (items = requests)",
+                          static_cast<double>(burstRequests), nullptr, [&]() {
+        for (int i = 0; i < burstRequests; i++) {
+            CompilationResult result = slowEngine.compile(options);
+        }
+    } });
+
+    scenarios.push_back({ "json", "Compact JSON result document", diagnosticCount, nullptr, [&]() {
+        std::string buffer;
+        writeCompilationResultJson(buffer, compiled, false);
+    } });
+
+    // The same result with one message reworded, against the delta of the
+    // previous output: one "changed" entry instead of the whole list
+    CompilationResult edited = compiled;
+    edited.diagnostics.clear();
+    for (size_t i = 0; i < compiled.diagnostics.size(); i++) {
+        DiagnosticView diag = compiled.diagnostics[i];
+        std::string reworded;
+        if (i == compiled.diagnostics.size() / 2) {
+            reworded = std::string(diag.message) + " (edited)";
+            diag.message = reworded;
+        }
+        edited.diagnostics.push_back(diag);
+    }
+    DiagnosticDeltaTracker deltaTracker(0);
+    deltaTracker.update("bench", compiled);
+    bool deltaEdited = false;
+
+    scenarios.push_back({ "json-delta", "Delta JSON after one diagnostic changed", diagnosticCount, nullptr, [&]() {
+        deltaEdited = !deltaEdited;
+        const CompilationResult& result = deltaEdited ? edited : compiled;
+        DiagnosticDelta delta = deltaTracker.update("bench", result);
+        std::string buffer;
+        JsonWriter writer(buffer);
+        writer.beginObject();
+        writeCompilationDeltaMembers(writer, result, delta);
+        writer.endObject();
+    } });
+
+    // Binary encoding against the JSON round trip the cache used to make
+    std::string encodedResult;
+    encodeCompilationResult(encodedResult, compiled);
+    std::string jsonResult;
+    writeCompilationResultJson(jsonResult, compiled, false);
+
+    scenarios.push_back({ "binary-encode", "Binary result encoding with checksum", diagnosticCount, nullptr, [&]() {
+        std::string buffer;
+        encodeCompilationResult(buffer, compiled);
+    } });
+
+    scenarios.push_back({ "binary-view", "Validating and reading every diagnostic in place", diagnosticCount, nullptr, [&]() {
+        EncodedResultView view;
+        view.attach(encodedResult);
+        size_t bytes = 0;
+        for (size_t i = 0; i < view.diagnosticCount(); i++) {
+            bytes += view.diagnostic(i).message.size();
+        }
+        if (bytes == 0 && view.diagnosticCount() > 0) std::abort();
+    } });
+
+    scenarios.push_back({ "binary-decode", "Binary result decoded into a CompilationResult", diagnosticCount, nullptr, [&]() {
+        CompilationResult result;
+        decodeCompilationResult(encodedResult, result);
+    } });
+
+    scenarios.push_back({ "json-decode", "JSON result parsed into a CompilationResult", diagnosticCount, nullptr, [&]() {
+        JsonValue document = JsonValue::parse(jsonResult);
+        CompilationResult result;
+        result.success = document["success"].asBool();
+        result.errorCount = document["errorCount"].asInt();
+        result.warningCount = document["warningCount"].asInt();
+        const JsonValue& errors = document["errors"];
+        result.diagnostics.reserve(errors.size());
+        for (const auto& item : errors.items()) {
+            result.diagnostics.push_back({ item["file"].asString(), item["line"].asInt(), item["column"].asInt(),
+                                           item["message"].asString(), item["procName"].asString(),
+                                           item["severity"].asString() == "error" ? DiagnosticMessage::Severity::Error
+                                                                                  : DiagnosticMessage::Severity::Warning,
+                                           item["messageNumber"].asInt() });
+        }
+    } });
+
+    // A second checkout of the same sources: its key matches the first's,
+    // so the compiled result comes out of the shared store
+    fs::path storeDirectory = workDirectory / "store";
+    std::string storeApplications[2];
+    for (int c = 0; c < 2; c++) {
+        fs::path directory = workDirectory / ("checkout" + std::to_string(c));
+        fs::create_directories(directory, ec);
+        std::ofstream(directory / "App.apc", std::ios::binary) << logicText;
+        std::ofstream(directory / "App.ent", std::ios::binary) << "[Files]\nApplication=App.apc\n";
+        storeApplications[c] = (directory / "App.ent").u8string();
+    }
+    ResultStore resultStore(storeDirectory, 1024ull * 1024 * 1024);
+    int storeMismatches = 0;
+    std::string storeKey;
+    ResultStore::computeKey(storeApplications[0], options, "bench", storeKey);
+    resultStore.insert(storeKey, storeApplications[0], compiled);
+
+    scenarios.push_back({ "store-lookup", "Key of the second checkout and its result read from the store",
+                          diagnosticCount, nullptr, [&]() {
+        std::string key;
+        CompilationResult result;
+        if (!ResultStore::computeKey(storeApplications[1], options, "bench", key) ||
+            !resultStore.lookup(key, storeApplications[1], result) || result.diagnostics.size() != compiled.diagnostics.size()) {
+            storeMismatches++;
+        }
+    } });
+
+    scenarios.push_back({ "store-insert", "Result of the first checkout added to the store", diagnosticCount, nullptr, [&]() {
+        if (!resultStore.insert(storeKey, storeApplications[0], compiled)) {
+            storeMismatches++;
+        }
+    } });
+
+    scenarios.push_back({ "pipeline", "Compile, reports and JSON together", diagnosticCount, nullptr, [&]() {
+        CompilationResult result = engine.compile(options);
+        ReportWriter::writeReports(applicationFile, result);
+        std::string buffer;
+        writeCompilationResultJson(buffer, result, false);
+    } });
+
+    // The real engine, when this build has one
+    std::unique_ptr<ICompilerEngine> realEngine;
+    std::string realEngineSkipped;
+    if (!settings.fixture.empty()) {
+        realEngine = createCompilerEngine();
+        if (!realEngine || !realEngine->initialize()) {
+            realEngineSkipped = "CSPro engine unavailable in this build";
+            realEngine.reset();
+        }
+    }
+
+    scenarios.push_back({ "fixture", "Real engine compile of --fixture", 0, nullptr, [&]() {
+        CompilerOptions fixtureOptions;
+        fixtureOptions.inputFile = settings.fixture;
+        fixtureOptions.checkSyntaxOnly = true;
+        CompilationResult result = realEngine->compile(fixtureOptions);
+    } });
+
+    if (listOnly) {
+        for (const auto& scenario : scenarios) {
+            std::cout << std::left << std::setw(16) << scenario.name << scenario.description << "\n";
+        }
+        fs::remove_all(workDirectory, ec);
+        return 0;
+    }
+
+    std::vector<ScenarioResult> results;
+    for (const auto& scenario : scenarios) {
+        if (!settings.wants(scenario.name)) {
+            continue;
+        }
+
+        if (scenario.name == "fixture") {
+            if (settings.fixture.empty()) {
+                continue;
+            }
+            if (!realEngine) {
+                ScenarioResult skipped;
+                skipped.name = scenario.name;
+                skipped.description = scenario.description;
+                skipped.skippedReason = realEngineSkipped;
+                results.push_back(skipped);
+                continue;
+            }
+        }
+
+        results.push_back(runScenario(scenario, settings));
+    }
+
+    if (realEngine) {
+        realEngine->shutdown();
+    }
+    enginePool.shutdown();
+    scheduler.shutdown();
+    slowEngine.shutdown();
+    fs::remove_all(workDirectory, ec);
+
+    if (settings.jsonOutput) {
+        printJson(results, settings);
+    } else {
+        printTable(results, settings);
+    }
+
+    if (corpusMismatches > 0) {
+        std::cerr << "Error: generated corpus compiled to unexpected diagnostics: " << corpusMismatches.load() << " mismatches" << std::endl;
+        return 1;
+    }
+    if (dictionaryMismatches > 0) {
+        std::cerr << "Error: suite batches with shared dictionaries failed: " << dictionaryMismatches.load() << " times" << std::endl;
+        return 1;
+    }
+    if (storeMismatches > 0) {
+        std::cerr << "Error: result store lookups or inserts failed: " << storeMismatches << " times" << std::endl;
+        return 1;
+    }
+    if (supersedeMismatches > 0) {
+        std::cerr << "Error: superseded compiles answered wrongly: " << supersedeMismatches.load() << " mismatches" << std::endl;
+        return 1;
+    }
+    return 0;
+}
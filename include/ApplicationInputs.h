@@ -0,0 +1,30 @@
+/*
+ * ApplicationInputs.h - Discovery of the files an application compiles from
+ *
+ * Reads an application file (.ent/.bch), or a .pff pointing at one, and
+ * lists every file that feeds the compile: the application file itself,
+ * dictionaries, forms, logic, message and question text files.
+ *
+ * Both the CSPro 8 JSON application format and the older INI-style
+ * format ("File=..." entries) are understood.
+ */
+
+#ifndef CSPRO_APPLICATION_INPUTS_H
+#define CSPRO_APPLICATION_INPUTS_H
+
+#include <filesystem>
+#include <vector>
+
+namespace CSProCompiler {
+
+// Returns absolute, normalized paths of all existing inputs, the
+// application file first, without duplicates. Unreadable or missing
+// references are skipped.
+std::vector<std::filesystem::path> discoverApplicationInputs(const std::filesystem::path& applicationFile);
+
+// True for the file extensions that can contribute to a compile
+bool isApplicationInputExtension(const std::filesystem::path& path);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_APPLICATION_INPUTS_H
@@ -0,0 +1,117 @@
+/*
+ * BatchCompiler.h - Parallel compilation of many applications
+ *
+ * Applications are scheduled across a work-stealing pool of worker
+ * threads. Each worker owns its own ICompilerEngine, created on first use
+ * so that workers serving only cached results never initialize one. When
+ * the engine cannot run concurrently in one process, each worker instead
+ * drives a child CSProCompile process per application.
+ */
+
+#ifndef CSPRO_BATCH_COMPILER_H
+#define CSPRO_BATCH_COMPILER_H
+
+#include "CompilerInterface.h"
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CSProCompiler {
+
+using EngineFactory = std::function<std::unique_ptr<ICompilerEngine>()>;
+
+// An engine created and initialized on first use, shut down on destruction
+class WorkerEngine {
+public:
+    explicit WorkerEngine(EngineFactory factory);
+    ~WorkerEngine();
+
+    WorkerEngine(const WorkerEngine&) = delete;
+    WorkerEngine& operator=(const WorkerEngine&) = delete;
+
+    // Returns nullptr if the engine failed to initialize
+    ICompilerEngine* get();
+
+    bool isCreated() const { return m_engine != nullptr; }
+
+private:
+    EngineFactory m_factory;
+    std::unique_ptr<ICompilerEngine> m_engine;
+    bool m_initialized;
+};
+
+// Compiles one application with the worker's engine
+using CompileJob = std::function<CompilationResult(const std::string& inputFile, WorkerEngine& engine)>;
+
+struct BatchOptions {
+    int jobs;
+    bool useProcesses;
+    std::string executablePath;                 // Used to launch worker processes
+    std::vector<std::string> childArguments;    // Extra arguments passed to each worker process
+
+    BatchOptions()
+        : jobs(1)
+        , useProcesses(false)
+    {}
+};
+
+struct BatchItemResult {
+    std::string inputFile;
+    CompilationResult result;
+    double wallTimeMs;
+    int worker;
+
+    BatchItemResult()
+        : wallTimeMs(0.0)
+        , worker(0)
+    {}
+};
+
+struct BatchReport {
+    std::vector<BatchItemResult> items;     // In input order
+    int jobs;
+    double totalWallTimeMs;                 // Elapsed time for the whole batch
+    double cumulativeWallTimeMs;            // Sum of per-application wall times
+
+    BatchReport()
+        : jobs(1)
+        , totalWallTimeMs(0.0)
+        , cumulativeWallTimeMs(0.0)
+    {}
+
+    bool allSucceeded() const;
+    int getErrorCount() const;
+    int getWarningCount() const;
+
+    double getSpeedup() const {
+        return totalWallTimeMs > 0.0 ? cumulativeWallTimeMs / totalWallTimeMs : 1.0;
+    }
+};
+
+class BatchCompiler {
+public:
+    BatchCompiler(EngineFactory factory, CompileJob job);
+
+    BatchReport run(const std::vector<std::string>& inputFiles, const BatchOptions& options);
+
+    // Runs one application in a child process and reads back its --binary-result output
+    static CompilationResult compileInProcess(const std::string& inputFile, const BatchOptions& options);
+
+private:
+    EngineFactory m_factory;
+    CompileJob m_job;
+};
+
+// Expand files, directories (searched recursively) and glob patterns (*, ?
+// and ** path components) into a sorted, duplicate-free list of application
+// files; directories and globs yield only .ent and .bch applications
+std::vector<std::string> expandInputPatterns(const std::vector<std::string>& patterns);
+
+// Aggregated JSON report for a batch run
+void writeBatchReportJson(std::ostream& out, const BatchReport& report);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_BATCH_COMPILER_H
@@ -0,0 +1,101 @@
+/*
+ * CompileScheduler.h - Asynchronous compiles with request supersession
+ *
+ * An editor asks for a compile on every pause in typing, far faster than
+ * an application compiles. Only the newest request for an application
+ * matters, so submit() supersedes older ones for the same application:
+ * a request still queued is answered at once with a cancelled result,
+ * and one already running has its cancellation token set, so the engine
+ * stops at its next phase boundary.
+ *
+ * Requests start in submission order on the scheduler's own threads: one,
+ * unless the compile function can run several compiles at once. Requests
+ * are told apart by their resolved input file.
+ */
+
+#ifndef CSPRO_COMPILE_SCHEDULER_H
+#define CSPRO_COMPILE_SCHEDULER_H
+
+#include "CompilerInterface.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct CompileSchedulerStats {
+    long long submitted;
+    long long completed;        // Ran to the end, cancelled or not
+    long long supersededQueued; // Answered without running
+    long long cancelledRunning; // Told to stop while running
+
+    CompileSchedulerStats()
+        : submitted(0)
+        , completed(0)
+        , supersededQueued(0)
+        , cancelledRunning(0)
+    {}
+};
+
+class CompileScheduler {
+public:
+    using CompileFunction = std::function<CompilationResult(const CompilerOptions&)>;
+
+    explicit CompileScheduler(ICompilerEngine& engine);
+
+    // workers > 1 only for a compile function that is safe to call from
+    // several threads at once (an EnginePool of concurrent engines, say)
+    explicit CompileScheduler(CompileFunction compile, int workers = 1);
+    ~CompileScheduler();
+
+    CompileScheduler(const CompileScheduler&) = delete;
+    CompileScheduler& operator=(const CompileScheduler&) = delete;
+
+    // Queues a compile, superseding those of the same application; the
+    // token in options is replaced by the scheduler's own
+    std::future<CompilationResult> submit(CompilerOptions options);
+
+    // Supersedes the application's queued and running compiles without
+    // queuing another; inputFile is resolved as submit() resolves it
+    void cancel(const std::string& inputFile);
+
+    // Cancels every queued and running compile and stops the thread
+    void shutdown();
+
+    CompileSchedulerStats getStats() const;
+
+private:
+    struct Request {
+        std::string application;
+        CompilerOptions options;
+        CancellationSource cancellation;
+        std::promise<CompilationResult> promise;
+    };
+
+    CompileFunction m_compile;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work;
+    std::deque<std::unique_ptr<Request>> m_queue;
+    std::vector<Request*> m_running;
+    bool m_stopping;
+    CompileSchedulerStats m_stats;
+    std::vector<std::thread> m_workers;
+
+    void run();
+
+    // Caller holds m_mutex; moves the application's queued requests into
+    // superseded and cancels its running ones
+    void supersede(const std::string& application, std::deque<std::unique_ptr<Request>>& superseded);
+    static CompilationResult cancelledResult();
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_COMPILE_SCHEDULER_H
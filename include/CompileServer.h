@@ -0,0 +1,118 @@
+/*
+ * CompileServer.h - Persistent compile server
+ *
+ * Keeps one initialized ICompilerEngine warm and serves compile requests
+ * as line-delimited JSON, either over stdin/stdout or a local Unix socket.
+ *
+ * Request (one per line):
+ *   {"id": 1, "inputFile": "app.ent", "checkOnly": false, "verbose": false}
+ *   {"id": 2, "inputFile": "app.ent", "delta": true}  (only changes since the last delta; "full": true to resync)
+ *   {"id": 3, "command": "stats"}         (includes "pool" when serving from an EnginePool)
+ *   {"command": "shutdown"}
+ *
+ * A relative inputFile is resolved against the request's optional
+ * "baseDirectory", else the directory the server was started in.
+ *
+ * Delta state belongs to the stream or connection: each client sees the
+ * changes since its own last delta, and a new connection starts with a
+ * full snapshot.
+ *
+ * Requests on one stream or connection are answered in order. On a
+ * socket, connections are served side by side when the pool has several
+ * engines that support concurrent compiles, else one at a time.
+ *
+ * Compiles go through a CompileScheduler, so a request for an application
+ * supersedes any other connection's queued or running compile of it: that
+ * request is answered with "cancelled": true and no diagnostics.
+ *
+ * Response (one per line):
+ *   {"id": 1, "success": true, "errorCount": 0, "warningCount": 0,
+ *    "compilationTime": 0.25, "latencyMs": 251.3, "errors": [...]}
+ */
+
+#ifndef CSPRO_COMPILE_SERVER_H
+#define CSPRO_COMPILE_SERVER_H
+
+#include "CompilerInterface.h"
+#include "DiagnosticDelta.h"
+#include <atomic>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace CSProCompiler {
+
+class CompileScheduler;
+class EnginePool;
+class JsonValue;
+
+// Running totals for the requests served by one server instance
+struct ServerStats {
+    long long requestCount;
+    long long failedRequestCount;
+    double totalLatencyMs;
+    double maxLatencyMs;
+    double lastLatencyMs;
+
+    ServerStats()
+        : requestCount(0)
+        , failedRequestCount(0)
+        , totalLatencyMs(0.0)
+        , maxLatencyMs(0.0)
+        , lastLatencyMs(0.0)
+    {}
+
+    double getMeanLatencyMs() const {
+        return requestCount > 0 ? totalLatencyMs / requestCount : 0.0;
+    }
+};
+
+class CompileServer {
+public:
+    // The engine is borrowed, not owned; any ICompilerEngine works,
+    // which lets a stand-in engine drive the server on Linux
+    explicit CompileServer(ICompilerEngine& engine);
+
+    // Serves from a pool of pre-warmed, recycled engines instead (see EnginePool.h)
+    explicit CompileServer(EnginePool& pool);
+    ~CompileServer();
+
+    void setVerbose(bool verbose) { m_verbose = verbose; }
+
+    // Initialize the engine (or pool) once; requests never pay this cost
+    bool start();
+
+    // Serve requests from a stream until EOF or a shutdown command
+    int serveStream(std::istream& in, std::ostream& out);
+
+    // Serve requests on a Unix domain socket until a shutdown command
+    int serveUnixSocket(const std::string& socketPath);
+
+    // Handle one request line and return the response line (without
+    // newline); deltas is the calling client's own. Safe to call from
+    // several threads with different trackers.
+    std::string handleRequest(const std::string& requestLine, DiagnosticDeltaTracker& deltas);
+
+    bool isShutdownRequested() const { return m_shutdownRequested; }
+    ServerStats getStats() const;
+
+private:
+    ICompilerEngine* m_engine;
+    EnginePool* m_pool;
+    bool m_started;
+    bool m_verbose;
+    std::atomic<bool> m_shutdownRequested;
+
+    std::unique_ptr<CompileScheduler> m_scheduler;  // Created by start()
+
+    mutable std::mutex m_mutex;         // Guards m_started, m_scheduler and m_stats
+    ServerStats m_stats;
+
+    std::string formatStats(const JsonValue& id) const;
+    void recordLatency(double latencyMs, bool failed);
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_COMPILE_SERVER_H
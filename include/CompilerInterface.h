@@ -13,7 +13,16 @@
 #ifndef CSPRO_COMPILER_INTERFACE_H
 #define CSPRO_COMPILER_INTERFACE_H
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <memory>
 
@@ -31,6 +40,7 @@ struct DiagnosticMessage {
         Warning,
         Info
     } severity;
+    int messageNumber = 0;  // CSPro system message number (see CSProDesigner.mgf), 0 when unknown
 
     std::string getSeverityString() const {
         switch (severity) {
@@ -42,13 +52,174 @@ struct DiagnosticMessage {
     }
 };
 
+// Non-owning view of a diagnostic, as stored in a DiagnosticList or
+// borrowed from a DiagnosticMessage; valid while its source is unchanged
+struct DiagnosticView {
+    std::string_view file;
+    int line;
+    int column;
+    std::string_view message;
+    std::string_view procName;
+    DiagnosticMessage::Severity severity;
+    int messageNumber;
+
+    DiagnosticView(std::string_view file_, int line_, int column_, std::string_view message_,
+                   std::string_view procName_, DiagnosticMessage::Severity severity_, int messageNumber_ = 0)
+        : file(file_), line(line_), column(column_), message(message_), procName(procName_), severity(severity_)
+        , messageNumber(messageNumber_)
+    {}
+
+    DiagnosticView(const DiagnosticMessage& diag)
+        : DiagnosticView(diag.file, diag.line, diag.column, diag.message, diag.procName, diag.severity, diag.messageNumber)
+    {}
+
+    std::string getSeverityString() const {
+        return DiagnosticMessage{ {}, 0, 0, {}, {}, severity }.getSeverityString();
+    }
+
+    DiagnosticMessage toMessage() const {
+        return { std::string(file), line, column, std::string(message), std::string(procName), severity, messageNumber };
+    }
+};
+
+// Compact diagnostic storage. File and procedure names repeat across
+// thousands of messages, so they are interned once and referenced by id;
+// message text lives in a single arena. Each entry is a fixed-size record,
+// which keeps the whole list a handful of allocations that are cheap to copy.
+class DiagnosticList {
+public:
+    // Dereferencing builds a DiagnosticView by value, which only an input
+    // iterator may do; index with operator[] for random access
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = DiagnosticView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = DiagnosticView;
+
+        const_iterator(const DiagnosticList* list, size_t index) : m_list(list), m_index(index) {}
+
+        DiagnosticView operator*() const { return (*m_list)[m_index]; }
+        const_iterator& operator++() { m_index++; return *this; }
+        const_iterator operator++(int) { const_iterator previous = *this; m_index++; return previous; }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+        }
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+
+    private:
+        const DiagnosticList* m_list;
+        size_t m_index;
+    };
+
+    void push_back(const DiagnosticView& diag);
+
+    // Reserve room for count diagnostics averaging textBytes of message text
+    void reserve(size_t count, size_t textBytes = 64);
+    void clear();
+
+    size_t size() const { return m_records.size(); }
+    bool empty() const { return m_records.empty(); }
+
+    DiagnosticView operator[](size_t index) const;
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_records.size()); }
+
+    size_t getNameCount() const { return m_nameSpans.size(); }
+
+    // Bytes held by the list, including unused reserved capacity
+    size_t getMemoryUsage() const;
+
+private:
+    struct Record {
+        uint32_t fileId;
+        uint32_t procNameId;
+        uint32_t messageOffset;
+        uint32_t messageLength;
+        int32_t line;
+        int32_t column;
+        int32_t messageNumber;
+        DiagnosticMessage::Severity severity;
+    };
+
+    struct Span {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::vector<Record> m_records;
+    std::string m_messageText;
+    std::string m_nameText;
+    std::vector<Span> m_nameSpans;
+    std::vector<uint32_t> m_nameBuckets;    // Open-addressed hash index into m_nameSpans, 0 = empty
+
+    uint32_t intern(std::string_view name);
+    std::string_view getName(uint32_t id) const;
+    void rehashNames(size_t bucketCount);
+};
+
+// Lets whoever started a compile ask it to stop early. Engines check the
+// token between phases and return a result with cancelled set; a
+// default-constructed token is never cancelled.
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    bool isCancelled() const { return m_flag && m_flag->load(std::memory_order_relaxed); }
+
+    // Sleeps for up to duration, in short slices; false if cancelled meanwhile.
+    // For engines that simulate work.
+    bool sleepFor(std::chrono::steady_clock::duration duration) const {
+        auto until = std::chrono::steady_clock::now() + duration;
+        while (!isCancelled()) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= until) return true;
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(until - now, std::chrono::milliseconds(2)));
+        }
+        return false;
+    }
+
+private:
+    friend class CancellationSource;
+
+    explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> flag) : m_flag(std::move(flag)) {}
+
+    std::shared_ptr<const std::atomic<bool>> m_flag;
+};
+
+class CancellationSource {
+public:
+    CancellationSource() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    CancellationToken token() const { return CancellationToken(m_flag); }
+    void cancel() { m_flag->store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_flag->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
 // Compilation options
 struct CompilerOptions {
     std::string inputFile;
     std::string outputDirectory;
+
+    // A relative inputFile is taken against this rather than the current
+    // directory; empty means the directory the process started in (see
+    // WorkingDirectory.h)
+    std::string baseDirectory;
     bool checkSyntaxOnly;
     bool verboseOutput;
     bool generateDebugInfo;
+
+    // Unsaved editor buffers, keyed by absolute UTF-8 path, to compile in
+    // place of the files on disk. Only honored by engines that report
+    // supportsSourceOverlays(); results compiled with overlays must not be cached.
+    std::map<std::string, std::string> sourceOverlays;
+
+    CancellationToken cancellation;
     
     CompilerOptions() 
         : checkSyntaxOnly(false)
@@ -57,23 +228,55 @@ struct CompilerOptions {
     {}
 };
 
+// A timed stage of a compile. Times are milliseconds on the process-wide
+// trace clock (see PhaseTiming.h); parent is the index of the enclosing
+// span in the same list, or -1 at the top level.
+struct PhaseSpan {
+    std::string name;
+    double startMs;
+    double durationMs;
+    int parent;
+};
+
 // Compilation result
 struct CompilationResult {
     bool success;
     int errorCount;
     int warningCount;
-    std::vector<DiagnosticMessage> diagnostics;
+    DiagnosticList diagnostics;
     std::string compiledOutput;
     double compilationTimeMs;
+    bool fromCache;  // Returned from the result cache without running the engine
+    bool cancelled;  // Stopped early through CompilerOptions::cancellation; diagnostics are incomplete
+    std::vector<PhaseSpan> phases;  // In start order, parents before children
 
     CompilationResult() 
         : success(false)
         , errorCount(0)
         , warningCount(0)
         , compilationTimeMs(0.0) 
+        , fromCache(false)
+        , cancelled(false)
     {}
 };
 
+// A PROC of a logic file, the granularity of incremental compiles (see IncrementalCompiler.h)
+struct LogicUnit {
+    std::string file;       // Absolute UTF-8 path of the logic file
+    std::string name;       // PROC name, uppercased; empty for text before the first PROC
+    int startLine;          // 1-based line of the PROC keyword
+    int lineCount;
+    uint64_t hash;          // Of the unit's text
+};
+
+// Receives diagnostics one at a time, as the engine converts them
+class IDiagnosticSink {
+public:
+    virtual ~IDiagnosticSink() = default;
+
+    virtual void onDiagnostic(const DiagnosticView& diagnostic) = 0;
+};
+
 // Main compiler interface class
 class ICompilerEngine {
 public:
@@ -85,14 +288,51 @@ public:
     // Compile a CSPro application
     virtual CompilationResult compile(const CompilerOptions& options) = 0;
 
+    // Compile, handing each diagnostic to the sink as soon as it is produced
+    // instead of collecting it; the returned result has counts but no diagnostics.
+    // The default implementation replays the buffered diagnostics.
+    virtual CompilationResult compileStreaming(const CompilerOptions& options, IDiagnosticSink& sink) {
+        CompilationResult result = compile(options);
+        for (const auto& diagnostic : result.diagnostics) {
+            sink.onDiagnostic(diagnostic);
+        }
+        result.diagnostics.clear();
+        return result;
+    }
+
     // Clean up resources
     virtual void shutdown() = 0;
+
+    // Whether separate engine instances may compile at the same time on
+    // different threads of one process
+    virtual bool supportsConcurrentCompiles() const { return false; }
+
+    // Whether CompilerOptions::sourceOverlays are read instead of the files on disk
+    virtual bool supportsSourceOverlays() const { return false; }
+
+    // Whether compileUnits can compile part of an application
+    virtual bool supportsUnitCompiles() const { return false; }
+
+    // Compile only the given units of the application and report just their
+    // diagnostics. The default compiles the whole application.
+    virtual CompilationResult compileUnits(const CompilerOptions& options, const std::vector<LogicUnit>& units) {
+        (void)units;
+        return compile(options);
+    }
 };
 
 // Factory function to create compiler engine
 // Implementation depends on whether we're linking to real CSPro libraries
 std::unique_ptr<ICompilerEngine> createCompilerEngine();
 
+// Version of this tool, from the CMake project
+const char* toolVersion();
+
+// Names the engine createCompilerEngine() makes, with the SDK version it
+// was built against. Results from different engines must never be mixed,
+// so the result cache and store put this in their keys.
+std::string compilerEngineIdentity();
+
 /*
  * INTEGRATION NOTES FOR LINKING TO CSPRO:
  * 
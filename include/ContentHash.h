@@ -0,0 +1,34 @@
+/*
+ * ContentHash.h - Fast non-cryptographic content hashing
+ *
+ * XXH64 (xxHash, 64-bit variant) over memory buffers and files. Used to
+ * key cached compilation results on the bytes of the application inputs.
+ */
+
+#ifndef CSPRO_CONTENT_HASH_H
+#define CSPRO_CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace CSProCompiler {
+
+// XXH64 of a memory buffer
+uint64_t hash64(const void* data, size_t length, uint64_t seed = 0);
+
+inline uint64_t hash64(std::string_view text, uint64_t seed = 0) {
+    return hash64(text.data(), text.size(), seed);
+}
+
+// XXH64 of a file's contents; returns false if the file cannot be read
+bool hashFile(const std::filesystem::path& path, uint64_t& hash);
+
+// Fixed-width lowercase hexadecimal form of a hash (16 characters)
+std::string hashToHex(uint64_t hash);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_CONTENT_HASH_H
@@ -0,0 +1,83 @@
+/*
+ * CorpusGenerator.h - Reproducible synthetic CSPro applications
+ *
+ * Scale testing needs applications the size of the largest surveys,
+ * and real survey code cannot leave its owners. The generator writes a
+ * workspace of made-up applications from a seed:
+ *
+ *   dicts/SharedNN.dcf             dictionaries shared between applications
+ *   appNNNN/AppNNNN.ent            CSPro 8 JSON application
+ *   appNNNN/AppNNNN.dcf            the application's own dictionary, one item per PROC
+ *   appNNNN/AppNNNN.apc            logic: PROC GLOBAL, then one PROC per item
+ *
+ * Application n uses fanOut consecutive shared dictionaries starting at
+ * n modulo their count. Logic lines carry "@warning" and "@error" markers
+ * at the requested densities, so ScriptedEngine reports a known number of
+ * diagnostics for every application.
+ *
+ * The same seed and options always give the same bytes, and each
+ * application depends only on the seed and its index: a larger corpus
+ * starts with the applications of a smaller one. Files whose contents
+ * are unchanged are not rewritten, so caches keyed on them stay warm.
+ */
+
+#ifndef CSPRO_CORPUS_GENERATOR_H
+#define CSPRO_CORPUS_GENERATOR_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct CorpusOptions {
+    uint64_t seed;
+    int applications;
+    int procsPerApplication;
+    int linesPerApplication;        // Logic lines, PROC headers included
+    double warningsPerThousandLines;
+    double errorsPerThousandLines;
+    int sharedDictionaries;
+    int fanOut;                     // Shared dictionaries per application
+    int itemsPerDictionary;         // Of each shared dictionary
+
+    CorpusOptions()
+        : seed(1)
+        , applications(1)
+        , procsPerApplication(100)
+        , linesPerApplication(2000)
+        , warningsPerThousandLines(5.0)
+        , errorsPerThousandLines(0.0)
+        , sharedDictionaries(4)
+        , fanOut(2)
+        , itemsPerDictionary(500)
+    {}
+};
+
+struct CorpusApplication {
+    std::string applicationFile;
+    int lines = 0;
+    int procs = 0;
+    int warnings = 0;               // Markers ScriptedEngine will report
+    int errors = 0;
+};
+
+struct CorpusStats {
+    std::vector<CorpusApplication> applications;
+    long long lines = 0;
+    long long warnings = 0;
+    long long errors = 0;
+    uint64_t bytes = 0;             // Of every generated file
+    int filesWritten = 0;
+    int filesUnchanged = 0;
+};
+
+// Writes the corpus under directory; false with a message in error when
+// the options are out of range or a file cannot be written
+bool generateCorpus(const std::filesystem::path& directory, const CorpusOptions& options,
+                    CorpusStats& stats, std::string& error);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_CORPUS_GENERATOR_H
@@ -0,0 +1,63 @@
+/*
+ * DiagnosticConverter.h - Logic::ParserMessage to DiagnosticMessage conversion
+ *
+ * The engine describes each parser message through ParserMessageFields,
+ * views onto the SDK object's wide strings, so the conversion itself does
+ * not depend on the CSPro headers. Text is encoded straight into the
+ * destination strings as UTF-8, reusing their capacity, and the names
+ * repeated across consecutive messages are converted only once.
+ */
+
+#ifndef CSPRO_DIAGNOSTIC_CONVERTER_H
+#define CSPRO_DIAGNOSTIC_CONVERTER_H
+
+#include "CompilerInterface.h"
+#include <string>
+#include <string_view>
+
+namespace CSProCompiler {
+
+// Views onto one parser message; valid only for the duration of convert()
+struct ParserMessageFields {
+    std::string_view formattedText;         // ParserMessage::what()
+    std::wstring_view messageText;
+    std::wstring_view procName;
+    std::wstring_view compilationUnitName;
+    int line;
+    int column;
+    int messageNumber;
+    DiagnosticMessage::Severity severity;
+
+    ParserMessageFields()
+        : line(0)
+        , column(0)
+        , messageNumber(0)
+        , severity(DiagnosticMessage::Severity::Error)
+    {}
+};
+
+class DiagnosticConverter {
+public:
+    explicit DiagnosticConverter(std::string inputFile);
+
+    // Overwrites every field of diag; its string buffers are reused
+    void convert(const ParserMessageFields& fields, DiagnosticMessage& diag);
+
+private:
+    // Remembers the last wide name and its UTF-8 form
+    struct NameCache {
+        std::wstring wide;
+        std::string utf8;
+        bool valid = false;
+
+        const std::string& get(std::wstring_view name);
+    };
+
+    std::string m_inputFile;
+    NameCache m_unitNames;
+    NameCache m_procNames;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_DIAGNOSTIC_CONVERTER_H
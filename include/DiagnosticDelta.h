@@ -0,0 +1,80 @@
+/*
+ * DiagnosticDelta.h - Differences between consecutive compiles' diagnostics
+ *
+ * A rebuild of a large application usually changes a handful of its
+ * thousands of diagnostics, yet the full list is serialized, sent and
+ * diffed by the editor every time. The tracker remembers, per application,
+ * the identity and content digest of each diagnostic of the last compile
+ * and reports only what was added, changed or removed since.
+ *
+ * A diagnostic's identity is the XXH64 of its file, PROC, line, column and
+ * message number (the text too for unnumbered messages); a second
+ * diagnostic with the same identity in one compile is told apart by its
+ * occurrence. Its content digest covers the text and severity, so a
+ * diagnostic that keeps its place but changes wording is "changed".
+ *
+ * Outputs of one application are numbered; every snapshotInterval-th is a
+ * full snapshot, so a client that missed one resynchronizes. The state can
+ * be saved to a small binary file for tools that run once per compile.
+ */
+
+#ifndef CSPRO_DIAGNOSTIC_DELTA_H
+#define CSPRO_DIAGNOSTIC_DELTA_H
+
+#include "CompilerInterface.h"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct DiagnosticDelta {
+    uint64_t sequence;                  // Of this output for the application, from 1
+    bool full;                          // A snapshot: replace everything held for the application
+    std::vector<uint64_t> identities;   // Of each diagnostic of the result
+    std::vector<size_t> added;          // Indexes into the result's diagnostics; empty when full
+    std::vector<size_t> changed;
+    std::vector<uint64_t> removed;      // Identities no longer reported
+
+    DiagnosticDelta()
+        : sequence(0)
+        , full(true)
+    {}
+};
+
+class DiagnosticDeltaTracker {
+public:
+    // A full snapshot every snapshotInterval outputs; 0 for only the first
+    explicit DiagnosticDeltaTracker(int snapshotInterval = 50);
+
+    // Compares the result with the application's previous one and
+    // remembers it; forceFull asks for a snapshot now
+    DiagnosticDelta update(const std::string& application, const CompilationResult& result, bool forceFull = false);
+
+    void forget(const std::string& application) { m_applications.erase(application); }
+
+    // A missing or unreadable state file starts from nothing
+    bool load(const std::filesystem::path& stateFile);
+    bool save(const std::filesystem::path& stateFile) const;
+
+private:
+    struct Entry {
+        uint64_t identity;
+        uint64_t content;
+    };
+
+    struct ApplicationState {
+        uint64_t sequence = 0;
+        uint32_t sinceSnapshot = 0;
+        std::vector<Entry> entries;     // Sorted by identity
+    };
+
+    int m_snapshotInterval;
+    std::map<std::string, ApplicationState> m_applications;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_DIAGNOSTIC_DELTA_H
@@ -0,0 +1,164 @@
+/*
+ * DistributedCompiler.h - Batch compilation sharded across build workers
+ *
+ * One machine's cores bound even a fully parallel batch. Build workers
+ * (CSProCompile --worker <port>) each keep a mirror of the coordinator's
+ * sources; the coordinator (CSProCompile --workers <host:port,...>)
+ * connects to every worker and hands out one application at a time,
+ * longest expected compile first, to whichever worker is free.
+ *
+ * Inputs travel by content: a job lists each input's path, relative to
+ * the folder that holds every application of the batch, with its XXH64
+ * digest. The worker answers with the digests it has never seen, only
+ * those files are sent, and the worker keeps them in a blob directory
+ * for later jobs and later coordinators. The result comes back in the
+ * ResultCodec encoding, with the compiled .pen when there is one, and
+ * its paths are re-rooted at the coordinator's folder.
+ *
+ * A worker that drops its connection or misses the result timeout is
+ * given up on, and its application goes back to the queue for another
+ * worker, up to maxAttempts tries. Compile times are kept in a history
+ * file and order the next batch, with the worker that compiled each
+ * application: a free worker takes the longest application that is its
+ * own or nobody's, so mirrors and dictionary caches stay warm, and only
+ * takes another worker's when nothing else is left.
+ *
+ * Messages are framed as a 16-byte header { type, reserved, payload
+ * length } and the payload, in host byte order like the binary state
+ * files; every supported target is little-endian. The protocol has no
+ * authentication: workers listen on the loopback interface unless told
+ * otherwise, and belong on a trusted build network.
+ */
+
+#ifndef CSPRO_DISTRIBUTED_COMPILER_H
+#define CSPRO_DISTRIBUTED_COMPILER_H
+
+#include "BatchCompiler.h"
+#include "CompilerInterface.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct WorkerAddress {
+    std::string host;
+    int port = 0;
+};
+
+// "host:port" or "port" (the loopback interface); false when malformed
+bool parseWorkerAddress(const std::string& text, WorkerAddress& address);
+
+struct CompileTime {
+    double milliseconds = 0.0;
+    std::string worker;             // host:port of the worker that compiled it
+};
+
+// Last compile of each application, by absolute path
+class CompileTimeHistory {
+public:
+    // .csprocompile/compile-times under the initial working directory
+    static std::filesystem::path defaultHistoryPath();
+
+    bool load(const std::filesystem::path& historyFile);
+    bool save(const std::filesystem::path& historyFile) const;
+
+    bool lookup(const std::string& applicationFile, CompileTime& time) const;
+    void record(const std::string& applicationFile, CompileTime time);
+
+private:
+    std::map<std::string, CompileTime> m_times;
+};
+
+struct DistributedOptions {
+    std::vector<WorkerAddress> workers;
+    bool checkSyntaxOnly;
+    bool generateDebugInfo;
+    int maxAttempts;                // Tries per application before it is reported as failed
+    int resultTimeoutSeconds;       // A worker silent for this long is given up on
+    bool verbose;
+
+    DistributedOptions()
+        : checkSyntaxOnly(false)
+        , generateDebugInfo(true)
+        , maxAttempts(3)
+        , resultTimeoutSeconds(600)
+        , verbose(false)
+    {}
+};
+
+struct DistributedStats {
+    int workersConnected = 0;
+    int workersLost = 0;            // Dropped or timed out mid-batch
+    long long retries = 0;          // Applications sent to another worker after a loss
+    long long filesShipped = 0;
+    uint64_t bytesShipped = 0;
+    long long filesReused = 0;      // Inputs a worker already had
+};
+
+class DistributedCompiler {
+public:
+    explicit DistributedCompiler(DistributedOptions options);
+
+    // Compiles every application on the workers; history orders the
+    // queue and receives the new times. Items are in input order, and
+    // BatchItemResult::worker is the index of the worker in the options.
+    BatchReport run(const std::vector<std::string>& applicationFiles, CompileTimeHistory& history);
+
+    const DistributedStats& getStats() const { return m_stats; }
+
+private:
+    DistributedOptions m_options;
+    DistributedStats m_stats;
+};
+
+struct BuildWorkerStats {
+    long long jobs = 0;
+    long long filesReceived = 0;
+    uint64_t bytesReceived = 0;
+};
+
+// Serves one coordinator connection at a time, compiling in its mirror
+// of the coordinator's folder under directory/tree
+class BuildWorker {
+public:
+    BuildWorker(EngineFactory factory, std::filesystem::path directory);
+    ~BuildWorker();
+
+    BuildWorker(const BuildWorker&) = delete;
+    BuildWorker& operator=(const BuildWorker&) = delete;
+
+    // Binds and listens; port 0 picks a free port (see getPort())
+    bool listen(const WorkerAddress& address, std::string& error);
+    int getPort() const { return m_port; }
+
+    // Serves connections until stop()
+    void serve();
+    void stop();
+
+    void setVerbose(bool verbose) { m_verbose = verbose; }
+    BuildWorkerStats getStats() const;
+
+private:
+    EngineFactory m_factory;
+    std::filesystem::path m_directory;
+    int m_listenFd;
+    std::atomic<int> m_connectionFd;     // The coordinator being served, for stop()
+    int m_port;
+    std::atomic<bool> m_stopping;
+    bool m_verbose;
+
+    mutable std::mutex m_mutex;
+    BuildWorkerStats m_stats;
+    std::map<std::string, uint64_t> m_mirrored;     // Tree path -> digest on disk; serving thread only
+
+    void serveConnection(int fd, WorkerEngine& engine);
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_DISTRIBUTED_COMPILER_H
@@ -0,0 +1,140 @@
+/*
+ * EnginePool.h - Pre-warmed, recycled compiler engines
+ *
+ * A long-running process (the compile server) keeps its engines for
+ * hours, and whatever an engine holds on to between compiles adds up. The
+ * pool keeps a fixed number of initialized engines and retires each one
+ * after a set number of compiles, or as soon as the process's resident
+ * set grows past a ceiling after one of its compiles.
+ *
+ * A retired engine is replaced in the background: it keeps serving until
+ * its replacement has finished initialize(), then it is shut down and
+ * destroyed. Requests therefore never wait for an engine to start, except
+ * for the very first ones if they arrive before start() returns.
+ *
+ * That overlap needs an engine that supports concurrent compiles. For
+ * any other (the SDK engine) the pool keeps a single engine, whatever
+ * its size option, and replaces it between compiles: requests wait while
+ * the replacement starts.
+ *
+ * The resident set is the process's own (/proc/self/statm, or the working
+ * set on Windows). Engines in one process share it, so the ceiling is
+ * charged to whichever engine just finished compiling. Replacing an engine
+ * does not always give memory back (the allocator keeps freed pages, and
+ * process-wide caches stay resident), so the RSS is measured again once
+ * the old engine is gone. If it is still over the ceiling, the next
+ * memory recycle waits until the RSS has grown by a further tenth of the
+ * ceiling past that level, rather than retiring an engine on every compile.
+ */
+
+#ifndef CSPRO_ENGINE_POOL_H
+#define CSPRO_ENGINE_POOL_H
+
+#include "BatchCompiler.h"
+#include "CompilerInterface.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct EnginePoolOptions {
+    int size;                       // Engines kept initialized
+    int maxCompilesPerEngine;       // Retire an engine after this many compiles; 0 for never
+    size_t maxResidentBytes;        // Retire the engine that pushes the RSS past this; 0 for no ceiling
+
+    EnginePoolOptions()
+        : size(1)
+        , maxCompilesPerEngine(0)
+        , maxResidentBytes(0)
+    {}
+};
+
+struct EnginePoolStats {
+    int liveEngines;                // Initialized engines, busy or idle
+    int busyEngines;
+    long long compiles;
+    long long recycles;             // Engines retired and replaced
+    long long recyclesForMemory;    // ... of which because of the RSS ceiling
+    long long ineffectiveMemoryRecycles;    // ... of which left the RSS over the ceiling
+    long long failedWarmups;        // Replacements whose initialize() failed
+    size_t residentBytes;           // At the last compile
+    size_t peakResidentBytes;
+
+    EnginePoolStats()
+        : liveEngines(0)
+        , busyEngines(0)
+        , compiles(0)
+        , recycles(0)
+        , recyclesForMemory(0)
+        , ineffectiveMemoryRecycles(0)
+        , failedWarmups(0)
+        , residentBytes(0)
+        , peakResidentBytes(0)
+    {}
+};
+
+// Resident set size of this process in bytes, 0 where it cannot be read
+size_t currentResidentBytes();
+
+class EnginePool {
+public:
+    EnginePool(EngineFactory factory, EnginePoolOptions options);
+    ~EnginePool();
+
+    EnginePool(const EnginePool&) = delete;
+    EnginePool& operator=(const EnginePool&) = delete;
+
+    // Creates and initializes the engines; false if none could be initialized
+    bool start();
+
+    // Shuts every engine down; waits for compiles in progress
+    void shutdown();
+
+    // Compiles on an idle engine, waiting for one if all are busy; with
+    // no engine at all the result carries an initialization error
+    CompilationResult compile(const CompilerOptions& options);
+
+    // Whether compile() may run on several threads at once; false for
+    // engines that do not support concurrent compiles
+    bool supportsConcurrentCompiles() const;
+
+    EnginePoolStats getStats() const;
+    const EnginePoolOptions& getOptions() const { return m_options; }
+
+private:
+    struct Slot {
+        std::unique_ptr<ICompilerEngine> engine;
+        int compiles = 0;
+        bool busy = false;
+        bool retiring = false;      // A replacement is being warmed
+        bool retiringForMemory = false;
+        bool swapPending = false;   // The replacement is ready; no new compiles
+    };
+
+    EngineFactory m_factory;
+    EnginePoolOptions m_options;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_idle;         // A slot became free, or the pool stopped
+    std::condition_variable m_work;         // The warmer has replacements to make
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::deque<Slot*> m_retiring;           // Slots waiting for their replacement
+    std::thread m_warmer;
+    bool m_stopping;
+    bool m_concurrent;                      // Engines may start and compile side by side
+    bool m_warming;                         // Without m_concurrent: a replacement is starting, no compiles
+    size_t m_memoryFloor;                   // RSS left over the ceiling by the last memory recycle; 0 if none
+    EnginePoolStats m_stats;
+
+    std::unique_ptr<ICompilerEngine> createEngine();
+    void warmReplacements();
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_ENGINE_POOL_H
@@ -0,0 +1,74 @@
+/*
+ * FileWatcher.h - Change notification for a set of files
+ *
+ * On Linux the watcher subscribes to the files' directories with inotify
+ * and blocks in poll() until something happens, so an idle watch costs
+ * no CPU. Directories are watched rather than the files themselves
+ * because editors commonly save by writing a new file and renaming it
+ * over the old one. Elsewhere the files' modification times and sizes
+ * are polled, as they are on Linux when inotify cannot be used (the
+ * per-user instance or watch limits are exhausted, say).
+ */
+
+#ifndef CSPRO_FILE_WATCHER_H
+#define CSPRO_FILE_WATCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace CSProCompiler {
+
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Replaces the watched set; returns false if nothing could be watched
+    bool watch(const std::vector<std::filesystem::path>& files);
+
+    // Blocks until a watched file changes, timeoutMs passes (-1 waits
+    // indefinitely) or stop() is called. Returns the changed files, which
+    // is empty on timeout or stop.
+    std::vector<std::filesystem::path> wait(int timeoutMs);
+
+    // Wakes a blocked wait() and makes later ones return at once.
+    // Safe to call from a signal handler.
+    void stop();
+    bool isStopped() const { return m_stopped.load(); }
+
+    // False while the files are being polled
+    bool usesNotifications() const;
+
+private:
+    struct FileStamp {
+        std::filesystem::file_time_type modified;
+        uintmax_t size;
+        bool exists;
+    };
+
+    std::set<std::filesystem::path> m_files;
+    std::atomic<bool> m_stopped;
+    std::map<std::filesystem::path, FileStamp> m_stamps;    // When polling
+
+#ifdef __linux__
+    int m_inotify;
+    int m_wakePipe[2];
+    std::map<int, std::filesystem::path> m_directories;     // Watch descriptor to directory
+    bool m_polling;                                         // inotify could not watch every file
+#endif
+
+    static FileStamp stampOf(const std::filesystem::path& path);
+    void stampFiles();
+    std::vector<std::filesystem::path> pollForChanges(int timeoutMs);
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_FILE_WATCHER_H
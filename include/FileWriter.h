@@ -0,0 +1,70 @@
+/*
+ * FileWriter.h - Atomic whole-file writes, optionally on a background thread
+ *
+ * Output files (reports, cache entries) are produced in memory and
+ * replaced in one step: the contents go to a uniquely named temporary
+ * file beside the target, which is then renamed over it, so readers never
+ * see a partial file. writeFileIfChanged leaves the target alone when it
+ * already holds the same bytes, keeping its timestamp and sparing editors
+ * that watch it a reload.
+ */
+
+#ifndef CSPRO_FILE_WRITER_H
+#define CSPRO_FILE_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace CSProCompiler {
+
+enum class FileWriteOutcome {
+    Written,
+    Unchanged,
+    Failed
+};
+
+bool writeFileAtomically(const std::filesystem::path& path, std::string_view contents);
+FileWriteOutcome writeFileIfChanged(const std::filesystem::path& path, std::string_view contents);
+
+// A single background thread writing queued files with writeFileIfChanged,
+// in submission order. The thread starts with the first submission.
+class AsyncFileWriter {
+public:
+    AsyncFileWriter();
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    void submit(std::filesystem::path path, std::string contents);
+
+    // Blocks until every submitted file has been written; returns the
+    // number of writes that failed since the previous drain
+    size_t drain();
+
+private:
+    struct Job {
+        std::filesystem::path path;
+        std::string contents;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<Job> m_jobs;
+    std::thread m_thread;
+    bool m_busy;
+    bool m_stopping;
+    size_t m_failures;
+
+    void run();
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_FILE_WRITER_H
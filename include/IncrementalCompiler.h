@@ -0,0 +1,83 @@
+/*
+ * IncrementalCompiler.h - Per-PROC incremental recompilation
+ *
+ * Splits each logic file of an application into units, one per PROC (plus
+ * whatever precedes the first PROC), and hashes every unit's text. The
+ * diagnostics of the previous run are kept per unit, with lines relative
+ * to the unit, so a unit that merely moved keeps them.
+ *
+ * On the next compile only the units whose text changed are handed to the
+ * engine (ICompilerEngine::compileUnits) and the remembered diagnostics are
+ * merged back in for the rest. Everything is recompiled when a unit's
+ * dependents cannot be narrowed down: PROC GLOBAL changed (it declares
+ * what the other PROCs use), a non-logic input such as a dictionary or
+ * form changed, the options changed, or the engine compiles only whole
+ * applications.
+ */
+
+#ifndef CSPRO_INCREMENTAL_COMPILER_H
+#define CSPRO_INCREMENTAL_COMPILER_H
+
+#include "CompilerInterface.h"
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CSProCompiler {
+
+// Splits logic text into PROC units; PROC keywords inside comments and
+// string literals are ignored. Unit names are uppercased.
+std::vector<LogicUnit> splitLogicUnits(std::string_view text, const std::string& file);
+
+struct IncrementalStats {
+    bool fullCompile;           // The engine compiled the whole application
+    int unitCount;
+    int compiledUnitCount;      // Units handed to the engine
+    int reusedUnitCount;        // Units whose previous diagnostics were merged in
+
+    IncrementalStats()
+        : fullCompile(false)
+        , unitCount(0)
+        , compiledUnitCount(0)
+        , reusedUnitCount(0)
+    {}
+};
+
+// Wraps an engine for repeated compiles of the same applications; not thread-safe
+class IncrementalCompiler {
+public:
+    explicit IncrementalCompiler(ICompilerEngine& engine);
+
+    CompilationResult compile(const CompilerOptions& options);
+
+    // Forget an application's state, so its next compile is a full one
+    void invalidate(const std::string& applicationFile);
+
+    const IncrementalStats& getLastStats() const { return m_lastStats; }
+
+private:
+    struct UnitState {
+        uint64_t hash;
+        DiagnosticList diagnostics;     // Lines relative to the unit's first line
+    };
+
+    struct ApplicationState {
+        uint64_t fingerprint;           // Options and non-logic inputs
+        std::unordered_map<std::string, UnitState> units;   // By file and unit name
+        DiagnosticList applicationDiagnostics;      // Not attributable to any unit
+    };
+
+    ICompilerEngine& m_engine;
+    std::map<std::string, ApplicationState> m_applications;    // By resolved application path
+    IncrementalStats m_lastStats;
+
+    CompilationResult compileFully(const CompilerOptions& options, const std::vector<LogicUnit>& units,
+                                   uint64_t fingerprint);
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_INCREMENTAL_COMPILER_H
@@ -0,0 +1,86 @@
+/*
+ * JsonValue.h - Minimal JSON document model
+ *
+ * Small reader used for the line-delimited request protocols of the
+ * command-line tool. Only what the tool needs is supported: objects,
+ * arrays, strings (with \u escapes), numbers, booleans and null.
+ */
+
+#ifndef CSPRO_JSON_VALUE_H
+#define CSPRO_JSON_VALUE_H
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace CSProCompiler {
+
+class JsonParseError : public std::runtime_error {
+public:
+    JsonParseError(const std::string& message, size_t offset)
+        : std::runtime_error(message + " at offset " + std::to_string(offset))
+        , m_offset(offset)
+    {}
+
+    size_t offset() const { return m_offset; }
+
+private:
+    size_t m_offset;
+};
+
+class JsonValue {
+public:
+    enum class Type {
+        Null,
+        Boolean,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    JsonValue() : m_type(Type::Null), m_bool(false), m_number(0.0) {}
+
+    // Parse a complete JSON document; throws JsonParseError on malformed input
+    static JsonValue parse(std::string_view text);
+
+    Type type() const { return m_type; }
+    bool isNull() const { return m_type == Type::Null; }
+    bool isBool() const { return m_type == Type::Boolean; }
+    bool isNumber() const { return m_type == Type::Number; }
+    bool isString() const { return m_type == Type::String; }
+    bool isArray() const { return m_type == Type::Array; }
+    bool isObject() const { return m_type == Type::Object; }
+
+    bool asBool(bool defaultValue = false) const { return isBool() ? m_bool : defaultValue; }
+    double asNumber(double defaultValue = 0.0) const { return isNumber() ? m_number : defaultValue; }
+    int asInt(int defaultValue = 0) const { return isNumber() ? static_cast<int>(m_number) : defaultValue; }
+    std::string asString(const std::string& defaultValue = std::string()) const { return isString() ? m_string : defaultValue; }
+
+    // Object member lookup; returns a null value when missing or not an object
+    const JsonValue& operator[](std::string_view key) const;
+    bool contains(std::string_view key) const;
+
+    // Array element lookup; returns a null value when out of range or not an array
+    const JsonValue& operator[](size_t index) const;
+    size_t size() const;
+
+    const std::vector<JsonValue>& items() const { return m_items; }
+    const std::vector<std::pair<std::string, JsonValue>>& members() const { return m_members; }
+
+private:
+    friend class JsonParser;
+
+    Type m_type;
+    bool m_bool;
+    double m_number;
+    std::string m_string;
+    std::vector<JsonValue> m_items;
+    std::vector<std::pair<std::string, JsonValue>> m_members;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_JSON_VALUE_H
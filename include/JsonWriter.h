@@ -0,0 +1,92 @@
+/*
+ * JsonWriter.h - Buffered JSON serializer
+ *
+ * Appends JSON into a caller-owned std::string that can be reused across
+ * documents, so output is produced without per-value allocations and
+ * flushed with a single write. Commas and (optionally) indentation are
+ * handled by the writer; strings are escaped with a vectorized scan for
+ * the characters JSON requires to be escaped.
+ */
+
+#ifndef CSPRO_JSON_WRITER_H
+#define CSPRO_JSON_WRITER_H
+
+#include "CompilerInterface.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct DiagnosticDelta;
+
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& buffer, bool pretty = false);
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(int number) { return value(static_cast<long long>(number)); }
+    JsonWriter& value(long long number);
+    JsonWriter& value(unsigned long long number);
+    JsonWriter& value(double number);
+    JsonWriter& value(bool flag);
+    JsonWriter& valueNull();
+
+    // Insert an already serialized JSON value verbatim
+    JsonWriter& rawValue(std::string_view json);
+
+    template<typename T>
+    JsonWriter& member(std::string_view name, const T& memberValue) {
+        key(name);
+        return value(memberValue);
+    }
+
+    std::string& buffer() { return m_buffer; }
+
+    // Append text with JSON string escaping applied (without quotes)
+    static void appendEscaped(std::string& out, std::string_view text);
+
+private:
+    std::string& m_buffer;
+    bool m_pretty;
+    bool m_afterKey;
+    std::vector<bool> m_hasElements;    // One entry per open object/array
+
+    void beforeValue();
+    void newline();
+};
+
+// Convenience wrapper returning an escaped copy
+std::string jsonEscape(std::string_view text);
+
+// Diagnostic object: file, line, column, message, procName, severity
+void writeDiagnosticJson(JsonWriter& writer, const DiagnosticView& diag);
+
+// Phase tree: [{name, startMs, durationMs, children?}], start times relative to the first span
+void writePhasesJson(JsonWriter& writer, const std::vector<PhaseSpan>& phases);
+
+// Members describing a result, written into an object the caller has opened:
+// success, errorCount, warningCount, compilationTime (seconds), cached, cancelled (only when set), phases, errors
+void writeCompilationResultMembers(JsonWriter& writer, const CompilationResult& result);
+
+// Same summary members, but the diagnostics as a delta against the previous
+// compile (see DiagnosticDelta.h): "delta": {sequence, full, added, changed,
+// removed}, each diagnostic with its "id". A full snapshot has "errors" as usual.
+void writeCompilationDeltaMembers(JsonWriter& writer, const CompilationResult& result, const DiagnosticDelta& delta);
+
+// Complete result document
+void writeCompilationResultJson(std::string& buffer, const CompilationResult& result, bool pretty);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_JSON_WRITER_H
@@ -0,0 +1,156 @@
+/*
+ * LanguageServer.h - Language Server Protocol front end over ICompilerEngine
+ *
+ * Speaks JSON-RPC with Content-Length framing (LSP base protocol) and
+ * publishes compile diagnostics with textDocument/publishDiagnostics.
+ *
+ * Open documents live in memory (full-text sync) and are handed to the
+ * engine as source overlays, so edits never wait on the disk. Each change
+ * marks the applications that use the document dirty; a single thread
+ * picks up an application once its edits have been quiet for the debounce
+ * interval and submits it to a CompileScheduler, so a storm of didChange
+ * notifications collapses into one compile and at most one compile per
+ * application is ever in flight. A change that arrives during a compile of
+ * the same application supersedes it through the scheduler: the engine
+ * stops at its next phase boundary, nothing is published, and the
+ * application stays dirty for the next round. Compiles go through an
+ * IncrementalCompiler, so an edit inside one PROC recompiles only that
+ * PROC on engines that allow it.
+ *
+ * Engines that cannot read overlays get a shadow copy of the application
+ * in a private directory, with the open buffers written over the files.
+ *
+ * Besides the standard lifecycle and text synchronization methods, the
+ * server answers "csprocompile/stats" with its compile counters.
+ */
+
+#ifndef CSPRO_LANGUAGE_SERVER_H
+#define CSPRO_LANGUAGE_SERVER_H
+
+#include "CompileScheduler.h"
+#include "CompilerInterface.h"
+#include "IncrementalCompiler.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CSProCompiler {
+
+class JsonValue;
+class JsonWriter;
+class ShadowWorkspace;
+
+struct LanguageServerStats {
+    long long changeCount;          // didOpen/didChange/didSave/didClose notifications
+    long long compileCount;
+    long long cancelledCount;       // Compiles abandoned because of a newer change
+    long long publishCount;         // publishDiagnostics notifications sent
+    long long compiledUnitCount;    // PROCs handed to the engine
+    long long reusedUnitCount;      // PROCs whose previous diagnostics were reused
+
+    LanguageServerStats()
+        : changeCount(0)
+        , compileCount(0)
+        , cancelledCount(0)
+        , publishCount(0)
+        , compiledUnitCount(0)
+        , reusedUnitCount(0)
+    {}
+};
+
+class LanguageServer {
+public:
+    // The engine is borrowed; compiles run on the scheduler's thread
+    explicit LanguageServer(ICompilerEngine& engine);
+    ~LanguageServer();
+
+    LanguageServer(const LanguageServer&) = delete;
+    LanguageServer& operator=(const LanguageServer&) = delete;
+
+    void setVerbose(bool verbose) { m_verbose = verbose; }
+    void setDebounceMs(int milliseconds) { m_debounceMs = milliseconds; }
+
+    // Serve until the exit notification or end of input; returns the
+    // process exit code (0 only after an orderly shutdown request)
+    int serve(std::istream& in, std::ostream& out);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Document {
+        std::string uri;
+        std::string text;
+        long long version;
+    };
+
+    struct Application {
+        uint64_t generation = 0;                // Bumped by every change to one of its documents
+        uint64_t compiledGeneration = 0;        // Generation the last finished compile saw
+        Clock::time_point changedAt;
+        std::set<std::string> publishedUris;    // Documents currently showing its diagnostics
+    };
+
+    ICompilerEngine& m_engine;
+    bool m_verbose;
+    int m_debounceMs;
+
+    std::ostream* m_out;
+    std::mutex m_outputMutex;
+
+    // Shared between the reader and the compile thread
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::map<std::filesystem::path, Document> m_documents;
+    std::map<std::filesystem::path, Application> m_applications;
+    std::map<std::filesystem::path, std::set<std::filesystem::path>> m_applicationsByInput;
+    std::vector<std::filesystem::path> m_workspaceRoots;
+    LanguageServerStats m_stats;
+    bool m_stopping;
+    bool m_shutdownRequested;
+    bool m_engineReady;
+    std::filesystem::path m_compiling;          // Application of the compile in flight, if any
+    std::string m_compilingInput;               // ... and the input file it was submitted as
+
+    // Compile thread only
+    std::thread m_compileThread;
+    std::map<std::filesystem::path, std::unique_ptr<ShadowWorkspace>> m_shadows;
+
+    // Scheduler thread only; the scheduler is declared last so that it
+    // stops before what its compiles use goes away
+    IncrementalCompiler m_incremental;
+    CompileScheduler m_scheduler;
+
+    void handleMessage(const JsonValue& message);
+    void handleInitialize(const JsonValue& id, const JsonValue& params);
+    void handleDocumentChange(const std::string& method, const JsonValue& params);
+
+    void send(const std::string& body);
+    void sendResult(const JsonValue& id, const std::function<void(JsonWriter&)>& writeResult);
+    void sendError(const JsonValue& id, int code, const std::string& message);
+    void log(const std::string& message);
+
+    // Caller holds m_mutex
+    std::set<std::filesystem::path> findApplications(const std::filesystem::path& document);
+    void indexApplication(const std::filesystem::path& application);
+    void markDirty(const std::filesystem::path& document);
+
+    void compileLoop();
+    void compileApplication(const std::filesystem::path& application, uint64_t generation,
+                            std::map<std::string, std::string> overlays);
+    void publish(const std::filesystem::path& application, const CompilationResult& result,
+                 const std::function<std::string(const std::string&)>& toRealPath);
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_LANGUAGE_SERVER_H
@@ -0,0 +1,41 @@
+/*
+ * LogicScanner.h - Native structural pre-scan of CSPro logic
+ *
+ * A single pass over the application's logic files that finds the errors
+ * which make a full compile pointless: comments and string literals that
+ * are never closed, unbalanced parentheses, and if/loop/function/when/
+ * recode blocks that are left open, closed by the wrong keyword, or are
+ * missing their 'then' or 'do'. Names, types and expressions are not
+ * checked; that is the engine's job.
+ *
+ * Characters are classified through a 256-entry table, so the scanner
+ * touches each byte once and runs in microseconds even on large files.
+ * Files are memory-mapped; open editor buffers (CompilerOptions::
+ * sourceOverlays) are scanned in their place.
+ *
+ * Errors carry the message numbers and texts of the CSPro system message
+ * file (CSProDesigner.mgf), so they read the same as the engine's own; the
+ * texts come from systemMessages() once the catalog has been loaded.
+ * String literals are scanned with logic version 8.0 rules (backslash
+ * escapes, @"verbatim" strings), matching the version the engine forces.
+ */
+
+#ifndef CSPRO_LOGIC_SCANNER_H
+#define CSPRO_LOGIC_SCANNER_H
+
+#include "CompilerInterface.h"
+#include <string_view>
+
+namespace CSProCompiler {
+
+// Scans one logic source, appending the errors found to result and
+// updating its error count; returns the number of errors found
+int scanLogicSource(std::string_view text, std::string_view file, CompilationResult& result);
+
+// Scans every logic file (.apc, .app) of options.inputFile; success is
+// false when an error was found or the application could not be read
+CompilationResult prescanApplication(const CompilerOptions& options);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_LOGIC_SCANNER_H
@@ -0,0 +1,44 @@
+/*
+ * MappedFile.h - Read-only memory mapping of a whole file
+ *
+ * Maps the file into memory so scanners can walk it as one string_view
+ * without copying. Empty files need no mapping and yield an empty view;
+ * where mapping is not possible the contents are read into a buffer
+ * instead, so callers never need a second code path.
+ */
+
+#ifndef CSPRO_MAPPED_FILE_H
+#define CSPRO_MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace CSProCompiler {
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Replaces any previous mapping; false if the file cannot be opened
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+    bool isMapped() const { return m_mapping != nullptr; }
+
+private:
+    const char* m_data;
+    size_t m_size;
+    void* m_mapping;            // Base address of the mapping, nullptr when buffered
+    std::string m_buffer;       // Contents when the file could not be mapped
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_MAPPED_FILE_H
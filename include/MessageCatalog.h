@@ -0,0 +1,79 @@
+/*
+ * MessageCatalog.h - Precompiled, memory-mapped CSPro message files
+ *
+ * CSPro message files (.mgf) are text: a "Language=EN" line, then one
+ * "<number> <text>" line per message, with C-style comments between.
+ * Parsing CSProDesigner.mgf (~44 KB) on every start costs more than the
+ * lookups it serves, so CSProMessageCatalog compiles each .mgf at build
+ * time into a binary catalog (.mgc) beside it:
+ *
+ *   header   magic "CMGC", format version, message count, blob size,
+ *            and the size, write time and XXH64 digest of the source
+ *   index    { number, offset, length } per message, sorted by number
+ *   blob     the message texts, back to back, not terminated
+ *
+ * Opening a catalog maps it and checks the header against the source; a
+ * lookup is a binary search over the index that returns a view into the
+ * mapping. Nothing is parsed or copied. When the catalog is missing,
+ * damaged or older than its .mgf, the text file is parsed into the same
+ * layout in memory, so lookups behave the same either way.
+ */
+
+#ifndef CSPRO_MESSAGE_CATALOG_H
+#define CSPRO_MESSAGE_CATALOG_H
+
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace CSProCompiler {
+
+class MessageCatalog {
+public:
+    MessageCatalog();
+
+    MessageCatalog(const MessageCatalog&) = delete;
+    MessageCatalog& operator=(const MessageCatalog&) = delete;
+
+    // Loads messageFile through its catalog when that is current, otherwise
+    // from the text; false when neither can be read
+    bool open(const std::filesystem::path& messageFile, std::string_view language = "EN");
+    void close();
+
+    // The text of a message, empty when the number is unknown
+    std::string_view lookup(int number) const;
+
+    size_t size() const { return m_count; }
+    bool isPrecompiled() const { return m_precompiled; }     // Served from the .mgc rather than the text
+
+    // <name>.mgc beside <name>.mgf
+    static std::filesystem::path catalogPathFor(const std::filesystem::path& messageFile);
+
+    // Writes the catalog of messageFile to catalogFile (atomically); the
+    // number of messages compiled is returned in messageCount
+    static bool compile(const std::filesystem::path& messageFile, const std::filesystem::path& catalogFile,
+                        std::string_view language, size_t& messageCount, std::string& error);
+
+private:
+    MappedFile m_catalog;
+    std::string m_image;        // Catalog built from the text file when the .mgc was not usable
+    const char* m_data;         // Start of the catalog, mapped or built
+    size_t m_count;
+    const char* m_blob;
+    uint32_t m_blobSize;
+    bool m_precompiled;
+
+    bool attach(const char* data, size_t size);
+};
+
+// The process-wide CSProDesigner.mgf catalog. Load it once at startup,
+// before other threads run; until then systemMessages() is empty.
+bool loadSystemMessages(const std::filesystem::path& messageFile);
+const MessageCatalog& systemMessages();
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_MESSAGE_CATALOG_H
@@ -0,0 +1,72 @@
+/*
+ * PhaseTiming.h - Per-phase compile timings and Chrome trace export
+ *
+ * Stages of a compile are recorded as PhaseSpans on one process-wide
+ * steady clock, so spans from the engine, the cache and the report
+ * writers (and from every worker of a batch) share a time base. Spans
+ * are opened and closed with PhaseScope; nesting follows scope nesting.
+ *
+ * The trace export writes the Chrome trace-event format ("X" complete
+ * events), which chrome://tracing, Perfetto and Speedscope can open.
+ */
+
+#ifndef CSPRO_PHASE_TIMING_H
+#define CSPRO_PHASE_TIMING_H
+
+#include "CompilerInterface.h"
+#include <string>
+#include <vector>
+
+namespace CSProCompiler {
+
+// Milliseconds since the trace clock was first read in this process
+double traceClockMs();
+
+// Appends spans to a caller-owned list, tracking which span is open
+class PhaseRecorder {
+public:
+    explicit PhaseRecorder(std::vector<PhaseSpan>& spans);
+
+    // Opens a span nested in the innermost open one; returns its index
+    size_t begin(std::string name);
+    void end(size_t index);
+
+    // Append spans recorded elsewhere (by an engine, say), placing their
+    // top-level spans under the innermost open span
+    void adopt(const std::vector<PhaseSpan>& spans);
+
+private:
+    std::vector<PhaseSpan>& m_spans;
+    int m_open;
+};
+
+// Times a block: begins on construction, ends on destruction or end()
+class PhaseScope {
+public:
+    PhaseScope(PhaseRecorder& recorder, std::string name);
+    ~PhaseScope();
+
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+    void end();
+
+private:
+    PhaseRecorder& m_recorder;
+    size_t m_index;
+    bool m_open;
+};
+
+// One lane's worth of spans in a trace; tracks sharing a threadId share a lane
+struct TraceTrack {
+    std::string threadName;
+    int threadId;
+    const std::vector<PhaseSpan>* phases;
+};
+
+void writeChromeTrace(std::string& buffer, const std::vector<TraceTrack>& tracks);
+bool writeChromeTraceFile(const std::string& path, const std::vector<TraceTrack>& tracks);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_PHASE_TIMING_H
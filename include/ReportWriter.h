@@ -0,0 +1,58 @@
+/*
+ * ReportWriter.h - compileErrors.txt / compileErrorsFormatted.txt output
+ *
+ * Writes the two report files that sit next to the application:
+ *   compileErrors.txt           Detailed listing with totals
+ *   compileErrorsFormatted.txt  CSPro Designer format: SEVERITY(Proc, line): message
+ *
+ * The writer is an IDiagnosticSink, so it can be fed while a streaming
+ * compile is running. Both reports are formatted into memory in the same
+ * pass over the diagnostics; finish() then replaces each file with a
+ * single atomic write, skipped when the file is unchanged, either inline
+ * or through an AsyncFileWriter so the caller can answer the editor
+ * first. Files are only touched once the first diagnostic arrives,
+ * matching the behavior of leaving the previous reports alone after a
+ * clean compile.
+ */
+
+#ifndef CSPRO_REPORT_WRITER_H
+#define CSPRO_REPORT_WRITER_H
+
+#include "CompilerInterface.h"
+#include "FileWriter.h"
+#include <filesystem>
+#include <string>
+
+namespace CSProCompiler {
+
+class ReportWriter : public IDiagnosticSink {
+public:
+    explicit ReportWriter(const std::string& applicationFile);
+
+    void onDiagnostic(const DiagnosticView& diagnostic) override;
+
+    // Completes the detailed report, whose header needs the final totals,
+    // and writes both files: inline, or queued on fileWriter when given.
+    // Returns false when no diagnostics were received and nothing was written,
+    // or when an inline write failed.
+    bool finish(const CompilationResult& result, AsyncFileWriter* fileWriter = nullptr);
+
+    // Write both reports for a fully buffered result
+    static bool writeReports(const std::string& applicationFile, const CompilationResult& result,
+                             AsyncFileWriter* fileWriter = nullptr);
+
+    const std::filesystem::path& getDetailedPath() const { return m_detailedPath; }
+    const std::filesystem::path& getFormattedPath() const { return m_formattedPath; }
+
+private:
+    std::string m_applicationFile;
+    std::filesystem::path m_detailedPath;
+    std::filesystem::path m_formattedPath;
+    std::string m_detailedBody;
+    std::string m_formatted;
+    bool m_started;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_REPORT_WRITER_H
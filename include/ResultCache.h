@@ -0,0 +1,52 @@
+/*
+ * ResultCache.h - On-disk compilation result cache
+ *
+ * Stores the last CompilationResult of an application next to it, in
+ * <application folder>/.csprocompile/<application file>.result, keyed by
+ * an XXH64 digest over the contents of every input file plus the
+ * CompilerOptions that affect the result. When nothing changed the stored
+ * result is returned without creating or initializing a compiler engine.
+ *
+ * An entry is a small header with the key, followed by the result in the
+ * binary encoding of ResultCodec.h; a hit maps the file and decodes it
+ * in place instead of parsing JSON.
+ */
+
+#ifndef CSPRO_RESULT_CACHE_H
+#define CSPRO_RESULT_CACHE_H
+
+#include "CompilerInterface.h"
+#include <filesystem>
+#include <string>
+
+namespace CSProCompiler {
+
+class ResultCache {
+public:
+    explicit ResultCache(const std::string& applicationFile);
+
+    // Digest of all application inputs, the result-affecting options, the
+    // engine (see compilerEngineIdentity()) and the tool version; returns
+    // false when the inputs cannot be read
+    bool computeKey(const CompilerOptions& options, const std::string& engineIdentity, std::string& key) const;
+
+    // Loads the stored result if it was produced for this key
+    bool lookup(const std::string& key, CompilationResult& result) const;
+
+    // Replaces the stored result; written atomically via a temporary file
+    bool store(const std::string& key, const CompilationResult& result) const;
+
+    // Results that reflect an environment failure rather than the inputs
+    // (engine exceptions, missing files) are not worth caching
+    static bool isCacheable(const CompilationResult& result);
+
+    const std::filesystem::path& getCachePath() const { return m_cachePath; }
+
+private:
+    std::filesystem::path m_applicationFile;
+    std::filesystem::path m_cachePath;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_RESULT_CACHE_H
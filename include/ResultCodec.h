@@ -0,0 +1,89 @@
+/*
+ * ResultCodec.h - Versioned binary encoding of CompilationResult
+ *
+ * JSON is the format for people and editors; between our own processes
+ * and in the result cache it is slow to write and slower to parse back.
+ * This encoding is read in place, from a buffer, a mapped file or shared
+ * memory, without parsing or copying:
+ *
+ *   header       magic "CRES", format version, flags, counts, the result's
+ *                scalars, and an optional XXH64 checksum of the whole
+ *   phases       { name, parent, startMs, durationMs } per PhaseSpan
+ *   diagnostics  { file, procName, message, line, column, messageNumber,
+ *                  severity } per diagnostic; strings are table indexes
+ *   offsets      position of each string in the table
+ *   strings      { length, bytes } per distinct string, each stored once
+ *
+ * Fields are in host byte order; every supported target is little-endian.
+ * Readers reject other versions, so bump ResultFormatVersion with any
+ * change to the layout.
+ */
+
+#ifndef CSPRO_RESULT_CODEC_H
+#define CSPRO_RESULT_CODEC_H
+
+#include "CompilerInterface.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace CSProCompiler {
+
+constexpr uint32_t ResultFormatVersion = 1;
+
+// Appends the encoding of result to buffer; withChecksum lets readers
+// detect damaged or truncated data at the cost of one pass over it
+void encodeCompilationResult(std::string& buffer, const CompilationResult& result, bool withChecksum = true);
+
+// Read-only view of an encoded result. The viewed bytes must outlive it,
+// and so must every string_view it hands out.
+class EncodedResultView {
+public:
+    EncodedResultView();
+
+    // Validates the header and every index (and the checksum, when the
+    // data has one and verifyChecksum is set); false leaves the view empty
+    bool attach(std::string_view data, bool verifyChecksum = true);
+
+    bool isValid() const { return m_data != nullptr; }
+    size_t encodedSize() const { return m_size; }   // The bytes attach() consumed
+
+    bool success() const;
+    bool fromCache() const;
+    bool cancelled() const;
+    int errorCount() const;
+    int warningCount() const;
+    double compilationTimeMs() const;
+    std::string_view compiledOutput() const;
+
+    size_t diagnosticCount() const { return m_diagnosticCount; }
+    DiagnosticView diagnostic(size_t index) const;
+
+    size_t phaseCount() const { return m_phaseCount; }
+    PhaseSpan phase(size_t index) const;
+
+    // Copies everything into a standalone result
+    CompilationResult toResult() const;
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_diagnosticCount;
+    size_t m_phaseCount;
+    size_t m_stringCount;
+    const char* m_phases;
+    const char* m_diagnostics;
+    const char* m_offsets;
+    const char* m_strings;
+    uint32_t m_stringBytes;
+
+    std::string_view string(uint32_t index) const;
+};
+
+// Decodes into a standalone result; false when the data is not a valid encoding
+bool decodeCompilationResult(std::string_view data, CompilationResult& result, bool verifyChecksum = true);
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_RESULT_CODEC_H
@@ -0,0 +1,109 @@
+/*
+ * ResultStore.h - Shared, content-addressed store of compile outputs
+ *
+ * ResultCache keeps one result beside each application, so every checkout
+ * of the same sources compiles them again. The store is a directory that
+ * any number of checkouts and processes on a host share: entries are
+ * keyed by a digest of the inputs' contents and their paths relative to
+ * the application, so identical sources hit wherever they are checked out.
+ *
+ *   objects/<2 hex>/<key>.result   the CompilationResult (ResultCodec.h)
+ *   objects/<2 hex>/<key>.pen      the compiled application, when there is one
+ *   stats.log                      one line of counters per process that used it
+ *
+ * Paths inside the application's folder are stored relative to it and
+ * re-rooted on a hit; the .pen is written back where the compile would
+ * have put it.
+ *
+ * Nothing is locked. Files are written under unique temporary names and
+ * renamed into place, the .pen before the .result, so a reader sees a
+ * whole entry or none; concurrent writers of one key write the same bytes.
+ * A hit touches the .result, and when the store grows past its size cap
+ * the least recently used entries are removed down to 90% of it. The
+ * store's size is measured by one walk of objects/ per instance and then
+ * kept up to date from its own inserts; the tree is walked again only
+ * when that running total passes the cap. Other processes' inserts are
+ * not seen until then, so a store shared by several writers can overshoot
+ * the cap by what they added since the last walk.
+ */
+
+#ifndef CSPRO_RESULT_STORE_H
+#define CSPRO_RESULT_STORE_H
+
+#include "CompilerInterface.h"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+namespace CSProCompiler {
+
+struct ResultStoreStats {
+    long long hits;
+    long long misses;
+    long long inserts;
+    long long evictions;
+    uint64_t evictedBytes;
+    uint64_t entryCount;        // Contents, from readTotals() only
+    uint64_t totalBytes;
+
+    ResultStoreStats()
+        : hits(0)
+        , misses(0)
+        , inserts(0)
+        , evictions(0)
+        , evictedBytes(0)
+        , entryCount(0)
+        , totalBytes(0)
+    {}
+};
+
+class ResultStore {
+public:
+    ResultStore(std::filesystem::path directory, uint64_t maxBytes);
+    ~ResultStore();     // Appends this instance's counters to stats.log
+
+    ResultStore(const ResultStore&) = delete;
+    ResultStore& operator=(const ResultStore&) = delete;
+
+    // Digest of the inputs' contents, their paths relative to the
+    // application, the result-affecting options, the engine (see
+    // compilerEngineIdentity()) and the tool version, so checkouts built
+    // differently never share results or .pen files; false when an input
+    // cannot be read
+    static bool computeKey(const std::string& applicationFile, const CompilerOptions& options,
+                           const std::string& engineIdentity, std::string& key);
+
+    // The stored result, re-rooted at applicationFile's folder, with its
+    // .pen restored; counts a hit or a miss
+    bool lookup(const std::string& key, const std::string& applicationFile, CompilationResult& result);
+
+    // Adds the result (and its .pen) and evicts down to the cap when the
+    // running size total passes it
+    bool insert(const std::string& key, const std::string& applicationFile, const CompilationResult& result);
+
+    // Measures the store and removes least recently used entries until it
+    // fits its cap; resets the running size total
+    void evict();
+
+    const std::filesystem::path& getDirectory() const { return m_directory; }
+    ResultStoreStats getStats() const;
+
+    // Counters of every process so far, plus the current contents
+    ResultStoreStats readTotals() const;
+
+private:
+    std::filesystem::path m_directory;
+    uint64_t m_maxBytes;
+
+    mutable std::mutex m_mutex;
+    ResultStoreStats m_stats;
+    uint64_t m_trackedBytes;    // Size as of the last walk plus later inserts
+    bool m_trackedBytesKnown;   // False until the first walk
+
+    std::filesystem::path entryPath(const std::string& key, const char* extension) const;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_RESULT_STORE_H
@@ -0,0 +1,71 @@
+/*
+ * ScriptedEngine.h - Stand-in compiler engine driven by markers in the sources
+ *
+ * Reads the application's inputs (or their in-memory overlays) and turns
+ * marker comments into diagnostics, so front ends can be exercised end
+ * to end without the CSPro SDK:
+ *
+ *   PROC AGE
+ *       if AGE > 120 then   { @error Age out of range }
+ *       { @warning Unused variable }
+ *
+ * Each "@error", "@warning" or "@info" produces a diagnostic of that
+ * severity at the marker's line and column, with the rest of the line
+ * (up to a closing brace) as the message and the enclosing PROC as its
+ * procedure name.
+ *
+ * Dictionaries are loaded as the real engine loads them, parsed from
+ * their JSON through a SharedObjectCache; one that does not parse is
+ * reported as an error.
+ *
+ * compileUnits scans only the given PROCs and spends a share of the
+ * simulated compile time proportional to their length, so incremental
+ * front ends can be checked against full compiles.
+ */
+
+#ifndef CSPRO_SCRIPTED_ENGINE_H
+#define CSPRO_SCRIPTED_ENGINE_H
+
+#include "CompilerInterface.h"
+#include "SharedObjectCache.h"
+#include <atomic>
+
+namespace CSProCompiler {
+
+class ScriptedEngine : public ICompilerEngine {
+public:
+    // compileDelayMs simulates the time a real compile takes; without a
+    // dictionary cache every compile parses its dictionaries again
+    explicit ScriptedEngine(int compileDelayMs = 0, SharedObjectCache* dictionaryCache = &sharedDictionaryCache());
+
+    // For result cache keys (see compilerEngineIdentity()); bump with any
+    // change to what the markers produce
+    static std::string identity() { return "scripted-1"; }
+
+    bool initialize() override;
+    CompilationResult compile(const CompilerOptions& options) override;
+    void shutdown() override;
+
+    bool supportsConcurrentCompiles() const override { return true; }
+    bool supportsSourceOverlays() const override { return true; }
+    bool supportsUnitCompiles() const override { return true; }
+
+    CompilationResult compileUnits(const CompilerOptions& options, const std::vector<LogicUnit>& units) override;
+
+    long long getCompileCount() const { return m_compileCount.load(); }
+    long long getCompiledUnitCount() const { return m_compiledUnitCount.load(); }
+
+private:
+    int m_compileDelayMs;
+    SharedObjectCache* m_dictionaryCache;
+    bool m_initialized;
+    std::atomic<long long> m_compileCount;
+    std::atomic<long long> m_compiledUnitCount;
+
+    // True when the dictionary parses (or is in the older text format)
+    bool loadDictionary(const std::filesystem::path& file) const;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_SCRIPTED_ENGINE_H
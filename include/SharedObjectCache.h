@@ -0,0 +1,117 @@
+/*
+ * SharedObjectCache.h - Parsed input files shared between compiles
+ *
+ * The applications of a survey suite load the same large dictionaries,
+ * and each compile parses them again. The cache keeps the parsed object
+ * of a file, keyed by its path, its content digest and the object's
+ * type, so a later compile of any application on any thread gets the
+ * same object back after hashing the file instead of parsing it.
+ *
+ * Objects are immutable once loaded and handed out as shared_ptr<const T>;
+ * an engine that needs to modify one copies it. Evicting or invalidating
+ * an entry only drops the cache's reference, so compiles still holding
+ * the object are unaffected.
+ *
+ * Threads asking for the same missing entry wait for one load rather
+ * than parsing it several times. Loaders report the memory their object
+ * holds; past the byte cap the least recently used entries are dropped.
+ */
+
+#ifndef CSPRO_SHARED_OBJECT_CACHE_H
+#define CSPRO_SHARED_OBJECT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <typeindex>
+
+namespace CSProCompiler {
+
+struct SharedObjectCacheStats {
+    long long hits;
+    long long misses;               // Each one a load, unless another thread was already loading
+    long long failedLoads;
+    long long invalidations;        // Entries dropped by invalidate() or clear()
+    long long evictions;            // Entries dropped for the byte cap
+    size_t entryCount;
+    size_t bytes;                   // As reported by the loaders
+    size_t peakBytes;
+
+    SharedObjectCacheStats()
+        : hits(0)
+        , misses(0)
+        , failedLoads(0)
+        , invalidations(0)
+        , evictions(0)
+        , entryCount(0)
+        , bytes(0)
+        , peakBytes(0)
+    {}
+};
+
+class SharedObjectCache {
+public:
+    // Parses a file from its contents, setting bytes to the memory the
+    // object holds; nullptr when the file is not valid
+    template<typename T>
+    using Loader = std::function<std::shared_ptr<const T>(const std::filesystem::path& file, std::string_view contents, size_t& bytes)>;
+
+    explicit SharedObjectCache(size_t maxBytes = DefaultMaxBytes);
+
+    SharedObjectCache(const SharedObjectCache&) = delete;
+    SharedObjectCache& operator=(const SharedObjectCache&) = delete;
+
+    static constexpr size_t DefaultMaxBytes = 256 * 1024 * 1024;
+
+    // The parsed object of file's current contents, loaded on a miss;
+    // nullptr when the file cannot be read or the loader rejects it
+    template<typename T>
+    std::shared_ptr<const T> get(const std::filesystem::path& file, const Loader<T>& load) {
+        return std::static_pointer_cast<const T>(getObject(file, typeid(T),
+            [&load](const std::filesystem::path& path, std::string_view contents, size_t& bytes) -> std::shared_ptr<const void> {
+                return load(path, contents, bytes);
+            }));
+    }
+
+    // Drops every entry of the file, whatever its contents or type
+    void invalidate(const std::filesystem::path& file);
+    void clear();
+
+    void setMaxBytes(size_t maxBytes);
+    SharedObjectCacheStats getStats() const;
+
+private:
+    using ObjectLoader = std::function<std::shared_ptr<const void>(const std::filesystem::path&, std::string_view, size_t&)>;
+    using Key = std::tuple<std::string, uint64_t, std::type_index>;
+
+    struct Entry {
+        std::shared_future<std::shared_ptr<const void>> object;
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+        bool loaded = false;        // False while its load is in progress
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<Key, Entry> m_entries;
+    size_t m_maxBytes;
+    uint64_t m_useClock;
+    SharedObjectCacheStats m_stats;
+
+    std::shared_ptr<const void> getObject(const std::filesystem::path& file, std::type_index type, const ObjectLoader& load);
+    void evictLocked();
+};
+
+// The process-wide cache the engines load dictionaries through
+SharedObjectCache& sharedDictionaryCache();
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_SHARED_OBJECT_CACHE_H
@@ -0,0 +1,79 @@
+/*
+ * SyntheticEngine.h - Stand-in compiler engine with generated diagnostics
+ *
+ * Produces a configurable volume of parser messages without the CSPro
+ * SDK. The messages are generated once, as wide strings shaped like
+ * Logic::ParserMessage, and every compile runs them through the same
+ * DiagnosticConverter path as the real engine, so benchmarks and stress
+ * runs exercise our own code on any platform.
+ */
+
+#ifndef CSPRO_SYNTHETIC_ENGINE_H
+#define CSPRO_SYNTHETIC_ENGINE_H
+
+#include "CompilerInterface.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct SyntheticEngineConfig {
+    int diagnosticCount;
+    int compilationUnitCount;       // Distinct file names across the messages
+    int procCount;                  // Distinct PROC names across the messages
+    int messageLength;              // Approximate characters per message
+    double warningRatio;            // Fraction of messages that are warnings
+    int initializeDelayMs;          // Simulated engine start-up cost
+    int compileDelayMs;             // Simulated parse time per compile
+    uint64_t seed;
+
+    SyntheticEngineConfig()
+        : diagnosticCount(1000)
+        , compilationUnitCount(4)
+        , procCount(32)
+        , messageLength(48)
+        , warningRatio(0.25)
+        , initializeDelayMs(0)
+        , compileDelayMs(0)
+        , seed(1)
+    {}
+};
+
+class SyntheticEngine : public ICompilerEngine {
+public:
+    explicit SyntheticEngine(SyntheticEngineConfig config = SyntheticEngineConfig());
+
+    bool initialize() override;
+    CompilationResult compile(const CompilerOptions& options) override;
+    CompilationResult compileStreaming(const CompilerOptions& options, IDiagnosticSink& sink) override;
+    void shutdown() override;
+
+    // Each compile only reads the generated messages
+    bool supportsConcurrentCompiles() const override { return true; }
+
+    const SyntheticEngineConfig& getConfig() const { return m_config; }
+
+private:
+    struct Message {
+        std::wstring text;
+        size_t unitIndex;
+        size_t procIndex;
+        int line;
+        int column;
+        DiagnosticMessage::Severity severity;
+    };
+
+    SyntheticEngineConfig m_config;
+    std::vector<std::wstring> m_unitNames;
+    std::vector<std::wstring> m_procNames;
+    std::vector<Message> m_messages;
+    bool m_initialized;
+
+    void generate();
+    CompilationResult compileInternal(const CompilerOptions& options, IDiagnosticSink* sink);
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_SYNTHETIC_ENGINE_H
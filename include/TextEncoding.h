@@ -0,0 +1,36 @@
+/*
+ * TextEncoding.h - UTF-8 <-> wide string conversion
+ *
+ * CSPro keeps its text in wide strings (UTF-16 on Windows, UTF-32 where
+ * wchar_t is 32 bits); everything the tool emits is UTF-8. The append
+ * functions write into an existing buffer so callers can reuse its
+ * capacity. Unpaired surrogates and invalid bytes become U+FFFD.
+ */
+
+#ifndef CSPRO_TEXT_ENCODING_H
+#define CSPRO_TEXT_ENCODING_H
+
+#include <string>
+#include <string_view>
+
+namespace CSProCompiler {
+
+void appendUtf8(std::string& out, std::wstring_view text);
+
+inline std::string toUtf8(std::wstring_view text) {
+    std::string result;
+    appendUtf8(result, text);
+    return result;
+}
+
+void appendWide(std::wstring& out, std::string_view utf8);
+
+inline std::wstring fromUtf8(std::string_view utf8) {
+    std::wstring result;
+    appendWide(result, utf8);
+    return result;
+}
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_TEXT_ENCODING_H
@@ -0,0 +1,53 @@
+/*
+ * WorkingDirectory.h - Path resolution that does not depend on the CWD
+ *
+ * The current directory is process-wide, so nothing that may run beside
+ * another compile may read or change it. Relative paths are instead
+ * resolved against an explicit base directory (CompilerOptions::
+ * baseDirectory), or, when none is given, against the directory the
+ * process started in.
+ *
+ * Code that truly needs the CWD, such as SDK calls that resolve relative
+ * references on their own, holds a ScopedWorkingDirectory: it takes a
+ * process-wide lock, switches directories, and switches back when it goes
+ * out of scope, exceptions included.
+ */
+
+#ifndef CSPRO_WORKING_DIRECTORY_H
+#define CSPRO_WORKING_DIRECTORY_H
+
+#include "CompilerInterface.h"
+#include <filesystem>
+#include <mutex>
+
+namespace CSProCompiler {
+
+// The working directory at the first call; captured before any
+// ScopedWorkingDirectory changes it
+const std::filesystem::path& initialWorkingDirectory();
+
+// Absolute, normalized path; a relative path is taken against
+// baseDirectory, or initialWorkingDirectory() when that is empty
+std::filesystem::path resolvePath(const std::filesystem::path& path, const std::filesystem::path& baseDirectory = {});
+
+// options.inputFile resolved against options.baseDirectory
+std::filesystem::path resolveInputFile(const CompilerOptions& options);
+
+class ScopedWorkingDirectory {
+public:
+    // Blocks while another thread holds a ScopedWorkingDirectory; throws
+    // std::filesystem::filesystem_error if the directory cannot be entered
+    explicit ScopedWorkingDirectory(const std::filesystem::path& directory);
+    ~ScopedWorkingDirectory();
+
+    ScopedWorkingDirectory(const ScopedWorkingDirectory&) = delete;
+    ScopedWorkingDirectory& operator=(const ScopedWorkingDirectory&) = delete;
+
+private:
+    std::unique_lock<std::mutex> m_lock;
+    std::filesystem::path m_previous;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_WORKING_DIRECTORY_H
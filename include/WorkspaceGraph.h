@@ -0,0 +1,89 @@
+/*
+ * WorkspaceGraph.h - Which applications of a workspace depend on which files
+ *
+ * Applications share dictionaries, forms and logic, so one changed file
+ * can affect many of them. The graph records, for every application, the
+ * files it compiles from (see ApplicationInputs.h: dictionaries, forms,
+ * external logic, and the applications a .pff or .bch points at) together
+ * with a fingerprint of each file: size, write time and XXH64 digest.
+ *
+ * It is kept on disk between runs and refreshed incrementally. A file
+ * whose size and write time are unchanged is not read at all; one whose
+ * write time changed is hashed, so a fresh checkout that only touched
+ * timestamps changes nothing. An application's references are parsed
+ * again only when one of its application files (.ent, .bch, .pff) changed
+ * or one of its inputs disappeared.
+ *
+ * After a refresh the graph answers which applications transitively use a
+ * given file, and which use a file that changed since the graph was saved.
+ */
+
+#ifndef CSPRO_WORKSPACE_GRAPH_H
+#define CSPRO_WORKSPACE_GRAPH_H
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace CSProCompiler {
+
+struct WorkspaceScanStats {
+    int applicationCount;
+    int rediscoveredCount;      // Applications whose references were parsed again
+    int hashedFileCount;        // Files read because their size or write time changed
+    int changedFileCount;       // Files whose contents changed (or that are new)
+
+    WorkspaceScanStats()
+        : applicationCount(0)
+        , rediscoveredCount(0)
+        , hashedFileCount(0)
+        , changedFileCount(0)
+    {}
+};
+
+class WorkspaceGraph {
+public:
+    WorkspaceGraph() = default;
+
+    // .csprocompile/workspace.graph in the directory the process started in
+    static std::filesystem::path defaultGraphPath();
+
+    // A missing, damaged or outdated graph file starts from nothing
+    bool load(const std::filesystem::path& graphFile);
+    bool save(const std::filesystem::path& graphFile) const;
+
+    // Brings the graph up to date for exactly these applications; the
+    // files changed since the loaded state are remembered for changedApplications()
+    WorkspaceScanStats refresh(const std::vector<std::string>& applicationFiles);
+
+    // Applications (as given to refresh()) that use any of the files
+    std::vector<std::string> affectedBy(const std::vector<std::filesystem::path>& files) const;
+
+    // Applications that use a file changed at the last refresh(), new applications included
+    std::vector<std::string> changedApplications() const;
+
+    size_t applicationCount() const { return m_applications.size(); }
+
+private:
+    struct FileRecord {
+        uint64_t size = 0;
+        int64_t time = 0;           // Last write time, in file clock ticks
+        uint64_t hash = 0;
+    };
+
+    struct Application {
+        std::string name;                       // As given to refresh()
+        std::vector<std::filesystem::path> inputs;  // The application file first
+    };
+
+    std::map<std::filesystem::path, FileRecord> m_files;
+    std::map<std::filesystem::path, Application> m_applications;   // By absolute path
+    std::set<std::filesystem::path> m_changedFiles;
+};
+
+} // namespace CSProCompiler
+
+#endif // CSPRO_WORKSPACE_GRAPH_H
@@ -0,0 +1,159 @@
+/*
+ * ApplicationInputs.cpp - Discovery of the files an application compiles from
+ */
+
+#include "../include/ApplicationInputs.h"
+#include "../include/JsonValue.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    std::string lowerExtension(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return ext;
+    }
+
+    bool isApplicationFile(const fs::path& path) {
+        std::string ext = lowerExtension(path);
+        return ext == ".ent" || ext == ".bch" || ext == ".pff";
+    }
+
+    std::string readText(const fs::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        std::string text = contents.str();
+
+        // Skip a UTF-8 byte order mark
+        if (text.size() >= 3 && text.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            text.erase(0, 3);
+        }
+        return text;
+    }
+
+    std::string trim(const std::string& text) {
+        size_t start = text.find_first_not_of(" \t\r\n\"");
+        if (start == std::string::npos) return std::string();
+        size_t end = text.find_last_not_of(" \t\r\n\"");
+        return text.substr(start, end - start + 1);
+    }
+
+    void collectJsonStrings(const JsonValue& value, std::vector<std::string>& strings) {
+        if (value.isString()) {
+            strings.push_back(value.asString());
+        } else if (value.isArray()) {
+            for (const auto& item : value.items()) collectJsonStrings(item, strings);
+        } else if (value.isObject()) {
+            for (const auto& member : value.members()) collectJsonStrings(member.second, strings);
+        }
+    }
+
+    // Every string that could name a file: JSON string values, or the
+    // right-hand side of INI-style "Key=Value" lines
+    std::vector<std::string> extractReferences(const std::string& text) {
+        std::vector<std::string> references;
+
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && text[first] == '{') {
+            try {
+                collectJsonStrings(JsonValue::parse(text), references);
+                return references;
+            }
+            catch (const JsonParseError&) {
+                // Fall through to the line-based scan
+            }
+        }
+
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t equals = line.find('=');
+            if (equals == std::string::npos) continue;
+
+            std::string value = trim(line.substr(equals + 1));
+            if (value.empty()) continue;
+            references.push_back(value);
+
+            // Some entries carry extra attributes after a comma
+            size_t comma = value.find(',');
+            if (comma != std::string::npos) {
+                references.push_back(trim(value.substr(0, comma)));
+            }
+        }
+
+        return references;
+    }
+
+    fs::path resolveReference(std::string reference, const fs::path& baseDirectory) {
+#ifndef _WIN32
+        // Application files written on Windows use backslash separators
+        std::replace(reference.begin(), reference.end(), '\\', '/');
+#endif
+        fs::path path = fs::u8path(reference);
+        if (path.is_relative()) {
+            path = baseDirectory / path;
+        }
+        return path.lexically_normal();
+    }
+
+    void discover(const fs::path& applicationFile, std::vector<fs::path>& inputs, std::set<fs::path>& seen) {
+        std::error_code ec;
+        fs::path absolutePath = resolvePath(applicationFile);
+        if (!seen.insert(absolutePath).second) return;
+        if (!fs::is_regular_file(absolutePath, ec)) return;
+
+        inputs.push_back(absolutePath);
+
+        fs::path baseDirectory = absolutePath.parent_path();
+        std::vector<fs::path> nestedApplications;
+
+        for (const auto& reference : extractReferences(readText(absolutePath))) {
+            if (reference.empty() || reference.size() > 1024) continue;
+
+            fs::path candidate = resolveReference(reference, baseDirectory);
+            if (!isApplicationInputExtension(candidate) || seen.count(candidate) > 0) continue;
+            if (!fs::is_regular_file(candidate, ec)) continue;
+
+            if (isApplicationFile(candidate)) {
+                nestedApplications.push_back(candidate);
+            } else {
+                seen.insert(candidate);
+                inputs.push_back(candidate);
+            }
+        }
+
+        for (const auto& nested : nestedApplications) {
+            discover(nested, inputs, seen);
+        }
+    }
+}
+
+bool isApplicationInputExtension(const fs::path& path) {
+    static const std::set<std::string> extensions = {
+        ".ent", ".bch", ".pff",     // applications
+        ".dcf",                     // dictionaries
+        ".fmf", ".ord",             // forms and batch order files
+        ".apc", ".app",             // logic
+        ".mgf", ".qsf", ".ecf"      // messages, question text, capi settings
+    };
+    return extensions.count(lowerExtension(path)) > 0;
+}
+
+std::vector<fs::path> discoverApplicationInputs(const fs::path& applicationFile) {
+    std::vector<fs::path> inputs;
+    std::set<fs::path> seen;
+    discover(applicationFile, inputs, seen);
+    return inputs;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,445 @@
+/*
+ * BatchCompiler.cpp - Parallel compilation of many applications
+ */
+
+#include "../include/BatchCompiler.h"
+#include "../include/JsonWriter.h"
+#include "../include/MappedFile.h"
+#include "../include/PhaseTiming.h"
+#include "../include/ResultCodec.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <set>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+#endif
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+// ----- WorkerEngine -----
+
+WorkerEngine::WorkerEngine(EngineFactory factory)
+    : m_factory(std::move(factory))
+    , m_initialized(false)
+{}
+
+WorkerEngine::~WorkerEngine() {
+    if (m_engine) {
+        m_engine->shutdown();
+    }
+}
+
+ICompilerEngine* WorkerEngine::get() {
+    if (!m_engine) {
+        m_engine = m_factory();
+        m_initialized = m_engine && m_engine->initialize();
+    }
+    return m_initialized ? m_engine.get() : nullptr;
+}
+
+// ----- BatchReport -----
+
+bool BatchReport::allSucceeded() const {
+    return std::all_of(items.begin(), items.end(), [](const BatchItemResult& item) { return item.result.success; });
+}
+
+int BatchReport::getErrorCount() const {
+    int count = 0;
+    for (const auto& item : items) count += item.result.errorCount;
+    return count;
+}
+
+int BatchReport::getWarningCount() const {
+    int count = 0;
+    for (const auto& item : items) count += item.result.warningCount;
+    return count;
+}
+
+// ----- Work-stealing scheduling -----
+
+namespace {
+    // One deque per worker; owners take from the front, thieves from the back
+    class WorkQueues {
+    public:
+        WorkQueues(size_t workerCount, size_t itemCount) {
+            for (size_t i = 0; i < workerCount; i++) {
+                m_queues.push_back(std::make_unique<Queue>());
+            }
+            for (size_t item = 0; item < itemCount; item++) {
+                m_queues[item % workerCount]->items.push_back(item);
+            }
+        }
+
+        bool pop(size_t worker, size_t& item) {
+            if (takeFront(*m_queues[worker], item)) {
+                return true;
+            }
+            for (size_t offset = 1; offset < m_queues.size(); offset++) {
+                if (takeBack(*m_queues[(worker + offset) % m_queues.size()], item)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<size_t> items;
+        };
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+
+        static bool takeFront(Queue& queue, size_t& item) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.items.empty()) return false;
+            item = queue.items.front();
+            queue.items.pop_front();
+            return true;
+        }
+
+        static bool takeBack(Queue& queue, size_t& item) {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.items.empty()) return false;
+            item = queue.items.back();
+            queue.items.pop_back();
+            return true;
+        }
+    };
+
+    CompilationResult makeFailure(const std::string& inputFile, const std::string& message) {
+        CompilationResult result;
+        result.success = false;
+        result.diagnostics.push_back({inputFile, 0, 0, message, "", DiagnosticMessage::Severity::Error});
+        return result;
+    }
+
+#ifdef _WIN32
+    // Quoted so CommandLineToArgvW gives back the argument unchanged:
+    // backslashes are literal except in front of a quote
+    std::wstring quoteArgument(const std::wstring& argument) {
+        std::wstring quoted = L"\"";
+        size_t backslashes = 0;
+        for (wchar_t ch : argument) {
+            if (ch == L'\\') {
+                backslashes++;
+            } else {
+                if (ch == L'"') quoted.append(backslashes + 1, L'\\');
+                backslashes = 0;
+            }
+            quoted += ch;
+        }
+        quoted.append(backslashes, L'\\');
+        quoted += L'"';
+        return quoted;
+    }
+
+    // Runs arguments[0] with no shell in between; returns how it ended
+    std::string runProcess(const std::vector<std::string>& arguments) {
+        std::wstring commandLine;
+        for (const auto& argument : arguments) {
+            if (!commandLine.empty()) commandLine += L' ';
+            commandLine += quoteArgument(fs::u8path(argument).wstring());
+        }
+        std::wstring application = fs::u8path(arguments.front()).wstring();
+
+        STARTUPINFOW startup = {};
+        startup.cb = sizeof(startup);
+        PROCESS_INFORMATION process = {};
+        if (!CreateProcessW(application.c_str(), commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr,
+                            &startup, &process)) {
+            return "could not be started, error " + std::to_string(GetLastError());
+        }
+        WaitForSingleObject(process.hProcess, INFINITE);
+        DWORD exitCode = 0;
+        GetExitCodeProcess(process.hProcess, &exitCode);
+        CloseHandle(process.hThread);
+        CloseHandle(process.hProcess);
+        return "exit code " + std::to_string(exitCode);
+    }
+#else
+    // Runs arguments[0] with no shell in between; returns how it ended
+    std::string runProcess(const std::vector<std::string>& arguments) {
+        std::vector<char*> argv;
+        for (const auto& argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        pid_t pid;
+        int error = posix_spawn(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+        if (error != 0) {
+            return std::string("could not be started: ") + std::strerror(error);
+        }
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0) {
+            if (errno != EINTR) return std::string("could not be waited for: ") + std::strerror(errno);
+        }
+        if (WIFSIGNALED(status)) {
+            return "killed by signal " + std::to_string(WTERMSIG(status));
+        }
+        return "exit code " + std::to_string(WEXITSTATUS(status));
+    }
+#endif
+}
+
+BatchCompiler::BatchCompiler(EngineFactory factory, CompileJob job)
+    : m_factory(std::move(factory))
+    , m_job(std::move(job))
+{}
+
+BatchReport BatchCompiler::run(const std::vector<std::string>& inputFiles, const BatchOptions& options) {
+    BatchReport report;
+    report.items.resize(inputFiles.size());
+
+    size_t workerCount = static_cast<size_t>(std::max(1, options.jobs));
+    workerCount = std::min(workerCount, std::max<size_t>(1, inputFiles.size()));
+    report.jobs = static_cast<int>(workerCount);
+
+    WorkQueues queues(workerCount, inputFiles.size());
+    auto batchStart = std::chrono::high_resolution_clock::now();
+
+    auto workerMain = [&](size_t worker) {
+        WorkerEngine engine(m_factory);
+        size_t index;
+
+        while (queues.pop(worker, index)) {
+            BatchItemResult& item = report.items[index];
+            item.inputFile = inputFiles[index];
+            item.worker = static_cast<int>(worker);
+
+            auto itemStart = std::chrono::high_resolution_clock::now();
+            double itemStartMs = traceClockMs();
+            try {
+                item.result = options.useProcesses
+                    ? compileInProcess(item.inputFile, options)
+                    : m_job(item.inputFile, engine);
+            }
+            catch (const std::exception& ex) {
+                item.result = makeFailure(item.inputFile, std::string("Exception: ") + ex.what());
+            }
+            catch (...) {
+                item.result = makeFailure(item.inputFile, "Unknown exception during compilation");
+            }
+            auto itemEnd = std::chrono::high_resolution_clock::now();
+            item.wallTimeMs = std::chrono::duration<double, std::milli>(itemEnd - itemStart).count();
+
+            // Worker processes time their phases on their own clock; keep at least the item's span
+            if (item.result.phases.empty()) {
+                item.result.phases.push_back({ fs::u8path(item.inputFile).filename().u8string(), itemStartMs, item.wallTimeMs, -1 });
+            }
+        }
+    };
+
+    if (workerCount == 1) {
+        workerMain(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t worker = 0; worker < workerCount; worker++) {
+            workers.emplace_back(workerMain, worker);
+        }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
+
+    auto batchEnd = std::chrono::high_resolution_clock::now();
+    report.totalWallTimeMs = std::chrono::duration<double, std::milli>(batchEnd - batchStart).count();
+    for (const auto& item : report.items) {
+        report.cumulativeWallTimeMs += item.wallTimeMs;
+    }
+
+    return report;
+}
+
+CompilationResult BatchCompiler::compileInProcess(const std::string& inputFile, const BatchOptions& options) {
+    static std::atomic<unsigned> sequence{0};
+    static const unsigned runId = std::random_device{}();
+
+    fs::path resultPath = fs::temp_directory_path() /
+        ("csprocompile-" + std::to_string(runId) + "-" + std::to_string(sequence++) + ".result");
+
+    std::vector<std::string> arguments = { options.executablePath, inputFile, "--binary-result", resultPath.u8string() };
+    arguments.insert(arguments.end(), options.childArguments.begin(), options.childArguments.end());
+    std::string ending = runProcess(arguments);
+
+    // The worker's result is decoded straight from the mapped file
+    CompilationResult result;
+    bool decoded;
+    {
+        MappedFile file;
+        decoded = file.open(resultPath) && decodeCompilationResult(file.view(), result);
+    }
+    std::error_code ec;
+    fs::remove(resultPath, ec);
+
+    if (!decoded) {
+        return makeFailure(inputFile, "Worker process produced no result (" + ending + ")");
+    }
+    return result;
+}
+
+// ----- Input expansion -----
+
+namespace {
+    bool hasWildcard(const std::string& text) {
+        return text.find_first_of("*?") != std::string::npos;
+    }
+
+    bool wildcardMatch(const std::string& pattern, const std::string& name) {
+        size_t p = 0, n = 0;
+        size_t starPattern = std::string::npos, starName = 0;
+
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                p++;
+                n++;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                starPattern = p++;
+                starName = n;
+            } else if (starPattern != std::string::npos) {
+                p = starPattern + 1;
+                n = ++starName;
+            } else {
+                return false;
+            }
+        }
+
+        while (p < pattern.size() && pattern[p] == '*') p++;
+        return p == pattern.size();
+    }
+
+    bool isCompilableApplication(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return ext == ".ent" || ext == ".bch";
+    }
+
+    void expandGlob(const fs::path& current, const std::vector<std::string>& parts, size_t index, std::vector<fs::path>& matches) {
+        std::error_code ec;
+        fs::path directory = current.empty() ? fs::path(".") : current;
+
+        // Like a directory search, a glob yields only applications, so "app/*"
+        // does not hand the dictionaries and logic files to the compiler
+        if (index == parts.size()) {
+            if (fs::is_regular_file(directory, ec) && isCompilableApplication(current)) matches.push_back(current);
+            return;
+        }
+
+        const std::string& part = parts[index];
+
+        if (part == "**") {
+            expandGlob(current, parts, index + 1, matches);
+            for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+                if (it->is_directory(ec)) {
+                    expandGlob(current / it->path().filename(), parts, index, matches);
+                }
+            }
+        }
+        else if (!hasWildcard(part)) {
+            expandGlob(current / part, parts, index + 1, matches);
+        }
+        else {
+            for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+                std::string name = it->path().filename().string();
+                if (wildcardMatch(part, name)) {
+                    expandGlob(current / name, parts, index + 1, matches);
+                }
+            }
+        }
+    }
+}
+
+std::vector<std::string> expandInputPatterns(const std::vector<std::string>& patterns) {
+    std::vector<fs::path> matches;
+
+    for (const auto& pattern : patterns) {
+        fs::path path(pattern);
+        std::error_code ec;
+
+        if (hasWildcard(pattern)) {
+            fs::path root = path.root_path();
+            std::vector<std::string> parts;
+            for (const auto& component : path.relative_path()) {
+                parts.push_back(component.string());
+            }
+            expandGlob(root, parts, 0, matches);
+        }
+        else if (fs::is_directory(path, ec)) {
+            for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+                if (it->is_regular_file(ec) && isCompilableApplication(it->path())) {
+                    matches.push_back(it->path());
+                }
+            }
+        }
+        else {
+            matches.push_back(path);
+        }
+    }
+
+    std::set<std::string> seen;
+    std::vector<std::string> inputs;
+    for (const auto& match : matches) {
+        std::string normalized = match.lexically_normal().string();
+        if (seen.insert(normalized).second) {
+            inputs.push_back(normalized);
+        }
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return inputs;
+}
+
+// ----- Reporting -----
+
+void writeBatchReportJson(std::ostream& out, const BatchReport& report) {
+    std::string buffer;
+    JsonWriter writer(buffer, true);
+
+    writer.beginObject();
+    writer.member("success", report.allSucceeded());
+    writer.member("jobs", report.jobs);
+    writer.member("applicationCount", static_cast<unsigned long long>(report.items.size()));
+    writer.member("errorCount", report.getErrorCount());
+    writer.member("warningCount", report.getWarningCount());
+    writer.member("totalWallTime", report.totalWallTimeMs / 1000.0);
+    writer.member("cumulativeWallTime", report.cumulativeWallTimeMs / 1000.0);
+    writer.member("speedup", report.getSpeedup());
+    writer.key("applications").beginArray();
+
+    for (const auto& item : report.items) {
+        writer.beginObject();
+        writer.member("file", item.inputFile);
+        writer.member("wallTime", item.wallTimeMs / 1000.0);
+        writeCompilationResultMembers(writer, item.result);
+        writer.endObject();
+    }
+
+    writer.endArray();
+    writer.endObject();
+    buffer += '\n';
+
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+} // namespace CSProCompiler
@@ -10,23 +10,80 @@
  * - Provides JSON output for editor integration
  * 
  * Usage:
- *   CSProCompile <application.ent|.bch> [options] /* Has been changed to use entry compilation instead of Batch */
+ *   CSProCompile <application.ent|.bch> [options]   (now uses entry compilation instead of Batch)
  *   CSProCompile <application.ent> [options]
+ *   CSProCompile <app.ent|directory|glob>... -j <n> [options]
  * 
  * Options:
  *   -o <file>     Output compilation results to JSON file
  *   -v            Verbose mode
  *   --check-only  Only check syntax, don't generate binaries
  *   --json        Output errors in JSON format (for VS Code)
+ *   --stream      Emit each diagnostic as soon as it is produced (NDJSON with --json)
+ *   --delta <f>   With --json, report only diagnostics changed since the last run (state in f)
+ *   --binary-result <f> Write the result to f in the binary encoding (ResultCodec.h)
+ *   --affected-by <f> Compile only the applications that use file f (repeatable)
+ *   --changed-since Compile only the applications whose inputs changed since the last successful run
+ *   --graph <f>   Workspace dependency graph file (default .csprocompile/workspace.graph)
+ *   -j <n>        Compile applications in parallel with n workers
+ *   --processes   Use worker processes instead of worker threads
+ *   --no-cache    Always run the compiler, ignoring cached results
+ *   --scripted-engine Compile with the marker-driven stand-in engine (for CSProCorpusGen corpora)
+ *   --script-delay <ms> With --scripted-engine, simulated compile time
+ *   --store <dir> Share results and .pen files with other checkouts through this store
+ *   --store-size <MB> Size cap of the store (default 1024)
+ *   --store-stats Print the store's hit/miss counters and size, then exit
+ *   --workers <h:p,...> Compile the applications on these build workers
+ *   --worker <[host:]port> Serve as a build worker (loopback interface unless a host is given)
+ *   --worker-dir <dir> With --worker, where the mirrored sources live
+ *   --server      Serve line-delimited JSON compile requests on stdin
+ *   --socket <p>  With --server, listen on a Unix domain socket instead
+ *   --pool <n>    With --server, keep n engines initialized (default 1)
+ *   --recycle-after <n> With --server, replace an engine after n compiles
+ *   --max-rss <MB> With --server, replace the engine that pushes memory past this
+ *   --trace <f>   Write per-phase timings as a Chrome trace-event file
+ *   --watch       Recompile whenever an input file changes
+ *   --debounce <ms> With --watch, wait for saves to settle (default 200)
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <csignal>
+#include <map>
+#include <memory>
+#include <set>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <cstdlib>
 #include <cstring>
+#include <thread>
+#include "../include/ApplicationInputs.h"
+#include "../include/BatchCompiler.h"
 #include "../include/CompilerInterface.h"
+#include "../include/CompileServer.h"
+#include "../include/EnginePool.h"
+#include "../include/ContentHash.h"
+#include "../include/DiagnosticDelta.h"
+#include "../include/DistributedCompiler.h"
+#include "../include/FileWatcher.h"
+#include "../include/FileWriter.h"
+#include "../include/IncrementalCompiler.h"
+#include "../include/JsonWriter.h"
+#include "../include/LogicScanner.h"
+#include "../include/MessageCatalog.h"
+#include "../include/PhaseTiming.h"
+#include "../include/ReportWriter.h"
+#include "../include/ResultCache.h"
+#include "../include/ResultCodec.h"
+#include "../include/ResultStore.h"
+#include "../include/ScriptedEngine.h"
+#include "../include/SharedObjectCache.h"
+#include "../include/WorkingDirectory.h"
+#include "../include/WorkspaceGraph.h"
 
 // For compatibility with legacy code
 namespace CSPro {
@@ -34,31 +91,209 @@ namespace CSPro {
     using CompilationResult = CSProCompiler::CompilationResult;
 }
 
+// The watcher a running --watch blocks on, so Ctrl+C can end it cleanly
+static CSProCompiler::FileWatcher* activeWatcher = nullptr;
+
+extern "C" void stopWatching(int) {
+    if (activeWatcher != nullptr) {
+        activeWatcher->stop();
+    }
+}
+
+// Writes each diagnostic the moment it arrives, as one NDJSON object or one text line,
+// then forwards it to the next sink (the report files)
+class StreamingOutputSink : public CSProCompiler::IDiagnosticSink {
+private:
+    std::ostream& out;
+    bool json;
+    CSProCompiler::IDiagnosticSink* next;
+    std::string line;   // Reused for every diagnostic
+
+public:
+    StreamingOutputSink(std::ostream& stream, bool jsonMode, CSProCompiler::IDiagnosticSink* nextSink)
+        : out(stream), json(jsonMode), next(nextSink) {}
+
+    void onDiagnostic(const CSProCompiler::DiagnosticView& diag) override {
+        line.clear();
+        if (json) {
+            CSProCompiler::JsonWriter writer(line);
+            writer.beginObject();
+            writer.member("type", "diagnostic");
+            writer.member("file", diag.file);
+            writer.member("line", diag.line);
+            writer.member("column", diag.column);
+            writer.member("message", diag.message);
+            writer.member("procName", diag.procName);
+            writer.member("severity", diag.getSeverityString());
+            writer.endObject();
+        } else {
+            line.append(diag.file).append("(").append(std::to_string(diag.line)).append(",")
+                .append(std::to_string(diag.column)).append("): ").append(diag.getSeverityString())
+                .append(": ").append(diag.message);
+        }
+        line += '\n';
+        out.write(line.data(), static_cast<std::streamsize>(line.size()));
+        out.flush();
+
+        if (next != nullptr) {
+            next->onDiagnostic(diag);
+        }
+    }
+
+    void writeSummary(const CSPro::CompilationResult& result) {
+        if (json) {
+            line.clear();
+            CSProCompiler::JsonWriter writer(line);
+            writer.beginObject();
+            writer.member("type", "summary");
+            writer.member("success", result.success);
+            writer.member("errorCount", result.errorCount);
+            writer.member("warningCount", result.warningCount);
+            writer.member("compilationTime", result.compilationTimeMs / 1000.0);
+            writer.member("cached", result.fromCache);
+            writer.key("phases");
+            CSProCompiler::writePhasesJson(writer, result.phases);
+            writer.endObject();
+            out << line << "\n";
+        } else if (result.success) {
+            out << "Compilation successful!\n";
+        } else {
+            out << "Compilation failed with " << result.errorCount << " error(s) and "
+                << result.warningCount << " warning(s)\n";
+        }
+        out.flush();
+    }
+};
+
 class CSProCommandLineCompiler {
 private:
     std::string inputFile;
+    std::vector<std::string> inputPatterns;
     std::string outputFile;
+    std::string executablePath;
+    std::string socketPath;
+    std::string traceFile;
+    std::string deltaStateFile;
+    std::string binaryResultFile;   // Worker processes hand their result back through this
+    std::vector<std::string> affectedFiles;     // --affected-by
+    bool changedSince = false;
+    std::string graphFile;
+    std::string storeDirectory;                 // --store
+    int storeMegabytes = 1024;
+    std::unique_ptr<CSProCompiler::ResultStore> store;     // Shared by the worker threads
+    CSProCompiler::EngineFactory engineFactory = CSProCompiler::createCompilerEngine;
+    int scriptDelayMs = -1;                     // --scripted-engine; -1 for the CSPro engine
+    std::string engineIdentity = CSProCompiler::compilerEngineIdentity();  // Keys cached and stored results
+    std::vector<CSProCompiler::WorkerAddress> workerAddresses;     // --workers
+    bool workerMode = false;                    // --worker
+    CSProCompiler::WorkerAddress workerAddress;
+    std::string workerDirectory;
     bool verboseMode;
     bool checkOnly;
     bool jsonOutput;
+    bool serverMode;
+    bool watchMode;
+    bool streamOutput;
+    bool useCache;
+    bool forceProcesses;
+    int jobs;
+    int debounceMs;
+    CSProCompiler::EnginePoolOptions poolOptions;  // Server mode
     std::vector<CSPro::CompilationError> errors;
+    CSProCompiler::AsyncFileWriter reportFiles;     // Reports are written while results go out
+    std::unique_ptr<CSProCompiler::IncrementalCompiler> incremental;   // Watch mode: recompile only edited PROCs
+    CSProCompiler::DiagnosticDeltaTracker deltas;   // --delta: diagnostics of the previous output
+    bool deltaStateLoaded = false;
 
 public:
-    CSProCommandLineCompiler() : verboseMode(false), checkOnly(false), jsonOutput(false) {}
+    CSProCommandLineCompiler() : verboseMode(false), checkOnly(false), jsonOutput(false), serverMode(false), watchMode(false), streamOutput(false), useCache(true), forceProcesses(false), jobs(0), debounceMs(200) {}
 
     void setInputFile(const std::string& file) { inputFile = file; }
+    void addInputPattern(const std::string& pattern) { inputPatterns.push_back(pattern); inputFile = inputPatterns.front(); }
+    void setJobs(int count) { jobs = count; }
+    void setForceProcesses(bool mode) { forceProcesses = mode; }
+    void setExecutablePath(const std::string& path) { executablePath = path; }
     void setOutputFile(const std::string& file) { outputFile = file; }
     void setVerboseMode(bool mode) { verboseMode = mode; }
     void setCheckOnly(bool mode) { checkOnly = mode; }
     void setJsonOutput(bool mode) { jsonOutput = mode; }
+    void setServerMode(bool mode) { serverMode = mode; }
+    void setWatchMode(bool mode) { watchMode = mode; }
+    void setDebounceMs(int milliseconds) { debounceMs = milliseconds; }
+    void setSocketPath(const std::string& path) { socketPath = path; }
+    void setTraceFile(const std::string& file) { traceFile = file; }
+    void setDeltaStateFile(const std::string& file) { deltaStateFile = file; }
+    void setBinaryResultFile(const std::string& file) { binaryResultFile = file; }
+    void addAffectedFile(const std::string& file) { affectedFiles.push_back(file); }
+    void setChangedSince(bool mode) { changedSince = mode; }
+    void setGraphFile(const std::string& file) { graphFile = file; }
+    void setUseCache(bool mode) { useCache = mode; }
+    void setStoreDirectory(const std::string& directory) { storeDirectory = directory; }
+    void setStoreMegabytes(int megabytes) { storeMegabytes = megabytes; }
+    void setScriptedEngine(int compileDelayMs) {
+        scriptDelayMs = compileDelayMs;
+        engineIdentity = CSProCompiler::ScriptedEngine::identity();
+        engineFactory = [compileDelayMs]() { return std::make_unique<CSProCompiler::ScriptedEngine>(compileDelayMs); };
+    }
+    void addWorkerAddress(const CSProCompiler::WorkerAddress& address) { workerAddresses.push_back(address); }
+    void setWorkerAddress(const CSProCompiler::WorkerAddress& address) { workerMode = true; workerAddress = address; }
+    void setWorkerDirectory(const std::string& directory) { workerDirectory = directory; }
+    void setStreamOutput(bool mode) { streamOutput = mode; }
+    void setPoolSize(int count) { poolOptions.size = count; }
+    void setRecycleAfter(int compiles) { poolOptions.maxCompilesPerEngine = compiles; }
+    void setMaxResidentMegabytes(int megabytes) { poolOptions.maxResidentBytes = static_cast<size_t>(megabytes) * 1024 * 1024; }
+
+    // Opened before any compile, so worker threads only ever read the pointer
+    void openStore() {
+        if (!storeDirectory.empty() && !store) {
+            store = std::make_unique<CSProCompiler::ResultStore>(std::filesystem::u8path(storeDirectory),
+                                                                 static_cast<uint64_t>(storeMegabytes) * 1024 * 1024);
+        }
+    }
+
+    int printStoreStats() {
+        if (storeDirectory.empty()) {
+            std::cerr << "Error: --store-stats requires --store <dir>\n";
+            return 1;
+        }
+        openStore();
+        CSProCompiler::ResultStoreStats totals = store->readTotals();
+        long long lookups = totals.hits + totals.misses;
+        std::cout << "Store: " << store->getDirectory().u8string() << "\n"
+                  << "Entries: " << totals.entryCount << " (" << (totals.totalBytes + 1024 * 1024 - 1) / (1024 * 1024)
+                  << " of " << storeMegabytes << " MB)\n"
+                  << "Hits: " << totals.hits << ", misses: " << totals.misses;
+        if (lookups > 0) {
+            std::cout << " (" << (100 * totals.hits / lookups) << "% hit rate)";
+        }
+        std::cout << "\nInserts: " << totals.inserts << ", evictions: " << totals.evictions
+                  << " (" << totals.evictedBytes << " bytes)" << std::endl;
+        return 0;
+    }
+
+    bool isServerMode() const { return serverMode; }
+    bool isWorkerMode() const { return workerMode; }
+    bool isWatchMode() const { return watchMode; }
+    bool isStreamOutput() const { return streamOutput; }
+
+    bool isBatchMode() const {
+        if (jobs > 0 || inputPatterns.size() > 1 || !affectedFiles.empty() || changedSince || !workerAddresses.empty()) return true;
+        if (inputPatterns.empty()) return false;
+        return inputPatterns.front().find_first_of("*?") != std::string::npos ||
+               std::filesystem::is_directory(inputPatterns.front());
+    }
 
     bool validateInputFile() {
-        if (!std::filesystem::exists(inputFile)) {
-            std::cerr << "Error: Input file not found: " << inputFile << std::endl;
+        return validateInputFile(inputFile);
+    }
+
+    static bool validateInputFile(const std::string& file) {
+        if (!std::filesystem::exists(file)) {
+            std::cerr << "Error: Input file not found: " << file << std::endl;
             return false;
         }
 
-        std::string ext = std::filesystem::path(inputFile).extension().string();
+        std::string ext = std::filesystem::path(file).extension().string();
         if (ext != ".ent" && ext != ".bch" && ext != ".pff") {
             std::cerr << "Error: Invalid file type. Expected .ent, .bch, or .pff" << std::endl;
             return false;
@@ -68,141 +303,710 @@ public:
     }
 
     CSPro::CompilationResult compile() {
+        CSProCompiler::WorkerEngine engine(engineFactory);
+        return compileApplication(inputFile, engine);
+    }
+
+    // Compile one application with a lazily created engine, consulting the result cache first
+    CSPro::CompilationResult compileApplication(const std::string& applicationFile, CSProCompiler::WorkerEngine& workerEngine) {
         if (verboseMode) {
-            std::cout << "Compiling: " << inputFile << std::endl;
+            std::cout << "Compiling: " << applicationFile << std::endl;
             if (checkOnly) {
                 std::cout << "Mode: Syntax check only" << std::endl;
             }
         }
 
-        // Use real CSPro compiler engine
-        auto engine = CSProCompiler::createCompilerEngine();
-        
-        if (!engine->initialize()) {
-            CSPro::CompilationResult result;
-            result.success = false;
-            result.compilationTimeMs = 0.0;
-            CSProCompiler::DiagnosticMessage msg;
-            msg.severity = CSProCompiler::DiagnosticMessage::Severity::Error;
-            msg.message = "Failed to initialize CSPro compiler";
-            result.diagnostics.push_back(msg);
-            result.errorCount = 1;
-            return result;
-        }
-
         // Set compilation options
         CSProCompiler::CompilerOptions options;
-        options.inputFile = inputFile;
+        options.inputFile = applicationFile;
         options.verboseOutput = verboseMode;
         options.checkSyntaxOnly = checkOnly;
-        
-        // Compile
-        auto result = engine->compile(options);
-        
-        // Shutdown engine
-        engine->shutdown();
-        
-        // Save errors to compileErrors.txt in the same folder as the .ent file
-        if (!result.diagnostics.empty()) {
-            std::filesystem::path entPath(inputFile);
-            std::filesystem::path errorFilePath = entPath.parent_path() / "compileErrors.txt";
-            std::filesystem::path formattedFilePath = entPath.parent_path() / "compileErrorsFormatted.txt";
-            
-            // Save detailed format (original)
-            std::ofstream errorFile(errorFilePath);
-            if (errorFile.is_open()) {
-                errorFile << "CSPro Compilation Errors/Warnings\n";
-                errorFile << "==================================\n";
-                errorFile << "File: " << inputFile << "\n";
-                errorFile << "Date: " << __DATE__ << " " << __TIME__ << "\n";
-                errorFile << "Total Errors: " << result.errorCount << "\n";
-                errorFile << "Total Warnings: " << result.warningCount << "\n";
-                errorFile << "\n";
-                
-                for (const auto& diag : result.diagnostics) {
-                    std::string severity = (diag.severity == CSProCompiler::DiagnosticMessage::Severity::Error) ? "ERROR" : "WARNING";
-                    errorFile << severity << " at line " << diag.line << ", column " << diag.column << ":\n";
-                    errorFile << "  " << diag.message << "\n";
-                    errorFile << "  Location: " << diag.file << "\n";
-                    errorFile << "\n";
+
+        // Phases are gathered here and attached once the engine's result is in hand
+        std::vector<CSProCompiler::PhaseSpan> phases;
+        CSProCompiler::PhaseRecorder recorder(phases);
+        CSProCompiler::PhaseScope applicationPhase(recorder, std::filesystem::u8path(applicationFile).filename().u8string());
+
+        // Unchanged inputs reuse the stored result without touching the engine
+        auto lookupStart = std::chrono::high_resolution_clock::now();
+        CSProCompiler::ResultCache cache(applicationFile);
+        std::string cacheKey;
+        CSProCompiler::PhaseScope keyPhase(recorder, "cache-key");
+        bool cacheable = useCache && cache.computeKey(options, engineIdentity, cacheKey);
+        keyPhase.end();
+
+        CSPro::CompilationResult result;
+
+        CSProCompiler::PhaseScope lookupPhase(recorder, "cache-lookup");
+        bool cached = cacheable && cache.lookup(cacheKey, result);
+        lookupPhase.end();
+
+        if (cached) {
+            auto lookupEnd = std::chrono::high_resolution_clock::now();
+            result.compilationTimeMs = std::chrono::duration<double, std::milli>(lookupEnd - lookupStart).count();
+            if (verboseMode) {
+                std::cout << "Inputs unchanged, using cached result: " << cache.getCachePath().string() << std::endl;
+            }
+        }
+
+        // Then the shared store, which other checkouts of the same sources fill
+        std::string storeKey;
+        if (!cached && store && useCache) {
+            CSProCompiler::PhaseScope storeLookupPhase(recorder, "store-lookup");
+            cached = CSProCompiler::ResultStore::computeKey(applicationFile, options, engineIdentity, storeKey) &&
+                     store->lookup(storeKey, applicationFile, result);
+            storeLookupPhase.end();
+
+            if (cached) {
+                auto lookupEnd = std::chrono::high_resolution_clock::now();
+                result.compilationTimeMs = std::chrono::duration<double, std::milli>(lookupEnd - lookupStart).count();
+                if (cacheable) {
+                    cache.store(cacheKey, result);
                 }
-                
-                errorFile.close();
-                
                 if (verboseMode) {
-                    std::cout << "Errors/warnings saved to: " << errorFilePath.string() << std::endl;
+                    std::cout << "Inputs found in store, using stored result: " << store->getDirectory().u8string() << std::endl;
                 }
             }
+        }
+
+        // A syntax check that the native pre-scan already fails never
+        // creates or initializes an engine
+        bool prescanFailed = !cached && checkOnly && prescan(options, recorder, result);
+
+        if (!cached && !prescanFailed) {
+            // Use real CSPro compiler engine
+            CSProCompiler::ICompilerEngine* engine;
+            if (workerEngine.isCreated()) {
+                engine = workerEngine.get();
+            } else {
+                CSProCompiler::PhaseScope initPhase(recorder, "engine-init");
+                engine = workerEngine.get();
+            }
             
-            // Save Designer-compatible format
-            std::ofstream formattedFile(formattedFilePath);
-            if (formattedFile.is_open()) {
-                for (const auto& diag : result.diagnostics) {
-                    std::string severity = (diag.severity == CSProCompiler::DiagnosticMessage::Severity::Error) ? "ERROR" : "WARNING";
-                    
-                    // Format like CSPro Designer: SEVERITY(ProcName, line): message
-                    if (!diag.procName.empty() && diag.line > 0) {
-                        formattedFile << severity << "(" << diag.procName << ", " << diag.line << "): " << diag.message << "\n";
-                    } else if (!diag.procName.empty()) {
-                        formattedFile << severity << "(" << diag.procName << "): " << diag.message << "\n";
-                    } else if (diag.line > 0) {
-                        formattedFile << severity << "(" << diag.line << "): " << diag.message << "\n";
-                    } else {
-                        formattedFile << severity << ": " << diag.message << "\n";
-                    }
+            if (engine == nullptr) {
+                result.success = false;
+                result.compilationTimeMs = 0.0;
+                result.diagnostics.push_back({"", 0, 0, "Failed to initialize CSPro compiler", "", CSProCompiler::DiagnosticMessage::Severity::Error});
+                result.errorCount = 1;
+                applicationPhase.end();
+                result.phases = std::move(phases);
+                return result;
+            }
+
+            // Compile
+            CSProCompiler::PhaseScope compilePhase(recorder, "compile");
+            if (watchMode) {
+                // One engine serves the whole watch, so per-PROC state carries across saves
+                if (!incremental) {
+                    incremental = std::make_unique<CSProCompiler::IncrementalCompiler>(*engine);
                 }
-                
-                formattedFile.close();
-                
-                if (verboseMode) {
-                    std::cout << "Formatted errors saved to: " << formattedFilePath.string() << std::endl;
+                result = incremental->compile(options);
+                const CSProCompiler::IncrementalStats& units = incremental->getLastStats();
+                if (verboseMode && !units.fullCompile) {
+                    std::cout << "Recompiled " << units.compiledUnitCount << " of " << units.unitCount << " PROCs" << std::endl;
+                }
+            } else {
+                result = engine->compile(options);
+            }
+            recorder.adopt(result.phases);
+            compilePhase.end();
+        }
+
+        if (!cached) {
+            if (cacheable && CSProCompiler::ResultCache::isCacheable(result)) {
+                CSProCompiler::PhaseScope storePhase(recorder, "cache-store");
+                cache.store(cacheKey, result);
+            }
+            if (!storeKey.empty() && CSProCompiler::ResultCache::isCacheable(result)) {
+                CSProCompiler::PhaseScope storeInsertPhase(recorder, "store-insert");
+                if (!store->insert(storeKey, applicationFile, result) && verboseMode) {
+                    std::cout << "Could not add the result to the store: " << store->getDirectory().u8string() << std::endl;
                 }
             }
         }
         
+        CSProCompiler::PhaseScope reportPhase(recorder, "reports");
+        writeReports(applicationFile, result);
+        reportPhase.end();
+
+        applicationPhase.end();
+        result.phases = std::move(phases);
         return result;
     }
 
+    // The native structural pre-scan of a syntax check; true, with its
+    // errors in result, when the engine need not be started at all
+    bool prescan(const CSProCompiler::CompilerOptions& options, CSProCompiler::PhaseRecorder& recorder, CSPro::CompilationResult& result) {
+        CSProCompiler::PhaseScope prescanPhase(recorder, "prescan");
+        CSPro::CompilationResult scanned = CSProCompiler::prescanApplication(options);
+        prescanPhase.end();
+
+        if (scanned.errorCount == 0) {
+            return false;
+        }
+        result = std::move(scanned);
+        return true;
+    }
+
+    // Save errors to compileErrors.txt in the same folder as the .ent file
+    void writeReports(const std::string& applicationFile, const CSPro::CompilationResult& result) {
+        CSProCompiler::ReportWriter reports(applicationFile);
+        for (const auto& diag : result.diagnostics) {
+            reports.onDiagnostic(diag);
+        }
+        bool reportsWritten = reports.finish(result, &reportFiles);
+        if (reportsWritten && verboseMode) {
+            std::cout << "Errors/warnings saved to: " << reports.getDetailedPath().string() << std::endl;
+            std::cout << "Formatted errors saved to: " << reports.getFormattedPath().string() << std::endl;
+        }
+    }
+
+    // Emit each diagnostic as soon as the engine converts it instead of after the compile
+    int runStreaming() {
+        std::ofstream file;
+        if (!outputFile.empty()) {
+            file.open(outputFile);
+        }
+        std::ostream& out = file.is_open() ? file : (jsonOutput ? std::cout : std::cerr);
+
+        CSProCompiler::ReportWriter reports(inputFile);
+        StreamingOutputSink sink(out, jsonOutput, &reports);
+
+        CSProCompiler::CompilerOptions options;
+        options.inputFile = inputFile;
+        options.verboseOutput = verboseMode;
+        options.checkSyntaxOnly = checkOnly;
+
+        // Streamed diagnostics are never collected, so this mode reads the cache but does not fill it
+        CSProCompiler::ResultCache cache(inputFile);
+        std::string cacheKey;
+        CSPro::CompilationResult result;
+
+        std::vector<CSProCompiler::PhaseSpan> phases;
+        CSProCompiler::PhaseRecorder recorder(phases);
+        CSProCompiler::PhaseScope applicationPhase(recorder, std::filesystem::u8path(inputFile).filename().u8string());
+
+        CSProCompiler::PhaseScope lookupPhase(recorder, "cache-lookup");
+        bool cached = useCache && cache.computeKey(options, engineIdentity, cacheKey) && cache.lookup(cacheKey, result);
+        lookupPhase.end();
+
+        if (cached) {
+            for (const auto& diag : result.diagnostics) {
+                sink.onDiagnostic(diag);
+            }
+            result.diagnostics.clear();
+        }
+        else if (checkOnly && prescan(options, recorder, result)) {
+            for (const auto& diag : result.diagnostics) {
+                sink.onDiagnostic(diag);
+            }
+            result.diagnostics.clear();
+        }
+        else {
+            CSProCompiler::WorkerEngine workerEngine(engineFactory);
+            CSProCompiler::PhaseScope initPhase(recorder, "engine-init");
+            CSProCompiler::ICompilerEngine* engine = workerEngine.get();
+            initPhase.end();
+
+            if (engine == nullptr) {
+                // As in the buffered path, an engine failure does not overwrite the reports
+                StreamingOutputSink failureSink(out, jsonOutput, nullptr);
+                result.errorCount = 1;
+                failureSink.onDiagnostic({"", 0, 0, "Failed to initialize CSPro compiler", "", CSProCompiler::DiagnosticMessage::Severity::Error});
+            } else {
+                CSProCompiler::PhaseScope compilePhase(recorder, "compile");
+                result = engine->compileStreaming(options, sink);
+                recorder.adopt(result.phases);
+            }
+        }
+
+        CSProCompiler::PhaseScope reportPhase(recorder, "reports");
+        reports.finish(result, &reportFiles);
+        reportPhase.end();
+
+        applicationPhase.end();
+        result.phases = std::move(phases);
+        sink.writeSummary(result);
+        writeTrace({ { "main", 1, &result.phases } });
+        waitForReports();
+
+        return result.success ? 0 : 1;
+    }
+
+    // --worker: compile what coordinators send until the process is stopped
+    int runWorker() {
+        std::filesystem::path directory = workerDirectory.empty()
+            ? std::filesystem::temp_directory_path() / ("csprocompile-worker-" + std::to_string(workerAddress.port))
+            : CSProCompiler::resolvePath(std::filesystem::u8path(workerDirectory));
+
+        CSProCompiler::BuildWorker worker(engineFactory, directory);
+        worker.setVerbose(verboseMode);
+        std::string error;
+        if (!worker.listen(workerAddress, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        std::cerr << "Build worker listening on " << workerAddress.host << ":" << worker.getPort()
+                  << ", sources in " << directory.u8string() << std::endl;
+        worker.serve();
+        return 0;
+    }
+
+    // Many applications: expand directories and globs, then compile across a worker pool
+    int runBatch() {
+        // Narrowing down to affected applications looks at the whole current directory by default
+        bool selective = !affectedFiles.empty() || changedSince;
+        std::vector<std::string> patterns = inputPatterns;
+        if (patterns.empty() && selective) {
+            patterns.push_back(".");
+        }
+
+        std::vector<std::string> applications = CSProCompiler::expandInputPatterns(patterns);
+        if (applications.empty()) {
+            std::cerr << "Error: No applications found" << std::endl;
+            return 1;
+        }
+
+        CSProCompiler::WorkspaceGraph graph;
+        std::filesystem::path graphPath = graphFile.empty() ? CSProCompiler::WorkspaceGraph::defaultGraphPath()
+                                                            : CSProCompiler::resolvePath(std::filesystem::u8path(graphFile));
+        if (selective) {
+            applications = selectAffectedApplications(graph, graphPath, applications);
+            if (applications.empty()) {
+                std::cerr << "No applications affected" << std::endl;
+                if (changedSince) {
+                    saveGraph(graph, graphPath);
+                }
+                return 0;
+            }
+        }
+
+        for (const auto& application : applications) {
+            if (!validateInputFile(application)) {
+                return 1;
+            }
+        }
+
+        CSProCompiler::BatchReport report;
+        if (!workerAddresses.empty()) {
+            report = compileOnWorkers(applications);
+        } else {
+            CSProCompiler::BatchOptions options;
+            options.jobs = jobs > 0 ? jobs : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+            options.executablePath = executablePath;
+            if (checkOnly) options.childArguments.push_back("--check-only");
+            if (!useCache) options.childArguments.push_back("--no-cache");
+            if (scriptDelayMs >= 0) {
+                options.childArguments.push_back("--scripted-engine");
+                options.childArguments.push_back("--script-delay");
+                options.childArguments.push_back(std::to_string(scriptDelayMs));
+            }
+            if (!storeDirectory.empty()) {
+                options.childArguments.push_back("--store");
+                options.childArguments.push_back(storeDirectory);
+                options.childArguments.push_back("--store-size");
+                options.childArguments.push_back(std::to_string(storeMegabytes));
+            }
+
+            // Engines that cannot compile concurrently in one process get one process per application
+            options.useProcesses = forceProcesses ||
+                (options.jobs > 1 && !engineFactory()->supportsConcurrentCompiles());
+
+            if (verboseMode) {
+                std::cerr << "Compiling " << applications.size() << " application(s) with " << options.jobs
+                          << (options.useProcesses ? " worker process(es)" : " worker thread(s)") << std::endl;
+            }
+
+            CSProCompiler::BatchCompiler batch(engineFactory,
+                [this](const std::string& application, CSProCompiler::WorkerEngine& engine) {
+                    return compileApplication(application, engine);
+                });
+
+            report = batch.run(applications, options);
+
+            if (verboseMode && !options.useProcesses) {
+                CSProCompiler::SharedObjectCacheStats dictionaries = CSProCompiler::sharedDictionaryCache().getStats();
+                std::cerr << "Dictionaries: " << dictionaries.misses << " parsed, " << dictionaries.hits << " reused ("
+                          << (dictionaries.peakBytes + 1024 * 1024 - 1) / (1024 * 1024) << " MB at peak)" << std::endl;
+            }
+        }
+
+        outputBatchResults(report);
+        waitForReports();
+
+        // A failed run keeps the previous graph, so its changes are compiled again next time.
+        // Only --changed-since compiles every changed application; saving after --affected-by
+        // alone would mark other edits as seen without compiling them.
+        if (changedSince && report.allSucceeded()) {
+            saveGraph(graph, graphPath);
+        }
+
+        // One trace lane per worker
+        std::vector<CSProCompiler::TraceTrack> tracks;
+        for (const auto& item : report.items) {
+            tracks.push_back({ "worker " + std::to_string(item.worker + 1), item.worker + 1, &item.result.phases });
+        }
+        writeTrace(tracks);
+
+        return report.allSucceeded() ? 0 : 1;
+    }
+
+    // --workers: unchanged applications come from the result cache, the rest
+    // are compiled on the build workers; reports and .pen files land here
+    CSProCompiler::BatchReport compileOnWorkers(const std::vector<std::string>& applications) {
+        auto batchStart = std::chrono::high_resolution_clock::now();
+        CSProCompiler::BatchReport report;
+        report.items.resize(applications.size());
+        report.jobs = static_cast<int>(workerAddresses.size());
+
+        std::vector<std::string> remote;
+        std::vector<size_t> remoteIndexes;
+        std::vector<std::string> cacheKeys(applications.size());
+        for (size_t i = 0; i < applications.size(); i++) {
+            CSProCompiler::CompilerOptions options;
+            options.inputFile = applications[i];
+            options.checkSyntaxOnly = checkOnly;
+
+            CSProCompiler::BatchItemResult& item = report.items[i];
+            item.inputFile = applications[i];
+            CSProCompiler::ResultCache cache(applications[i]);
+            if (useCache && cache.computeKey(options, engineIdentity, cacheKeys[i]) && cache.lookup(cacheKeys[i], item.result)) {
+                continue;
+            }
+            remote.push_back(applications[i]);
+            remoteIndexes.push_back(i);
+        }
+
+        if (verboseMode) {
+            std::cerr << "Compiling " << remote.size() << " of " << applications.size() << " application(s) on "
+                      << workerAddresses.size() << " build worker(s)" << std::endl;
+        }
+
+        if (!remote.empty()) {
+            CSProCompiler::DistributedOptions options;
+            options.workers = workerAddresses;
+            options.checkSyntaxOnly = checkOnly;
+            options.verbose = verboseMode;
+
+            std::filesystem::path historyPath = CSProCompiler::CompileTimeHistory::defaultHistoryPath();
+            CSProCompiler::CompileTimeHistory history;
+            history.load(historyPath);
+
+            CSProCompiler::DistributedCompiler distributed(options);
+            CSProCompiler::BatchReport compiled = distributed.run(remote, history);
+            report.cumulativeWallTimeMs = compiled.cumulativeWallTimeMs;
+            for (size_t i = 0; i < remote.size(); i++) {
+                size_t index = remoteIndexes[i];
+                report.items[index] = std::move(compiled.items[i]);
+                if (!cacheKeys[index].empty() && CSProCompiler::ResultCache::isCacheable(report.items[index].result)) {
+                    CSProCompiler::ResultCache(applications[index]).store(cacheKeys[index], report.items[index].result);
+                }
+            }
+
+            if (!history.save(historyPath)) {
+                std::cerr << "Warning: Could not write compile times: " << historyPath.u8string() << std::endl;
+            }
+            if (verboseMode) {
+                const CSProCompiler::DistributedStats& stats = distributed.getStats();
+                std::cerr << "Build workers: " << stats.workersConnected << " connected, " << stats.workersLost << " lost, "
+                          << stats.retries << " retried; " << stats.filesShipped << " file(s) shipped ("
+                          << (stats.bytesShipped + 1023) / 1024 << " KB), " << stats.filesReused << " reused" << std::endl;
+            }
+        }
+
+        for (const auto& item : report.items) {
+            writeReports(item.inputFile, item.result);
+        }
+        report.totalWallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - batchStart).count();
+        return report;
+    }
+
+    // Refreshes the workspace graph and keeps the applications that use an
+    // --affected-by file or, with --changed-since, a file changed since the saved graph
+    std::vector<std::string> selectAffectedApplications(CSProCompiler::WorkspaceGraph& graph, const std::filesystem::path& graphPath,
+                                                        const std::vector<std::string>& applications) {
+        bool loaded = graph.load(graphPath);
+        CSProCompiler::WorkspaceScanStats scan = graph.refresh(applications);
+
+        std::set<std::string> selected;
+        if (changedSince) {
+            for (const auto& application : graph.changedApplications()) selected.insert(application);
+        }
+        if (!affectedFiles.empty()) {
+            std::vector<std::filesystem::path> files;
+            for (const auto& file : affectedFiles) files.push_back(std::filesystem::u8path(file));
+            for (const auto& application : graph.affectedBy(files)) selected.insert(application);
+        }
+
+        if (verboseMode) {
+            std::cerr << "Workspace graph " << (loaded ? "loaded" : "built") << ": " << scan.applicationCount << " application(s), "
+                      << scan.rediscoveredCount << " rescanned, " << scan.hashedFileCount << " file(s) hashed, "
+                      << scan.changedFileCount << " changed; " << selected.size() << " affected" << std::endl;
+        }
+        return std::vector<std::string>(selected.begin(), selected.end());
+    }
+
+    void saveGraph(const CSProCompiler::WorkspaceGraph& graph, const std::filesystem::path& graphPath) {
+        if (!graph.save(graphPath)) {
+            std::cerr << "Warning: Could not write workspace graph: " << graphPath.u8string() << std::endl;
+        }
+    }
+
+    // Long-lived mode: recompile through one engine whenever the contents of an input change
+    int runWatch() {
+        namespace fs = std::filesystem;
+
+        CSProCompiler::WorkerEngine workerEngine(engineFactory);
+        CSProCompiler::FileWatcher watcher;
+        activeWatcher = &watcher;
+        std::signal(SIGINT, stopWatching);
+        std::signal(SIGTERM, stopWatching);
+
+        // Content hashes of the current inputs; missing files are left out
+        auto fingerprintInputs = [this]() {
+            std::map<fs::path, uint64_t> fingerprints;
+            for (const auto& input : CSProCompiler::discoverApplicationInputs(fs::u8path(inputFile))) {
+                uint64_t hash;
+                if (CSProCompiler::hashFile(input, hash)) {
+                    fingerprints[input] = hash;
+                }
+            }
+            return fingerprints;
+        };
+
+        auto watchInputs = [&](const std::map<fs::path, uint64_t>& fingerprints) {
+            std::vector<fs::path> files;
+            for (const auto& entry : fingerprints) files.push_back(entry.first);
+            if (!watcher.watch(files)) {
+                std::cerr << "Warning: Could not watch the application's input files" << std::endl;
+            }
+        };
+
+        std::map<fs::path, uint64_t> fingerprints = fingerprintInputs();
+        watchInputs(fingerprints);
+
+        if (verboseMode) {
+            std::cerr << "Watching " << fingerprints.size() << " input file(s)"
+                      << (watcher.usesNotifications() ? "" : " by polling") << "; press Ctrl+C to stop" << std::endl;
+        }
+
+        outputWatchResult(compileApplication(inputFile, workerEngine), {});
+
+        while (!watcher.isStopped()) {
+            if (watcher.wait(-1).empty()) {
+                continue;
+            }
+
+            // Coalesce a burst of saves: wait until the inputs have been quiet for the debounce interval
+            while (!watcher.isStopped() && !watcher.wait(debounceMs).empty()) {
+            }
+            if (watcher.isStopped()) {
+                break;
+            }
+
+            // Saves that leave the bytes as they were (touch, undo) do not trigger a compile
+            std::map<fs::path, uint64_t> current = fingerprintInputs();
+            if (current == fingerprints) {
+                continue;
+            }
+
+            std::vector<std::string> changedFiles;
+            for (const auto& [path, hash] : current) {
+                auto previous = fingerprints.find(path);
+                if (previous == fingerprints.end() || previous->second != hash) {
+                    changedFiles.push_back(path.u8string());
+                }
+            }
+            for (const auto& entry : fingerprints) {
+                if (current.count(entry.first) == 0) {
+                    changedFiles.push_back(entry.first.u8string());
+                }
+            }
+
+            // Added or removed references (a new dictionary, say) change what is watched
+            bool sameFiles = current.size() == fingerprints.size() &&
+                std::equal(current.begin(), current.end(), fingerprints.begin(),
+                           [](const auto& a, const auto& b) { return a.first == b.first; });
+            fingerprints = std::move(current);
+            for (const auto& file : changedFiles) {
+                CSProCompiler::sharedDictionaryCache().invalidate(std::filesystem::u8path(file));
+            }
+            if (!sameFiles) {
+                watchInputs(fingerprints);
+            }
+
+            outputWatchResult(compileApplication(inputFile, workerEngine), changedFiles);
+        }
+
+        activeWatcher = nullptr;
+        waitForReports();
+        return 0;
+    }
+
+    // Long-lived mode: engines are initialized up front, recycled as they age,
+    // and reused for every request
+    int runServer() {
+        CSProCompiler::EnginePool pool(engineFactory, poolOptions);
+        CSProCompiler::CompileServer server(pool);
+        server.setVerbose(verboseMode);
+
+        if (!server.start()) {
+            std::cerr << "Error: Failed to initialize CSPro compiler" << std::endl;
+            return 1;
+        }
+
+        int exitCode = socketPath.empty()
+            ? server.serveStream(std::cin, std::cout)
+            : server.serveUnixSocket(socketPath);
+
+        CSProCompiler::EnginePoolStats poolStats = pool.getStats();
+        pool.shutdown();
+
+        if (verboseMode) {
+            const auto& stats = server.getStats();
+            std::cerr << "Served " << stats.requestCount << " request(s), mean latency "
+                      << stats.getMeanLatencyMs() << " ms, max " << stats.maxLatencyMs << " ms" << std::endl;
+            std::cerr << "Engines recycled " << poolStats.recycles << " time(s) (" << poolStats.ineffectiveMemoryRecycles
+                      << " without freeing memory), peak memory " << poolStats.peakResidentBytes / (1024 * 1024) << " MB" << std::endl;
+        }
+
+        return exitCode;
+    }
+
 public:
+    // Wait for the report files queued by earlier compiles
+    void waitForReports() {
+        if (reportFiles.drain() > 0) {
+            std::cerr << "Warning: Could not write compile error reports" << std::endl;
+        }
+    }
+
+    // Chrome trace-event export of the recorded phases, when --trace was given
+    void writeTrace(const std::vector<CSProCompiler::TraceTrack>& tracks) {
+        if (traceFile.empty()) {
+            return;
+        }
+        if (!CSProCompiler::writeChromeTraceFile(traceFile, tracks)) {
+            std::cerr << "Warning: Could not write trace file: " << traceFile << std::endl;
+        } else if (verboseMode) {
+            std::cerr << "Trace written to: " << traceFile << std::endl;
+        }
+    }
+
     void outputResults(const CSPro::CompilationResult& result) {
-        if (jsonOutput) {
+        if (!binaryResultFile.empty()) {
+            std::string buffer;
+            CSProCompiler::encodeCompilationResult(buffer, result);
+            if (!CSProCompiler::writeFileAtomically(binaryResultFile, buffer)) {
+                std::cerr << "Error: Could not write result file: " << binaryResultFile << std::endl;
+            }
+        } else if (jsonOutput) {
             outputJson(result);
         } else {
             outputText(result);
         }
     }
 
+    void outputBatchResults(const CSProCompiler::BatchReport& report) {
+        // The JSON report goes to stdout or -o; the timing table goes to stderr so it never corrupts it
+        std::ostream& summary = jsonOutput ? std::cerr : std::cout;
+
+        for (const auto& item : report.items) {
+            summary << (item.result.success ? "  [ok]     " : "  [failed] ") << item.inputFile << "  "
+                    << item.wallTimeMs / 1000.0 << " s";
+            if (item.result.fromCache) summary << " (cached)";
+            if (item.result.errorCount > 0 || item.result.warningCount > 0) {
+                summary << "  " << item.result.errorCount << " error(s), " << item.result.warningCount << " warning(s)";
+            }
+            summary << "\n";
+        }
+
+        summary << "Compiled " << report.items.size() << " application(s) with " << report.jobs << " job(s) in "
+                << report.totalWallTimeMs / 1000.0 << " s (cumulative " << report.cumulativeWallTimeMs / 1000.0
+                << " s, speedup " << report.getSpeedup() << "x)" << std::endl;
+
+        if (jsonOutput) {
+            std::ofstream file;
+            if (!outputFile.empty()) file.open(outputFile);
+            CSProCompiler::writeBatchReportJson(file.is_open() ? file : std::cout, report);
+        }
+        else {
+            for (const auto& item : report.items) {
+                if (!item.result.success) {
+                    outputText(item.result);
+                }
+            }
+        }
+    }
+
 private:
+    // One NDJSON line per compile with --json; otherwise the usual text output
+    void outputWatchResult(const CSPro::CompilationResult& result, const std::vector<std::string>& changedFiles) {
+        if (jsonOutput) {
+            std::string line;
+            CSProCompiler::JsonWriter writer(line);
+            writer.beginObject();
+            writer.member("type", "result");
+            writer.key("changed").beginArray();
+            for (const auto& file : changedFiles) {
+                writer.value(file);
+            }
+            writer.endArray();
+            writeResultMembers(writer, result);
+            writer.endObject();
+            line += '\n';
+            std::cout.write(line.data(), static_cast<std::streamsize>(line.size()));
+            std::cout.flush();
+        } else {
+            if (!changedFiles.empty()) {
+                std::cerr << "Change detected in " << changedFiles.front();
+                if (changedFiles.size() > 1) std::cerr << " and " << changedFiles.size() - 1 << " other file(s)";
+                std::cerr << ", recompiling" << std::endl;
+            }
+            outputText(result);
+        }
+        waitForReports();
+    }
+
+    // The full diagnostic list, or with --delta only what changed since the
+    // previous output for this application
+    void writeResultMembers(CSProCompiler::JsonWriter& writer, const CSPro::CompilationResult& result) {
+        if (deltaStateFile.empty()) {
+            CSProCompiler::writeCompilationResultMembers(writer, result);
+            return;
+        }
+
+        // A missing state file simply starts with a full snapshot
+        if (!deltaStateLoaded) {
+            deltas.load(deltaStateFile);
+            deltaStateLoaded = true;
+        }
+        CSProCompiler::DiagnosticDelta delta = deltas.update(CSProCompiler::resolvePath(inputFile).u8string(), result);
+        CSProCompiler::writeCompilationDeltaMembers(writer, result, delta);
+        if (!deltas.save(deltaStateFile)) {
+            std::cerr << "Warning: Could not write delta state file: " << deltaStateFile << std::endl;
+        }
+    }
+
     void outputJson(const CSPro::CompilationResult& result) {
         std::ostream* out = &std::cout;
         std::ofstream file;
 
         if (!outputFile.empty()) {
-            file.open(outputFile);
+            file.open(outputFile, std::ios::binary);
             out = &file;
         }
 
-        *out << "{\n";
-        *out << "  \"success\": " << (result.success ? "true" : "false") << ",\n";
-        *out << "  \"compilationTime\": " << result.compilationTimeMs / 1000.0 << ",\n";
-        *out << "  \"errors\": [\n";
-
-        for (size_t i = 0; i < result.diagnostics.size(); i++) {
-            const auto& diag = result.diagnostics[i];
-            std::string severity = (diag.severity == CSProCompiler::DiagnosticMessage::Severity::Error) ? "error" : "warning";
-            *out << "    {\n";
-            *out << "      \"file\": \"" << diag.file << "\",\n";
-            *out << "      \"line\": " << diag.line << ",\n";
-            *out << "      \"column\": " << diag.column << ",\n";
-            *out << "      \"message\": \"" << diag.message << "\",\n";
-            *out << "      \"severity\": \"" << severity << "\"\n";
-            *out << "    }";
-            if (i < result.diagnostics.size() - 1) *out << ",";
-            *out << "\n";
-        }
-
-        *out << "  ]\n";
-        *out << "}\n";
+        // Serialize into one buffer and write it once
+        std::string buffer;
+        buffer.reserve(256 + result.diagnostics.size() * 160);
+        CSProCompiler::JsonWriter writer(buffer, true);
+        writer.beginObject();
+        writeResultMembers(writer, result);
+        writer.endObject();
+        buffer += '\n';
+        out->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out->flush();
 
         if (file.is_open()) {
             file.close();
@@ -234,17 +1038,56 @@ private:
 void printUsage(const char* programName) {
     std::cout << "CSProCompile - Command-line CSPro Application Compiler\n\n";
     std::cout << "Usage:\n";
-    std::cout << "  " << programName << " <application.ent|.bch|.pff> [options]\n\n";
+    std::cout << "  " << programName << " <application.ent|.bch|.pff> [options]\n";
+    std::cout << "  " << programName << " <application|directory|glob>... [-j <n>] [options]\n\n";
     std::cout << "Options:\n";
     std::cout << "  -o <file>     Output compilation results to JSON file\n";
     std::cout << "  -v            Verbose mode\n";
     std::cout << "  --check-only  Only check syntax, don't generate binaries\n";
     std::cout << "  --json        Output errors in JSON format (for VS Code)\n";
+    std::cout << "  --stream      Emit each diagnostic as soon as it is produced (NDJSON with --json)\n";
+    std::cout << "  --delta <f>   With --json, report only diagnostics changed since the last run (state in f)\n";
+    std::cout << "  --binary-result <f> Write the result to f in the binary encoding\n";
+    std::cout << "  --affected-by <f> Compile only the applications that use file f (repeatable)\n";
+    std::cout << "  --changed-since Compile only the applications whose inputs changed since the last successful run\n";
+    std::cout << "  --graph <f>   Workspace dependency graph file (default .csprocompile/workspace.graph)\n";
+    std::cout << "  -j <n>        Compile applications in parallel with n workers\n";
+    std::cout << "  --processes   Use worker processes instead of worker threads\n";
+    std::cout << "  --no-cache    Always run the compiler, ignoring cached results\n";
+    std::cout << "  --scripted-engine Compile with the marker-driven stand-in engine (for CSProCorpusGen corpora)\n";
+    std::cout << "  --script-delay <ms> With --scripted-engine, simulated compile time\n";
+    std::cout << "  --store <dir> Share results and .pen files with other checkouts through this store\n";
+    std::cout << "  --store-size <MB> Size cap of the store (default 1024)\n";
+    std::cout << "  --store-stats Print the store's hit/miss counters and size, then exit\n";
+    std::cout << "  --workers <h:p,...> Compile the applications on these build workers\n";
+    std::cout << "  --worker <[host:]port> Serve as a build worker (loopback interface unless a host is given)\n";
+    std::cout << "  --worker-dir <dir> With --worker, where the mirrored sources live\n";
+    std::cout << "  --server      Serve line-delimited JSON compile requests on stdin\n";
+    std::cout << "  --socket <p>  With --server, listen on a Unix domain socket instead\n";
+    std::cout << "  --pool <n>    With --server, keep n engines initialized (default 1)\n";
+    std::cout << "  --recycle-after <n> With --server, replace an engine after n compiles\n";
+    std::cout << "  --max-rss <MB> With --server, replace the engine that pushes memory past this\n";
+    std::cout << "  --trace <f>   Write per-phase timings as a Chrome trace-event file\n";
+    std::cout << "  --watch       Recompile whenever an input file changes\n";
+    std::cout << "  --debounce <ms> With --watch, wait for saves to settle (default 200)\n";
     std::cout << "  -h, --help    Show this help message\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << programName << " myapp.ent\n";
     std::cout << "  " << programName << " myapp.bch -v --json\n";
     std::cout << "  " << programName << " myapp.pff -o results.json\n";
+    std::cout << "  " << programName << " surveys/ -j 8 --json -o report.json\n";
+    std::cout << "  " << programName << " --server\n";
+    std::cout << "  " << programName << " surveys/ --workers build1:7100,build2:7100\n";
+}
+
+// Worker processes relaunch this executable, so resolve it independently of the current directory
+std::string getExecutablePath(const char* argv0) {
+    std::error_code ec;
+    std::filesystem::path self = std::filesystem::read_symlink("/proc/self/exe", ec);
+    if (!ec && !self.empty()) {
+        return self.string();
+    }
+    return std::filesystem::absolute(argv0, ec).string();
 }
 
 int main(int argc, char* argv[]) {
@@ -255,6 +1098,14 @@ int main(int argc, char* argv[]) {
         }
 
         CSProCommandLineCompiler compiler;
+        std::string executablePath = getExecutablePath(argv[0]);
+        compiler.setExecutablePath(executablePath);
+        bool showStoreStats = false;
+        bool scripted = false;
+        int scriptDelayMs = 0;
+
+        // Maps CSProDesigner.mgc when the build produced it, else parses the .mgf
+        CSProCompiler::loadSystemMessages(std::filesystem::path(executablePath).parent_path() / "CSProDesigner.mgf");
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -273,6 +1124,162 @@ int main(int argc, char* argv[]) {
         else if (arg == "--json") {
             compiler.setJsonOutput(true);
         }
+        else if (arg == "--stream") {
+            compiler.setStreamOutput(true);
+        }
+        else if (arg == "-j") {
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+                compiler.setJobs(std::atoi(argv[++i]));
+            } else {
+                std::cerr << "Error: -j requires a positive number of jobs\n";
+                return 1;
+            }
+        }
+        else if (arg == "--processes") {
+            compiler.setForceProcesses(true);
+        }
+        else if (arg == "--no-cache") {
+            compiler.setUseCache(false);
+        }
+        else if (arg == "--scripted-engine") {
+            scripted = true;
+        }
+        else if (arg == "--script-delay") {
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                scriptDelayMs = std::atoi(argv[++i]);
+            } else {
+                std::cerr << "Error: --script-delay requires a number of milliseconds\n";
+                return 1;
+            }
+        }
+        else if (arg == "--store") {
+            if (i + 1 < argc) {
+                compiler.setStoreDirectory(argv[++i]);
+            } else {
+                std::cerr << "Error: --store requires a directory\n";
+                return 1;
+            }
+        }
+        else if (arg == "--store-size") {
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) && std::atoi(argv[i + 1]) > 0) {
+                compiler.setStoreMegabytes(std::atoi(argv[++i]));
+            } else {
+                std::cerr << "Error: --store-size requires a positive number of megabytes\n";
+                return 1;
+            }
+        }
+        else if (arg == "--store-stats") {
+            showStoreStats = true;
+        }
+        else if (arg == "--workers") {
+            std::string list = (i + 1 < argc) ? argv[++i] : "";
+            size_t start = 0;
+            do {
+                size_t comma = list.find(',', start);
+                CSProCompiler::WorkerAddress address;
+                if (!CSProCompiler::parseWorkerAddress(list.substr(start, comma - start), address)) {
+                    std::cerr << "Error: --workers requires a comma-separated list of host:port\n";
+                    return 1;
+                }
+                compiler.addWorkerAddress(address);
+                start = (comma == std::string::npos) ? list.size() : comma + 1;
+            } while (start < list.size());
+        }
+        else if (arg == "--worker") {
+            CSProCompiler::WorkerAddress address;
+            if (i + 1 < argc && CSProCompiler::parseWorkerAddress(argv[i + 1], address)) {
+                compiler.setWorkerAddress(address);
+                i++;
+            } else {
+                std::cerr << "Error: --worker requires a port or host:port\n";
+                return 1;
+            }
+        }
+        else if (arg == "--worker-dir") {
+            if (i + 1 < argc) {
+                compiler.setWorkerDirectory(argv[++i]);
+            } else {
+                std::cerr << "Error: --worker-dir requires a directory\n";
+                return 1;
+            }
+        }
+        else if (arg == "--server") {
+            compiler.setServerMode(true);
+        }
+        else if (arg == "--socket") {
+            if (i + 1 < argc) {
+                compiler.setSocketPath(argv[++i]);
+            } else {
+                std::cerr << "Error: --socket requires a socket path\n";
+                return 1;
+            }
+        }
+        else if (arg == "--pool" || arg == "--recycle-after" || arg == "--max-rss") {
+            int minimum = (arg == "--pool") ? 1 : 0;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])) && std::atoi(argv[i + 1]) >= minimum) {
+                int value = std::atoi(argv[++i]);
+                if (arg == "--pool") compiler.setPoolSize(value);
+                else if (arg == "--recycle-after") compiler.setRecycleAfter(value);
+                else compiler.setMaxResidentMegabytes(value);
+            } else {
+                std::cerr << "Error: " << arg << " requires a number" << (minimum > 0 ? " of at least 1" : "") << "\n";
+                return 1;
+            }
+        }
+        else if (arg == "--watch") {
+            compiler.setWatchMode(true);
+        }
+        else if (arg == "--debounce") {
+            if (i + 1 < argc && std::atoi(argv[i + 1]) >= 0 && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                compiler.setDebounceMs(std::atoi(argv[++i]));
+            } else {
+                std::cerr << "Error: --debounce requires a number of milliseconds\n";
+                return 1;
+            }
+        }
+        else if (arg == "--delta") {
+            if (i + 1 < argc) {
+                compiler.setDeltaStateFile(argv[++i]);
+            } else {
+                std::cerr << "Error: --delta requires a state filename\n";
+                return 1;
+            }
+        }
+        else if (arg == "--binary-result") {
+            if (i + 1 < argc) {
+                compiler.setBinaryResultFile(argv[++i]);
+            } else {
+                std::cerr << "Error: --binary-result requires an output filename\n";
+                return 1;
+            }
+        }
+        else if (arg == "--affected-by") {
+            if (i + 1 < argc) {
+                compiler.addAffectedFile(argv[++i]);
+            } else {
+                std::cerr << "Error: --affected-by requires a filename\n";
+                return 1;
+            }
+        }
+        else if (arg == "--changed-since") {
+            compiler.setChangedSince(true);
+        }
+        else if (arg == "--graph") {
+            if (i + 1 < argc) {
+                compiler.setGraphFile(argv[++i]);
+            } else {
+                std::cerr << "Error: --graph requires a filename\n";
+                return 1;
+            }
+        }
+        else if (arg == "--trace") {
+            if (i + 1 < argc) {
+                compiler.setTraceFile(argv[++i]);
+            } else {
+                std::cerr << "Error: --trace requires an output filename\n";
+                return 1;
+            }
+        }
         else if (arg == "-o") {
             if (i + 1 < argc) {
                 compiler.setOutputFile(argv[++i]);
@@ -282,8 +1289,8 @@ int main(int argc, char* argv[]) {
             }
         }
         else if (arg[0] != '-') {
-            // Input file
-            compiler.setInputFile(arg);
+            // Input file, directory or glob
+            compiler.addInputPattern(arg);
         }
         else {
             std::cerr << "Unknown option: " << arg << std::endl;
@@ -292,13 +1299,43 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (scripted) {
+        compiler.setScriptedEngine(scriptDelayMs);
+    }
+    if (showStoreStats) {
+        return compiler.printStoreStats();
+    }
+    compiler.openStore();
+
+    if (compiler.isWorkerMode()) {
+        return compiler.runWorker();
+    }
+
+    if (compiler.isServerMode()) {
+        return compiler.runServer();
+    }
+
+    if (compiler.isBatchMode()) {
+        return compiler.runBatch();
+    }
+
     // Validate and compile
     if (!compiler.validateInputFile()) {
         return 1;
     }
 
+        if (compiler.isWatchMode()) {
+            return compiler.runWatch();
+        }
+
+        if (compiler.isStreamOutput()) {
+            return compiler.runStreaming();
+        }
+
         CSPro::CompilationResult result = compiler.compile();
         compiler.outputResults(result);
+        compiler.writeTrace({ { "main", 1, &result.phases } });
+        compiler.waitForReports();
 
         return result.success ? 0 : 1;
     }
@@ -0,0 +1,110 @@
+/*
+ * CSProCorpusGen - Generates synthetic CSPro applications for scale testing
+ *
+ * Writes a reproducible workspace of applications (see CorpusGenerator.h)
+ * that CSProCompile --scripted-engine compiles on any platform, reporting
+ * exactly the diagnostics this tool prints as expected.
+ *
+ * Usage:
+ *   CSProCorpusGen [options] <directory>
+ *
+ * Options:
+ *   --seed <n>           Seed of the corpus (default 1)
+ *   --apps <n>           Applications to generate (default 1)
+ *   --procs <n>          PROCs per application (default 100)
+ *   --lines <n>          Logic lines per application (default 2000)
+ *   --warnings <n>       Warnings per 1000 logic lines (default 5)
+ *   --errors <n>         Errors per 1000 logic lines (default 0)
+ *   --dictionaries <n>   Shared dictionaries (default 4)
+ *   --fan-out <n>        Shared dictionaries used by each application (default 2)
+ *   --items <n>          Items per shared dictionary (default 500)
+ *   -q                   Print nothing on success
+ */
+
+#include "../include/CorpusGenerator.h"
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace {
+    void printUsage(const char* programName) {
+        std::cerr << "Usage: " << programName << " [options] <directory>\n"
+                  << "\nOptions:\n"
+                  << "  --seed <n>           Seed of the corpus (default 1)\n"
+                  << "  --apps <n>           Applications to generate (default 1)\n"
+                  << "  --procs <n>          PROCs per application (default 100)\n"
+                  << "  --lines <n>          Logic lines per application (default 2000)\n"
+                  << "  --warnings <n>       Warnings per 1000 logic lines (default 5)\n"
+                  << "  --errors <n>         Errors per 1000 logic lines (default 0)\n"
+                  << "  --dictionaries <n>   Shared dictionaries (default 4)\n"
+                  << "  --fan-out <n>        Shared dictionaries used by each application (default 2)\n"
+                  << "  --items <n>          Items per shared dictionary (default 500)\n"
+                  << "  -q                   Print nothing on success\n";
+    }
+
+    bool isNumber(const char* text) {
+        return text != nullptr && (std::isdigit(static_cast<unsigned char>(text[0])) || text[0] == '.');
+    }
+}
+
+int main(int argc, char* argv[]) {
+    CSProCompiler::CorpusOptions options;
+    std::filesystem::path directory;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-q") quiet = true;
+        else if (!arg.empty() && arg[0] != '-') directory = std::filesystem::u8path(arg);
+        else if (arg == "--seed" || arg == "--apps" || arg == "--procs" || arg == "--lines" || arg == "--warnings" ||
+                 arg == "--errors" || arg == "--dictionaries" || arg == "--fan-out" || arg == "--items") {
+            if (!isNumber(value)) {
+                std::cerr << "Error: " << arg << " requires a number\n";
+                return 1;
+            }
+            i++;
+            if (arg == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+            else if (arg == "--apps") options.applications = std::atoi(value);
+            else if (arg == "--procs") options.procsPerApplication = std::atoi(value);
+            else if (arg == "--lines") options.linesPerApplication = std::atoi(value);
+            else if (arg == "--warnings") options.warningsPerThousandLines = std::atof(value);
+            else if (arg == "--errors") options.errorsPerThousandLines = std::atof(value);
+            else if (arg == "--dictionaries") options.sharedDictionaries = std::atoi(value);
+            else if (arg == "--fan-out") options.fanOut = std::atoi(value);
+            else options.itemsPerDictionary = std::atoi(value);
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (directory.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    CSProCompiler::CorpusStats stats;
+    std::string error;
+    if (!CSProCompiler::generateCorpus(directory, options, stats, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    if (!quiet) {
+        std::cout << directory.u8string() << ": " << stats.applications.size() << " application(s), "
+                  << stats.lines << " logic lines, " << (stats.bytes + 1024 * 1024 - 1) / (1024 * 1024) << " MB\n"
+                  << "Files: " << stats.filesWritten << " written, " << stats.filesUnchanged << " unchanged\n"
+                  << "Expected diagnostics: " << stats.errors << " error(s), " << stats.warnings << " warning(s)\n";
+    }
+    return 0;
+}
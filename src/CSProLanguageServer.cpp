@@ -0,0 +1,120 @@
+/*
+ * CSProLanguageServer - Language Server Protocol front end for CSPro applications
+ *
+ * Editors start it with stdio pipes and receive compile diagnostics for
+ * CSPro logic and dictionaries as the user types.
+ *
+ * Usage:
+ *   CSProLanguageServer [options]
+ *
+ * Options:
+ *   --stdio              Communicate over stdin/stdout (the default)
+ *   --debounce <ms>      Wait for edits to settle before compiling (default 150)
+ *   --scripted-engine    Use the marker-driven stand-in engine instead of CSPro
+ *   --script-delay <ms>  With --scripted-engine, simulated compile time
+ *   -v                   Log activity to stderr
+ */
+
+#include "../include/LanguageServer.h"
+#include "../include/MessageCatalog.h"
+#include "../include/ScriptedEngine.h"
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+    bool parseMilliseconds(const char* text, int& value) {
+        if (text == nullptr || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+            return false;
+        }
+        value = std::atoi(text);
+        return true;
+    }
+
+    void printUsage(const char* programName) {
+        std::cerr << "Usage: " << programName << " [options]\n"
+                  << "\nOptions:\n"
+                  << "  --stdio              Communicate over stdin/stdout (the default)\n"
+                  << "  --debounce <ms>      Wait for edits to settle before compiling (default 150)\n"
+                  << "  --scripted-engine    Use the marker-driven stand-in engine instead of CSPro\n"
+                  << "  --script-delay <ms>  With --scripted-engine, simulated compile time\n"
+                  << "  -v                   Log activity to stderr\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool verbose = false;
+    bool scripted = false;
+    int debounceMs = 150;
+    int scriptDelayMs = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if (arg == "--stdio") {
+            // The only transport
+        }
+        else if (arg == "--scripted-engine") {
+            scripted = true;
+        }
+        else if (arg == "--debounce" || arg == "--script-delay") {
+            int& value = (arg == "--debounce") ? debounceMs : scriptDelayMs;
+            if (i + 1 >= argc || !parseMilliseconds(argv[i + 1], value)) {
+                std::cerr << "Error: " << arg << " requires a number of milliseconds\n";
+                return 1;
+            }
+            i++;
+        }
+        else {
+            std::cerr << "Error: Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    // Content-Length counts bytes; keep the CRT from translating line endings
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    std::ios::sync_with_stdio(false);
+
+    std::error_code ec;
+    std::filesystem::path self = std::filesystem::read_symlink("/proc/self/exe", ec);
+    if (ec || self.empty()) {
+        self = std::filesystem::absolute(argv[0], ec);
+    }
+    CSProCompiler::loadSystemMessages(self.parent_path() / "CSProDesigner.mgf");
+
+    std::unique_ptr<CSProCompiler::ICompilerEngine> engine;
+    if (scripted) {
+        engine = std::make_unique<CSProCompiler::ScriptedEngine>(scriptDelayMs);
+    } else {
+        engine = CSProCompiler::createCompilerEngine();
+    }
+
+    int exitCode;
+    {
+        CSProCompiler::LanguageServer server(*engine);
+        server.setVerbose(verbose);
+        server.setDebounceMs(debounceMs);
+        exitCode = server.serve(std::cin, std::cout);
+    }
+
+    engine->shutdown();
+    return exitCode;
+}
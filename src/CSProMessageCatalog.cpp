@@ -0,0 +1,76 @@
+/*
+ * CSProMessageCatalog - Compiles CSPro message files into binary catalogs
+ *
+ * Run by the build for every .mgf in bin/; CSProCompile and the language
+ * server then map the .mgc at startup instead of parsing the text.
+ *
+ * Usage:
+ *   CSProMessageCatalog [options] <file.mgf>...
+ *
+ * Options:
+ *   -o <catalog>         Output file (one input only; default <file>.mgc)
+ *   --language <name>    Messages of this Language= section (default EN)
+ *   -q                   Print nothing on success
+ */
+
+#include "../include/MessageCatalog.h"
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    void printUsage(const char* programName) {
+        std::cerr << "Usage: " << programName << " [options] <file.mgf>...\n"
+                  << "\nOptions:\n"
+                  << "  -o <catalog>         Output file (one input only; default <file>.mgc)\n"
+                  << "  --language <name>    Messages of this Language= section (default EN)\n"
+                  << "  -q                   Print nothing on success\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::filesystem::path> inputs;
+    std::filesystem::path output;
+    std::string language = "EN";
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if (arg == "-o" && i + 1 < argc) output = std::filesystem::u8path(argv[++i]);
+        else if (arg == "--language" && i + 1 < argc) language = argv[++i];
+        else if (arg == "-q") quiet = true;
+        else if (!arg.empty() && arg[0] != '-') inputs.push_back(std::filesystem::u8path(arg));
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (inputs.empty() || (!output.empty() && inputs.size() > 1)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    int failures = 0;
+    for (const auto& input : inputs) {
+        std::filesystem::path catalogFile = output.empty() ? CSProCompiler::MessageCatalog::catalogPathFor(input) : output;
+        size_t messageCount = 0;
+        std::string error;
+
+        if (!CSProCompiler::MessageCatalog::compile(input, catalogFile, language, messageCount, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            failures++;
+        } else if (!quiet) {
+            std::cout << input.u8string() << ": " << messageCount << " messages -> " << catalogFile.u8string() << "\n";
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
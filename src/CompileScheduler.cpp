@@ -0,0 +1,146 @@
+/*
+ * CompileScheduler.cpp - Asynchronous compiles with request supersession
+ */
+
+#include "../include/CompileScheduler.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+
+namespace CSProCompiler {
+
+CompileScheduler::CompileScheduler(ICompilerEngine& engine)
+    : CompileScheduler([&engine](const CompilerOptions& options) { return engine.compile(options); })
+{}
+
+CompileScheduler::CompileScheduler(CompileFunction compile, int workers)
+    : m_compile(std::move(compile))
+    , m_stopping(false)
+{
+    for (int i = 0; i < std::max(workers, 1); i++) {
+        m_workers.emplace_back([this]() { run(); });
+    }
+}
+
+CompileScheduler::~CompileScheduler() {
+    shutdown();
+}
+
+CompilationResult CompileScheduler::cancelledResult() {
+    CompilationResult result;
+    result.cancelled = true;
+    return result;
+}
+
+std::future<CompilationResult> CompileScheduler::submit(CompilerOptions options) {
+    auto request = std::make_unique<Request>();
+    request->application = resolveInputFile(options).u8string();
+    options.cancellation = request->cancellation.token();
+    request->options = std::move(options);
+    std::future<CompilationResult> future = request->promise.get_future();
+
+    std::deque<std::unique_ptr<Request>> superseded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.submitted++;
+        if (m_stopping) {
+            request->promise.set_value(cancelledResult());
+            return future;
+        }
+
+        supersede(request->application, superseded);
+        m_queue.push_back(std::move(request));
+    }
+    m_work.notify_one();
+
+    for (auto& old : superseded) {
+        old->promise.set_value(cancelledResult());
+    }
+    return future;
+}
+
+void CompileScheduler::cancel(const std::string& inputFile) {
+    std::string application = resolvePath(std::filesystem::u8path(inputFile)).u8string();
+
+    std::deque<std::unique_ptr<Request>> superseded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        supersede(application, superseded);
+    }
+    for (auto& old : superseded) {
+        old->promise.set_value(cancelledResult());
+    }
+}
+
+void CompileScheduler::supersede(const std::string& application, std::deque<std::unique_ptr<Request>>& superseded) {
+    for (auto it = m_queue.begin(); it != m_queue.end();) {
+        if ((*it)->application == application) {
+            superseded.push_back(std::move(*it));
+            it = m_queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_stats.supersededQueued += static_cast<long long>(superseded.size());
+
+    for (Request* running : m_running) {
+        if (running->application == application && !running->cancellation.isCancelled()) {
+            running->cancellation.cancel();
+            m_stats.cancelledRunning++;
+        }
+    }
+}
+
+void CompileScheduler::shutdown() {
+    std::deque<std::unique_ptr<Request>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        abandoned.swap(m_queue);
+        for (Request* running : m_running) {
+            running->cancellation.cancel();
+        }
+    }
+    m_work.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    for (auto& request : abandoned) {
+        request->promise.set_value(cancelledResult());
+    }
+}
+
+void CompileScheduler::run() {
+    while (true) {
+        std::unique_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            request = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_running.push_back(request.get());
+        }
+
+        try {
+            request->promise.set_value(m_compile(request->options));
+        }
+        catch (...) {
+            request->promise.set_exception(std::current_exception());
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running.erase(std::find(m_running.begin(), m_running.end(), request.get()));
+        m_stats.completed++;
+    }
+}
+
+CompileSchedulerStats CompileScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,407 @@
+/*
+ * CompileServer.cpp - Persistent compile server
+ */
+
+#include "../include/CompileServer.h"
+#include "../include/CompileScheduler.h"
+#include "../include/EnginePool.h"
+#include "../include/JsonValue.h"
+#include "../include/JsonWriter.h"
+#include "../include/WorkingDirectory.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace CSProCompiler {
+
+namespace {
+    void writeId(JsonWriter& writer, const JsonValue& id) {
+        writer.key("id");
+        if (id.isString()) {
+            writer.value(id.asString());
+        } else if (id.isNumber()) {
+            writer.value(id.asNumber());
+        } else {
+            writer.valueNull();
+        }
+    }
+
+    std::string formatError(const JsonValue& id, const std::string& message) {
+        std::string response;
+        JsonWriter writer(response);
+        writer.beginObject();
+        writeId(writer, id);
+        writer.member("success", false);
+        writer.member("error", message);
+        writer.endObject();
+        return response;
+    }
+
+    std::string formatResult(const JsonValue& id, const CompilationResult& result, double latencyMs,
+                             const DiagnosticDelta* delta) {
+        std::string response;
+        response.reserve(256 + result.diagnostics.size() * 160);
+        JsonWriter writer(response);
+        writer.beginObject();
+        writeId(writer, id);
+        writer.member("latencyMs", latencyMs);
+        if (delta != nullptr) {
+            writeCompilationDeltaMembers(writer, result, *delta);
+        } else {
+            writeCompilationResultMembers(writer, result);
+        }
+        writer.endObject();
+        return response;
+    }
+}
+
+CompileServer::CompileServer(ICompilerEngine& engine)
+    : m_engine(&engine)
+    , m_pool(nullptr)
+    , m_started(false)
+    , m_verbose(false)
+    , m_shutdownRequested(false)
+{}
+
+CompileServer::CompileServer(EnginePool& pool)
+    : m_engine(nullptr)
+    , m_pool(&pool)
+    , m_started(false)
+    , m_verbose(false)
+    , m_shutdownRequested(false)
+{}
+
+CompileServer::~CompileServer() = default;
+
+bool CompileServer::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_started) {
+        m_started = (m_pool != nullptr) ? m_pool->start() : m_engine->initialize();
+    }
+
+    // As many scheduler threads as compiles that can run at once
+    if (m_started && !m_scheduler) {
+        if (m_pool != nullptr) {
+            EnginePool& pool = *m_pool;
+            int workers = pool.supportsConcurrentCompiles() ? pool.getOptions().size : 1;
+            m_scheduler = std::make_unique<CompileScheduler>(
+                [&pool](const CompilerOptions& options) { return pool.compile(options); }, workers);
+        } else {
+            m_scheduler = std::make_unique<CompileScheduler>(*m_engine);
+        }
+    }
+    return m_started;
+}
+
+ServerStats CompileServer::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void CompileServer::recordLatency(double latencyMs, bool failed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.requestCount++;
+    if (failed) m_stats.failedRequestCount++;
+    m_stats.totalLatencyMs += latencyMs;
+    m_stats.lastLatencyMs = latencyMs;
+    if (latencyMs > m_stats.maxLatencyMs) m_stats.maxLatencyMs = latencyMs;
+}
+
+std::string CompileServer::formatStats(const JsonValue& id) const {
+    ServerStats stats = getStats();
+    CompileSchedulerStats scheduled;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_scheduler) scheduled = m_scheduler->getStats();
+    }
+    std::string response;
+    JsonWriter writer(response);
+    writer.beginObject();
+    writeId(writer, id);
+    writer.member("requests", stats.requestCount);
+    writer.member("failedRequests", stats.failedRequestCount);
+    writer.member("meanLatencyMs", stats.getMeanLatencyMs());
+    writer.member("maxLatencyMs", stats.maxLatencyMs);
+    writer.member("lastLatencyMs", stats.lastLatencyMs);
+    writer.member("supersededRequests", scheduled.supersededQueued + scheduled.cancelledRunning);
+    if (m_pool != nullptr) {
+        EnginePoolStats pool = m_pool->getStats();
+        writer.key("pool").beginObject();
+        writer.member("liveEngines", pool.liveEngines);
+        writer.member("busyEngines", pool.busyEngines);
+        writer.member("compiles", pool.compiles);
+        writer.member("recycles", pool.recycles);
+        writer.member("recyclesForMemory", pool.recyclesForMemory);
+        writer.member("ineffectiveMemoryRecycles", pool.ineffectiveMemoryRecycles);
+        writer.member("failedWarmups", pool.failedWarmups);
+        writer.member("residentBytes", static_cast<unsigned long long>(pool.residentBytes));
+        writer.member("peakResidentBytes", static_cast<unsigned long long>(pool.peakResidentBytes));
+        writer.endObject();
+    }
+    writer.endObject();
+    return response;
+}
+
+std::string CompileServer::handleRequest(const std::string& requestLine, DiagnosticDeltaTracker& deltas) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    JsonValue request;
+    try {
+        request = JsonValue::parse(requestLine);
+    }
+    catch (const JsonParseError& ex) {
+        return formatError(JsonValue(), std::string("Invalid request: ") + ex.what());
+    }
+
+    const JsonValue& id = request["id"];
+
+    if (!request.isObject()) {
+        return formatError(id, "Invalid request: expected a JSON object");
+    }
+
+    std::string command = request["command"].asString("compile");
+
+    if (command == "shutdown") {
+        m_shutdownRequested = true;
+        std::string response;
+        JsonWriter writer(response);
+        writer.beginObject();
+        writeId(writer, id);
+        writer.member("shutdown", true);
+        writer.endObject();
+        return response;
+    }
+    if (command == "stats") {
+        return formatStats(id);
+    }
+    if (command == "ping") {
+        std::string response;
+        JsonWriter writer(response);
+        writer.beginObject();
+        writeId(writer, id);
+        writer.member("pong", true);
+        writer.endObject();
+        return response;
+    }
+    if (command != "compile") {
+        return formatError(id, "Unknown command: " + command);
+    }
+
+    CompilerOptions options;
+    options.inputFile = request["inputFile"].asString();
+    options.checkSyntaxOnly = request["checkOnly"].asBool(false);
+    options.verboseOutput = request["verbose"].asBool(false);
+    options.baseDirectory = request["baseDirectory"].asString();
+
+    if (options.inputFile.empty()) {
+        return formatError(id, "Missing inputFile");
+    }
+    if (!std::filesystem::exists(resolveInputFile(options))) {
+        return formatError(id, "Input file not found: " + options.inputFile);
+    }
+
+    if (!start()) {
+        return formatError(id, "Failed to initialize CSPro compiler");
+    }
+
+    std::future<CompilationResult> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pending = m_scheduler->submit(options);
+    }
+    CompilationResult result = pending.get();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double latencyMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    recordLatency(latencyMs, !result.success);
+
+    if (m_verbose) {
+        std::cerr << "Compiled " << options.inputFile << " in " << latencyMs << " ms" << std::endl;
+    }
+
+    // A superseded compile has no diagnostics to diff against the last output
+    if (request["delta"].asBool(false) && !result.cancelled) {
+        DiagnosticDelta delta = deltas.update(resolveInputFile(options).u8string(), result, request["full"].asBool(false));
+        return formatResult(id, result, latencyMs, &delta);
+    }
+    return formatResult(id, result, latencyMs, nullptr);
+}
+
+int CompileServer::serveStream(std::istream& in, std::ostream& out) {
+    std::string line;
+    DiagnosticDeltaTracker deltas;
+
+    while (!m_shutdownRequested && std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+        out << handleRequest(line, deltas) << "\n";
+        out.flush();
+    }
+
+    return 0;
+}
+
+#ifndef _WIN32
+
+namespace {
+    bool sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t written = ::write(fd, data.data() + sent, data.size() - sent);
+            if (written <= 0) return false;
+            sent += static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+int CompileServer::serveUnixSocket(const std::string& socketPath) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << socketPath << std::endl;
+        return 1;
+    }
+
+    // A client that disconnects mid-response must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: Could not create socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    ::unlink(socketPath.c_str());
+
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listenFd, 8) < 0) {
+        std::cerr << "Error: Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        ::close(listenFd);
+        return 1;
+    }
+
+    if (m_verbose) {
+        std::cerr << "Listening on " << socketPath << std::endl;
+    }
+
+    // Pool engines that compile side by side get a thread per connection;
+    // anything else is served one connection at a time, as before
+    bool concurrent = m_pool != nullptr && m_pool->supportsConcurrentCompiles();
+
+    struct Connection {
+        int fd;
+        std::thread thread;
+        bool done = false;
+    };
+    std::mutex connectionsMutex;
+    std::list<Connection> connections;
+
+    // A shutdown request wakes the accept() below and every other
+    // connection's read, so the server stops without waiting on clients
+    auto stopServing = [&]() {
+        ::shutdown(listenFd, SHUT_RDWR);
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (auto& connection : connections) {
+            ::shutdown(connection.fd, SHUT_RD);
+        }
+    };
+
+    auto serveConnection = [&](int clientFd) {
+        std::string pending;
+        char buffer[4096];
+        bool connected = true;
+        DiagnosticDeltaTracker deltas;
+
+        while (connected && !m_shutdownRequested) {
+            ssize_t count = ::read(clientFd, buffer, sizeof(buffer));
+            if (count <= 0) break;
+            pending.append(buffer, static_cast<size_t>(count));
+
+            size_t lineEnd;
+            while (connected && !m_shutdownRequested && (lineEnd = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, lineEnd);
+                pending.erase(0, lineEnd + 1);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (line.find_first_not_of(" \t") == std::string::npos) continue;
+
+                connected = sendAll(clientFd, handleRequest(line, deltas) + "\n");
+            }
+        }
+
+        if (concurrent && m_shutdownRequested) {
+            stopServing();
+        }
+    };
+
+    while (!m_shutdownRequested) {
+        int clientFd = ::accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (!concurrent) {
+            serveConnection(clientFd);
+            ::close(clientFd);
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (it->done) {
+                it->thread.join();
+                ::close(it->fd);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        connections.push_back(Connection{ clientFd, std::thread(), false });
+        Connection* connection = &connections.back();
+        connection->thread = std::thread([&, connection]() {
+            serveConnection(connection->fd);
+            std::lock_guard<std::mutex> doneLock(connectionsMutex);
+            connection->done = true;
+        });
+
+        // Accepted while another connection was asking to stop
+        if (m_shutdownRequested) {
+            ::shutdown(clientFd, SHUT_RD);
+        }
+    }
+
+    for (auto& connection : connections) {
+        connection.thread.join();
+        ::close(connection.fd);
+    }
+
+    ::close(listenFd);
+    ::unlink(socketPath.c_str());
+    return 0;
+}
+
+#else
+
+int CompileServer::serveUnixSocket(const std::string& socketPath) {
+    std::cerr << "Error: Unix socket mode is not supported on this platform (" << socketPath << ")" << std::endl;
+    return 1;
+}
+
+#endif
+
+} // namespace CSProCompiler
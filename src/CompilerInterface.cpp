@@ -4,13 +4,21 @@
  */
 
 #include "../include/CompilerInterface.h"
+#include "../include/DiagnosticConverter.h"
+#include "../include/LogicScanner.h"
+#include "../include/PhaseTiming.h"
+#include "../include/SharedObjectCache.h"
+#include "../include/TextEncoding.h"
+#include "../include/WorkingDirectory.h"
 #include <chrono>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <string>
 #include <locale.h>
+#ifdef _WIN32
 #include <mbctype.h>
+#endif
 
 #ifdef CSPRO_SDK_AVAILABLE
 // CSPro standard system includes (MFC, Windows, C++17 std lib, string utilities)
@@ -19,6 +27,7 @@
 
 // CSPro Designer Compiler API headers
 #include <zAppO/Application.h>
+#include <zDictO/DDClass.h>
 #include <zEngineO/FileApplicationLoader.h>
 #include <zEngineO/ApplicationBuilder.h>
 #include <zToolsO/CSProException.h>
@@ -42,6 +51,33 @@ namespace fs = std::filesystem;
 
 namespace CSProCompiler {
 
+#ifdef CSPRO_SDK_AVAILABLE
+namespace {
+    // Dictionaries come from the process-wide cache. Building the
+    // application attaches symbols to its dictionaries, so each compile
+    // gets its own copy of the shared, parsed one.
+    class CachingApplicationLoader : public FileApplicationLoader {
+    public:
+        using FileApplicationLoader::FileApplicationLoader;
+
+        std::shared_ptr<CDataDict> GetDictionary(NullTerminatedString dictionary_filename) override {
+            std::shared_ptr<const CDataDict> parsed = sharedDictionaryCache().get<CDataDict>(
+                fs::path(dictionary_filename.c_str()),
+                [](const fs::path& file, std::string_view contents, size_t& bytes) -> std::shared_ptr<const CDataDict> {
+                    std::shared_ptr<CDataDict> dictionary = CDataDict::InstantiateAndOpen(file.wstring(), true);
+                    // Parsed objects run to a few times their JSON
+                    bytes = sizeof(CDataDict) + contents.size() * 4;
+                    return dictionary;
+                });
+            if (!parsed) {
+                return FileApplicationLoader::GetDictionary(dictionary_filename);
+            }
+            return std::make_shared<CDataDict>(*parsed);
+        }
+    };
+}
+#endif
+
 class CSProEngineImpl : public ICompilerEngine {
 private:
     bool m_initialized;
@@ -63,7 +99,9 @@ public:
     
     bool initialize() override {
         setlocale(LC_ALL, "");
+#ifdef _WIN32
         _setmbcp(_MB_CP_LOCALE);
+#endif
 
         if (m_initialized) return true;
         
@@ -100,58 +138,127 @@ public:
     }
     
     CompilationResult compile(const CompilerOptions& options) override {
+        return compileInternal(options, nullptr);
+    }
+
+    CompilationResult compileStreaming(const CompilerOptions& options, IDiagnosticSink& sink) override {
+        return compileInternal(options, &sink);
+    }
+
+private:
+    // Stream the diagnostic to the sink when there is one, otherwise collect it
+    static void addDiagnostic(CompilationResult& result, IDiagnosticSink* sink, const DiagnosticView& diagnostic) {
+        if (sink != nullptr) {
+            sink->onDiagnostic(diagnostic);
+        } else {
+            result.diagnostics.push_back(diagnostic);
+        }
+    }
+
+    CompilationResult compileInternal(const CompilerOptions& options, IDiagnosticSink* sink) {
         CompilationResult result;
         auto startTime = std::chrono::high_resolution_clock::now();
-        
+
+        // Checked between phases; a superseded compile stops at the next one
+        auto cancelled = [&]() {
+            if (!options.cancellation.isCancelled()) {
+                return false;
+            }
+            result.cancelled = true;
+            result.success = false;
+            auto endTime = std::chrono::high_resolution_clock::now();
+            result.compilationTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+            return true;
+        };
+
+        // A syntax check stops at structural errors the native pre-scan can
+        // find, without loading the application into the engine
+        if (options.checkSyntaxOnly) {
+            PhaseRecorder prescanPhases(result.phases);
+            PhaseScope phase(prescanPhases, "prescan");
+            CompilationResult prescan = prescanApplication(options);
+            phase.end();
+
+            if (prescan.errorCount > 0) {
+                if (sink != nullptr) {
+                    for (const auto& diagnostic : prescan.diagnostics) {
+                        sink->onDiagnostic(diagnostic);
+                    }
+                    prescan.diagnostics.clear();
+                }
+                prescan.phases = std::move(result.phases);
+                return prescan;
+            }
+        }
+        if (cancelled()) {
+            return result;
+        }
+
         if (!m_initialized) {
             if (!initialize()) {
                 result.success = false;
-                result.diagnostics.push_back({"", 0, 0, "Failed to initialize CSPro engine", "", DiagnosticMessage::Severity::Error});
+                addDiagnostic(result, sink, {"", 0, 0, "Failed to initialize CSPro engine", "", DiagnosticMessage::Severity::Error});
                 return result;
             }
         }
         
 #ifdef CSPRO_SDK_AVAILABLE
+        PhaseRecorder phases(result.phases);
         try {
-            std::wstring wInputFile(options.inputFile.begin(), options.inputFile.end());
-            CString csInputFile(wInputFile.c_str());
             m_application = std::make_unique<Application>();
             
             // Force Logic Version 8.0+ to ensure modern syntax support and full error reporting
             Versioning::SetCompiledLogicVersion(Serializer::GetCurrentVersion());
             
-            // Set CWD
-            std::filesystem::path originalCwd = std::filesystem::current_path();
-            std::filesystem::path appDir(wInputFile);
-            if (appDir.is_relative()) {
-                appDir = originalCwd / appDir;
-            }
-            appDir = std::filesystem::canonical(appDir);
-            std::filesystem::path appFileName = appDir.filename();
-            appDir.remove_filename();
-            
-            std::filesystem::current_path(appDir);
+            if (cancelled()) {
+                return result;
+            }
+            {
+                PhaseScope phase(phases, "open");
 
-            std::filesystem::path absoluteAppPath = appDir / appFileName;
-            m_application->Open(CString(absoluteAppPath.c_str()), true, true);
-            
-            // Ensure Application object also has V80 settings
-            LogicSettings logicSettings = m_application->GetLogicSettings();
-            logicSettings.SetVersion(LogicSettings::Version::V8_0);
-            m_application->SetLogicSettings(logicSettings);
-            
-            std::filesystem::current_path(originalCwd);
+                // Resolved against options.baseDirectory, never the CWD
+                std::filesystem::path absoluteAppPath = std::filesystem::canonical(resolveInputFile(options));
+
+                {
+                    // Application::Open resolves some references against the CWD;
+                    // the guard serializes that and restores the CWD on any exit
+                    ScopedWorkingDirectory workingDirectory(absoluteAppPath.parent_path());
+                    m_application->Open(CString(absoluteAppPath.c_str()), true, true);
+                }
+                
+                // Ensure Application object also has V80 settings
+                LogicSettings logicSettings = m_application->GetLogicSettings();
+                logicSettings.SetVersion(LogicSettings::Version::V8_0);
+                m_application->SetLogicSettings(logicSettings);
+            }
             
-            BuildApplication(std::make_shared<FileApplicationLoader>(m_application.get()));
+            if (cancelled()) {
+                return result;
+            }
+            {
+                PhaseScope phase(phases, "build-application");
+                BuildApplication(std::make_shared<CachingApplicationLoader>(m_application.get()));
+            }
             
-            CSourceCode* pSourceCode = new CSourceCode(*m_application);
+            if (cancelled()) {
+                return result;
+            }
+
+            // Owned here until the application takes it, so a failed load does not leak it
+            auto sourceCode = std::make_unique<CSourceCode>(*m_application);
             // Load the source code from the application's logic file
-            if (!pSourceCode->Load()) {
-                result.diagnostics.push_back({options.inputFile, 0, 0, "Failed to load application source code", "", DiagnosticMessage::Severity::Error});
+            bool sourceLoaded;
+            {
+                PhaseScope phase(phases, "load-source");
+                sourceLoaded = sourceCode->Load();
+            }
+            if (!sourceLoaded) {
+                addDiagnostic(result, sink, {options.inputFile, 0, 0, "Failed to load application source code", "", DiagnosticMessage::Severity::Error});
                 result.success = false;
                 return result;
             }
-            m_application->SetAppSrcCode(pSourceCode);
+            CSourceCode* pSourceCode = sourceCode.get();
+            m_application->SetAppSrcCode(sourceCode.release());
             
             m_compiler = std::make_unique<CCompiler>(m_application.get());
             m_compiler->SetOptimizeFlowTree(true);
@@ -159,51 +266,53 @@ public:
             
             // Do NOT call Init() explicitly.
             
+            if (cancelled()) {
+                return result;
+            }
+            PhaseScope fullCompilePhase(phases, "full-compile");
             CCompiler::Result compileResult = m_compiler->FullCompile(pSourceCode);
-            
+            fullCompilePhase.end();
+
+            if (cancelled()) {
+                return result;
+            }
+            PhaseScope convertPhase(phases, "convert-messages");
             const std::vector<Logic::ParserMessage>& allMessages = CCompiler::GetCurrentSession()->GetParserMessages();
             
+            DiagnosticConverter converter(options.inputFile);
+            if (sink == nullptr) {
+                result.diagnostics.reserve(allMessages.size());
+            }
+
+            // One scratch message; the list copies it into its arena
+            DiagnosticMessage msg;
             for (const auto& parserMsg : allMessages) {
-                DiagnosticMessage msg;
-                msg.file = options.inputFile;
-                msg.line = static_cast<int>(parserMsg.line_number);
-                msg.column = static_cast<int>(parserMsg.position_in_line);
-                
-                std::string formatted = parserMsg.what();
-                if (formatted == "Logic - Parser Message" && !parserMsg.message_text.empty()) {
-                    std::wstring wMsgText = parserMsg.message_text;
-                    formatted = std::string(wMsgText.begin(), wMsgText.end());
-                }
-                msg.message = formatted;
-                
-                if (!parserMsg.proc_name.empty()) {
-                    std::wstring wProcName = parserMsg.proc_name;
-                    msg.procName = std::string(wProcName.begin(), wProcName.end());
-                } else if (!parserMsg.compilation_unit_name.empty()) {
-                    std::wstring wUnitName = parserMsg.compilation_unit_name;
-                    msg.procName = std::string(wUnitName.begin(), wUnitName.end());
-                }
+                ParserMessageFields fields;
+                fields.formattedText = parserMsg.what();
+                fields.messageText = parserMsg.message_text;
+                fields.procName = parserMsg.proc_name;
+                fields.compilationUnitName = parserMsg.compilation_unit_name;
+                fields.line = static_cast<int>(parserMsg.line_number);
+                fields.column = static_cast<int>(parserMsg.position_in_line);
+                fields.messageNumber = parserMsg.message_number;
                 
                 switch (parserMsg.type) {
                     case Logic::ParserMessage::Type::Error:
-                        msg.severity = DiagnosticMessage::Severity::Error;
+                        fields.severity = DiagnosticMessage::Severity::Error;
                         result.errorCount++;
                         break;
                     case Logic::ParserMessage::Type::Warning:
                     case Logic::ParserMessage::Type::DeprecationMajor:
                     case Logic::ParserMessage::Type::DeprecationMinor:
-                        msg.severity = DiagnosticMessage::Severity::Warning;
+                        fields.severity = DiagnosticMessage::Severity::Warning;
                         result.warningCount++;
                         break;
                 }
-                
-                if (!parserMsg.compilation_unit_name.empty()) {
-                    std::wstring wUnitName = parserMsg.compilation_unit_name;
-                    msg.file = std::string(wUnitName.begin(), wUnitName.end());
-                }
 
-                result.diagnostics.push_back(msg);
+                converter.convert(fields, msg);
+                addDiagnostic(result, sink, msg);
             }
+            convertPhase.end();
             
             if (result.errorCount == 0) {
                 result.success = true;
@@ -217,14 +326,16 @@ public:
             
         }
         catch (const std::exception& ex) {
-            result.diagnostics.push_back({options.inputFile, 0, 0, std::string("Exception: ") + ex.what(), "", DiagnosticMessage::Severity::Error});
+            addDiagnostic(result, sink, {options.inputFile, 0, 0, std::string("Exception: ") + ex.what(), "", DiagnosticMessage::Severity::Error});
             result.success = false;
         }
         catch (...) {
-            result.diagnostics.push_back({options.inputFile, 0, 0, "Unknown exception during compilation", "", DiagnosticMessage::Severity::Error});
+            addDiagnostic(result, sink, {options.inputFile, 0, 0, "Unknown exception during compilation", "", DiagnosticMessage::Severity::Error});
             result.success = false;
         }
 #else
+        (void)options;
+        (void)sink;
         result.success = false;
 #endif
         
@@ -239,6 +350,18 @@ std::unique_ptr<ICompilerEngine> createCompilerEngine() {
     return std::make_unique<CSProEngineImpl>();
 }
 
+const char* toolVersion() {
+    return CSPROCOMPILE_VERSION;
+}
+
+std::string compilerEngineIdentity() {
+#ifdef CSPRO_SDK_AVAILABLE
+    return std::string("cspro-sdk-") + CSPRO_SDK_VERSION;
+#else
+    return "cspro-unavailable";
+#endif
+}
+
 } // namespace CSProCompiler
 
 
@@ -0,0 +1,131 @@
+/*
+ * ContentHash.cpp - Fast non-cryptographic content hashing
+ */
+
+#include "../include/ContentHash.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr uint64_t Prime1 = 11400714785074694791ULL;
+    constexpr uint64_t Prime2 = 14029467366897019727ULL;
+    constexpr uint64_t Prime3 = 1609587929392839161ULL;
+    constexpr uint64_t Prime4 = 9650029242287828579ULL;
+    constexpr uint64_t Prime5 = 2870177450012600261ULL;
+
+    inline uint64_t rotl(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // Inputs are read as little-endian, which is what every supported target is
+    inline uint64_t read64(const unsigned char* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t read32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t round(uint64_t accumulator, uint64_t input) {
+        accumulator += input * Prime2;
+        accumulator = rotl(accumulator, 31);
+        return accumulator * Prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t accumulator, uint64_t value) {
+        accumulator ^= round(0, value);
+        return accumulator * Prime1 + Prime4;
+    }
+}
+
+uint64_t hash64(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        const unsigned char* limit = end - 32;
+        uint64_t v1 = seed + Prime1 + Prime2;
+        uint64_t v2 = seed + Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - Prime1;
+
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    } else {
+        hash = seed + Prime5;
+    }
+
+    hash += static_cast<uint64_t>(length);
+
+    while (p + 8 <= end) {
+        hash ^= round(0, read64(p));
+        hash = rotl(hash, 27) * Prime1 + Prime4;
+        p += 8;
+    }
+
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(p)) * Prime1;
+        hash = rotl(hash, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+
+    while (p < end) {
+        hash ^= (*p) * Prime5;
+        hash = rotl(hash, 11) * Prime1;
+        p++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+bool hashFile(const std::filesystem::path& path, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad()) {
+        return false;
+    }
+
+    hash = hash64(contents.data(), contents.size());
+    return true;
+}
+
+std::string hashToHex(uint64_t hash) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        hex[static_cast<size_t>(i)] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+    return hex;
+}
+
+} // namespace CSProCompiler
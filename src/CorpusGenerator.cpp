@@ -0,0 +1,238 @@
+/*
+ * CorpusGenerator.cpp - Reproducible synthetic CSPro applications
+ */
+
+#include "../include/CorpusGenerator.h"
+#include "../include/FileWriter.h"
+#include <algorithm>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    // splitmix64: tiny, fast and fully specified, so corpora match across
+    // platforms and standard libraries
+    class SplitMix64 {
+    public:
+        explicit SplitMix64(uint64_t seed) : m_state(seed) {}
+
+        uint64_t next() {
+            uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in [0, bound); the modulo bias is irrelevant at these bounds
+        uint32_t below(uint32_t bound) {
+            return static_cast<uint32_t>(next() % bound);
+        }
+
+        // Uniform in [0, 1)
+        double fraction() {
+            return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+    private:
+        uint64_t m_state;
+    };
+
+    std::string padded(long long number, size_t width) {
+        std::string digits = std::to_string(number);
+        return std::string(width > digits.size() ? width - digits.size() : 0, '0') + digits;
+    }
+
+    std::string sharedItemName(int dictionary, int item) {
+        return "S" + padded(dictionary, 2) + "_V" + padded(item, 4);
+    }
+
+    std::string procItemName(int proc) {
+        return "Q" + padded(proc, 5);
+    }
+
+    std::string buildDictionary(const std::string& name, const std::vector<std::string>& items) {
+        std::string text = "{\n  \"software\": \"CSPro\",\n  \"version\": 8.0,\n  \"fileType\": \"dictionary\",\n"
+                           "  \"name\": \"" + name + "\",\n  \"labels\": [ { \"text\": \"Synthetic " + name + "\" } ],\n"
+                           "  \"levels\": [ {\n    \"name\": \"" + name + "_LEVEL\",\n    \"records\": [ {\n"
+                           "      \"name\": \"" + name + "_REC\",\n      \"items\": [\n";
+        int start = 1;
+        for (size_t i = 0; i < items.size(); i++) {
+            int length = 1 + static_cast<int>(i % 3);
+            text += "        { \"name\": \"" + items[i] + "\", \"labels\": [ { \"text\": \"Question " + std::to_string(i + 1) +
+                    "\" } ], \"contentType\": \"numeric\", \"start\": " + std::to_string(start) +
+                    ", \"length\": " + std::to_string(length) + ",\n          \"valueSets\": [ { \"name\": \"" + items[i] +
+                    "_VS1\", \"values\": [";
+            for (int v = 1; v <= 5; v++) {
+                text += std::string(v > 1 ? "," : "") + " { \"labels\": [ { \"text\": \"Answer " + std::to_string(v) +
+                        "\" } ], \"pairs\": [ { \"from\": " + std::to_string(v) + " } ] }";
+            }
+            text += " ] } ] }";
+            text += (i + 1 < items.size()) ? ",\n" : "\n";
+            start += length;
+        }
+        text += "      ]\n    } ]\n  } ]\n}\n";
+        return text;
+    }
+
+    struct LogicWriter {
+        const CorpusOptions& options;
+        SplitMix64& random;
+        const std::vector<int>& dictionaries;
+        CorpusApplication& application;
+        std::string text;
+
+        // One line, with a marker at the configured densities
+        void line(std::string_view content) {
+            text += content;
+            double roll = random.fraction() * 1000.0;
+            if (roll < options.errorsPerThousandLines) {
+                application.errors++;
+                text += " { @error E" + std::to_string(application.errors) + ": synthetic error }";
+            } else if (roll < options.errorsPerThousandLines + options.warningsPerThousandLines) {
+                application.warnings++;
+                text += " { @warning W" + std::to_string(application.warnings) + ": synthetic warning }";
+            }
+            text += '\n';
+            application.lines++;
+        }
+
+        std::string sharedItem() {
+            if (dictionaries.empty() || options.itemsPerDictionary == 0) {
+                return "total";
+            }
+            return sharedItemName(dictionaries[random.below(static_cast<uint32_t>(dictionaries.size()))],
+                                  static_cast<int>(random.below(static_cast<uint32_t>(options.itemsPerDictionary))));
+        }
+
+        // bodyLines lines of statements about item
+        void procBody(const std::string& item, int bodyLines) {
+            while (bodyLines > 0) {
+                uint32_t kind = random.below(bodyLines >= 3 ? 5 : 3);
+                if (kind == 0) {
+                    line("    total = total + " + item + " * " + std::to_string(1 + random.below(9)) + ";");
+                    bodyLines--;
+                } else if (kind == 1) {
+                    line("    // Checked against " + sharedItem());
+                    bodyLines--;
+                } else if (kind == 2) {
+                    line("    if " + item + " = notappl then checked = checked + 1; endif;");
+                    bodyLines--;
+                } else {
+                    line("    if " + item + " > " + std::to_string(1 + random.below(5)) + " and " + sharedItem() + " <> 1 then");
+                    line("        errmsg(\"" + item + " inconsistent with the household record\");");
+                    line("    endif;");
+                    bodyLines -= 3;
+                }
+            }
+        }
+    };
+
+    bool writeGenerated(const fs::path& path, const std::string& contents, CorpusStats& stats, std::string& error) {
+        FileWriteOutcome outcome = writeFileIfChanged(path, contents);
+        if (outcome == FileWriteOutcome::Failed) {
+            error = "Cannot write " + path.u8string();
+            return false;
+        }
+        (outcome == FileWriteOutcome::Written ? stats.filesWritten : stats.filesUnchanged)++;
+        stats.bytes += contents.size();
+        return true;
+    }
+}
+
+bool generateCorpus(const fs::path& directory, const CorpusOptions& options, CorpusStats& stats, std::string& error) {
+    if (options.applications < 1 || options.procsPerApplication < 1 || options.sharedDictionaries < 0 ||
+        options.fanOut < 0 || options.fanOut > options.sharedDictionaries || options.itemsPerDictionary < 0 ||
+        options.warningsPerThousandLines < 0 || options.errorsPerThousandLines < 0 ||
+        options.warningsPerThousandLines + options.errorsPerThousandLines > 1000) {
+        error = "Corpus options out of range";
+        return false;
+    }
+    // PROC GLOBAL, its declarations, and a blank line and header per PROC
+    int minimumLines = 2 * options.procsPerApplication + 2;
+    if (options.linesPerApplication < minimumLines) {
+        error = "Need at least " + std::to_string(minimumLines) + " lines for " +
+                std::to_string(options.procsPerApplication) + " PROCs";
+        return false;
+    }
+
+    std::error_code ec;
+    fs::create_directories(directory / "dicts", ec);
+    if (ec) {
+        error = "Cannot create " + (directory / "dicts").u8string() + ": " + ec.message();
+        return false;
+    }
+
+    stats = CorpusStats();
+    for (int d = 0; d < options.sharedDictionaries; d++) {
+        std::vector<std::string> items;
+        for (int i = 0; i < options.itemsPerDictionary; i++) {
+            items.push_back(sharedItemName(d, i));
+        }
+        std::string name = "SHARED" + padded(d, 2);
+        if (!writeGenerated(directory / "dicts" / ("Shared" + padded(d, 2) + ".dcf"), buildDictionary(name, items), stats, error)) {
+            return false;
+        }
+    }
+
+    for (int a = 0; a < options.applications; a++) {
+        std::string name = "App" + padded(a, 4);
+        fs::path applicationDirectory = directory / ("app" + padded(a, 4));
+        fs::create_directories(applicationDirectory, ec);
+
+        // Each application's stream depends only on the seed and its index
+        SplitMix64 random(options.seed ^ SplitMix64(static_cast<uint64_t>(a)).next());
+
+        std::vector<int> dictionaries;
+        for (int k = 0; k < options.fanOut; k++) {
+            dictionaries.push_back((a + k) % options.sharedDictionaries);
+        }
+
+        std::string entry = "{\n  \"software\": \"CSPro\",\n  \"version\": 8.0,\n  \"fileType\": \"application\",\n"
+                            "  \"type\": \"entry\",\n  \"name\": \"" + name + "\",\n"
+                            "  \"labels\": [ { \"text\": \"Synthetic application " + std::to_string(a) + "\" } ],\n"
+                            "  \"dictionaries\": [\n    { \"type\": \"input\", \"path\": \"" + name + ".dcf\" }";
+        for (int d : dictionaries) {
+            entry += ",\n    { \"type\": \"external\", \"path\": \"../dicts/Shared" + padded(d, 2) + ".dcf\" }";
+        }
+        entry += "\n  ],\n  \"code\": [ { \"type\": \"main\", \"path\": \"" + name + ".apc\" } ]\n}\n";
+
+        std::vector<std::string> procItems;
+        for (int p = 0; p < options.procsPerApplication; p++) {
+            procItems.push_back(procItemName(p));
+        }
+
+        CorpusApplication application;
+        application.applicationFile = (applicationDirectory / (name + ".ent")).u8string();
+        application.procs = options.procsPerApplication;
+
+        LogicWriter logic{ options, random, dictionaries, application, std::string() };
+        logic.text.reserve(static_cast<size_t>(options.linesPerApplication) * 48);
+        logic.text += "PROC GLOBAL\n";
+        application.lines++;
+        logic.line("numeric total, checked;");
+
+        int bodyLines = options.linesPerApplication - minimumLines;
+        for (int p = 0; p < options.procsPerApplication; p++) {
+            logic.text += "\nPROC " + procItems[p] + "\n";
+            application.lines += 2;
+            int lines = bodyLines / options.procsPerApplication + (p < bodyLines % options.procsPerApplication ? 1 : 0);
+            logic.procBody(procItems[p], lines);
+        }
+
+        if (!writeGenerated(applicationDirectory / (name + ".ent"), entry, stats, error) ||
+            !writeGenerated(applicationDirectory / (name + ".dcf"), buildDictionary(name, procItems), stats, error) ||
+            !writeGenerated(applicationDirectory / (name + ".apc"), logic.text, stats, error)) {
+            return false;
+        }
+
+        stats.lines += application.lines;
+        stats.warnings += application.warnings;
+        stats.errors += application.errors;
+        stats.applications.push_back(std::move(application));
+    }
+    return true;
+}
+
+} // namespace CSProCompiler
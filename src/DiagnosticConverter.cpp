@@ -0,0 +1,58 @@
+/*
+ * DiagnosticConverter.cpp - Logic::ParserMessage to DiagnosticMessage conversion
+ */
+
+#include "../include/DiagnosticConverter.h"
+#include "../include/TextEncoding.h"
+
+namespace CSProCompiler {
+
+namespace {
+    // What ParserMessage::what() reports when the text lives in message_text
+    constexpr std::string_view GenericParserMessage = "Logic - Parser Message";
+}
+
+const std::string& DiagnosticConverter::NameCache::get(std::wstring_view name) {
+    if (!valid || name != wide) {
+        wide.assign(name.data(), name.size());
+        utf8.clear();
+        appendUtf8(utf8, name);
+        valid = true;
+    }
+    return utf8;
+}
+
+DiagnosticConverter::DiagnosticConverter(std::string inputFile)
+    : m_inputFile(std::move(inputFile))
+{}
+
+void DiagnosticConverter::convert(const ParserMessageFields& fields, DiagnosticMessage& diag) {
+    diag.line = fields.line;
+    diag.column = fields.column;
+    diag.severity = fields.severity;
+    diag.messageNumber = fields.messageNumber;
+
+    diag.message.clear();
+    if (fields.formattedText == GenericParserMessage && !fields.messageText.empty()) {
+        appendUtf8(diag.message, fields.messageText);
+    } else {
+        diag.message.assign(fields.formattedText.data(), fields.formattedText.size());
+    }
+
+    // The compilation unit names the file; the PROC falls back to it as well
+    if (!fields.compilationUnitName.empty()) {
+        diag.file = m_unitNames.get(fields.compilationUnitName);
+    } else {
+        diag.file = m_inputFile;
+    }
+
+    if (!fields.procName.empty()) {
+        diag.procName = m_procNames.get(fields.procName);
+    } else if (!fields.compilationUnitName.empty()) {
+        diag.procName = diag.file;
+    } else {
+        diag.procName.clear();
+    }
+}
+
+} // namespace CSProCompiler
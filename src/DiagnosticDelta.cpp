@@ -0,0 +1,214 @@
+/*
+ * DiagnosticDelta.cpp - Differences between consecutive compiles' diagnostics
+ */
+
+#include "../include/DiagnosticDelta.h"
+#include "../include/ContentHash.h"
+#include "../include/FileWriter.h"
+#include "../include/MappedFile.h"
+#include <algorithm>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr char StateMagic[4] = { 'C', 'D', 'L', 'T' };
+    constexpr uint32_t StateFormatVersion = 1;
+
+    // Fields are in host byte order, like the message catalogs
+    struct StateHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t applicationCount;
+        uint32_t reserved;
+    };
+
+    struct ApplicationHeader {
+        uint64_t sequence;
+        uint32_t sinceSnapshot;
+        uint32_t pathLength;        // UTF-8 path follows, then the entries
+        uint64_t entryCount;
+    };
+
+    static_assert(sizeof(StateHeader) == 16, "state header must not be padded");
+    static_assert(sizeof(ApplicationHeader) == 24, "application header must not be padded");
+
+    void appendField(std::string& key, std::string_view text) {
+        key.append(text);
+        key.push_back('\0');
+    }
+
+    void appendField(std::string& key, int number) {
+        key.append(reinterpret_cast<const char*>(&number), sizeof(number));
+    }
+
+    uint64_t identityOf(const DiagnosticView& diag, std::string& key) {
+        key.clear();
+        appendField(key, diag.file);
+        appendField(key, diag.procName);
+        appendField(key, diag.line);
+        appendField(key, diag.column);
+        appendField(key, diag.messageNumber);
+        if (diag.messageNumber == 0) {
+            appendField(key, diag.message);
+        }
+        return hash64(key);
+    }
+
+    uint64_t contentOf(const DiagnosticView& diag) {
+        return hash64(diag.message, static_cast<uint64_t>(diag.severity));
+    }
+
+    struct Ranked {
+        uint64_t identity;
+        uint64_t content;
+        size_t index;       // In the result
+    };
+}
+
+DiagnosticDeltaTracker::DiagnosticDeltaTracker(int snapshotInterval)
+    : m_snapshotInterval(std::max(snapshotInterval, 0))
+{}
+
+DiagnosticDelta DiagnosticDeltaTracker::update(const std::string& application, const CompilationResult& result, bool forceFull) {
+    DiagnosticDelta delta;
+
+    // Sorted by identity, then by position in the result
+    std::vector<Ranked> current;
+    current.reserve(result.diagnostics.size());
+    std::string key;
+    for (size_t i = 0; i < result.diagnostics.size(); i++) {
+        DiagnosticView diag = result.diagnostics[i];
+        current.push_back({ identityOf(diag, key), contentOf(diag), i });
+    }
+    auto byIdentity = [](const Ranked& a, const Ranked& b) {
+        return a.identity < b.identity || (a.identity == b.identity && a.index < b.index);
+    };
+    std::sort(current.begin(), current.end(), byIdentity);
+
+    // Repeats of an identity are renamed by their occurrence in the result
+    bool renamed = false;
+    for (size_t first = 0; first < current.size();) {
+        size_t last = first + 1;
+        while (last < current.size() && current[last].identity == current[first].identity) {
+            identityOf(result.diagnostics[current[last].index], key);
+            current[last].identity = hash64(key, last - first);
+            last++;
+            renamed = true;
+        }
+        first = last;
+    }
+    if (renamed) {
+        std::sort(current.begin(), current.end(), byIdentity);
+    }
+
+    delta.identities.resize(current.size());
+    for (const auto& entry : current) {
+        delta.identities[entry.index] = entry.identity;
+    }
+
+    ApplicationState& state = m_applications[application];
+    bool snapshot = forceFull || state.sequence == 0 ||
+                    (m_snapshotInterval > 0 && state.sinceSnapshot + 1 >= static_cast<uint32_t>(m_snapshotInterval));
+    delta.full = snapshot;
+    delta.sequence = ++state.sequence;
+    state.sinceSnapshot = snapshot ? 0 : state.sinceSnapshot + 1;
+
+    if (!snapshot) {
+        const std::vector<Entry>& previous = state.entries;
+        size_t p = 0;
+        for (const auto& entry : current) {
+            while (p < previous.size() && previous[p].identity < entry.identity) {
+                delta.removed.push_back(previous[p++].identity);
+            }
+            if (p < previous.size() && previous[p].identity == entry.identity) {
+                if (previous[p].content != entry.content) {
+                    delta.changed.push_back(entry.index);
+                }
+                p++;
+            } else {
+                delta.added.push_back(entry.index);
+            }
+        }
+        for (; p < previous.size(); p++) {
+            delta.removed.push_back(previous[p].identity);
+        }
+        std::sort(delta.added.begin(), delta.added.end());
+        std::sort(delta.changed.begin(), delta.changed.end());
+    }
+
+    state.entries.resize(current.size());
+    for (size_t i = 0; i < current.size(); i++) {
+        state.entries[i] = { current[i].identity, current[i].content };
+    }
+    return delta;
+}
+
+bool DiagnosticDeltaTracker::load(const fs::path& stateFile) {
+    m_applications.clear();
+
+    MappedFile file;
+    if (!file.open(stateFile)) {
+        return false;
+    }
+    std::string_view data = file.view();
+
+    StateHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, StateMagic, sizeof(header.magic)) != 0 || header.version != StateFormatVersion) {
+        return false;
+    }
+    data.remove_prefix(sizeof(header));
+
+    std::map<std::string, ApplicationState> applications;
+    for (uint32_t a = 0; a < header.applicationCount; a++) {
+        ApplicationHeader application;
+        if (data.size() < sizeof(application)) {
+            return false;
+        }
+        std::memcpy(&application, data.data(), sizeof(application));
+        data.remove_prefix(sizeof(application));
+        if (data.size() < application.pathLength ||
+            (data.size() - application.pathLength) / sizeof(Entry) < application.entryCount) {
+            return false;
+        }
+
+        ApplicationState& state = applications[std::string(data.substr(0, application.pathLength))];
+        data.remove_prefix(application.pathLength);
+        state.sequence = application.sequence;
+        state.sinceSnapshot = application.sinceSnapshot;
+        state.entries.resize(static_cast<size_t>(application.entryCount));
+        std::memcpy(state.entries.data(), data.data(), state.entries.size() * sizeof(Entry));
+        data.remove_prefix(state.entries.size() * sizeof(Entry));
+    }
+
+    m_applications = std::move(applications);
+    return true;
+}
+
+bool DiagnosticDeltaTracker::save(const fs::path& stateFile) const {
+    StateHeader header = {};
+    std::memcpy(header.magic, StateMagic, sizeof(header.magic));
+    header.version = StateFormatVersion;
+    header.applicationCount = static_cast<uint32_t>(m_applications.size());
+
+    std::string image(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& [path, state] : m_applications) {
+        ApplicationHeader application = {};
+        application.sequence = state.sequence;
+        application.sinceSnapshot = state.sinceSnapshot;
+        application.pathLength = static_cast<uint32_t>(path.size());
+        application.entryCount = state.entries.size();
+        image.append(reinterpret_cast<const char*>(&application), sizeof(application));
+        image.append(path);
+        image.append(reinterpret_cast<const char*>(state.entries.data()), state.entries.size() * sizeof(Entry));
+    }
+    return writeFileAtomically(stateFile, image);
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,107 @@
+/*
+ * DiagnosticList.cpp - Compact interned diagnostic storage
+ */
+
+#include "../include/CompilerInterface.h"
+#include "../include/ContentHash.h"
+#include <stdexcept>
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr uint32_t EmptyBucket = 0;
+    constexpr size_t InitialBucketCount = 16;
+
+    uint32_t checkedSize(size_t size) {
+        if (size > UINT32_MAX) {
+            throw std::length_error("DiagnosticList exceeds 4 GB of text");
+        }
+        return static_cast<uint32_t>(size);
+    }
+}
+
+void DiagnosticList::push_back(const DiagnosticView& diag) {
+    Record record;
+    record.fileId = intern(diag.file);
+    record.procNameId = intern(diag.procName);
+    record.messageOffset = checkedSize(m_messageText.size());
+    record.messageLength = checkedSize(diag.message.size());
+    record.line = diag.line;
+    record.column = diag.column;
+    record.messageNumber = diag.messageNumber;
+    record.severity = diag.severity;
+
+    m_messageText.append(diag.message.data(), diag.message.size());
+    checkedSize(m_messageText.size());
+    m_records.push_back(record);
+}
+
+void DiagnosticList::reserve(size_t count, size_t textBytes) {
+    m_records.reserve(count);
+    m_messageText.reserve(count * textBytes);
+}
+
+void DiagnosticList::clear() {
+    m_records.clear();
+    m_messageText.clear();
+    m_nameText.clear();
+    m_nameSpans.clear();
+    m_nameBuckets.clear();
+}
+
+DiagnosticView DiagnosticList::operator[](size_t index) const {
+    const Record& record = m_records[index];
+    return DiagnosticView(getName(record.fileId), record.line, record.column,
+                          std::string_view(m_messageText.data() + record.messageOffset, record.messageLength),
+                          getName(record.procNameId), record.severity, record.messageNumber);
+}
+
+size_t DiagnosticList::getMemoryUsage() const {
+    return sizeof(*this)
+        + m_records.capacity() * sizeof(Record)
+        + m_messageText.capacity()
+        + m_nameText.capacity()
+        + m_nameSpans.capacity() * sizeof(Span)
+        + m_nameBuckets.capacity() * sizeof(uint32_t);
+}
+
+uint32_t DiagnosticList::intern(std::string_view name) {
+    // Keep the load factor at or below one half
+    if ((m_nameSpans.size() + 1) * 2 > m_nameBuckets.size()) {
+        rehashNames(m_nameBuckets.empty() ? InitialBucketCount : m_nameBuckets.size() * 2);
+    }
+
+    size_t mask = m_nameBuckets.size() - 1;
+    for (size_t bucket = hash64(name) & mask; ; bucket = (bucket + 1) & mask) {
+        uint32_t slot = m_nameBuckets[bucket];
+        if (slot == EmptyBucket) {
+            uint32_t id = checkedSize(m_nameSpans.size());
+            m_nameSpans.push_back({ checkedSize(m_nameText.size()), checkedSize(name.size()) });
+            m_nameText.append(name.data(), name.size());
+            m_nameBuckets[bucket] = id + 1;
+            return id;
+        }
+        if (getName(slot - 1) == name) {
+            return slot - 1;
+        }
+    }
+}
+
+std::string_view DiagnosticList::getName(uint32_t id) const {
+    const Span& span = m_nameSpans[id];
+    return std::string_view(m_nameText.data() + span.offset, span.length);
+}
+
+void DiagnosticList::rehashNames(size_t bucketCount) {
+    m_nameBuckets.assign(bucketCount, EmptyBucket);
+    size_t mask = bucketCount - 1;
+    for (uint32_t id = 0; id < m_nameSpans.size(); id++) {
+        size_t bucket = hash64(getName(id)) & mask;
+        while (m_nameBuckets[bucket] != EmptyBucket) {
+            bucket = (bucket + 1) & mask;
+        }
+        m_nameBuckets[bucket] = id + 1;
+    }
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,1104 @@
+/*
+ * DistributedCompiler.cpp - Batch compilation sharded across build workers
+ */
+
+#include "../include/DistributedCompiler.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/ContentHash.h"
+#include "../include/FileWriter.h"
+#include "../include/MappedFile.h"
+#include "../include/PhaseTiming.h"
+#include "../include/ResultCodec.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <set>
+#include <string_view>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr char HistoryMagic[4] = { 'C', 'T', 'I', 'M' };
+    constexpr uint32_t HistoryFormatVersion = 1;
+
+    // Fields are in host byte order, like the other binary state files
+    struct HistoryHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t count;
+        uint32_t reserved;
+    };
+
+    struct HistoryEntry {
+        double milliseconds;
+        uint32_t pathLength;        // UTF-8 path follows, then the worker
+        uint32_t workerLength;
+    };
+
+    static_assert(sizeof(HistoryHeader) == 16, "history header must not be padded");
+    static_assert(sizeof(HistoryEntry) == 16, "history entries must not be padded");
+
+    bool take(std::string_view& data, void* out, size_t count) {
+        if (data.size() < count) return false;
+        std::memcpy(out, data.data(), count);
+        data.remove_prefix(count);
+        return true;
+    }
+
+    CompilationResult makeFailure(const std::string& inputFile, const std::string& message) {
+        CompilationResult result;
+        result.success = false;
+        result.errorCount = 1;
+        result.diagnostics.push_back({inputFile, 0, 0, message, "", DiagnosticMessage::Severity::Error});
+        return result;
+    }
+}
+
+bool parseWorkerAddress(const std::string& text, WorkerAddress& address) {
+    size_t colon = text.rfind(':');
+    std::string host = (colon == std::string::npos) ? "127.0.0.1" : text.substr(0, colon);
+    std::string port = (colon == std::string::npos) ? text : text.substr(colon + 1);
+    if (host.empty() || port.empty() || port.size() > 5 ||
+        !std::all_of(port.begin(), port.end(), [](unsigned char ch) { return std::isdigit(ch) != 0; })) {
+        return false;
+    }
+    int number = std::stoi(port);
+    if (number > 65535) {
+        return false;
+    }
+    address.host = host;
+    address.port = number;
+    return true;
+}
+
+fs::path CompileTimeHistory::defaultHistoryPath() {
+    return initialWorkingDirectory() / ".csprocompile" / "compile-times";
+}
+
+bool CompileTimeHistory::load(const fs::path& historyFile) {
+    m_times.clear();
+
+    MappedFile file;
+    if (!file.open(historyFile)) {
+        return false;
+    }
+    std::string_view data = file.view();
+
+    HistoryHeader header;
+    if (!take(data, &header, sizeof(header)) || std::memcmp(header.magic, HistoryMagic, sizeof(header.magic)) != 0 ||
+        header.version != HistoryFormatVersion) {
+        return false;
+    }
+
+    std::map<std::string, CompileTime> times;
+    for (uint32_t i = 0; i < header.count; i++) {
+        HistoryEntry entry;
+        if (!take(data, &entry, sizeof(entry)) || data.size() < uint64_t(entry.pathLength) + entry.workerLength) {
+            return false;
+        }
+        CompileTime& time = times[std::string(data.substr(0, entry.pathLength))];
+        time.milliseconds = entry.milliseconds;
+        time.worker = std::string(data.substr(entry.pathLength, entry.workerLength));
+        data.remove_prefix(entry.pathLength + entry.workerLength);
+    }
+    m_times = std::move(times);
+    return true;
+}
+
+bool CompileTimeHistory::save(const fs::path& historyFile) const {
+    HistoryHeader header = {};
+    std::memcpy(header.magic, HistoryMagic, sizeof(header.magic));
+    header.version = HistoryFormatVersion;
+    header.count = static_cast<uint32_t>(m_times.size());
+
+    std::string image(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& [path, time] : m_times) {
+        HistoryEntry entry = { time.milliseconds, static_cast<uint32_t>(path.size()), static_cast<uint32_t>(time.worker.size()) };
+        image.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        image.append(path);
+        image.append(time.worker);
+    }
+
+    std::error_code ec;
+    fs::create_directories(historyFile.parent_path(), ec);
+    return writeFileAtomically(historyFile, image);
+}
+
+bool CompileTimeHistory::lookup(const std::string& applicationFile, CompileTime& time) const {
+    auto found = m_times.find(applicationFile);
+    if (found == m_times.end()) {
+        return false;
+    }
+    time = found->second;
+    return true;
+}
+
+void CompileTimeHistory::record(const std::string& applicationFile, CompileTime time) {
+    m_times[applicationFile] = std::move(time);
+}
+
+DistributedCompiler::DistributedCompiler(DistributedOptions options)
+    : m_options(std::move(options))
+{}
+
+BuildWorker::BuildWorker(EngineFactory factory, fs::path directory)
+    : m_factory(std::move(factory))
+    , m_directory(resolvePath(directory).lexically_normal())
+    , m_listenFd(-1)
+    , m_connectionFd(-1)
+    , m_port(0)
+    , m_stopping(false)
+    , m_verbose(false)
+{}
+
+BuildWorkerStats BuildWorker::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+#ifndef _WIN32
+
+namespace {
+    constexpr uint32_t ProtocolVersion = 1;
+    constexpr uint64_t MaxPayloadBytes = uint64_t(1) << 30;
+
+    enum class MessageType : uint32_t {
+        Hello = 1,          // u32 protocol version, both ways
+        Job = 2,            // u32 flags, text application, u32 count, { text path, u64 digest, u64 size } per input
+        Need = 3,           // u32 count, u32 input index per file the worker lacks
+        File = 4,           // u32 input index, bytes contents
+        Result = 5,         // bytes encoded CompilationResult, bytes compiled .pen (may be empty)
+        Failure = 6         // text message; the job is not retried
+    };
+
+    constexpr uint32_t JobCheckSyntaxOnly = 1;
+    constexpr uint32_t JobGenerateDebugInfo = 2;
+
+    struct FrameHeader {
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t length;
+    };
+
+    static_assert(sizeof(FrameHeader) == 16, "frame header must not be padded");
+
+    class PayloadWriter {
+    public:
+        void u32(uint32_t value) { m_data.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+        void u64(uint64_t value) { m_data.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+        void text(std::string_view value) {
+            u32(static_cast<uint32_t>(value.size()));
+            m_data.append(value);
+        }
+
+        void bytes(std::string_view value) {
+            u64(value.size());
+            m_data.append(value);
+        }
+
+        const std::string& data() const { return m_data; }
+
+    private:
+        std::string m_data;
+    };
+
+    // Every read fails once the payload runs short, so callers check at the end
+    class PayloadReader {
+    public:
+        explicit PayloadReader(std::string_view data) : m_data(data), m_ok(true) {}
+
+        uint32_t u32() { uint32_t value = 0; read(&value, sizeof(value)); return value; }
+        uint64_t u64() { uint64_t value = 0; read(&value, sizeof(value)); return value; }
+
+        std::string_view text() { return slice(u32()); }
+        std::string_view bytes() { return slice(u64()); }
+
+        bool ok() const { return m_ok; }
+
+    private:
+        std::string_view m_data;
+        bool m_ok;
+
+        void read(void* out, size_t count) {
+            m_ok = m_ok && take(m_data, out, count);
+        }
+
+        std::string_view slice(uint64_t count) {
+            if (!m_ok || m_data.size() < count) {
+                m_ok = false;
+                return {};
+            }
+            std::string_view value = m_data.substr(0, static_cast<size_t>(count));
+            m_data.remove_prefix(static_cast<size_t>(count));
+            return value;
+        }
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    std::string describe(const WorkerAddress& address) {
+        return address.host + ":" + std::to_string(address.port);
+    }
+
+    // Milliseconds left until deadline for poll(); -1 waits forever
+    int remainingMs(const Clock::time_point* deadline) {
+        if (deadline == nullptr) return -1;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - Clock::now()).count();
+        return static_cast<int>(std::max<long long>(0, std::min<long long>(left, 60 * 60 * 1000)));
+    }
+
+    bool waitFor(int fd, short events, const Clock::time_point* deadline) {
+        while (true) {
+            pollfd entry = { fd, events, 0 };
+            int ready = ::poll(&entry, 1, remainingMs(deadline));
+            if (ready > 0) return true;
+            if (ready == 0) {
+                if (deadline == nullptr || Clock::now() >= *deadline) return false;
+            } else if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    bool sendAll(int fd, const char* data, size_t length, const Clock::time_point* deadline) {
+        while (length > 0) {
+            if (!waitFor(fd, POLLOUT, deadline)) return false;
+            ssize_t sent = ::send(fd, data, length, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                return false;
+            }
+            data += sent;
+            length -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    bool receiveAll(int fd, char* data, size_t length, const Clock::time_point* deadline) {
+        while (length > 0) {
+            if (!waitFor(fd, POLLIN, deadline)) return false;
+            ssize_t received = ::recv(fd, data, length, 0);
+            if (received < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                return false;
+            }
+            if (received == 0) return false;
+            data += received;
+            length -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+    bool sendMessage(int fd, MessageType type, std::string_view payload, const Clock::time_point* deadline = nullptr) {
+        FrameHeader header = { static_cast<uint32_t>(type), 0, payload.size() };
+        return sendAll(fd, reinterpret_cast<const char*>(&header), sizeof(header), deadline) &&
+               sendAll(fd, payload.data(), payload.size(), deadline);
+    }
+
+    bool receiveMessage(int fd, MessageType& type, std::string& payload, const Clock::time_point* deadline = nullptr) {
+        FrameHeader header;
+        if (!receiveAll(fd, reinterpret_cast<char*>(&header), sizeof(header), deadline) || header.length > MaxPayloadBytes) {
+            return false;
+        }
+        type = static_cast<MessageType>(header.type);
+        payload.resize(static_cast<size_t>(header.length));
+        return receiveAll(fd, payload.data(), payload.size(), deadline);
+    }
+
+    bool sendFailure(int fd, const std::string& message) {
+        PayloadWriter payload;
+        payload.text(message);
+        return sendMessage(fd, MessageType::Failure, payload.data());
+    }
+
+    std::string hello() {
+        PayloadWriter payload;
+        payload.u32(ProtocolVersion);
+        return payload.data();
+    }
+
+    // Small messages go out at once rather than waiting on Nagle
+    void setNoDelay(int fd) {
+        int enabled = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+    }
+
+    int connectToWorker(const WorkerAddress& address, std::string& error) {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        int status = ::getaddrinfo(address.host.c_str(), std::to_string(address.port).c_str(), &hints, &addresses);
+        if (status != 0) {
+            error = ::gai_strerror(status);
+            return -1;
+        }
+
+        int fd = -1;
+        for (addrinfo* candidate = addresses; candidate != nullptr && fd < 0; candidate = candidate->ai_next) {
+            fd = ::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0) {
+                error = std::strerror(errno);
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ::freeaddrinfo(addresses);
+        if (fd >= 0) {
+            setNoDelay(fd);
+        }
+        return fd;
+    }
+
+    // Job paths come from the network: relative, and never above the tree
+    bool isContainedPath(const fs::path& path) {
+        if (path.empty() || path.has_root_name() || path.has_root_directory()) {
+            return false;
+        }
+        for (const auto& part : path) {
+            if (part == "..") return false;
+        }
+        return true;
+    }
+
+    // Paths under baseDirectory become relative to it, so they survive the trip between machines
+    std::string toPortable(std::string_view file, const fs::path& baseDirectory) {
+        fs::path path = fs::u8path(file);
+        if (file.empty() || !path.is_absolute()) {
+            return std::string(file);
+        }
+        fs::path relative = path.lexically_normal().lexically_relative(baseDirectory);
+        if (relative.empty() || *relative.begin() == "..") {
+            return std::string(file);
+        }
+        return relative.generic_u8string();
+    }
+
+    std::string fromPortable(std::string_view file, const fs::path& baseDirectory) {
+        fs::path path = fs::u8path(file);
+        if (file.empty() || path.is_absolute()) {
+            return std::string(file);
+        }
+        return (baseDirectory / path).lexically_normal().u8string();
+    }
+
+    // The deepest folder holding both
+    fs::path commonAncestor(const fs::path& a, const fs::path& b) {
+        fs::path common;
+        auto left = a.begin();
+        auto right = b.begin();
+        for (; left != a.end() && right != b.end() && *left == *right; ++left, ++right) {
+            common /= *left;
+        }
+        return common;
+    }
+
+    struct JobInput {
+        fs::path file;
+        std::string relativePath;   // Generic form, relative to the batch root
+        uint64_t digest = 0;
+        uint64_t size = 0;
+    };
+
+    struct Job {
+        std::string relativeApplication;
+        std::vector<JobInput> inputs;
+        double expectedMs = 0.0;
+        int owner = -1;             // Index of the worker that compiled it last time
+        int attempts = 0;
+    };
+
+    enum class JobOutcome {
+        Compiled,
+        Rejected,               // The worker answered with a failure; another worker would too
+        Lost                    // The connection broke or timed out
+    };
+
+    struct JobTraffic {
+        long long filesShipped = 0;
+        uint64_t bytesShipped = 0;
+        long long filesReused = 0;
+    };
+
+    // One job on a connected worker; result is filled unless the worker was lost
+    JobOutcome runJob(int fd, const Job& job, uint32_t flags, const fs::path& root, int timeoutSeconds,
+                      CompilationResult& result, JobTraffic& traffic) {
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(timeoutSeconds);
+
+        PayloadWriter request;
+        request.u32(flags);
+        request.text(job.relativeApplication);
+        request.u32(static_cast<uint32_t>(job.inputs.size()));
+        for (const auto& input : job.inputs) {
+            request.text(input.relativePath);
+            request.u64(input.digest);
+            request.u64(input.size);
+        }
+        if (!sendMessage(fd, MessageType::Job, request.data(), &deadline)) {
+            return JobOutcome::Lost;
+        }
+
+        MessageType type;
+        std::string payload;
+        if (!receiveMessage(fd, type, payload, &deadline)) {
+            return JobOutcome::Lost;
+        }
+        if (type == MessageType::Failure) {
+            PayloadReader failure(payload);
+            std::string_view message = failure.text();
+            result = makeFailure(job.inputs.front().file.u8string(),
+                                 "Build worker failed: " + std::string(failure.ok() ? message : "no reason given"));
+            return JobOutcome::Rejected;
+        }
+        if (type != MessageType::Need) {
+            return JobOutcome::Lost;
+        }
+
+        PayloadReader need(payload);
+        uint32_t count = need.u32();
+        std::vector<uint32_t> needed;
+        for (uint32_t i = 0; i < count && need.ok(); i++) {
+            needed.push_back(need.u32());
+        }
+        if (!need.ok() || std::any_of(needed.begin(), needed.end(), [&](uint32_t index) { return index >= job.inputs.size(); })) {
+            return JobOutcome::Lost;
+        }
+
+        for (uint32_t index : needed) {
+            MappedFile contents;
+            if (!contents.open(job.inputs[index].file)) {
+                result = makeFailure(job.inputs.front().file.u8string(), "Cannot read " + job.inputs[index].file.u8string());
+                return JobOutcome::Rejected;
+            }
+            PayloadWriter file;
+            file.u32(index);
+            file.bytes(contents.view());
+            if (!sendMessage(fd, MessageType::File, file.data(), &deadline)) {
+                return JobOutcome::Lost;
+            }
+            traffic.filesShipped++;
+            traffic.bytesShipped += contents.view().size();
+        }
+        traffic.filesReused += static_cast<long long>(job.inputs.size() - needed.size());
+
+        if (!receiveMessage(fd, type, payload, &deadline)) {
+            return JobOutcome::Lost;
+        }
+        PayloadReader reply(payload);
+        if (type == MessageType::Failure) {
+            std::string_view message = reply.text();
+            result = makeFailure(job.inputs.front().file.u8string(),
+                                 "Build worker failed: " + std::string(reply.ok() ? message : "no reason given"));
+            return JobOutcome::Rejected;
+        }
+        std::string_view encoded = reply.bytes();
+        std::string_view compiled = reply.bytes();
+        EncodedResultView view;
+        if (type != MessageType::Result || !reply.ok() || !view.attach(encoded)) {
+            return JobOutcome::Lost;
+        }
+
+        // The worker's paths are relative to its mirror of root
+        result = CompilationResult();
+        result.success = view.success();
+        result.errorCount = view.errorCount();
+        result.warningCount = view.warningCount();
+        result.compilationTimeMs = view.compilationTimeMs();
+        result.diagnostics.reserve(view.diagnosticCount());
+        std::map<std::string_view, std::string> rebased;
+        for (size_t i = 0; i < view.diagnosticCount(); i++) {
+            DiagnosticView diag = view.diagnostic(i);
+            auto found = rebased.find(diag.file);
+            if (found == rebased.end()) {
+                found = rebased.emplace(diag.file, fromPortable(diag.file, root)).first;
+            }
+            diag.file = found->second;
+            result.diagnostics.push_back(diag);
+        }
+        for (size_t i = 0; i < view.phaseCount(); i++) {
+            result.phases.push_back(view.phase(i));
+        }
+
+        // The worker names where the .pen goes; it must land inside root
+        if (!view.compiledOutput().empty() && !isContainedPath(fs::u8path(view.compiledOutput()))) {
+            result = makeFailure(job.inputs.front().file.u8string(),
+                                 "Build worker returned an output path outside the batch folder: " + std::string(view.compiledOutput()));
+            return JobOutcome::Rejected;
+        }
+        if (!view.compiledOutput().empty()) {
+            fs::path compiledPath = fs::u8path(fromPortable(view.compiledOutput(), root));
+            std::error_code ec;
+            fs::create_directories(compiledPath.parent_path(), ec);
+            if (writeFileIfChanged(compiledPath, compiled) == FileWriteOutcome::Failed) {
+                result.success = false;
+                result.errorCount++;
+                result.diagnostics.push_back({job.inputs.front().file.u8string(), 0, 0,
+                                              "Cannot write " + compiledPath.u8string(), "", DiagnosticMessage::Severity::Error});
+            } else {
+                result.compiledOutput = compiledPath.u8string();
+            }
+        }
+        return JobOutcome::Compiled;
+    }
+}
+
+BatchReport DistributedCompiler::run(const std::vector<std::string>& applicationFiles, CompileTimeHistory& history) {
+    std::signal(SIGPIPE, SIG_IGN);
+    m_stats = DistributedStats();
+
+    BatchReport report;
+    report.items.resize(applicationFiles.size());
+    report.jobs = static_cast<int>(std::max<size_t>(1, m_options.workers.size()));
+    auto batchStart = std::chrono::high_resolution_clock::now();
+
+    // Every input of the batch is named relative to the folder that holds them all
+    std::vector<Job> jobs(applicationFiles.size());
+    std::vector<bool> pending(applicationFiles.size(), false);
+    std::vector<std::vector<fs::path>> inputs(applicationFiles.size());
+    fs::path root;
+    for (size_t i = 0; i < applicationFiles.size(); i++) {
+        report.items[i].inputFile = applicationFiles[i];
+        report.items[i].worker = -1;
+        inputs[i] = discoverApplicationInputs(resolvePath(fs::u8path(applicationFiles[i])).lexically_normal());
+        if (inputs[i].empty()) {
+            report.items[i].result = makeFailure(applicationFiles[i], "Failed to open application");
+            continue;
+        }
+        pending[i] = true;
+        for (const auto& input : inputs[i]) {
+            root = root.empty() ? input.parent_path() : commonAncestor(root, input.parent_path());
+        }
+    }
+
+    // Shared dictionaries are hashed once for the batch
+    std::map<fs::path, std::pair<uint64_t, uint64_t>> digests;
+    double knownMs = 0.0;
+    int knownCount = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (!pending[i]) continue;
+        Job& job = jobs[i];
+        job.relativeApplication = inputs[i].front().lexically_relative(root).generic_u8string();
+        for (const auto& input : inputs[i]) {
+            auto found = digests.find(input);
+            if (found == digests.end()) {
+                uint64_t digest = 0;
+                std::error_code ec;
+                uint64_t size = fs::file_size(input, ec);
+                if (ec || !hashFile(input, digest)) {
+                    break;
+                }
+                found = digests.emplace(input, std::make_pair(digest, size)).first;
+            }
+            job.inputs.push_back({ input, input.lexically_relative(root).generic_u8string(), found->second.first, found->second.second });
+        }
+        if (job.inputs.size() != inputs[i].size()) {
+            report.items[i].result = makeFailure(applicationFiles[i], "Cannot read " + inputs[i][job.inputs.size()].u8string());
+            pending[i] = false;
+            continue;
+        }
+        CompileTime previous;
+        if (history.lookup(inputs[i].front().u8string(), previous)) {
+            job.expectedMs = previous.milliseconds;
+            knownMs += job.expectedMs;
+            knownCount++;
+            for (size_t w = 0; w < m_options.workers.size(); w++) {
+                if (describe(m_options.workers[w]) == previous.worker) job.owner = static_cast<int>(w);
+            }
+        } else {
+            job.expectedMs = -1.0;
+        }
+    }
+
+    // Longest first, so no worker is left with a long application at the end;
+    // applications never compiled before are taken to be average
+    double averageMs = knownCount > 0 ? knownMs / knownCount : 0.0;
+    std::vector<size_t> order;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (!pending[i]) continue;
+        if (jobs[i].expectedMs < 0.0) jobs[i].expectedMs = averageMs;
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return jobs[a].expectedMs > jobs[b].expectedMs; });
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<size_t> queue(order.begin(), order.end());
+    size_t inFlight = 0;
+    size_t liveWorkers = m_options.workers.size();
+    std::vector<bool> connected(m_options.workers.size(), false);
+
+    uint32_t flags = (m_options.checkSyntaxOnly ? JobCheckSyntaxOnly : 0) | (m_options.generateDebugInfo ? JobGenerateDebugInfo : 0);
+
+    // With the lock held: nobody is left to compile what is queued
+    auto failQueued = [&](const std::string& message) {
+        for (size_t index : queue) {
+            report.items[index].result = makeFailure(applicationFiles[index], message);
+        }
+        queue.clear();
+    };
+
+    auto workerMain = [&](size_t worker) {
+        const WorkerAddress& address = m_options.workers[worker];
+        std::string error = "no reply";
+        int fd = order.empty() ? -1 : connectToWorker(address, error);
+
+        if (fd >= 0) {
+            Clock::time_point deadline = Clock::now() + std::chrono::seconds(m_options.resultTimeoutSeconds);
+            MessageType type;
+            std::string payload;
+            uint32_t version = 0;
+            if (sendMessage(fd, MessageType::Hello, hello(), &deadline) && receiveMessage(fd, type, payload, &deadline)) {
+                PayloadReader reply(payload);
+                if (type == MessageType::Hello) {
+                    version = reply.u32();
+                    error = "protocol version " + std::to_string(version);
+                } else {
+                    std::string_view message = reply.text();
+                    error = (type == MessageType::Failure && reply.ok()) ? std::string(message) : "protocol mismatch";
+                }
+            }
+            if (version != ProtocolVersion) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (fd < 0) {
+            if (m_options.verbose && !queue.empty()) {
+                std::cerr << "Build worker " << describe(address) << " unavailable: " << error << std::endl;
+            }
+            if (--liveWorkers == 0) {
+                failQueued("No build worker reachable");
+            }
+            changed.notify_all();
+            return;
+        }
+        m_stats.workersConnected++;
+        connected[worker] = true;
+
+        while (true) {
+            changed.wait(lock, [&]() { return !queue.empty() || inFlight == 0; });
+            if (queue.empty()) {
+                break;
+            }
+
+            // The longest application that is this worker's or nobody's,
+            // else the longest one of all
+            auto next = std::find_if(queue.begin(), queue.end(), [&](size_t index) {
+                int owner = jobs[index].owner;
+                return owner < 0 || owner == static_cast<int>(worker) || !connected[owner];
+            });
+            if (next == queue.end()) {
+                next = queue.begin();
+            }
+            size_t index = *next;
+            queue.erase(next);
+            inFlight++;
+            lock.unlock();
+
+            CompilationResult result;
+            JobTraffic traffic;
+            auto itemStart = std::chrono::high_resolution_clock::now();
+            double itemStartMs = traceClockMs();
+            JobOutcome outcome = runJob(fd, jobs[index], flags, root, m_options.resultTimeoutSeconds, result, traffic);
+            double wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - itemStart).count();
+
+            lock.lock();
+            inFlight--;
+            m_stats.filesShipped += traffic.filesShipped;
+            m_stats.bytesShipped += traffic.bytesShipped;
+            m_stats.filesReused += traffic.filesReused;
+
+            if (outcome == JobOutcome::Lost) {
+                // This worker is done for; the application goes to one that is still alive
+                m_stats.workersLost++;
+                if (m_options.verbose) {
+                    std::cerr << "Build worker " << describe(address) << " lost while compiling " << applicationFiles[index] << std::endl;
+                }
+                if (++jobs[index].attempts < m_options.maxAttempts) {
+                    m_stats.retries++;
+                    queue.push_front(index);
+                } else {
+                    report.items[index].result = makeFailure(applicationFiles[index],
+                        "Build worker lost while compiling (" + std::to_string(jobs[index].attempts) + " attempts)");
+                }
+                connected[worker] = false;
+                if (--liveWorkers == 0) {
+                    failQueued("Every build worker was lost");
+                }
+                changed.notify_all();
+                lock.unlock();
+                ::close(fd);
+                return;
+            }
+
+            // The worker's clock is not ours: its phases are moved to start with the job
+            if (result.phases.empty()) {
+                result.phases.push_back({ fs::u8path(applicationFiles[index]).filename().u8string(), itemStartMs, wallTimeMs, -1 });
+            } else {
+                double shift = itemStartMs - result.phases.front().startMs;
+                for (auto& phase : result.phases) phase.startMs += shift;
+            }
+
+            BatchItemResult& item = report.items[index];
+            item.result = std::move(result);
+            item.wallTimeMs = wallTimeMs;
+            item.worker = static_cast<int>(worker);
+            if (outcome == JobOutcome::Compiled) {
+                history.record(inputs[index].front().u8string(),
+                               { item.result.compilationTimeMs > 0.0 ? item.result.compilationTimeMs : wallTimeMs, describe(address) });
+            }
+            changed.notify_all();
+        }
+
+        connected[worker] = false;
+        liveWorkers--;
+        lock.unlock();
+        ::close(fd);
+    };
+
+    if (m_options.workers.empty()) {
+        failQueued("No build workers given");
+    }
+    std::vector<std::thread> threads;
+    for (size_t worker = 0; worker < m_options.workers.size(); worker++) {
+        threads.emplace_back(workerMain, worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto batchEnd = std::chrono::high_resolution_clock::now();
+    report.totalWallTimeMs = std::chrono::duration<double, std::milli>(batchEnd - batchStart).count();
+    for (const auto& item : report.items) {
+        report.cumulativeWallTimeMs += item.wallTimeMs;
+    }
+    return report;
+}
+
+BuildWorker::~BuildWorker() {
+    stop();
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+    }
+}
+
+bool BuildWorker::listen(const WorkerAddress& address, std::string& error) {
+    std::signal(SIGPIPE, SIG_IGN);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    std::string host = address.host.empty() ? "127.0.0.1" : address.host;
+    int status = ::getaddrinfo(host.c_str(), std::to_string(address.port).c_str(), &hints, &addresses);
+    if (status != 0) {
+        error = "Cannot resolve " + host + ": " + ::gai_strerror(status);
+        return false;
+    }
+
+    int fd = -1;
+    for (addrinfo* candidate = addresses; candidate != nullptr && fd < 0; candidate = candidate->ai_next) {
+        fd = ::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+        if (fd < 0) continue;
+        int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (::bind(fd, candidate->ai_addr, candidate->ai_addrlen) != 0 || ::listen(fd, 8) != 0) {
+            error = "Cannot listen on " + host + ":" + std::to_string(address.port) + ": " + std::strerror(errno);
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(addresses);
+    if (fd < 0) {
+        return false;
+    }
+
+    sockaddr_storage bound = {};
+    socklen_t length = sizeof(bound);
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length);
+    m_port = ntohs(bound.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port
+                                                : reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+    m_listenFd = fd;
+    return true;
+}
+
+void BuildWorker::serve() {
+    // One engine for the worker's life, like a batch worker thread
+    WorkerEngine engine(m_factory);
+    while (!m_stopping) {
+        int fd = ::accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        setNoDelay(fd);
+        m_connectionFd = fd;
+        if (!m_stopping) {
+            serveConnection(fd, engine);
+        }
+        m_connectionFd = -1;
+        ::close(fd);
+    }
+}
+
+void BuildWorker::stop() {
+    m_stopping = true;
+    if (m_listenFd >= 0) {
+        ::shutdown(m_listenFd, SHUT_RDWR);
+    }
+    int connection = m_connectionFd;
+    if (connection >= 0) {
+        ::shutdown(connection, SHUT_RDWR);
+    }
+}
+
+void BuildWorker::serveConnection(int fd, WorkerEngine& engine) {
+    MessageType type;
+    std::string payload;
+    if (!receiveMessage(fd, type, payload)) {
+        return;
+    }
+    PayloadReader greeting(payload);
+    uint32_t version = greeting.u32();
+    if (type != MessageType::Hello || !greeting.ok() || version != ProtocolVersion) {
+        sendFailure(fd, "Protocol version " + std::to_string(ProtocolVersion) + " required");
+        return;
+    }
+    if (!sendMessage(fd, MessageType::Hello, hello())) {
+        return;
+    }
+
+    fs::path tree = m_directory / "tree";
+    fs::path blobs = m_directory / "blobs";
+    while (receiveMessage(fd, type, payload)) {
+        if (type != MessageType::Job) {
+            sendFailure(fd, "Expected a job");
+            return;
+        }
+
+        PayloadReader job(payload);
+        uint32_t flags = job.u32();
+        fs::path application = fs::u8path(job.text());
+        uint32_t count = job.u32();
+        std::vector<JobInput> inputs;
+        for (uint32_t i = 0; i < count && job.ok(); i++) {
+            JobInput input;
+            input.relativePath = std::string(job.text());
+            input.digest = job.u64();
+            input.size = job.u64();
+            input.file = (tree / fs::u8path(input.relativePath)).lexically_normal();
+            inputs.push_back(std::move(input));
+        }
+        bool contained = isContainedPath(application) &&
+            std::all_of(inputs.begin(), inputs.end(), [](const JobInput& input) { return isContainedPath(fs::u8path(input.relativePath)); });
+        if (!job.ok() || !contained || inputs.empty()) {
+            if (!sendFailure(fd, "Malformed job")) return;
+            continue;
+        }
+        if (m_verbose) {
+            std::cerr << "Job: " << application.generic_u8string() << std::endl;
+        }
+
+        // Inputs already in the tree, or in a blob from an earlier job, are not sent again
+        std::vector<uint32_t> needed;
+        for (uint32_t i = 0; i < inputs.size(); i++) {
+            const JobInput& input = inputs[i];
+            std::string key = input.file.u8string();
+            auto mirrored = m_mirrored.find(key);
+            if (mirrored != m_mirrored.end() && mirrored->second == input.digest) {
+                continue;
+            }
+            uint64_t digest = 0;
+            if (hashFile(input.file, digest) && digest == input.digest) {
+                m_mirrored[key] = digest;
+                continue;
+            }
+            MappedFile blob;
+            std::error_code ec;
+            fs::create_directories(input.file.parent_path(), ec);
+            if (blob.open(blobs / (hashToHex(input.digest) + ".blob")) && hash64(blob.view()) == input.digest &&
+                writeFileIfChanged(input.file, blob.view()) != FileWriteOutcome::Failed) {
+                m_mirrored[key] = input.digest;
+                continue;
+            }
+            needed.push_back(i);
+        }
+
+        PayloadWriter need;
+        need.u32(static_cast<uint32_t>(needed.size()));
+        for (uint32_t index : needed) need.u32(index);
+        if (!sendMessage(fd, MessageType::Need, need.data())) {
+            return;
+        }
+
+        std::string failure;
+        for (uint32_t index : needed) {
+            if (!receiveMessage(fd, type, payload)) {
+                return;
+            }
+            PayloadReader file(payload);
+            uint32_t received = file.u32();
+            std::string_view contents = file.bytes();
+            const JobInput& input = inputs[index];
+            if (type != MessageType::File || !file.ok() || received != index) {
+                sendFailure(fd, "Expected " + input.relativePath);
+                return;
+            }
+            if (!failure.empty()) {
+                continue;
+            }
+            if (hash64(contents) != input.digest) {
+                failure = input.relativePath + " changed while it was being sent";
+                continue;
+            }
+
+            std::error_code ec;
+            fs::create_directories(blobs, ec);
+            fs::create_directories(input.file.parent_path(), ec);
+            if (!writeFileAtomically(blobs / (hashToHex(input.digest) + ".blob"), contents) ||
+                writeFileIfChanged(input.file, contents) == FileWriteOutcome::Failed) {
+                failure = "Cannot write " + input.file.u8string();
+                continue;
+            }
+            m_mirrored[input.file.u8string()] = input.digest;
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.filesReceived++;
+            m_stats.bytesReceived += contents.size();
+        }
+        if (!failure.empty()) {
+            if (!sendFailure(fd, failure)) return;
+            continue;
+        }
+
+        // Inputs an earlier coordinator sent that this one no longer has must
+        // not reach the compile, so anything the application still finds in
+        // the tree is removed. References may lead out of the tree; what is
+        // there belongs to the host and is never touched.
+        fs::path applicationFile = (tree / application).lexically_normal();
+        std::set<fs::path> expected;
+        for (const auto& input : inputs) expected.insert(input.file);
+        for (const auto& found : discoverApplicationInputs(applicationFile)) {
+            if (expected.count(found) == 0 && isContainedPath(found.lexically_relative(tree))) {
+                std::error_code ec;
+                fs::remove(found, ec);
+                m_mirrored.erase(found.u8string());
+            }
+        }
+
+        CompilerOptions options;
+        options.inputFile = applicationFile.u8string();
+        options.checkSyntaxOnly = (flags & JobCheckSyntaxOnly) != 0;
+        options.generateDebugInfo = (flags & JobGenerateDebugInfo) != 0;
+
+        CompilationResult result;
+        ICompilerEngine* compiler = engine.get();
+        if (compiler == nullptr) {
+            result = makeFailure(options.inputFile, "Failed to initialize CSPro compiler");
+        } else {
+            try {
+                result = compiler->compile(options);
+            }
+            catch (const std::exception& ex) {
+                result = makeFailure(options.inputFile, std::string("Exception: ") + ex.what());
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.jobs++;
+        }
+
+        // Paths leave relative to the tree; the .pen travels with the result
+        std::map<std::string_view, std::string> portablePaths;
+        CompilationResult portable;
+        portable.success = result.success;
+        portable.errorCount = result.errorCount;
+        portable.warningCount = result.warningCount;
+        portable.compilationTimeMs = result.compilationTimeMs;
+        portable.phases = result.phases;
+        portable.diagnostics.reserve(result.diagnostics.size());
+        for (const auto& diag : result.diagnostics) {
+            DiagnosticView view = diag;
+            auto found = portablePaths.find(view.file);
+            if (found == portablePaths.end()) {
+                found = portablePaths.emplace(view.file, toPortable(view.file, tree)).first;
+            }
+            view.file = found->second;
+            portable.diagnostics.push_back(view);
+        }
+
+        MappedFile compiled;
+        if (!result.compiledOutput.empty()) {
+            fs::path compiledPath = resolvePath(fs::u8path(result.compiledOutput)).lexically_normal();
+            std::string relative = toPortable(compiledPath.u8string(), tree);
+            if (compiled.open(compiledPath) && !fs::u8path(relative).is_absolute()) {
+                portable.compiledOutput = relative;
+            }
+        }
+
+        PayloadWriter reply;
+        std::string encoded;
+        encodeCompilationResult(encoded, portable);
+        reply.bytes(encoded);
+        reply.bytes(portable.compiledOutput.empty() ? std::string_view() : compiled.view());
+        if (!sendMessage(fd, MessageType::Result, reply.data())) {
+            return;
+        }
+    }
+}
+
+#else
+
+BatchReport DistributedCompiler::run(const std::vector<std::string>& applicationFiles, CompileTimeHistory&) {
+    BatchReport report;
+    for (const auto& application : applicationFiles) {
+        BatchItemResult item;
+        item.inputFile = application;
+        item.result = makeFailure(application, "Distributed compilation is not supported on this platform");
+        report.items.push_back(std::move(item));
+    }
+    return report;
+}
+
+BuildWorker::~BuildWorker() {}
+
+bool BuildWorker::listen(const WorkerAddress&, std::string& error) {
+    error = "Build workers are not supported on this platform";
+    return false;
+}
+
+void BuildWorker::serve() {}
+
+void BuildWorker::stop() {
+    m_stopping = true;
+}
+
+void BuildWorker::serveConnection(int, WorkerEngine&) {}
+
+#endif
+
+} // namespace CSProCompiler
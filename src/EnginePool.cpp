@@ -0,0 +1,283 @@
+/*
+ * EnginePool.cpp - Pre-warmed, recycled compiler engines
+ */
+
+#include "../include/EnginePool.h"
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+namespace CSProCompiler {
+
+size_t currentResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<size_t>(counters.WorkingSetSize);
+    }
+    return 0;
+#else
+    // Second field: resident pages
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0;
+    size_t residentPages = 0;
+    if (!(statm >> totalPages >> residentPages)) {
+        return 0;
+    }
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return residentPages * static_cast<size_t>(pageSize > 0 ? pageSize : 4096);
+#endif
+}
+
+EnginePool::EnginePool(EngineFactory factory, EnginePoolOptions options)
+    : m_factory(std::move(factory))
+    , m_options(options)
+    , m_stopping(false)
+    , m_concurrent(false)
+    , m_warming(false)
+    , m_memoryFloor(0)
+{
+    m_options.size = std::max(m_options.size, 1);
+}
+
+EnginePool::~EnginePool() {
+    shutdown();
+}
+
+std::unique_ptr<ICompilerEngine> EnginePool::createEngine() {
+    std::unique_ptr<ICompilerEngine> engine = m_factory();
+    if (engine && !engine->initialize()) {
+        engine->shutdown();
+        engine.reset();
+    }
+    return engine;
+}
+
+bool EnginePool::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_slots.empty()) {
+        return true;
+    }
+
+    // Initialized one after another: the SDK engine's start-up is not
+    // safe to run on several threads at once. An engine that cannot
+    // compile beside another is kept on its own.
+    for (int i = 0; i < m_options.size; i++) {
+        std::unique_ptr<ICompilerEngine> engine = createEngine();
+        if (engine) {
+            if (m_slots.empty()) {
+                m_concurrent = engine->supportsConcurrentCompiles();
+                if (!m_concurrent) m_options.size = 1;
+            }
+            m_slots.push_back(std::make_unique<Slot>());
+            m_slots.back()->engine = std::move(engine);
+        }
+    }
+    if (m_slots.empty()) {
+        return false;
+    }
+
+    m_stopping = false;
+    m_stats.liveEngines = static_cast<int>(m_slots.size());
+    m_warmer = std::thread([this]() { warmReplacements(); });
+    return true;
+}
+
+void EnginePool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work.notify_all();
+    m_idle.notify_all();
+    if (m_warmer.joinable()) {
+        m_warmer.join();
+    }
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this]() { return m_stats.busyEngines == 0; });
+        slots.swap(m_slots);
+        m_retiring.clear();
+        m_stats.liveEngines = 0;
+    }
+    for (auto& slot : slots) {
+        slot->engine->shutdown();
+    }
+}
+
+CompilationResult EnginePool::compile(const CompilerOptions& options) {
+    Slot* slot = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto findIdle = [this]() -> Slot* {
+            for (auto& candidate : m_slots) {
+                if (!candidate->busy && !candidate->swapPending) return candidate.get();
+            }
+            return nullptr;
+        };
+        m_idle.wait(lock, [&]() { return m_stopping || m_slots.empty() || (!m_warming && (slot = findIdle()) != nullptr); });
+
+        if (slot == nullptr) {
+            CompilationResult result;
+            result.diagnostics.push_back({ options.inputFile, 0, 0, "Failed to initialize CSPro compiler", "",
+                                           DiagnosticMessage::Severity::Error });
+            return result;
+        }
+        slot->busy = true;
+        m_stats.busyEngines++;
+    }
+
+    CompilationResult result;
+    try {
+        result = slot->engine->compile(options);
+    }
+    catch (...) {
+        // The engine is suspect; release it and have it replaced
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot->busy = false;
+            m_stats.busyEngines--;
+            if (!slot->retiring) {
+                slot->retiring = true;
+                m_retiring.push_back(slot);
+            }
+        }
+        m_work.notify_one();
+        m_idle.notify_all();
+        throw;
+    }
+
+    size_t residentBytes = currentResidentBytes();
+    bool retire = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        slot->busy = false;
+        slot->compiles++;
+        m_stats.busyEngines--;
+        m_stats.compiles++;
+        m_stats.residentBytes = residentBytes;
+        m_stats.peakResidentBytes = std::max(m_stats.peakResidentBytes, residentBytes);
+
+        bool overCompiles = m_options.maxCompilesPerEngine > 0 && slot->compiles >= m_options.maxCompilesPerEngine;
+
+        // Past a recycle that did not bring the RSS under the ceiling, only
+        // further growth retires another engine
+        size_t memoryLimit = m_options.maxResidentBytes;
+        if (residentBytes <= m_options.maxResidentBytes) {
+            m_memoryFloor = 0;
+        } else if (m_memoryFloor > 0) {
+            memoryLimit = std::max(memoryLimit, m_memoryFloor + m_options.maxResidentBytes / 10);
+        }
+        bool overMemory = m_options.maxResidentBytes > 0 && residentBytes > memoryLimit;
+        if ((overCompiles || overMemory) && !slot->retiring) {
+            slot->retiring = true;
+            slot->retiringForMemory = overMemory && !overCompiles;
+            m_retiring.push_back(slot);
+            retire = true;
+        }
+    }
+    if (retire) {
+        m_work.notify_one();
+    }
+    m_idle.notify_all();
+    return result;
+}
+
+void EnginePool::warmReplacements() {
+    while (true) {
+        Slot* slot;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work.wait(lock, [this]() { return m_stopping || !m_retiring.empty(); });
+
+            // An engine that cannot run beside another is replaced between
+            // compiles, with new ones held back until the old one is gone
+            if (!m_concurrent) {
+                m_idle.wait(lock, [this]() { return m_stopping || m_stats.busyEngines == 0; });
+                m_warming = !m_stopping;
+            }
+            if (m_stopping) {
+                return;
+            }
+            slot = m_retiring.front();
+            m_retiring.pop_front();
+        }
+
+        // A concurrent engine keeps serving while its replacement starts
+        std::unique_ptr<ICompilerEngine> replacement = createEngine();
+
+        std::unique_ptr<ICompilerEngine> retired;
+        bool recycledForMemory = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (replacement) {
+                slot->swapPending = true;
+                m_idle.wait(lock, [&]() { return !slot->busy || m_stopping; });
+                if (slot->busy) {
+                    slot->swapPending = false;
+                    replacement->shutdown();
+                    return;
+                }
+
+                retired = std::move(slot->engine);
+                slot->engine = std::move(replacement);
+                slot->compiles = 0;
+                slot->swapPending = false;
+                m_stats.recycles++;
+                if (slot->retiringForMemory) {
+                    m_stats.recyclesForMemory++;
+                    recycledForMemory = true;
+                }
+            } else {
+                // Keep the old engine; a later compile asks again
+                m_stats.failedWarmups++;
+            }
+            slot->retiring = false;
+            slot->retiringForMemory = false;
+        }
+
+        if (retired) {
+            retired->shutdown();
+            retired.reset();
+        }
+
+        // What the old engine's memory was worth is only known once it is gone
+        size_t residentBytes = recycledForMemory ? currentResidentBytes() : 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_warming = false;
+            if (recycledForMemory) {
+                if (residentBytes > m_options.maxResidentBytes) {
+                    m_stats.ineffectiveMemoryRecycles++;
+                    m_memoryFloor = residentBytes;
+                } else {
+                    m_memoryFloor = 0;
+                }
+            }
+        }
+        m_idle.notify_all();
+    }
+}
+
+bool EnginePool::supportsConcurrentCompiles() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_concurrent && m_slots.size() > 1;
+}
+
+EnginePoolStats EnginePool::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,240 @@
+/*
+ * FileWatcher.cpp - Change notification for a set of files
+ */
+
+#include "../include/FileWatcher.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr int PollIntervalMs = 250;
+}
+
+FileWatcher::FileStamp FileWatcher::stampOf(const fs::path& path) {
+    std::error_code ec;
+    FileStamp stamp{ {}, 0, false };
+    stamp.modified = fs::last_write_time(path, ec);
+    if (!ec) {
+        stamp.size = fs::file_size(path, ec);
+        stamp.exists = !ec;
+    }
+    return stamp;
+}
+
+void FileWatcher::stampFiles() {
+    m_stamps.clear();
+    for (const auto& file : m_files) {
+        m_stamps[file] = stampOf(file);
+    }
+}
+
+std::vector<fs::path> FileWatcher::pollForChanges(int timeoutMs) {
+    std::vector<fs::path> changed;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    while (changed.empty() && !m_stopped.load()) {
+        for (auto& [path, stamp] : m_stamps) {
+            FileStamp current = stampOf(path);
+            if (current.exists != stamp.exists || current.size != stamp.size || current.modified != stamp.modified) {
+                stamp = current;
+                changed.push_back(path);
+            }
+        }
+
+        if (!changed.empty()) {
+            break;
+        }
+
+        auto sleep = std::chrono::milliseconds(PollIntervalMs);
+        if (timeoutMs >= 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                break;
+            }
+            sleep = std::min(sleep, remaining);
+        }
+        std::this_thread::sleep_for(sleep);
+    }
+
+    return changed;
+}
+
+#ifdef __linux__
+
+namespace {
+    // Writes, atomic saves (rename over the file), recreation and deletion
+    constexpr uint32_t WatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+}
+
+FileWatcher::FileWatcher()
+    : m_stopped(false)
+    , m_inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , m_polling(m_inotify < 0)
+{
+    if (pipe2(m_wakePipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        m_wakePipe[0] = m_wakePipe[1] = -1;
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (m_inotify >= 0) close(m_inotify);
+    if (m_wakePipe[0] >= 0) close(m_wakePipe[0]);
+    if (m_wakePipe[1] >= 0) close(m_wakePipe[1]);
+}
+
+bool FileWatcher::usesNotifications() const {
+    return !m_polling;
+}
+
+bool FileWatcher::watch(const std::vector<fs::path>& files) {
+    for (const auto& [descriptor, directory] : m_directories) {
+        inotify_rm_watch(m_inotify, descriptor);
+    }
+    m_directories.clear();
+    m_files.clear();
+    m_stamps.clear();
+
+    std::set<fs::path> directories;
+    for (const auto& file : files) {
+        fs::path normalized = resolvePath(file);
+        m_files.insert(normalized);
+        directories.insert(normalized.parent_path());
+    }
+
+    // A directory that cannot be watched (no inotify instance, the watch
+    // limit reached) would miss its changes, so every file is polled instead
+    m_polling = m_inotify < 0;
+    for (const auto& directory : directories) {
+        if (m_polling) break;
+        int descriptor = inotify_add_watch(m_inotify, directory.c_str(), WatchMask);
+        if (descriptor < 0) {
+            m_polling = true;
+        } else {
+            m_directories[descriptor] = directory;
+        }
+    }
+
+    if (m_polling) {
+        for (const auto& [descriptor, directory] : m_directories) {
+            inotify_rm_watch(m_inotify, descriptor);
+        }
+        m_directories.clear();
+        stampFiles();
+    }
+    return !m_files.empty();
+}
+
+std::vector<fs::path> FileWatcher::wait(int timeoutMs) {
+    if (m_polling) {
+        return pollForChanges(timeoutMs);
+    }
+
+    std::set<fs::path> changed;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    while (changed.empty() && !m_stopped.load()) {
+        int remainingMs = -1;
+        if (timeoutMs >= 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                break;
+            }
+            remainingMs = static_cast<int>(remaining.count());
+        }
+
+        pollfd descriptors[2] = { { m_inotify, POLLIN, 0 }, { m_wakePipe[0], POLLIN, 0 } };
+        int ready = poll(descriptors, m_wakePipe[0] >= 0 ? 2 : 1, remainingMs);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ready == 0) {
+            break;
+        }
+
+        if (descriptors[0].revents & POLLIN) {
+            alignas(inotify_event) char buffer[16 * 1024];
+            ssize_t length;
+            while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+                for (ssize_t offset = 0; offset < length; ) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                    // Events were dropped; assume everything changed
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        changed.insert(m_files.begin(), m_files.end());
+                        continue;
+                    }
+
+                    auto directory = m_directories.find(event->wd);
+                    if (directory == m_directories.end() || event->len == 0) {
+                        continue;
+                    }
+
+                    fs::path path = directory->second / event->name;
+                    if (m_files.count(path) > 0) {
+                        changed.insert(path);
+                    }
+                }
+            }
+        }
+    }
+
+    return std::vector<fs::path>(changed.begin(), changed.end());
+}
+
+void FileWatcher::stop() {
+    m_stopped.store(true);
+    if (m_wakePipe[1] >= 0) {
+        char byte = 0;
+        ssize_t written = write(m_wakePipe[1], &byte, 1);
+        (void)written;
+    }
+}
+
+#else
+
+FileWatcher::FileWatcher()
+    : m_stopped(false)
+{}
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::usesNotifications() const {
+    return false;
+}
+
+bool FileWatcher::watch(const std::vector<fs::path>& files) {
+    m_files.clear();
+    for (const auto& file : files) {
+        m_files.insert(resolvePath(file));
+    }
+    stampFiles();
+    return !m_files.empty();
+}
+
+std::vector<fs::path> FileWatcher::wait(int timeoutMs) {
+    return pollForChanges(timeoutMs);
+}
+
+void FileWatcher::stop() {
+    m_stopped.store(true);
+}
+
+#endif
+
+} // namespace CSProCompiler
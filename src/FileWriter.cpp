@@ -0,0 +1,155 @@
+/*
+ * FileWriter.cpp - Atomic whole-file writes, optionally on a background thread
+ */
+
+#include "../include/FileWriter.h"
+#include <atomic>
+#include <fstream>
+#include <functional>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    unsigned long processId() {
+#ifdef _WIN32
+        return static_cast<unsigned long>(_getpid());
+#else
+        return static_cast<unsigned long>(getpid());
+#endif
+    }
+
+    // Unique per process and thread, so concurrent writers of one target
+    // never share a temp file: worker processes, checkouts sharing a store
+    // and build workers all write into the same folders
+    fs::path makeTempPath(const fs::path& path) {
+        static std::atomic<unsigned> sequence{ 0 };
+        fs::path tempPath = path;
+        tempPath += ".tmp" + std::to_string(processId()) + "-" +
+                    std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000) +
+                    "-" + std::to_string(sequence.fetch_add(1));
+        return tempPath;
+    }
+
+    bool fileHasContents(const fs::path& path, std::string_view contents) {
+        std::error_code ec;
+        if (fs::file_size(path, ec) != contents.size() || ec) {
+            return false;
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::string existing(contents.size(), '\0');
+        file.read(existing.data(), static_cast<std::streamsize>(existing.size()));
+        return file.gcount() == static_cast<std::streamsize>(existing.size()) && existing == contents;
+    }
+}
+
+bool writeFileAtomically(const fs::path& path, std::string_view contents) {
+    fs::path tempPath = makeTempPath(path);
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!file) {
+            file.close();
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+FileWriteOutcome writeFileIfChanged(const fs::path& path, std::string_view contents) {
+    if (fileHasContents(path, contents)) {
+        return FileWriteOutcome::Unchanged;
+    }
+    return writeFileAtomically(path, contents) ? FileWriteOutcome::Written : FileWriteOutcome::Failed;
+}
+
+AsyncFileWriter::AsyncFileWriter()
+    : m_busy(false)
+    , m_stopping(false)
+    , m_failures(0)
+{}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void AsyncFileWriter::submit(fs::path path, std::string contents) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back({ std::move(path), std::move(contents) });
+        if (!m_thread.joinable()) {
+            m_thread = std::thread(&AsyncFileWriter::run, this);
+        }
+    }
+    m_wake.notify_one();
+}
+
+size_t AsyncFileWriter::drain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_jobs.empty() && !m_busy; });
+    size_t failures = m_failures;
+    m_failures = 0;
+    return failures;
+}
+
+void AsyncFileWriter::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+        // Pending writes are finished even when stopping
+        if (m_jobs.empty()) {
+            return;
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_busy = true;
+        lock.unlock();
+
+        bool failed = writeFileIfChanged(job.path, job.contents) == FileWriteOutcome::Failed;
+
+        lock.lock();
+        m_busy = false;
+        if (failed) {
+            m_failures++;
+        }
+        if (m_jobs.empty()) {
+            m_idle.notify_all();
+        }
+    }
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,388 @@
+/*
+ * IncrementalCompiler.cpp - Per-PROC incremental recompilation
+ */
+
+#include "../include/IncrementalCompiler.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/ContentHash.h"
+#include "../include/MappedFile.h"
+#include "../include/PhaseTiming.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    bool isLogicFile(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return ext == ".apc" || ext == ".app";
+    }
+
+    bool isIdentifierChar(char ch) {
+        return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || static_cast<unsigned char>(ch) >= 0x80;
+    }
+
+    // "PROC NAME" at the start of a line, with the name uppercased
+    bool parseProcHeader(std::string_view line, std::string& name) {
+        size_t start = 0;
+        while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) start++;
+        line.remove_prefix(start);
+
+        if (line.size() < 6 || (line[4] != ' ' && line[4] != '\t')) {
+            return false;
+        }
+        for (size_t i = 0; i < 4; i++) {
+            if (std::toupper(static_cast<unsigned char>(line[i])) != "PROC"[i]) {
+                return false;
+            }
+        }
+
+        size_t nameStart = 5;
+        while (nameStart < line.size() && (line[nameStart] == ' ' || line[nameStart] == '\t')) nameStart++;
+        size_t nameEnd = nameStart;
+        while (nameEnd < line.size() && isIdentifierChar(line[nameEnd])) nameEnd++;
+        if (nameEnd == nameStart) {
+            return false;
+        }
+
+        name.assign(line.substr(nameStart, nameEnd - nameStart));
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch) { return static_cast<char>(std::toupper(ch)); });
+        return true;
+    }
+
+    enum class CommentState { Code, Brace, Block };
+
+    bool isCommentOrQuote(char ch) {
+        return ch == '{' || ch == '/' || ch == '"' || ch == '\'';
+    }
+
+    // Carries the comment state across one line of logic, jumping between
+    // the characters that can change it
+    CommentState advanceCommentState(std::string_view line, CommentState state) {
+        size_t i = 0;
+        while (i < line.size()) {
+            if (state == CommentState::Brace) {
+                i = line.find('}', i);
+                if (i == std::string_view::npos) break;
+                state = CommentState::Code;
+                i++;
+            } else if (state == CommentState::Block) {
+                i = line.find("*/", i);
+                if (i == std::string_view::npos) break;
+                state = CommentState::Code;
+                i += 2;
+            } else {
+                while (i < line.size() && !isCommentOrQuote(line[i])) i++;
+                if (i == line.size()) break;
+
+                char ch = line[i];
+                char next = (i + 1 < line.size()) ? line[i + 1] : '\0';
+                if (ch == '{') {
+                    state = CommentState::Brace;
+                    i++;
+                } else if (ch == '/' && next == '*') {
+                    state = CommentState::Block;
+                    i += 2;
+                } else if (ch == '/' && next == '/') {
+                    break;
+                } else if (ch == '/') {
+                    i++;
+                } else {
+                    bool verbatim = (i > 0 && line[i - 1] == '@');
+                    for (i++; i < line.size() && line[i] != ch; i++) {
+                        if (line[i] == '\\' && !verbatim) i++;
+                    }
+                    i++;
+                }
+            }
+        }
+        return state;
+    }
+
+    // Unit keys tell apart PROCs that repeat a name within a file
+    std::vector<std::string> makeUnitKeys(const std::vector<LogicUnit>& units) {
+        std::vector<std::string> keys;
+        std::unordered_map<std::string, int> occurrences;
+        keys.reserve(units.size());
+        for (const auto& unit : units) {
+            std::string key = unit.file + '\n' + unit.name;
+            int occurrence = occurrences[key]++;
+            if (occurrence > 0) {
+                key += '#' + std::to_string(occurrence);
+            }
+            keys.push_back(std::move(key));
+        }
+        return keys;
+    }
+
+    void appendRebased(DiagnosticList& target, const DiagnosticList& source, int lineOffset) {
+        for (DiagnosticView diag : source) {
+            diag.line += lineOffset;
+            target.push_back(diag);
+        }
+    }
+
+    void countDiagnostics(CompilationResult& result) {
+        result.errorCount = 0;
+        result.warningCount = 0;
+        for (const auto& diag : result.diagnostics) {
+            if (diag.severity == DiagnosticMessage::Severity::Error) {
+                result.errorCount++;
+            } else if (diag.severity == DiagnosticMessage::Severity::Warning) {
+                result.warningCount++;
+            }
+        }
+        result.success = (result.errorCount == 0);
+    }
+
+    // Errors outside every unit (a failed engine start, a broken dictionary)
+    // may not recur, so nothing is remembered from a run that has them
+    bool hasErrors(const DiagnosticList& diagnostics) {
+        return std::any_of(diagnostics.begin(), diagnostics.end(),
+            [](const DiagnosticView& diag) { return diag.severity == DiagnosticMessage::Severity::Error; });
+    }
+
+    // Hands each diagnostic to the unit containing its line, with lines
+    // stored relative to the unit; diagnostics outside the units go to unattributed
+    template <typename UnitStates>
+    void partitionDiagnostics(const DiagnosticList& diagnostics, const std::vector<LogicUnit>& units,
+                              const std::vector<std::string>& keys, UnitStates& states, DiagnosticList& unattributed) {
+        std::map<std::string_view, std::vector<size_t>> unitsByFile;
+        std::map<std::string, std::string_view> filesByName;
+        for (size_t i = 0; i < units.size(); i++) {
+            unitsByFile[units[i].file].push_back(i);
+            filesByName.emplace(fs::u8path(units[i].file).filename().u8string(), units[i].file);
+        }
+
+        for (DiagnosticView diag : diagnostics) {
+            auto file = unitsByFile.find(diag.file);
+            if (file == unitsByFile.end()) {
+                // Engines may name the compilation unit rather than its full path
+                auto named = filesByName.find(fs::u8path(std::string(diag.file)).filename().u8string());
+                if (named != filesByName.end()) file = unitsByFile.find(named->second);
+            }
+
+            const LogicUnit* owner = nullptr;
+            size_t ownerIndex = 0;
+            if (file != unitsByFile.end() && diag.line > 0) {
+                for (size_t index : file->second) {
+                    if (units[index].startLine > diag.line) break;
+                    owner = &units[index];
+                    ownerIndex = index;
+                }
+            }
+
+            if (owner == nullptr) {
+                unattributed.push_back(diag);
+                continue;
+            }
+            diag.line -= owner->startLine - 1;
+            states[keys[ownerIndex]].diagnostics.push_back(diag);
+        }
+    }
+}
+
+std::vector<LogicUnit> splitLogicUnits(std::string_view text, const std::string& file) {
+    std::vector<LogicUnit> units;
+    LogicUnit current{ file, std::string(), 1, 0, 0 };
+    size_t currentOffset = 0;
+    CommentState state = CommentState::Code;
+    int lineNumber = 0;
+
+    auto closeUnit = [&](size_t endOffset) {
+        std::string_view unitText = text.substr(currentOffset, endOffset - currentOffset);
+        // Nothing before the first PROC needs no unit of its own
+        if (!current.name.empty() || unitText.find_first_not_of(" \t\r\n\xEF\xBB\xBF") != std::string_view::npos) {
+            current.lineCount = lineNumber - current.startLine + 1;
+            current.hash = hash64(unitText);
+            units.push_back(current);
+        }
+    };
+
+    size_t offset = 0;
+    while (offset < text.size()) {
+        size_t lineEnd = text.find('\n', offset);
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        std::string_view line = text.substr(offset, lineEnd - offset);
+        lineNumber++;
+
+        std::string name;
+        if (state == CommentState::Code && parseProcHeader(line, name)) {
+            lineNumber--;
+            closeUnit(offset);
+            lineNumber++;
+            current = LogicUnit{ file, std::move(name), lineNumber, 0, 0 };
+            currentOffset = offset;
+        }
+
+        state = advanceCommentState(line, state);
+        offset = lineEnd + 1;
+    }
+    closeUnit(text.size());
+
+    return units;
+}
+
+IncrementalCompiler::IncrementalCompiler(ICompilerEngine& engine)
+    : m_engine(engine)
+{}
+
+void IncrementalCompiler::invalidate(const std::string& applicationFile) {
+    m_applications.erase(resolvePath(fs::u8path(applicationFile)).u8string());
+}
+
+CompilationResult IncrementalCompiler::compile(const CompilerOptions& options) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    m_lastStats = IncrementalStats();
+
+    std::vector<fs::path> inputs = discoverApplicationInputs(resolveInputFile(options));
+    if (inputs.empty() || !m_engine.supportsUnitCompiles()) {
+        m_lastStats.fullCompile = true;
+        return m_engine.compile(options);
+    }
+
+    std::vector<PhaseSpan> phases;
+    PhaseRecorder recorder(phases);
+    PhaseScope splitPhase(recorder, "split-units");
+
+    // Everything a unit compile cannot narrow down goes into the fingerprint
+    std::string material = "checkSyntaxOnly=" + std::to_string(options.checkSyntaxOnly) +
+                           "\ngenerateDebugInfo=" + std::to_string(options.generateDebugInfo) +
+                           "\noutputDirectory=" + options.outputDirectory + "\n";
+    std::vector<LogicUnit> units;
+    MappedFile mapped;
+    for (const auto& input : inputs) {
+        std::string file = input.u8string();
+        auto overlay = options.sourceOverlays.find(file);
+
+        if (isLogicFile(input)) {
+            std::vector<LogicUnit> fileUnits;
+            if (overlay != options.sourceOverlays.end()) {
+                fileUnits = splitLogicUnits(overlay->second, file);
+            } else if (mapped.open(input)) {
+                fileUnits = splitLogicUnits(mapped.view(), file);
+            }
+            units.insert(units.end(), fileUnits.begin(), fileUnits.end());
+            material += "logic " + file + "\n";
+            continue;
+        }
+
+        uint64_t hash = 0;
+        if (overlay != options.sourceOverlays.end()) {
+            hash = hash64(overlay->second);
+        } else if (!hashFile(input, hash)) {
+            hash = 0;
+        }
+        material += file + "=" + hashToHex(hash) + "\n";
+    }
+    mapped.close();
+
+    uint64_t fingerprint = hash64(material);
+    std::vector<std::string> keys = makeUnitKeys(units);
+    splitPhase.end();
+    m_lastStats.unitCount = static_cast<int>(units.size());
+
+    // PROC GLOBAL declares what the other PROCs use, so a change there dirties them all
+    auto known = m_applications.find(resolveInputFile(options).u8string());
+    bool full = (known == m_applications.end() || known->second.fingerprint != fingerprint);
+    std::vector<LogicUnit> changedUnits;
+    std::vector<std::string> changedKeys;
+    for (size_t i = 0; i < units.size() && !full; i++) {
+        auto previous = known->second.units.find(keys[i]);
+        if (previous == known->second.units.end() || previous->second.hash != units[i].hash) {
+            if (units[i].name.empty() || units[i].name == "GLOBAL") {
+                full = true;
+            }
+            changedUnits.push_back(units[i]);
+            changedKeys.push_back(keys[i]);
+        }
+    }
+
+    if (full) {
+        CompilationResult result = compileFully(options, units, fingerprint);
+        PhaseRecorder(phases).adopt(result.phases);
+        result.phases = std::move(phases);
+        return result;
+    }
+
+    ApplicationState& application = known->second;
+    CompilationResult compiled;
+    if (!changedUnits.empty()) {
+        PhaseScope compilePhase(recorder, "compile-units");
+        compiled = m_engine.compileUnits(options, changedUnits);
+        recorder.adopt(compiled.phases);
+        if (compiled.cancelled) {
+            // The units stay as they were; the next compile retries them
+            compiled.phases = std::move(phases);
+            return compiled;
+        }
+    }
+
+    PhaseScope mergePhase(recorder, "merge-diagnostics");
+    std::unordered_map<std::string, UnitState> nextUnits;
+    nextUnits.reserve(units.size());
+    for (size_t i = 0; i < changedUnits.size(); i++) {
+        nextUnits[changedKeys[i]].hash = changedUnits[i].hash;
+    }
+    DiagnosticList unattributed;
+    partitionDiagnostics(compiled.diagnostics, changedUnits, changedKeys, nextUnits, unattributed);
+
+    CompilationResult result;
+    appendRebased(result.diagnostics, application.applicationDiagnostics, 0);
+    appendRebased(result.diagnostics, unattributed, 0);
+    for (size_t i = 0; i < units.size(); i++) {
+        auto next = nextUnits.find(keys[i]);
+        if (next == nextUnits.end()) {
+            next = nextUnits.emplace(keys[i], std::move(application.units[keys[i]])).first;
+            m_lastStats.reusedUnitCount++;
+        }
+        appendRebased(result.diagnostics, next->second.diagnostics, units[i].startLine - 1);
+    }
+    if (hasErrors(unattributed)) {
+        m_applications.erase(known);
+    } else {
+        application.units = std::move(nextUnits);
+    }
+    countDiagnostics(result);
+    result.compiledOutput = compiled.compiledOutput;
+    mergePhase.end();
+
+    m_lastStats.compiledUnitCount = static_cast<int>(changedUnits.size());
+    result.phases = std::move(phases);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    result.compilationTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    return result;
+}
+
+CompilationResult IncrementalCompiler::compileFully(const CompilerOptions& options, const std::vector<LogicUnit>& units,
+                                                    uint64_t fingerprint) {
+    CompilationResult result = m_engine.compile(options);
+    m_lastStats.fullCompile = true;
+    m_lastStats.compiledUnitCount = static_cast<int>(units.size());
+    if (result.cancelled) {
+        return result;
+    }
+
+    std::vector<std::string> keys = makeUnitKeys(units);
+    ApplicationState application;
+    application.fingerprint = fingerprint;
+    for (size_t i = 0; i < units.size(); i++) {
+        application.units[keys[i]].hash = units[i].hash;
+    }
+    partitionDiagnostics(result.diagnostics, units, keys, application.units, application.applicationDiagnostics);
+
+    if (hasErrors(application.applicationDiagnostics)) {
+        m_applications.erase(resolveInputFile(options).u8string());
+    } else {
+        m_applications[resolveInputFile(options).u8string()] = std::move(application);
+    }
+    return result;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,254 @@
+/*
+ * JsonValue.cpp - Minimal JSON document model
+ */
+
+#include "../include/JsonValue.h"
+#include <cstdlib>
+
+namespace CSProCompiler {
+
+namespace {
+    const JsonValue& nullValue() {
+        static const JsonValue value;
+        return value;
+    }
+
+    void appendUtf8(std::string& out, unsigned long codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+}
+
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : m_text(text), m_pos(0) {}
+
+    JsonValue parseDocument() {
+        JsonValue value = parseValue(0);
+        skipWhitespace();
+        if (m_pos != m_text.size()) {
+            fail("Unexpected trailing characters");
+        }
+        return value;
+    }
+
+private:
+    static constexpr int MaxDepth = 256;
+
+    std::string_view m_text;
+    size_t m_pos;
+
+    [[noreturn]] void fail(const char* message) const {
+        throw JsonParseError(message, m_pos);
+    }
+
+    void skipWhitespace() {
+        while (m_pos < m_text.size()) {
+            char ch = m_text[m_pos];
+            if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n') break;
+            m_pos++;
+        }
+    }
+
+    bool consumeLiteral(std::string_view literal) {
+        if (m_text.substr(m_pos, literal.size()) == literal) {
+            m_pos += literal.size();
+            return true;
+        }
+        return false;
+    }
+
+    JsonValue parseValue(int depth) {
+        if (depth > MaxDepth) fail("Nesting too deep");
+
+        skipWhitespace();
+        if (m_pos >= m_text.size()) fail("Unexpected end of input");
+
+        JsonValue value;
+        char ch = m_text[m_pos];
+
+        if (ch == '{') {
+            value.m_type = JsonValue::Type::Object;
+            m_pos++;
+            skipWhitespace();
+            if (m_pos < m_text.size() && m_text[m_pos] == '}') {
+                m_pos++;
+                return value;
+            }
+            while (true) {
+                skipWhitespace();
+                if (m_pos >= m_text.size() || m_text[m_pos] != '"') fail("Expected member name");
+                std::string key = parseString();
+                skipWhitespace();
+                if (m_pos >= m_text.size() || m_text[m_pos] != ':') fail("Expected ':'");
+                m_pos++;
+                value.m_members.emplace_back(std::move(key), parseValue(depth + 1));
+                skipWhitespace();
+                if (m_pos < m_text.size() && m_text[m_pos] == ',') { m_pos++; continue; }
+                if (m_pos < m_text.size() && m_text[m_pos] == '}') { m_pos++; break; }
+                fail("Expected ',' or '}'");
+            }
+        }
+        else if (ch == '[') {
+            value.m_type = JsonValue::Type::Array;
+            m_pos++;
+            skipWhitespace();
+            if (m_pos < m_text.size() && m_text[m_pos] == ']') {
+                m_pos++;
+                return value;
+            }
+            while (true) {
+                value.m_items.push_back(parseValue(depth + 1));
+                skipWhitespace();
+                if (m_pos < m_text.size() && m_text[m_pos] == ',') { m_pos++; continue; }
+                if (m_pos < m_text.size() && m_text[m_pos] == ']') { m_pos++; break; }
+                fail("Expected ',' or ']'");
+            }
+        }
+        else if (ch == '"') {
+            value.m_type = JsonValue::Type::String;
+            value.m_string = parseString();
+        }
+        else if (consumeLiteral("true")) {
+            value.m_type = JsonValue::Type::Boolean;
+            value.m_bool = true;
+        }
+        else if (consumeLiteral("false")) {
+            value.m_type = JsonValue::Type::Boolean;
+            value.m_bool = false;
+        }
+        else if (consumeLiteral("null")) {
+            value.m_type = JsonValue::Type::Null;
+        }
+        else if (ch == '-' || (ch >= '0' && ch <= '9')) {
+            value.m_type = JsonValue::Type::Number;
+            value.m_number = parseNumber();
+        }
+        else {
+            fail("Unexpected character");
+        }
+
+        return value;
+    }
+
+    double parseNumber() {
+        size_t start = m_pos;
+        if (m_text[m_pos] == '-') m_pos++;
+        while (m_pos < m_text.size()) {
+            char ch = m_text[m_pos];
+            if ((ch >= '0' && ch <= '9') || ch == '.' || ch == 'e' || ch == 'E' || ch == '+' || ch == '-') {
+                m_pos++;
+            } else {
+                break;
+            }
+        }
+        std::string number(m_text.substr(start, m_pos - start));
+        char* end = nullptr;
+        double result = std::strtod(number.c_str(), &end);
+        if (end == number.c_str() || *end != '\0') {
+            m_pos = start;
+            fail("Invalid number");
+        }
+        return result;
+    }
+
+    unsigned long parseHex4() {
+        if (m_pos + 4 > m_text.size()) fail("Truncated \\u escape");
+        unsigned long codeUnit = 0;
+        for (int i = 0; i < 4; i++) {
+            char ch = m_text[m_pos++];
+            codeUnit <<= 4;
+            if (ch >= '0' && ch <= '9') codeUnit |= static_cast<unsigned long>(ch - '0');
+            else if (ch >= 'a' && ch <= 'f') codeUnit |= static_cast<unsigned long>(ch - 'a' + 10);
+            else if (ch >= 'A' && ch <= 'F') codeUnit |= static_cast<unsigned long>(ch - 'A' + 10);
+            else fail("Invalid \\u escape");
+        }
+        return codeUnit;
+    }
+
+    std::string parseString() {
+        m_pos++; // opening quote
+        std::string result;
+
+        while (true) {
+            if (m_pos >= m_text.size()) fail("Unterminated string");
+            char ch = m_text[m_pos++];
+
+            if (ch == '"') break;
+
+            if (ch != '\\') {
+                result += ch;
+                continue;
+            }
+
+            if (m_pos >= m_text.size()) fail("Unterminated escape");
+            char escaped = m_text[m_pos++];
+            switch (escaped) {
+                case '"': result += '"'; break;
+                case '\\': result += '\\'; break;
+                case '/': result += '/'; break;
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'u': {
+                    unsigned long codePoint = parseHex4();
+                    if (codePoint >= 0xD800 && codePoint <= 0xDBFF && consumeLiteral("\\u")) {
+                        unsigned long low = parseHex4();
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                    }
+                    appendUtf8(result, codePoint);
+                    break;
+                }
+                default:
+                    fail("Invalid escape sequence");
+            }
+        }
+
+        return result;
+    }
+};
+
+JsonValue JsonValue::parse(std::string_view text) {
+    return JsonParser(text).parseDocument();
+}
+
+const JsonValue& JsonValue::operator[](std::string_view key) const {
+    for (const auto& member : m_members) {
+        if (member.first == key) return member.second;
+    }
+    return nullValue();
+}
+
+bool JsonValue::contains(std::string_view key) const {
+    for (const auto& member : m_members) {
+        if (member.first == key) return true;
+    }
+    return false;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    return index < m_items.size() ? m_items[index] : nullValue();
+}
+
+size_t JsonValue::size() const {
+    return isArray() ? m_items.size() : isObject() ? m_members.size() : 0;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,352 @@
+/*
+ * JsonWriter.cpp - Buffered JSON serializer
+ */
+
+#include "../include/JsonWriter.h"
+#include "../include/ContentHash.h"
+#include "../include/DiagnosticDelta.h"
+#include <array>
+#include <charconv>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSPRO_JSON_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace CSProCompiler {
+
+namespace {
+    // For each byte: 0 if it can be copied as is, otherwise the character
+    // following the backslash ('u' meaning a \u00XX escape)
+    constexpr std::array<char, 256> makeEscapeTable() {
+        std::array<char, 256> table{};
+        for (int ch = 0; ch < 0x20; ch++) table[ch] = 'u';
+        table['"'] = '"';
+        table['\\'] = '\\';
+        table['\b'] = 'b';
+        table['\f'] = 'f';
+        table['\n'] = 'n';
+        table['\r'] = 'r';
+        table['\t'] = 't';
+        return table;
+    }
+
+    constexpr std::array<char, 256> EscapeTable = makeEscapeTable();
+
+#ifdef CSPRO_JSON_SSE2
+    inline int countTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+#endif
+}
+
+void JsonWriter::appendEscaped(std::string& out, std::string_view text) {
+    const char* data = text.data();
+    const size_t length = text.size();
+    size_t runStart = 0;
+    size_t i = 0;
+
+#ifdef CSPRO_JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i controlLimit = _mm_set1_epi8(0x1F);
+#endif
+
+    while (i < length) {
+#ifdef CSPRO_JSON_SSE2
+        // Skip 16 bytes at a time while none of them needs escaping
+        while (i + 16 <= length) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i needsEscape = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                _mm_cmpeq_epi8(_mm_max_epu8(chunk, controlLimit), controlLimit));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(needsEscape));
+            if (mask == 0) {
+                i += 16;
+                continue;
+            }
+            i += static_cast<size_t>(countTrailingZeros(mask));
+            break;
+        }
+        if (i >= length) break;
+#endif
+
+        unsigned char ch = static_cast<unsigned char>(data[i]);
+        char escape = EscapeTable[ch];
+        if (escape == 0) {
+            i++;
+            continue;
+        }
+
+        out.append(data + runStart, i - runStart);
+        out += '\\';
+        if (escape == 'u') {
+            static const char digits[] = "0123456789abcdef";
+            out += "u00";
+            out += digits[ch >> 4];
+            out += digits[ch & 0xF];
+        } else {
+            out += escape;
+        }
+        runStart = ++i;
+    }
+
+    out.append(data + runStart, length - runStart);
+}
+
+JsonWriter::JsonWriter(std::string& buffer, bool pretty)
+    : m_buffer(buffer)
+    , m_pretty(pretty)
+    , m_afterKey(false)
+{}
+
+void JsonWriter::newline() {
+    if (m_pretty) {
+        m_buffer += '\n';
+        m_buffer.append(m_hasElements.size() * 2, ' ');
+    }
+}
+
+void JsonWriter::beforeValue() {
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (!m_hasElements.empty()) {
+        if (m_hasElements.back()) m_buffer += ',';
+        m_hasElements.back() = true;
+        newline();
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    beforeValue();
+    m_buffer += '{';
+    m_hasElements.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    bool hadElements = m_hasElements.back();
+    m_hasElements.pop_back();
+    if (hadElements) newline();
+    m_buffer += '}';
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    beforeValue();
+    m_buffer += '[';
+    m_hasElements.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    bool hadElements = m_hasElements.back();
+    m_hasElements.pop_back();
+    if (hadElements) newline();
+    m_buffer += ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    beforeValue();
+    m_buffer += '"';
+    appendEscaped(m_buffer, name);
+    m_buffer += m_pretty ? "\": " : "\":";
+    m_afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    beforeValue();
+    m_buffer += '"';
+    appendEscaped(m_buffer, text);
+    m_buffer += '"';
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(long long number) {
+    beforeValue();
+    char digits[24];
+    auto conversion = std::to_chars(digits, digits + sizeof(digits), number);
+    m_buffer.append(digits, conversion.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(unsigned long long number) {
+    beforeValue();
+    char digits[24];
+    auto conversion = std::to_chars(digits, digits + sizeof(digits), number);
+    m_buffer.append(digits, conversion.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    // JSON has no representation for NaN or infinity
+    if (!std::isfinite(number)) {
+        return valueNull();
+    }
+    beforeValue();
+    char digits[32];
+    auto conversion = std::to_chars(digits, digits + sizeof(digits), number);
+    m_buffer.append(digits, conversion.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    beforeValue();
+    m_buffer += flag ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::valueNull() {
+    beforeValue();
+    m_buffer += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::rawValue(std::string_view json) {
+    beforeValue();
+    m_buffer.append(json.data(), json.size());
+    return *this;
+}
+
+std::string jsonEscape(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    JsonWriter::appendEscaped(escaped, text);
+    return escaped;
+}
+
+namespace {
+    void writeDiagnosticMembers(JsonWriter& writer, const DiagnosticView& diag) {
+        writer.member("file", diag.file);
+        writer.member("line", diag.line);
+        writer.member("column", diag.column);
+        writer.member("message", diag.message);
+        writer.member("procName", diag.procName);
+        writer.member("severity", diag.getSeverityString());
+        writer.member("messageNumber", diag.messageNumber);
+    }
+
+    void writeIdentifiedDiagnosticJson(JsonWriter& writer, const DiagnosticView& diag, uint64_t identity) {
+        writer.beginObject();
+        writer.member("id", hashToHex(identity));
+        writeDiagnosticMembers(writer, diag);
+        writer.endObject();
+    }
+}
+
+void writeDiagnosticJson(JsonWriter& writer, const DiagnosticView& diag) {
+    writer.beginObject();
+    writeDiagnosticMembers(writer, diag);
+    writer.endObject();
+}
+
+namespace {
+    void writePhaseChildren(JsonWriter& writer, const std::vector<PhaseSpan>& phases,
+                            const std::vector<std::vector<size_t>>& children, int parent, double origin) {
+        const std::vector<size_t>& spans = children[static_cast<size_t>(parent + 1)];
+        writer.beginArray();
+        for (size_t index : spans) {
+            const PhaseSpan& span = phases[index];
+            writer.beginObject();
+            writer.member("name", span.name);
+            writer.member("startMs", span.startMs - origin);
+            writer.member("durationMs", span.durationMs);
+            if (!children[index + 1].empty()) {
+                writer.key("children");
+                writePhaseChildren(writer, phases, children, static_cast<int>(index), origin);
+            }
+            writer.endObject();
+        }
+        writer.endArray();
+    }
+}
+
+void writePhasesJson(JsonWriter& writer, const std::vector<PhaseSpan>& phases) {
+    // children[0] holds the top-level spans, children[i + 1] those under span i
+    std::vector<std::vector<size_t>> children(phases.size() + 1);
+    for (size_t i = 0; i < phases.size(); i++) {
+        children[static_cast<size_t>(phases[i].parent + 1)].push_back(i);
+    }
+    writePhaseChildren(writer, phases, children, -1, phases.empty() ? 0.0 : phases.front().startMs);
+}
+
+namespace {
+    void writeSummaryMembers(JsonWriter& writer, const CompilationResult& result) {
+        writer.member("success", result.success);
+        writer.member("errorCount", result.errorCount);
+        writer.member("warningCount", result.warningCount);
+        writer.member("compilationTime", result.compilationTimeMs / 1000.0);
+        writer.member("cached", result.fromCache);
+        if (result.cancelled) {
+            writer.member("cancelled", true);
+        }
+        writer.key("phases");
+        writePhasesJson(writer, result.phases);
+    }
+}
+
+void writeCompilationResultMembers(JsonWriter& writer, const CompilationResult& result) {
+    writeSummaryMembers(writer, result);
+    writer.key("errors").beginArray();
+    for (const auto& diag : result.diagnostics) {
+        writeDiagnosticJson(writer, diag);
+    }
+    writer.endArray();
+}
+
+void writeCompilationDeltaMembers(JsonWriter& writer, const CompilationResult& result, const DiagnosticDelta& delta) {
+    writeSummaryMembers(writer, result);
+    if (delta.full) {
+        writer.key("errors").beginArray();
+        for (size_t i = 0; i < result.diagnostics.size(); i++) {
+            writeIdentifiedDiagnosticJson(writer, result.diagnostics[i], delta.identities[i]);
+        }
+        writer.endArray();
+    }
+
+    writer.key("delta").beginObject();
+    writer.member("sequence", static_cast<unsigned long long>(delta.sequence));
+    writer.member("full", delta.full);
+    if (!delta.full) {
+        writer.key("added").beginArray();
+        for (size_t index : delta.added) {
+            writeIdentifiedDiagnosticJson(writer, result.diagnostics[index], delta.identities[index]);
+        }
+        writer.endArray();
+        writer.key("changed").beginArray();
+        for (size_t index : delta.changed) {
+            writeIdentifiedDiagnosticJson(writer, result.diagnostics[index], delta.identities[index]);
+        }
+        writer.endArray();
+        writer.key("removed").beginArray();
+        for (uint64_t identity : delta.removed) {
+            writer.value(hashToHex(identity));
+        }
+        writer.endArray();
+    }
+    writer.endObject();
+}
+
+void writeCompilationResultJson(std::string& buffer, const CompilationResult& result, bool pretty) {
+    JsonWriter writer(buffer, pretty);
+    writer.beginObject();
+    writeCompilationResultMembers(writer, result);
+    writer.endObject();
+    if (pretty) buffer += '\n';
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,747 @@
+/*
+ * LanguageServer.cpp - Language Server Protocol front end over ICompilerEngine
+ */
+
+#include "../include/LanguageServer.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/BatchCompiler.h"
+#include "../include/ContentHash.h"
+#include "../include/FileWriter.h"
+#include "../include/JsonValue.h"
+#include "../include/JsonWriter.h"
+#include "../include/SharedObjectCache.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    // JSON-RPC error codes
+    constexpr int ParseError = -32700;
+    constexpr int MethodNotFound = -32601;
+
+    constexpr std::string_view Utf8ByteOrderMark = "\xEF\xBB\xBF";
+
+    bool isApplicationFile(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return ext == ".ent" || ext == ".bch";
+    }
+
+    bool isWithin(const fs::path& path, const fs::path& directory) {
+        fs::path relative = path.lexically_relative(directory);
+        return !relative.empty() && *relative.begin() != "..";
+    }
+
+    int hexValue(char ch) {
+        if (ch >= '0' && ch <= '9') return ch - '0';
+        if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+        return -1;
+    }
+
+    fs::path uriToPath(const std::string& uri) {
+        constexpr std::string_view scheme = "file://";
+        if (uri.compare(0, scheme.size(), scheme) != 0) {
+            return fs::path();
+        }
+
+        std::string path;
+        for (size_t i = scheme.size(); i < uri.size(); i++) {
+            if (uri[i] == '%' && i + 2 < uri.size() && hexValue(uri[i + 1]) >= 0 && hexValue(uri[i + 2]) >= 0) {
+                path += static_cast<char>(hexValue(uri[i + 1]) * 16 + hexValue(uri[i + 2]));
+                i += 2;
+            } else {
+                path += uri[i];
+            }
+        }
+
+#ifdef _WIN32
+        // file:///c:/dir -> c:/dir
+        if (path.size() >= 3 && path[0] == '/' && path[2] == ':') {
+            path.erase(0, 1);
+        }
+#endif
+        return fs::u8path(path).lexically_normal();
+    }
+
+    std::string pathToUri(const fs::path& path) {
+        static const char* const hexDigits = "0123456789ABCDEF";
+        std::string generic = path.generic_u8string();
+        std::string uri = "file://";
+        if (generic.empty() || generic.front() != '/') {
+            uri += '/';
+        }
+        for (unsigned char ch : generic) {
+            if (std::isalnum(ch) || ch == '/' || ch == '-' || ch == '.' || ch == '_' || ch == '~') {
+                uri += static_cast<char>(ch);
+            } else {
+                uri += '%';
+                uri += hexDigits[ch >> 4];
+                uri += hexDigits[ch & 0xF];
+            }
+        }
+        return uri;
+    }
+
+    // Larger bodies are skipped instead of allocated
+    constexpr long long MaxMessageBytes = 1LL << 30;
+
+    enum class ReadOutcome { Message, TooLarge, EndOfInput };
+
+    // One Content-Length framed message
+    ReadOutcome readMessage(std::istream& in, std::string& body) {
+        std::string line;
+        long long length = -1;
+
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) {
+                if (length >= 0) break;
+                continue;
+            }
+
+            // strtoll saturates where atoll would overflow
+            constexpr std::string_view header = "content-length:";
+            if (line.size() > header.size() &&
+                std::equal(header.begin(), header.end(), line.begin(),
+                           [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); })) {
+                length = std::strtoll(line.c_str() + header.size(), nullptr, 10);
+            }
+        }
+
+        if (!in || length < 0) {
+            return ReadOutcome::EndOfInput;
+        }
+
+        // Skipping the body keeps the stream framed for the next message
+        if (length > MaxMessageBytes) {
+            in.ignore(static_cast<std::streamsize>(length));
+            return ReadOutcome::TooLarge;
+        }
+
+        body.resize(static_cast<size_t>(length));
+        in.read(body.data(), length);
+        return in.gcount() == length ? ReadOutcome::Message : ReadOutcome::EndOfInput;
+    }
+
+    void writeId(JsonWriter& writer, const JsonValue& id) {
+        writer.key("id");
+        if (id.isString()) {
+            writer.value(id.asString());
+        } else if (id.isNumber()) {
+            writer.value(static_cast<long long>(id.asNumber()));
+        } else {
+            writer.valueNull();
+        }
+    }
+
+    int toLspSeverity(DiagnosticMessage::Severity severity) {
+        switch (severity) {
+            case DiagnosticMessage::Severity::Error: return 1;
+            case DiagnosticMessage::Severity::Warning: return 2;
+            default: return 3;
+        }
+    }
+}
+
+// Mirrors an application's inputs into a private directory with the open
+// editor buffers written over them, for engines that only read from disk.
+// Unchanged inputs are copied once and refreshed when their timestamp moves.
+class ShadowWorkspace {
+public:
+    explicit ShadowWorkspace(const fs::path& applicationFile)
+        : m_applicationFile(applicationFile)
+    {
+        std::error_code ec;
+        uint64_t salt = std::random_device()();
+        m_shadowRoot = fs::temp_directory_path(ec) / "csprocompile-lsp" /
+                       hashToHex(hash64(applicationFile.u8string(), salt));
+    }
+
+    ~ShadowWorkspace() {
+        std::error_code ec;
+        fs::remove_all(m_shadowRoot, ec);
+    }
+
+    // Brings the mirror up to date and returns its copy of the application file
+    fs::path prepare(const std::map<std::string, std::string>& overlays) {
+        std::vector<fs::path> inputs = discoverApplicationInputs(m_applicationFile);
+        if (inputs.empty()) {
+            return m_applicationFile;
+        }
+
+        // Mirror relative to a directory containing every input, so relative references still resolve
+        m_sourceRoot = inputs.front().parent_path();
+        for (const auto& input : inputs) {
+            while (!isWithin(input, m_sourceRoot) && m_sourceRoot.has_relative_path()) {
+                m_sourceRoot = m_sourceRoot.parent_path();
+            }
+        }
+
+        std::error_code ec;
+        for (const auto& input : inputs) {
+            fs::path target = m_shadowRoot / input.lexically_relative(m_sourceRoot);
+            fs::create_directories(target.parent_path(), ec);
+
+            auto overlay = overlays.find(input.u8string());
+            if (overlay != overlays.end()) {
+                // Editors drop the byte order mark CSPro writes; keep the file's encoding signature
+                if (hasByteOrderMark(input) && overlay->second.compare(0, Utf8ByteOrderMark.size(), Utf8ByteOrderMark) != 0) {
+                    writeFileIfChanged(target, std::string(Utf8ByteOrderMark) + overlay->second);
+                } else {
+                    writeFileIfChanged(target, overlay->second);
+                }
+                m_copiedStamps.erase(input);
+                continue;
+            }
+
+            fs::file_time_type stamp = fs::last_write_time(input, ec);
+            auto copied = m_copiedStamps.find(input);
+            if (copied == m_copiedStamps.end() || copied->second != stamp || !fs::exists(target)) {
+                fs::copy_file(input, target, fs::copy_options::overwrite_existing, ec);
+                m_copiedStamps[input] = stamp;
+            }
+        }
+
+        return m_shadowRoot / m_applicationFile.lexically_relative(m_sourceRoot);
+    }
+
+    std::string toRealPath(const std::string& file) const {
+        fs::path path = fs::u8path(file).lexically_normal();
+        if (!m_sourceRoot.empty() && isWithin(path, m_shadowRoot)) {
+            return (m_sourceRoot / path.lexically_relative(m_shadowRoot)).u8string();
+        }
+        return file;
+    }
+
+private:
+    fs::path m_applicationFile;
+    fs::path m_shadowRoot;
+    fs::path m_sourceRoot;
+    std::map<fs::path, fs::file_time_type> m_copiedStamps;
+    std::map<fs::path, bool> m_byteOrderMarks;
+
+    bool hasByteOrderMark(const fs::path& path) {
+        auto known = m_byteOrderMarks.find(path);
+        if (known != m_byteOrderMarks.end()) {
+            return known->second;
+        }
+        char start[3] = {};
+        std::ifstream file(path, std::ios::binary);
+        file.read(start, sizeof(start));
+        bool marked = file.gcount() == 3 && std::string_view(start, 3) == Utf8ByteOrderMark;
+        m_byteOrderMarks[path] = marked;
+        return marked;
+    }
+};
+
+LanguageServer::LanguageServer(ICompilerEngine& engine)
+    : m_engine(engine)
+    , m_verbose(false)
+    , m_debounceMs(150)
+    , m_out(nullptr)
+    , m_stopping(false)
+    , m_shutdownRequested(false)
+    , m_engineReady(false)
+    , m_incremental(engine)
+    , m_scheduler([this](const CompilerOptions& options) { return m_incremental.compile(options); })
+{}
+
+LanguageServer::~LanguageServer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    if (m_compileThread.joinable()) {
+        m_compileThread.join();
+    }
+}
+
+int LanguageServer::serve(std::istream& in, std::ostream& out) {
+    m_out = &out;
+    m_compileThread = std::thread(&LanguageServer::compileLoop, this);
+
+    std::string body;
+    ReadOutcome outcome;
+    while ((outcome = readMessage(in, body)) != ReadOutcome::EndOfInput) {
+        if (outcome == ReadOutcome::TooLarge) {
+            sendError(JsonValue(), ParseError, "Invalid message: Content-Length exceeds " +
+                      std::to_string(MaxMessageBytes) + " bytes");
+            continue;
+        }
+
+        JsonValue message;
+        try {
+            message = JsonValue::parse(body);
+        }
+        catch (const JsonParseError& ex) {
+            sendError(JsonValue(), ParseError, std::string("Invalid message: ") + ex.what());
+            continue;
+        }
+
+        handleMessage(message);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_compileThread.join();
+    m_shadows.clear();
+
+    return m_shutdownRequested ? 0 : 1;
+}
+
+void LanguageServer::handleMessage(const JsonValue& message) {
+    std::string method = message["method"].asString();
+    const JsonValue& id = message["id"];
+    const JsonValue& params = message["params"];
+    bool isRequest = message.contains("id");
+
+    // Responses to server-initiated requests; this server sends none
+    if (method.empty()) {
+        return;
+    }
+
+    if (method == "initialize") {
+        handleInitialize(id, params);
+    }
+    else if (method == "shutdown") {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shutdownRequested = true;
+        }
+        sendResult(id, [](JsonWriter& writer) { writer.valueNull(); });
+    }
+    else if (method == "exit") {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    else if (method == "textDocument/didOpen" || method == "textDocument/didChange" ||
+             method == "textDocument/didSave" || method == "textDocument/didClose") {
+        handleDocumentChange(method, params);
+    }
+    else if (method == "csprocompile/stats") {
+        LanguageServerStats stats;
+        size_t documentCount;
+        bool engineReady;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            stats = m_stats;
+            documentCount = m_documents.size();
+            engineReady = m_engineReady;
+        }
+        sendResult(id, [&](JsonWriter& writer) {
+            writer.beginObject();
+            writer.member("changes", stats.changeCount);
+            writer.member("compiles", stats.compileCount);
+            writer.member("cancelled", stats.cancelledCount);
+            writer.member("published", stats.publishCount);
+            writer.member("compiledUnits", stats.compiledUnitCount);
+            writer.member("reusedUnits", stats.reusedUnitCount);
+            writer.member("openDocuments", static_cast<long long>(documentCount));
+            writer.member("engineReady", engineReady);
+            writer.endObject();
+        });
+    }
+    else if (isRequest) {
+        sendError(id, MethodNotFound, "Unhandled method: " + method);
+    }
+    // Other notifications ($/cancelRequest, $/setTrace, ...) need no action
+}
+
+void LanguageServer::handleInitialize(const JsonValue& id, const JsonValue& params) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_workspaceRoots.clear();
+        for (const auto& folder : params["workspaceFolders"].items()) {
+            fs::path root = uriToPath(folder["uri"].asString());
+            if (!root.empty()) m_workspaceRoots.push_back(root);
+        }
+        if (m_workspaceRoots.empty() && params["rootUri"].isString()) {
+            fs::path root = uriToPath(params["rootUri"].asString());
+            if (!root.empty()) m_workspaceRoots.push_back(root);
+        }
+    }
+
+    sendResult(id, [](JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("capabilities").beginObject();
+        writer.key("textDocumentSync").beginObject();
+        writer.member("openClose", true);
+        writer.member("change", 1);    // Full document text on every change
+        writer.key("save").beginObject().member("includeText", false).endObject();
+        writer.endObject();
+        writer.endObject();
+        writer.key("serverInfo").beginObject();
+        writer.member("name", "CSProCompile");
+        writer.member("version", toolVersion());
+        writer.endObject();
+        writer.endObject();
+    });
+}
+
+void LanguageServer::handleDocumentChange(const std::string& method, const JsonValue& params) {
+    const JsonValue& textDocument = params["textDocument"];
+    std::string uri = textDocument["uri"].asString();
+    fs::path path = uriToPath(uri);
+    if (path.empty()) {
+        log("Ignoring non-file document: " + uri);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.changeCount++;
+
+        if (method == "textDocument/didOpen") {
+            m_documents[path] = { uri, textDocument["text"].asString(), textDocument["version"].asInt() };
+        }
+        else if (method == "textDocument/didChange") {
+            Document& document = m_documents[path];
+            document.uri = uri;
+            document.version = textDocument["version"].asInt();
+            for (const auto& change : params["contentChanges"].items()) {
+                if (change.contains("range")) {
+                    log("Ignoring incremental change; full-text sync was negotiated");
+                    continue;
+                }
+                document.text = change["text"].asString();
+            }
+        }
+        else if (method == "textDocument/didSave") {
+            if (params["text"].isString()) {
+                m_documents[path].text = params["text"].asString();
+            }
+            // A saved application file may reference different inputs now
+            if (isApplicationFile(path)) {
+                indexApplication(path);
+            }
+        }
+        else {
+            m_documents.erase(path);
+        }
+
+        markDirty(path);
+    }
+    m_wake.notify_all();
+}
+
+std::set<fs::path> LanguageServer::findApplications(const fs::path& document) {
+    if (isApplicationFile(document)) {
+        if (m_applications.find(document) == m_applications.end()) {
+            indexApplication(document);
+        }
+        return { document };
+    }
+
+    auto known = m_applicationsByInput.find(document);
+    if (known != m_applicationsByInput.end()) {
+        return known->second;
+    }
+
+    // First sight of this file: index every application that could use it
+    std::vector<std::string> searchPaths;
+    for (const auto& root : m_workspaceRoots) {
+        searchPaths.push_back(root.u8string());
+    }
+    if (searchPaths.empty()) {
+        searchPaths.push_back(document.parent_path().u8string());
+        searchPaths.push_back(document.parent_path().parent_path().u8string());
+    }
+
+    for (const auto& application : expandInputPatterns(searchPaths)) {
+        fs::path applicationPath = resolvePath(fs::u8path(application));
+        if (m_applications.find(applicationPath) == m_applications.end()) {
+            indexApplication(applicationPath);
+        }
+    }
+
+    // Remember files no application uses, so they are not searched for again
+    return m_applicationsByInput[document];
+}
+
+void LanguageServer::indexApplication(const fs::path& application) {
+    m_applications[application];
+    for (const auto& input : discoverApplicationInputs(application)) {
+        m_applicationsByInput[input].insert(application);
+    }
+}
+
+void LanguageServer::markDirty(const fs::path& document) {
+    // The stale parse would never be asked for again; free it now
+    if (document.extension() == ".dcf") {
+        sharedDictionaryCache().invalidate(document);
+    }
+
+    Clock::time_point now = Clock::now();
+    for (const auto& application : findApplications(document)) {
+        Application& state = m_applications[application];
+        state.generation++;
+        state.changedAt = now;
+        if (application == m_compiling) {
+            m_scheduler.cancel(m_compilingInput);
+        }
+    }
+}
+
+void LanguageServer::compileLoop() {
+    // Warm the engine before the first edit needs it
+    bool ready = m_engine.initialize();
+    if (!ready) {
+        log("Compiler engine failed to initialize; compiles will report the failure");
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_engineReady = ready;
+
+    while (!m_stopping) {
+        // The dirty application whose edits have been quiet the longest
+        const fs::path* next = nullptr;
+        Clock::time_point due = Clock::time_point::max();
+        for (const auto& [path, state] : m_applications) {
+            if (state.generation != state.compiledGeneration) {
+                Clock::time_point ready = state.changedAt + std::chrono::milliseconds(m_debounceMs);
+                if (ready < due) {
+                    due = ready;
+                    next = &path;
+                }
+            }
+        }
+
+        if (next == nullptr) {
+            m_wake.wait(lock);
+            continue;
+        }
+        if (due > Clock::now()) {
+            m_wake.wait_until(lock, due);
+            continue;
+        }
+
+        fs::path application = *next;
+        uint64_t generation = m_applications[application].generation;
+        std::map<std::string, std::string> overlays;
+        for (const auto& [path, document] : m_documents) {
+            overlays[path.u8string()] = document.text;
+        }
+
+        m_compiling = application;
+
+        lock.unlock();
+        compileApplication(application, generation, std::move(overlays));
+        lock.lock();
+        m_compiling.clear();
+        m_compilingInput.clear();
+    }
+}
+
+void LanguageServer::compileApplication(const fs::path& application, uint64_t generation,
+                                        std::map<std::string, std::string> overlays) {
+    CompilerOptions options;
+    options.checkSyntaxOnly = true;
+    std::function<std::string(const std::string&)> toRealPath = [](const std::string& file) { return file; };
+
+    if (m_engine.supportsSourceOverlays()) {
+        options.inputFile = application.u8string();
+        options.sourceOverlays = std::move(overlays);
+    } else {
+        std::unique_ptr<ShadowWorkspace>& shadow = m_shadows[application];
+        if (!shadow) {
+            shadow = std::make_unique<ShadowWorkspace>(application);
+        }
+        options.inputFile = shadow->prepare(overlays).u8string();
+        toRealPath = [&shadow](const std::string& file) { return shadow->toRealPath(file); };
+    }
+
+    // From here on a change supersedes the compile through the scheduler;
+    // one that came in while the shadow was prepared leaves it unstarted
+    std::future<CompilationResult> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_applications[application].generation != generation) {
+            return;
+        }
+        m_compilingInput = options.inputFile;
+        pending = m_scheduler.submit(options);
+    }
+
+    auto startTime = Clock::now();
+    CompilationResult result = pending.get();
+    double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+
+    // The scheduler has finished with m_incremental once the result is in
+    const IncrementalStats& units = m_incremental.getLastStats();
+
+    if (result.cancelled) {
+        // The generation stays behind, so the newer edits get compiled
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.cancelledCount++;
+        }
+        log("Cancelled compile of " + application.u8string() + " after " + std::to_string(elapsedMs) + " ms");
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.compileCount++;
+        m_stats.compiledUnitCount += units.compiledUnitCount;
+        m_stats.reusedUnitCount += units.reusedUnitCount;
+        m_applications[application].compiledGeneration = generation;
+    }
+
+    log("Compiled " + application.u8string() + " in " + std::to_string(elapsedMs) + " ms (" +
+        (units.fullCompile ? std::string("full") : std::to_string(units.compiledUnitCount) + " of " +
+         std::to_string(units.unitCount) + " PROCs") + "): " +
+        std::to_string(result.errorCount) + " error(s), " + std::to_string(result.warningCount) + " warning(s)");
+
+    publish(application, result, toRealPath);
+}
+
+void LanguageServer::publish(const fs::path& application, const CompilationResult& result,
+                             const std::function<std::string(const std::string&)>& toRealPath) {
+    // Diagnostics without a usable file land on the application file
+    std::map<fs::path, std::vector<size_t>> byFile;
+    for (size_t i = 0; i < result.diagnostics.size(); i++) {
+        std::string file = toRealPath(std::string(result.diagnostics[i].file));
+        fs::path path = file.empty() ? application : fs::u8path(file);
+        if (path.is_relative()) {
+            path = application.parent_path() / path;
+        }
+        std::error_code ec;
+        path = fs::exists(path, ec) ? path.lexically_normal() : application;
+        byFile[path].push_back(i);
+    }
+
+    // The reader thread adds applications meanwhile, so the map is only
+    // touched under the lock; the entry exists from before the first compile
+    std::map<fs::path, std::string> uris;
+    std::set<std::string> published;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : byFile) {
+            auto document = m_documents.find(entry.first);
+            uris[entry.first] = document != m_documents.end() ? document->second.uri : pathToUri(entry.first);
+        }
+        auto state = m_applications.find(application);
+        if (state != m_applications.end()) {
+            published = state->second.publishedUris;
+        }
+    }
+
+    auto sendDiagnostics = [this](const std::string& uri, const CompilationResult& result, const std::vector<size_t>& indexes) {
+        std::string body;
+        JsonWriter writer(body);
+        writer.beginObject();
+        writer.member("jsonrpc", "2.0");
+        writer.member("method", "textDocument/publishDiagnostics");
+        writer.key("params").beginObject();
+        writer.member("uri", uri);
+        writer.key("diagnostics").beginArray();
+        for (size_t index : indexes) {
+            DiagnosticView diag = result.diagnostics[index];
+            int line = std::max(diag.line, 1) - 1;
+            int character = std::max(diag.column, 1) - 1;
+
+            // A zero-width range; editors widen it to the word at that position
+            writer.beginObject();
+            writer.key("range").beginObject();
+            writer.key("start").beginObject().member("line", line).member("character", character).endObject();
+            writer.key("end").beginObject().member("line", line).member("character", character).endObject();
+            writer.endObject();
+            writer.member("severity", toLspSeverity(diag.severity));
+            if (diag.messageNumber != 0) {
+                writer.member("code", diag.messageNumber);
+            }
+            writer.member("source", "CSPro");
+            writer.member("message", diag.message);
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.endObject();
+        writer.endObject();
+        send(body);
+    };
+
+    std::set<std::string> current;
+    for (const auto& [path, indexes] : byFile) {
+        const std::string& uri = uris[path];
+        sendDiagnostics(uri, result, indexes);
+        current.insert(uri);
+    }
+
+    // Clear documents whose diagnostics have all gone away
+    for (const auto& uri : published) {
+        if (current.count(uri) == 0) {
+            sendDiagnostics(uri, result, {});
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.publishCount += static_cast<long long>(current.size());
+    for (const auto& uri : published) {
+        if (current.count(uri) == 0) m_stats.publishCount++;
+    }
+    auto state = m_applications.find(application);
+    if (state != m_applications.end()) {
+        state->second.publishedUris = std::move(current);
+    }
+}
+
+void LanguageServer::send(const std::string& body) {
+    std::string message = "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    message += body;
+
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    m_out->write(message.data(), static_cast<std::streamsize>(message.size()));
+    m_out->flush();
+}
+
+void LanguageServer::sendResult(const JsonValue& id, const std::function<void(JsonWriter&)>& writeResult) {
+    std::string body;
+    JsonWriter writer(body);
+    writer.beginObject();
+    writer.member("jsonrpc", "2.0");
+    writeId(writer, id);
+    writer.key("result");
+    writeResult(writer);
+    writer.endObject();
+    send(body);
+}
+
+void LanguageServer::sendError(const JsonValue& id, int code, const std::string& message) {
+    std::string body;
+    JsonWriter writer(body);
+    writer.beginObject();
+    writer.member("jsonrpc", "2.0");
+    writeId(writer, id);
+    writer.key("error").beginObject();
+    writer.member("code", code);
+    writer.member("message", message);
+    writer.endObject();
+    writer.endObject();
+    send(body);
+}
+
+void LanguageServer::log(const std::string& message) {
+    if (m_verbose) {
+        std::cerr << "[csprocompile-lsp] " << message << std::endl;
+    }
+}
+
+} // namespace CSProCompiler
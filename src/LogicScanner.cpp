@@ -0,0 +1,591 @@
+/*
+ * LogicScanner.cpp - Native structural pre-scan of CSPro logic
+ */
+
+#include "../include/LogicScanner.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/MappedFile.h"
+#include "../include/MessageCatalog.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    // Message numbers from CSProDesigner.mgf; the texts are used when the
+    // system message catalog has not been loaded
+    enum MessageNumber : int {
+        InvalidStatement = 1,
+        ExpectingThen = 6,
+        ExpectingEndif = 8,
+        ExpectingDo = 9,
+        ExpectingEnddo = 10,
+        ExpectingRightParenthesis = 19,
+        ExpectingEndwhen = 56,
+        ExpectingEndrecode = 57,
+        UnmatchedRightParenthesis = 59,
+        ExpectingWhileOrUntil = 8002,
+        FunctionWithoutEnd = 50005,
+        UnmatchedMultilineComment = 92180,
+        MissingEndQuote = 92181,
+    };
+
+    struct MessageText {
+        int number;
+        std::string_view text;
+    };
+
+    constexpr MessageText MessageTexts[] = {
+        { InvalidStatement, "Invalid statement" },
+        { ExpectingThen, "Expecting 'then'" },
+        { ExpectingEndif, "Expecting 'endif'" },
+        { ExpectingDo, "Expecting 'do'" },
+        { ExpectingEnddo, "Expecting 'enddo'" },
+        { ExpectingRightParenthesis, "Expecting right parenthesis ')'" },
+        { ExpectingEndwhen, "Expecting \"->\", \"::\", or ENDWHEN" },
+        { ExpectingEndrecode, "Expecting \"->\", \"::\", or ENDRECODE" },
+        { UnmatchedRightParenthesis, "Invalid right parenthesis ')' with no matching left parenthesis '('" },
+        { ExpectingWhileOrUntil, "Expecting 'while' or 'until'" },
+        { FunctionWithoutEnd, "User-defined functions must terminate with 'end'" },
+        { UnmatchedMultilineComment, "The %s of a multiline comment, %s, has no matching pair" },
+        { MissingEndQuote, "Missing end quote (%c) in the string literal" },
+    };
+
+    // Fills %s and %c placeholders in order
+    std::string formatMessage(int number, std::string_view first, std::string_view second) {
+        std::string_view format = systemMessages().lookup(number);
+        for (size_t i = 0; format.empty() && i < std::size(MessageTexts); i++) {
+            if (MessageTexts[i].number == number) format = MessageTexts[i].text;
+        }
+
+        std::string message;
+        std::string_view arguments[] = { first, second };
+        size_t nextArgument = 0;
+        for (size_t i = 0; i < format.size(); i++) {
+            if (format[i] == '%' && i + 1 < format.size() && (format[i + 1] == 's' || format[i + 1] == 'c')) {
+                if (nextArgument < 2) message += arguments[nextArgument++];
+                i++;
+            } else {
+                message += format[i];
+            }
+        }
+        return message;
+    }
+
+    enum CharClass : uint8_t {
+        Other,
+        Space,
+        Newline,
+        Letter,
+        Digit,
+        Quote,
+        At,
+        OpenBrace,
+        CloseBrace,
+        Slash,
+        Star,
+        OpenParen,
+        CloseParen,
+        Semicolon,
+        Dot,
+        Hash,
+    };
+
+    constexpr std::array<uint8_t, 256> buildCharClasses() {
+        std::array<uint8_t, 256> classes{};
+        for (int ch = 0; ch < 256; ch++) {
+            uint8_t charClass = Other;
+            if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v') charClass = Space;
+            else if (ch == '\n') charClass = Newline;
+            else if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch >= 0x80) charClass = Letter;
+            else if (ch >= '0' && ch <= '9') charClass = Digit;
+            else if (ch == '"' || ch == '\'') charClass = Quote;
+            else if (ch == '@') charClass = At;
+            else if (ch == '{') charClass = OpenBrace;
+            else if (ch == '}') charClass = CloseBrace;
+            else if (ch == '/') charClass = Slash;
+            else if (ch == '*') charClass = Star;
+            else if (ch == '(') charClass = OpenParen;
+            else if (ch == ')') charClass = CloseParen;
+            else if (ch == ';') charClass = Semicolon;
+            else if (ch == '.') charClass = Dot;
+            else if (ch == '#') charClass = Hash;
+            classes[static_cast<size_t>(ch)] = charClass;
+        }
+        return classes;
+    }
+
+    constexpr std::array<uint8_t, 256> CharClasses = buildCharClasses();
+
+    enum class Keyword {
+        None,
+        If, Then, Elseif, Else, Endif,
+        Do, While, Until, For, Enddo,
+        Function, End,
+        When, Endwhen,
+        Recode, Endrecode,
+        Proc,
+        Section,        // preproc, postproc, onfocus, killfocus, onoccchange
+    };
+
+    struct KeywordEntry {
+        std::string_view name;
+        Keyword keyword;
+    };
+
+    constexpr KeywordEntry Keywords[] = {
+        { "if", Keyword::If }, { "then", Keyword::Then }, { "elseif", Keyword::Elseif },
+        { "else", Keyword::Else }, { "endif", Keyword::Endif },
+        { "do", Keyword::Do }, { "while", Keyword::While }, { "until", Keyword::Until },
+        { "for", Keyword::For }, { "enddo", Keyword::Enddo },
+        { "function", Keyword::Function }, { "end", Keyword::End },
+        { "when", Keyword::When }, { "endwhen", Keyword::Endwhen },
+        { "recode", Keyword::Recode }, { "endrecode", Keyword::Endrecode },
+        { "proc", Keyword::Proc },
+        { "preproc", Keyword::Section }, { "postproc", Keyword::Section }, { "onfocus", Keyword::Section },
+        { "killfocus", Keyword::Section }, { "onoccchange", Keyword::Section },
+    };
+
+    constexpr size_t MaxKeywordLength = 11;
+
+    Keyword lookupKeyword(std::string_view word) {
+        if (word.size() < 2 || word.size() > MaxKeywordLength) {
+            return Keyword::None;
+        }
+
+        // Keywords are ASCII, so setting bit 0x20 lowercases the letters that could match
+        for (const auto& entry : Keywords) {
+            if (entry.name.size() != word.size() || entry.name[0] != (word[0] | 0x20)) continue;
+            size_t i = 1;
+            while (i < word.size() && entry.name[i] == (word[i] | 0x20)) i++;
+            if (i == word.size()) return entry.keyword;
+        }
+        return Keyword::None;
+    }
+
+    class StructureScanner {
+    public:
+        StructureScanner(std::string_view text, std::string_view file, CompilationResult& result)
+            : m_text(text)
+            , m_file(file)
+            , m_result(result)
+            , m_pos(0)
+            , m_line(1)
+            , m_lineStart(0)
+            , m_expect(Expect::None)
+            , m_parenDepth(0)
+            , m_afterDot(false)
+            , m_expectProcName(false)
+            , m_truncated(false)
+            , m_errorCount(0)
+        {}
+
+        int run() {
+            // Skip a UTF-8 byte order mark
+            if (m_text.substr(0, 3) == "\xEF\xBB\xBF") {
+                m_pos = m_lineStart = 3;
+            }
+
+            while (m_pos < m_text.size()) {
+                uint8_t charClass = CharClasses[static_cast<unsigned char>(m_text[m_pos])];
+                bool afterDot = false;
+
+                switch (charClass) {
+                    case Space:
+                        m_pos++;
+                        continue;
+                    case Newline:
+                        newLine();
+                        continue;
+                    case Letter:
+                        scanWord();
+                        break;
+                    case Digit:
+                        while (m_pos < m_text.size() && isWordOrNumber(m_text[m_pos])) m_pos++;
+                        break;
+                    case Quote:
+                        scanString(false);
+                        break;
+                    case At:
+                        if (m_pos + 1 < m_text.size() && CharClasses[static_cast<unsigned char>(m_text[m_pos + 1])] == Quote) {
+                            m_pos++;
+                            scanString(true);
+                        } else {
+                            m_pos++;
+                        }
+                        break;
+                    case OpenBrace:
+                        scanComment(1, "}", "{");
+                        break;
+                    case CloseBrace:
+                        report(UnmatchedMultilineComment, position(), "end", "}");
+                        m_pos++;
+                        break;
+                    case Slash:
+                        if (peek(1) == '/') {
+                            skipToLineEnd();
+                        } else if (peek(1) == '*') {
+                            scanComment(2, "*/", "/*");
+                        } else {
+                            m_pos++;
+                        }
+                        break;
+                    case Star:
+                        if (peek(1) == '/') {
+                            report(UnmatchedMultilineComment, position(), "end", "*/");
+                            m_pos += 2;
+                        } else {
+                            m_pos++;
+                        }
+                        break;
+                    case OpenParen:
+                        m_parenDepth++;
+                        m_pos++;
+                        break;
+                    case CloseParen:
+                        if (m_parenDepth == 0) {
+                            report(UnmatchedRightParenthesis, position());
+                        } else {
+                            m_parenDepth--;
+                        }
+                        m_pos++;
+                        break;
+                    case Semicolon:
+                        endStatement(position());
+                        m_pos++;
+                        break;
+                    case Dot:
+                        afterDot = true;
+                        m_pos++;
+                        break;
+                    case Hash:
+                        // Preprocessor directives occupy a whole line
+                        if (isLineBlankBefore(m_pos)) {
+                            skipToLineEnd();
+                        } else {
+                            m_pos++;
+                        }
+                        break;
+                    default:
+                        m_pos++;
+                        break;
+                }
+
+                m_afterDot = afterDot;
+            }
+
+            // After an unterminated comment the rest of the file was never seen
+            if (!m_truncated) {
+                closeAll(position());
+            }
+            return m_errorCount;
+        }
+
+    private:
+        enum class Block { If, Loop, Function, When, Recode };
+        enum class Expect { None, Then, Do, WhileOrUntil };
+
+        struct Position {
+            int line;
+            int column;
+        };
+
+        std::string_view m_text;
+        std::string_view m_file;
+        CompilationResult& m_result;
+        size_t m_pos;
+        int m_line;
+        size_t m_lineStart;
+
+        std::vector<Block> m_blocks;
+        Expect m_expect;
+        int m_parenDepth;
+        bool m_afterDot;            // Previous token was '.', so a word is a member name
+        bool m_expectProcName;
+        bool m_truncated;
+        std::string m_procName;
+        int m_errorCount;
+
+        char peek(size_t offset) const {
+            return m_pos + offset < m_text.size() ? m_text[m_pos + offset] : '\0';
+        }
+
+        static bool isWordOrNumber(char ch) {
+            uint8_t charClass = CharClasses[static_cast<unsigned char>(ch)];
+            return charClass == Letter || charClass == Digit || charClass == Dot;
+        }
+
+        Position position() const {
+            return { m_line, static_cast<int>(m_pos - m_lineStart) + 1 };
+        }
+
+        void newLine() {
+            m_pos++;
+            m_line++;
+            m_lineStart = m_pos;
+        }
+
+        void skipToLineEnd() {
+            size_t end = m_text.find('\n', m_pos);
+            m_pos = (end == std::string_view::npos) ? m_text.size() : end;
+        }
+
+        bool isLineBlankBefore(size_t pos) const {
+            for (size_t i = m_lineStart; i < pos; i++) {
+                if (CharClasses[static_cast<unsigned char>(m_text[i])] != Space) return false;
+            }
+            return true;
+        }
+
+        void report(int number, Position where, std::string_view first = {}, std::string_view second = {}) {
+            m_result.diagnostics.push_back({ m_file, where.line, where.column, formatMessage(number, first, second),
+                                             m_procName, DiagnosticMessage::Severity::Error, number });
+            m_result.errorCount++;
+            m_errorCount++;
+        }
+
+        void scanWord() {
+            size_t start = m_pos;
+            Position where = position();
+            while (m_pos < m_text.size()) {
+                uint8_t charClass = CharClasses[static_cast<unsigned char>(m_text[m_pos])];
+                if (charClass != Letter && charClass != Digit) break;
+                m_pos++;
+            }
+            std::string_view word = m_text.substr(start, m_pos - start);
+
+            if (m_expectProcName) {
+                m_procName.assign(word);
+                m_expectProcName = false;
+                return;
+            }
+
+            Keyword keyword = m_afterDot ? Keyword::None : lookupKeyword(word);
+            if (keyword != Keyword::None) {
+                onKeyword(keyword, where);
+            }
+        }
+
+        // Strings end on the same line; logic 8.0 escapes apply outside verbatim strings
+        void scanString(bool verbatim) {
+            Position where = position();
+            char quote = m_text[m_pos++];
+            while (m_pos < m_text.size()) {
+                char ch = m_text[m_pos];
+                if (ch == '\n' || ch == '\r') {
+                    break;
+                }
+                if (ch == quote) {
+                    m_pos++;
+                    return;
+                }
+                m_pos += (ch == '\\' && !verbatim && peek(1) != '\n') ? 2 : 1;
+            }
+            report(MissingEndQuote, where, std::string_view(&quote, 1));
+        }
+
+        void scanComment(size_t openLength, std::string_view close, std::string_view open) {
+            Position where = position();
+            m_pos += openLength;
+            while (m_pos < m_text.size()) {
+                if (m_text[m_pos] == '\n') {
+                    newLine();
+                } else if (m_text.compare(m_pos, close.size(), close) == 0) {
+                    m_pos += close.size();
+                    return;
+                } else {
+                    m_pos++;
+                }
+            }
+            report(UnmatchedMultilineComment, where, "start", open);
+            m_truncated = true;
+        }
+
+        static int closerMessage(Block block) {
+            switch (block) {
+                case Block::If: return ExpectingEndif;
+                case Block::Loop: return ExpectingEnddo;
+                case Block::Function: return FunctionWithoutEnd;
+                case Block::When: return ExpectingEndwhen;
+                default: return ExpectingEndrecode;
+            }
+        }
+
+        void reportExpectation(Position where) {
+            switch (m_expect) {
+                case Expect::Then: report(ExpectingThen, where); break;
+                case Expect::Do: report(ExpectingDo, where); break;
+                case Expect::WhileOrUntil: report(ExpectingWhileOrUntil, where); break;
+                default: break;
+            }
+            m_expect = Expect::None;
+        }
+
+        void endStatement(Position where) {
+            if (m_parenDepth > 0) {
+                report(ExpectingRightParenthesis, where);
+                m_parenDepth = 0;
+            }
+            reportExpectation(where);
+        }
+
+        // Unwinds to the innermost block of the given kind, reporting the
+        // blocks left open inside it; false when there is none
+        bool unwindTo(Block block, Position where) {
+            if (std::find(m_blocks.rbegin(), m_blocks.rend(), block) == m_blocks.rend()) {
+                report(m_blocks.empty() ? InvalidStatement : closerMessage(m_blocks.back()), where);
+                return false;
+            }
+            while (m_blocks.back() != block) {
+                report(closerMessage(m_blocks.back()), where);
+                m_blocks.pop_back();
+            }
+            return true;
+        }
+
+        void close(Block block, Position where) {
+            if (unwindTo(block, where)) {
+                m_blocks.pop_back();
+            }
+        }
+
+        void closeAll(Position where) {
+            endStatement(where);
+            while (!m_blocks.empty()) {
+                report(closerMessage(m_blocks.back()), where);
+                m_blocks.pop_back();
+            }
+        }
+
+        void open(Block block, Expect expect) {
+            m_blocks.push_back(block);
+            m_expect = expect;
+        }
+
+        void onKeyword(Keyword keyword, Position where) {
+            if (m_parenDepth > 0) {
+                // Function-typed parameters name the keyword inside a parameter list
+                if (keyword == Keyword::Function) return;
+                report(ExpectingRightParenthesis, where);
+                m_parenDepth = 0;
+            }
+
+            if (m_expect != Expect::None) {
+                bool satisfied = (m_expect == Expect::Then && keyword == Keyword::Then) ||
+                                 (m_expect == Expect::Do && keyword == Keyword::Do) ||
+                                 (m_expect == Expect::WhileOrUntil && (keyword == Keyword::While || keyword == Keyword::Until));
+                if (satisfied) {
+                    m_expect = Expect::None;
+                    return;
+                }
+                reportExpectation(where);
+            }
+
+            switch (keyword) {
+                case Keyword::If:
+                    open(Block::If, Expect::Then);
+                    break;
+                case Keyword::Elseif:
+                    if (unwindTo(Block::If, where)) m_expect = Expect::Then;
+                    break;
+                case Keyword::Else:
+                    unwindTo(Block::If, where);
+                    break;
+                case Keyword::Endif:
+                    close(Block::If, where);
+                    break;
+                case Keyword::While:
+                case Keyword::For:
+                    open(Block::Loop, Expect::Do);
+                    break;
+                case Keyword::Do:
+                    open(Block::Loop, Expect::WhileOrUntil);
+                    break;
+                case Keyword::Enddo:
+                    close(Block::Loop, where);
+                    break;
+                case Keyword::Function:
+                    open(Block::Function, Expect::None);
+                    break;
+                case Keyword::End:
+                    close(Block::Function, where);
+                    break;
+                case Keyword::When:
+                    open(Block::When, Expect::None);
+                    break;
+                case Keyword::Endwhen:
+                    close(Block::When, where);
+                    break;
+                case Keyword::Recode:
+                    open(Block::Recode, Expect::None);
+                    break;
+                case Keyword::Endrecode:
+                    close(Block::Recode, where);
+                    break;
+                case Keyword::Proc:
+                    closeAll(where);
+                    m_procName.clear();
+                    m_expectProcName = true;
+                    break;
+                case Keyword::Section:
+                    closeAll(where);
+                    break;
+                default:
+                    // A stray 'then' or 'until' is left for the engine to report
+                    break;
+            }
+        }
+    };
+
+    bool isLogicFile(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return ext == ".apc" || ext == ".app";
+    }
+}
+
+int scanLogicSource(std::string_view text, std::string_view file, CompilationResult& result) {
+    return StructureScanner(text, file, result).run();
+}
+
+CompilationResult prescanApplication(const CompilerOptions& options) {
+    CompilationResult result;
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<fs::path> inputs = discoverApplicationInputs(resolveInputFile(options));
+    if (inputs.empty()) {
+        result.diagnostics.push_back({ options.inputFile, 0, 0, "Failed to open application", "", DiagnosticMessage::Severity::Error });
+        result.errorCount = 1;
+        return result;
+    }
+
+    MappedFile mapped;
+    for (const auto& input : inputs) {
+        if (!isLogicFile(input)) continue;
+
+        std::string file = input.u8string();
+        auto overlay = options.sourceOverlays.find(file);
+        if (overlay != options.sourceOverlays.end()) {
+            scanLogicSource(overlay->second, file, result);
+        } else if (mapped.open(input)) {
+            scanLogicSource(mapped.view(), file, result);
+        }
+    }
+    mapped.close();
+
+    result.success = (result.errorCount == 0);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    result.compilationTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    return result;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,128 @@
+/*
+ * MappedFile.cpp - Read-only memory mapping of a whole file
+ */
+
+#include "../include/MappedFile.h"
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CSProCompiler {
+
+namespace {
+    void* mapFile(const std::filesystem::path& path, size_t& size, bool& opened) {
+        opened = false;
+        size = 0;
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        opened = true;
+
+        LARGE_INTEGER fileSize;
+        void* view = nullptr;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+            size = static_cast<size_t>(fileSize.QuadPart);
+        }
+        CloseHandle(file);
+        return view;
+#else
+        int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0) {
+            return nullptr;
+        }
+        opened = true;
+
+        struct stat status;
+        void* view = nullptr;
+        if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+            size = static_cast<size_t>(status.st_size);
+            view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (view == MAP_FAILED) {
+                view = nullptr;
+            }
+        }
+        ::close(descriptor);
+        return view;
+#endif
+    }
+
+    void unmapFile(void* mapping, size_t size) {
+#ifdef _WIN32
+        (void)size;
+        UnmapViewOfFile(mapping);
+#else
+        munmap(mapping, size);
+#endif
+    }
+}
+
+MappedFile::MappedFile()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_mapping(nullptr)
+{}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+
+    bool opened;
+    size_t size;
+    m_mapping = mapFile(path, size, opened);
+    if (!opened) {
+        return false;
+    }
+
+    if (m_mapping != nullptr) {
+        m_data = static_cast<const char*>(m_mapping);
+        m_size = size;
+        return true;
+    }
+
+    // Empty or unmappable (pipes, some network shares): fall back to reading
+    if (size > 0) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        m_buffer = contents.str();
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_mapping != nullptr) {
+        unmapFile(m_mapping, m_size);
+        m_mapping = nullptr;
+    }
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+} // namespace CSProCompiler
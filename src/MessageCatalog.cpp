@@ -0,0 +1,315 @@
+/*
+ * MessageCatalog.cpp - Precompiled, memory-mapped CSPro message files
+ */
+
+#include "../include/MessageCatalog.h"
+#include "../include/ContentHash.h"
+#include "../include/FileWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr char CatalogMagic[4] = { 'C', 'M', 'G', 'C' };
+    constexpr uint32_t CatalogFormatVersion = 1;
+
+    // Fields are in host byte order; every supported target is little-endian
+    struct CatalogHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t count;
+        uint32_t blobSize;
+        uint64_t sourceSize;
+        int64_t sourceTime;         // Last write time of the .mgf, in file clock ticks
+        uint64_t sourceHash;        // XXH64 of the .mgf
+        char language[8];           // NUL-padded
+    };
+
+    struct IndexEntry {
+        int32_t number;
+        uint32_t offset;            // Into the blob
+        uint32_t length;
+    };
+
+    static_assert(sizeof(CatalogHeader) == 48, "catalog header must not be padded");
+    static_assert(sizeof(IndexEntry) == 12, "catalog index entries must not be padded");
+
+    struct SourceInfo {
+        uint64_t size;
+        int64_t time;
+        uint64_t hash;
+    };
+
+    struct Message {
+        int32_t number;
+        std::string_view text;
+    };
+
+    bool statSource(const fs::path& path, SourceInfo& info) {
+        std::error_code ec;
+        uintmax_t size = fs::file_size(path, ec);
+        if (ec) return false;
+        fs::file_time_type time = fs::last_write_time(path, ec);
+        if (ec) return false;
+        info.size = static_cast<uint64_t>(size);
+        info.time = static_cast<int64_t>(time.time_since_epoch().count());
+        info.hash = 0;
+        return true;
+    }
+
+    bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return (x | 0x20) == (y | 0x20);
+        });
+    }
+
+    std::string_view trim(std::string_view text) {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) return {};
+        size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+
+    // Collects the messages of the given language (and of any lines before
+    // the first Language= line), sorted by number; a number defined twice
+    // keeps its last text, as CSPro does
+    std::vector<Message> parseMessageText(std::string_view text, std::string_view language) {
+        if (text.size() >= 3 && text.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            text.remove_prefix(3);
+        }
+
+        std::vector<Message> messages;
+        bool inComment = false;
+        bool active = true;
+
+        while (!text.empty()) {
+            size_t lineEnd = text.find('\n');
+            std::string_view line = trim(text.substr(0, lineEnd));
+            text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+
+            if (inComment) {
+                size_t close = line.find("*/");
+                if (close == std::string_view::npos) continue;
+                line = trim(line.substr(close + 2));
+                inComment = false;
+            }
+            if (line.size() >= 2 && line[0] == '/' && line[1] == '*') {
+                size_t close = line.find("*/", 2);
+                if (close == std::string_view::npos) {
+                    inComment = true;
+                    continue;
+                }
+                line = trim(line.substr(close + 2));
+            }
+            if (line.empty() || (line.size() >= 2 && line[0] == '/' && line[1] == '/')) {
+                continue;
+            }
+
+            if (line.size() >= 9 && equalsIgnoreCase(line.substr(0, 9), "Language=")) {
+                active = equalsIgnoreCase(trim(line.substr(9)), language);
+                continue;
+            }
+
+            if (!active || line[0] < '0' || line[0] > '9') {
+                continue;
+            }
+
+            int32_t number = 0;
+            size_t i = 0;
+            while (i < line.size() && line[i] >= '0' && line[i] <= '9' && number < 100000000) {
+                number = number * 10 + (line[i++] - '0');
+            }
+            messages.push_back({ number, trim(line.substr(i)) });
+        }
+
+        std::stable_sort(messages.begin(), messages.end(), [](const Message& a, const Message& b) {
+            return a.number < b.number;
+        });
+        auto last = std::unique(messages.rbegin(), messages.rend(), [](const Message& a, const Message& b) {
+            return a.number == b.number;
+        });
+        messages.erase(messages.begin(), last.base());
+        return messages;
+    }
+
+    std::string buildImage(const std::vector<Message>& messages, const SourceInfo& source, std::string_view language) {
+        CatalogHeader header = {};
+        std::memcpy(header.magic, CatalogMagic, sizeof(header.magic));
+        header.version = CatalogFormatVersion;
+        header.count = static_cast<uint32_t>(messages.size());
+        header.sourceSize = source.size;
+        header.sourceTime = source.time;
+        header.sourceHash = source.hash;
+        std::memcpy(header.language, language.data(), std::min(language.size(), sizeof(header.language)));
+
+        std::vector<IndexEntry> index;
+        index.reserve(messages.size());
+        uint32_t offset = 0;
+        for (const auto& message : messages) {
+            index.push_back({ message.number, offset, static_cast<uint32_t>(message.text.size()) });
+            offset += static_cast<uint32_t>(message.text.size());
+        }
+        header.blobSize = offset;
+
+        std::string image;
+        image.reserve(sizeof(header) + index.size() * sizeof(IndexEntry) + offset);
+        image.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        image.append(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(IndexEntry));
+        for (const auto& message : messages) {
+            image.append(message.text);
+        }
+        return image;
+    }
+
+    bool headerMatchesLanguage(const CatalogHeader& header, std::string_view language) {
+        std::string_view stored(header.language, sizeof(header.language));
+        stored = stored.substr(0, stored.find('\0'));
+        return equalsIgnoreCase(stored, language.substr(0, sizeof(header.language)));
+    }
+
+    MessageCatalog& systemCatalog() {
+        static MessageCatalog catalog;
+        return catalog;
+    }
+}
+
+MessageCatalog::MessageCatalog()
+    : m_data(nullptr)
+    , m_count(0)
+    , m_blob(nullptr)
+    , m_blobSize(0)
+    , m_precompiled(false)
+{}
+
+fs::path MessageCatalog::catalogPathFor(const fs::path& messageFile) {
+    fs::path catalogFile = messageFile;
+    return catalogFile.replace_extension(".mgc");
+}
+
+bool MessageCatalog::attach(const char* data, size_t size) {
+    if (size < sizeof(CatalogHeader)) {
+        return false;
+    }
+
+    CatalogHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, CatalogMagic, sizeof(header.magic)) != 0 || header.version != CatalogFormatVersion) {
+        return false;
+    }
+
+    uint64_t blobOffset = sizeof(CatalogHeader) + static_cast<uint64_t>(header.count) * sizeof(IndexEntry);
+    if (blobOffset + header.blobSize > size) {
+        return false;
+    }
+
+    m_data = data;
+    m_count = header.count;
+    m_blob = data + blobOffset;
+    m_blobSize = header.blobSize;
+    return true;
+}
+
+bool MessageCatalog::open(const fs::path& messageFile, std::string_view language) {
+    close();
+
+    SourceInfo source;
+    bool haveSource = statSource(messageFile, source);
+    MappedFile text;
+
+    // The catalog is current when it records the .mgf's size and write
+    // time; a copied .mgf has a new write time, so then its digest decides
+    if (m_catalog.open(catalogPathFor(messageFile))) {
+        std::string_view catalog = m_catalog.view();
+        CatalogHeader header;
+        bool current = false;
+        if (catalog.size() >= sizeof(header)) {
+            std::memcpy(&header, catalog.data(), sizeof(header));
+            if (!headerMatchesLanguage(header, language)) {
+                current = false;
+            } else if (!haveSource) {
+                current = true;     // Installed without its text; nothing to be stale against
+            } else if (header.sourceSize == source.size) {
+                current = (header.sourceTime == source.time) ||
+                          (text.open(messageFile) && hash64(text.view()) == header.sourceHash);
+            }
+        }
+        if (current && attach(catalog.data(), catalog.size())) {
+            m_precompiled = true;
+            return true;
+        }
+        m_catalog.close();
+    }
+
+    if (!haveSource || (text.view().empty() && !text.open(messageFile))) {
+        return false;
+    }
+
+    source.hash = hash64(text.view());
+    m_image = buildImage(parseMessageText(text.view(), language), source, language);
+    return attach(m_image.data(), m_image.size());
+}
+
+void MessageCatalog::close() {
+    m_catalog.close();
+    m_image.clear();
+    m_data = nullptr;
+    m_count = 0;
+    m_blob = nullptr;
+    m_blobSize = 0;
+    m_precompiled = false;
+}
+
+std::string_view MessageCatalog::lookup(int number) const {
+    if (m_data == nullptr) {
+        return {};
+    }
+
+    const IndexEntry* first = reinterpret_cast<const IndexEntry*>(m_data + sizeof(CatalogHeader));
+    const IndexEntry* last = first + m_count;
+    const IndexEntry* entry = std::lower_bound(first, last, number, [](const IndexEntry& e, int n) {
+        return e.number < n;
+    });
+    if (entry == last || entry->number != number ||
+        static_cast<uint64_t>(entry->offset) + entry->length > m_blobSize) {
+        return {};
+    }
+    return std::string_view(m_blob + entry->offset, entry->length);
+}
+
+bool MessageCatalog::compile(const fs::path& messageFile, const fs::path& catalogFile,
+                             std::string_view language, size_t& messageCount, std::string& error) {
+    SourceInfo source;
+    MappedFile text;
+    if (!statSource(messageFile, source) || !text.open(messageFile)) {
+        error = "Cannot read message file: " + messageFile.u8string();
+        return false;
+    }
+    if (language.empty() || language.size() > sizeof(CatalogHeader::language)) {
+        error = "Language names are 1 to 8 characters";
+        return false;
+    }
+
+    source.hash = hash64(text.view());
+    std::vector<Message> messages = parseMessageText(text.view(), language);
+    messageCount = messages.size();
+
+    if (!writeFileAtomically(catalogFile, buildImage(messages, source, language))) {
+        error = "Cannot write message catalog: " + catalogFile.u8string();
+        return false;
+    }
+    return true;
+}
+
+bool loadSystemMessages(const fs::path& messageFile) {
+    return systemCatalog().open(messageFile);
+}
+
+const MessageCatalog& systemMessages() {
+    return systemCatalog();
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,111 @@
+/*
+ * PhaseTiming.cpp - Per-phase compile timings and Chrome trace export
+ */
+
+#include "../include/PhaseTiming.h"
+#include "../include/JsonWriter.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+namespace CSProCompiler {
+
+double traceClockMs() {
+    static const auto origin = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+}
+
+PhaseRecorder::PhaseRecorder(std::vector<PhaseSpan>& spans)
+    : m_spans(spans)
+    , m_open(-1)
+{}
+
+size_t PhaseRecorder::begin(std::string name) {
+    m_spans.push_back({ std::move(name), traceClockMs(), 0.0, m_open });
+    m_open = static_cast<int>(m_spans.size() - 1);
+    return m_spans.size() - 1;
+}
+
+void PhaseRecorder::end(size_t index) {
+    PhaseSpan& span = m_spans[index];
+    span.durationMs = traceClockMs() - span.startMs;
+    m_open = span.parent;
+}
+
+void PhaseRecorder::adopt(const std::vector<PhaseSpan>& spans) {
+    int offset = static_cast<int>(m_spans.size());
+    for (const auto& span : spans) {
+        PhaseSpan adopted = span;
+        adopted.parent = (span.parent < 0) ? m_open : span.parent + offset;
+        m_spans.push_back(std::move(adopted));
+    }
+}
+
+PhaseScope::PhaseScope(PhaseRecorder& recorder, std::string name)
+    : m_recorder(recorder)
+    , m_index(recorder.begin(std::move(name)))
+    , m_open(true)
+{}
+
+PhaseScope::~PhaseScope() {
+    end();
+}
+
+void PhaseScope::end() {
+    if (m_open) {
+        m_recorder.end(m_index);
+        m_open = false;
+    }
+}
+
+void writeChromeTrace(std::string& buffer, const std::vector<TraceTrack>& tracks) {
+    JsonWriter writer(buffer);
+    writer.beginObject();
+    writer.member("displayTimeUnit", "ms");
+    writer.key("traceEvents").beginArray();
+
+    std::set<int> namedThreads;
+    for (const auto& track : tracks) {
+        if (namedThreads.insert(track.threadId).second) {
+            writer.beginObject();
+            writer.member("name", "thread_name");
+            writer.member("ph", "M");
+            writer.member("pid", 1);
+            writer.member("tid", track.threadId);
+            writer.key("args").beginObject().member("name", track.threadName).endObject();
+            writer.endObject();
+        }
+
+        // Trace timestamps are in microseconds
+        for (const auto& span : *track.phases) {
+            writer.beginObject();
+            writer.member("name", span.name);
+            writer.member("cat", "compile");
+            writer.member("ph", "X");
+            writer.member("ts", span.startMs * 1000.0);
+            writer.member("dur", span.durationMs * 1000.0);
+            writer.member("pid", 1);
+            writer.member("tid", track.threadId);
+            writer.endObject();
+        }
+    }
+
+    writer.endArray();
+    writer.endObject();
+    buffer += '\n';
+}
+
+bool writeChromeTraceFile(const std::string& path, const std::vector<TraceTrack>& tracks) {
+    std::string buffer;
+    writeChromeTrace(buffer, tracks);
+
+    std::ofstream file(std::filesystem::u8path(path), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<bool>(file);
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,98 @@
+/*
+ * ReportWriter.cpp - compileErrors.txt / compileErrorsFormatted.txt output
+ */
+
+#include "../include/ReportWriter.h"
+#include <charconv>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    void appendNumber(std::string& out, long long number) {
+        char digits[24];
+        auto converted = std::to_chars(digits, digits + sizeof(digits), number);
+        out.append(digits, converted.ptr);
+    }
+}
+
+ReportWriter::ReportWriter(const std::string& applicationFile)
+    : m_applicationFile(applicationFile)
+    , m_started(false)
+{
+    fs::path entPath(applicationFile);
+    m_detailedPath = entPath.parent_path() / "compileErrors.txt";
+    m_formattedPath = entPath.parent_path() / "compileErrorsFormatted.txt";
+}
+
+void ReportWriter::onDiagnostic(const DiagnosticView& diag) {
+    m_started = true;
+
+    std::string_view severity = (diag.severity == DiagnosticMessage::Severity::Error) ? "ERROR" : "WARNING";
+
+    m_detailedBody.append(severity).append(" at line ");
+    appendNumber(m_detailedBody, diag.line);
+    m_detailedBody.append(", column ");
+    appendNumber(m_detailedBody, diag.column);
+    m_detailedBody.append(":\n  ").append(diag.message).append("\n  Location: ").append(diag.file).append("\n\n");
+
+    // Format like CSPro Designer: SEVERITY(ProcName, line): message
+    m_formatted.append(severity);
+    if (!diag.procName.empty() || diag.line > 0) {
+        m_formatted += '(';
+        m_formatted.append(diag.procName);
+        if (diag.line > 0) {
+            if (!diag.procName.empty()) {
+                m_formatted.append(", ");
+            }
+            appendNumber(m_formatted, diag.line);
+        }
+        m_formatted += ')';
+    }
+    m_formatted.append(": ").append(diag.message) += '\n';
+}
+
+bool ReportWriter::finish(const CompilationResult& result, AsyncFileWriter* fileWriter) {
+    if (!m_started) {
+        return false;
+    }
+
+    std::string detailed;
+    detailed.reserve(256 + m_applicationFile.size() + m_detailedBody.size());
+    detailed.append("CSPro Compilation Errors/Warnings\n");
+    detailed.append("==================================\n");
+    detailed.append("File: ").append(m_applicationFile).append("\n");
+    detailed.append("Date: " __DATE__ " " __TIME__ "\n");
+    detailed.append("Total Errors: ");
+    appendNumber(detailed, result.errorCount);
+    detailed.append("\nTotal Warnings: ");
+    appendNumber(detailed, result.warningCount);
+    detailed.append("\n\n").append(m_detailedBody);
+    m_detailedBody.clear();
+
+    if (fileWriter != nullptr) {
+        fileWriter->submit(m_detailedPath, std::move(detailed));
+        fileWriter->submit(m_formattedPath, std::move(m_formatted));
+        m_formatted.clear();
+        return true;
+    }
+
+    bool detailedWritten = writeFileIfChanged(m_detailedPath, detailed) != FileWriteOutcome::Failed;
+    bool formattedWritten = writeFileIfChanged(m_formattedPath, m_formatted) != FileWriteOutcome::Failed;
+    m_formatted.clear();
+    return detailedWritten && formattedWritten;
+}
+
+bool ReportWriter::writeReports(const std::string& applicationFile, const CompilationResult& result,
+                                AsyncFileWriter* fileWriter) {
+    ReportWriter writer(applicationFile);
+    writer.m_detailedBody.reserve(result.diagnostics.size() * 128);
+    writer.m_formatted.reserve(result.diagnostics.size() * 96);
+    for (const auto& diag : result.diagnostics) {
+        writer.onDiagnostic(diag);
+    }
+    return writer.finish(result, fileWriter);
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,133 @@
+/*
+ * ResultCache.cpp - On-disk compilation result cache
+ */
+
+#include "../include/ResultCache.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/ContentHash.h"
+#include "../include/FileWriter.h"
+#include "../include/MappedFile.h"
+#include "../include/ResultCodec.h"
+#include "../include/WorkingDirectory.h"
+#include <cstring>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    // Bump when the key material or the file layout changes
+    constexpr int CacheFormatVersion = 4;
+
+    constexpr char CacheMagic[4] = { 'C', 'C', 'H', 'E' };
+
+    // Followed by the key, then the result (see ResultCodec.h)
+    struct CacheEntryHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t compiledOutputPresent;
+        uint32_t keyLength;
+    };
+
+    static_assert(sizeof(CacheEntryHeader) == 16, "cache entry header must not be padded");
+}
+
+ResultCache::ResultCache(const std::string& applicationFile) {
+    m_applicationFile = resolvePath(fs::u8path(applicationFile));
+    m_cachePath = m_applicationFile.parent_path() / ".csprocompile" / (m_applicationFile.filename().string() + ".result");
+}
+
+bool ResultCache::computeKey(const CompilerOptions& options, const std::string& engineIdentity, std::string& key) const {
+    std::vector<fs::path> inputs = discoverApplicationInputs(m_applicationFile);
+    if (inputs.empty()) {
+        return false;
+    }
+
+    // verboseOutput only changes logging, so it is left out of the key
+    std::ostringstream material;
+    material << "csprocompile-cache-v" << CacheFormatVersion << "\n"
+             << "tool=" << toolVersion() << "\n"
+             << "engine=" << engineIdentity << "\n"
+             << "input=" << m_applicationFile.generic_string() << "\n"
+             << "outputDirectory=" << options.outputDirectory << "\n"
+             << "checkSyntaxOnly=" << options.checkSyntaxOnly << "\n"
+             << "generateDebugInfo=" << options.generateDebugInfo << "\n";
+
+    fs::path baseDirectory = m_applicationFile.parent_path();
+    for (const auto& input : inputs) {
+        uint64_t contentHash;
+        if (!hashFile(input, contentHash)) {
+            return false;
+        }
+        material << input.lexically_relative(baseDirectory).generic_string() << '\0' << hashToHex(contentHash) << "\n";
+    }
+
+    key = hashToHex(hash64(material.str()));
+    return true;
+}
+
+bool ResultCache::lookup(const std::string& key, CompilationResult& result) const {
+    MappedFile file;
+    if (!file.open(m_cachePath)) {
+        return false;
+    }
+    std::string_view entry = file.view();
+
+    CacheEntryHeader header;
+    if (entry.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, entry.data(), sizeof(header));
+    if (std::memcmp(header.magic, CacheMagic, sizeof(header.magic)) != 0 ||
+        header.version != static_cast<uint32_t>(CacheFormatVersion) ||
+        entry.size() - sizeof(header) < header.keyLength || entry.substr(sizeof(header), header.keyLength) != key) {
+        return false;
+    }
+
+    EncodedResultView stored;
+    if (!stored.attach(entry.substr(sizeof(header) + header.keyLength))) {
+        return false;
+    }
+
+    // A deleted .pen invalidates a successful entry
+    if (header.compiledOutputPresent != 0 && !fs::exists(fs::u8path(std::string(stored.compiledOutput())))) {
+        return false;
+    }
+
+    // Timings belong to the run that produced the result, not to this hit
+    CompilationResult cached = stored.toResult();
+    cached.compilationTimeMs = 0.0;
+    cached.phases.clear();
+    cached.fromCache = true;
+    result = std::move(cached);
+    return true;
+}
+
+bool ResultCache::store(const std::string& key, const CompilationResult& result) const {
+    std::error_code ec;
+    fs::create_directories(m_cachePath.parent_path(), ec);
+    if (ec) {
+        return false;
+    }
+
+    CacheEntryHeader header = {};
+    std::memcpy(header.magic, CacheMagic, sizeof(header.magic));
+    header.version = CacheFormatVersion;
+    header.compiledOutputPresent = !result.compiledOutput.empty() && fs::exists(fs::u8path(result.compiledOutput));
+    header.keyLength = static_cast<uint32_t>(key.size());
+
+    std::string out;
+    out.reserve(sizeof(header) + key.size() + 128 + result.diagnostics.size() * 64);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(key);
+    encodeCompilationResult(out, result);
+
+    return writeFileAtomically(m_cachePath, out);
+}
+
+bool ResultCache::isCacheable(const CompilationResult& result) {
+    return !result.cancelled && (result.success || result.errorCount > 0);
+}
+
+} // namespace CSProCompiler
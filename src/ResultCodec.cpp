@@ -0,0 +1,333 @@
+/*
+ * ResultCodec.cpp - Versioned binary encoding of CompilationResult
+ */
+
+#include "../include/ResultCodec.h"
+#include "../include/ContentHash.h"
+#include <cstring>
+#include <vector>
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr char ResultMagic[4] = { 'C', 'R', 'E', 'S' };
+
+    // Header flags
+    constexpr uint32_t HasChecksum = 1u << 0;
+    constexpr uint32_t Success = 1u << 1;
+    constexpr uint32_t FromCache = 1u << 2;
+    constexpr uint32_t Cancelled = 1u << 3;
+
+    struct ResultHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t flags;
+        uint32_t diagnosticCount;
+        uint32_t phaseCount;
+        uint32_t stringCount;
+        uint32_t stringBytes;
+        int32_t errorCount;
+        int32_t warningCount;
+        uint32_t compiledOutput;        // String index
+        double compilationTimeMs;
+        uint64_t totalSize;             // Header included
+        uint64_t checksum;              // XXH64 of everything else, when HasChecksum
+    };
+
+    struct PhaseRecord {
+        uint32_t name;
+        int32_t parent;
+        double startMs;
+        double durationMs;
+    };
+
+    struct DiagnosticRecord {
+        uint32_t file;
+        uint32_t procName;
+        uint32_t message;
+        int32_t line;
+        int32_t column;
+        int32_t messageNumber;
+        uint32_t severity;
+    };
+
+    static_assert(sizeof(ResultHeader) == 64, "result header must not be padded");
+    static_assert(sizeof(PhaseRecord) == 24, "phase records must not be padded");
+    static_assert(sizeof(DiagnosticRecord) == 28, "diagnostic records must not be padded");
+
+    constexpr size_t ChecksumOffset = offsetof(ResultHeader, checksum);
+
+    uint64_t computeChecksum(const char* data, size_t size) {
+        uint64_t seed = hash64(data, ChecksumOffset);
+        return hash64(data + sizeof(ResultHeader), size - sizeof(ResultHeader), seed);
+    }
+
+    // Distinct strings in first-use order, found through an open-addressed
+    // index; file and PROC names repeat on nearly every diagnostic
+    class StringTable {
+    public:
+        explicit StringTable(size_t expected) {
+            size_t bucketCount = 64;
+            while (bucketCount < expected * 2) bucketCount *= 2;
+            m_buckets.assign(bucketCount, 0);
+            m_strings.reserve(expected);
+        }
+
+        uint32_t intern(std::string_view text) {
+            if ((m_strings.size() + 1) * 2 > m_buckets.size()) {
+                rehash(m_buckets.size() * 2);
+            }
+            size_t mask = m_buckets.size() - 1;
+            for (size_t bucket = hash64(text) & mask;; bucket = (bucket + 1) & mask) {
+                uint32_t slot = m_buckets[bucket];
+                if (slot == 0) {
+                    m_strings.push_back(text);
+                    m_bytes += sizeof(uint32_t) + text.size();
+                    m_buckets[bucket] = static_cast<uint32_t>(m_strings.size());
+                    return static_cast<uint32_t>(m_strings.size() - 1);
+                }
+                if (m_strings[slot - 1] == text) {
+                    return slot - 1;
+                }
+            }
+        }
+
+        const std::vector<std::string_view>& strings() const { return m_strings; }
+        size_t bytes() const { return m_bytes; }
+
+    private:
+        std::vector<std::string_view> m_strings;
+        std::vector<uint32_t> m_buckets;    // String index + 1, 0 = empty
+        size_t m_bytes = 0;
+
+        void rehash(size_t bucketCount) {
+            m_buckets.assign(bucketCount, 0);
+            size_t mask = bucketCount - 1;
+            for (size_t i = 0; i < m_strings.size(); i++) {
+                size_t bucket = hash64(m_strings[i]) & mask;
+                while (m_buckets[bucket] != 0) bucket = (bucket + 1) & mask;
+                m_buckets[bucket] = static_cast<uint32_t>(i + 1);
+            }
+        }
+    };
+}
+
+void encodeCompilationResult(std::string& buffer, const CompilationResult& result, bool withChecksum) {
+    size_t start = buffer.size();
+    size_t phasesOffset = start + sizeof(ResultHeader);
+    size_t diagnosticsOffset = phasesOffset + result.phases.size() * sizeof(PhaseRecord);
+    size_t offsetsOffset = diagnosticsOffset + result.diagnostics.size() * sizeof(DiagnosticRecord);
+    buffer.resize(offsetsOffset);
+
+    StringTable table(result.diagnostics.size() + result.phases.size() + 16);
+    uint32_t compiledOutput = table.intern(result.compiledOutput);
+
+    for (size_t i = 0; i < result.phases.size(); i++) {
+        const PhaseSpan& span = result.phases[i];
+        PhaseRecord record = { table.intern(span.name), span.parent, span.startMs, span.durationMs };
+        std::memcpy(&buffer[phasesOffset + i * sizeof(PhaseRecord)], &record, sizeof(record));
+    }
+
+    for (size_t i = 0; i < result.diagnostics.size(); i++) {
+        DiagnosticView diag = result.diagnostics[i];
+        DiagnosticRecord record;
+        record.file = table.intern(diag.file);
+        record.procName = table.intern(diag.procName);
+        record.message = table.intern(diag.message);
+        record.line = diag.line;
+        record.column = diag.column;
+        record.messageNumber = diag.messageNumber;
+        record.severity = static_cast<uint32_t>(diag.severity);
+        std::memcpy(&buffer[diagnosticsOffset + i * sizeof(DiagnosticRecord)], &record, sizeof(record));
+    }
+
+    const std::vector<std::string_view>& strings = table.strings();
+    buffer.reserve(offsetsOffset + strings.size() * sizeof(uint32_t) + table.bytes());
+    uint32_t stringOffset = 0;
+    for (std::string_view text : strings) {
+        buffer.append(reinterpret_cast<const char*>(&stringOffset), sizeof(stringOffset));
+        stringOffset += static_cast<uint32_t>(sizeof(uint32_t) + text.size());
+    }
+    for (std::string_view text : strings) {
+        uint32_t length = static_cast<uint32_t>(text.size());
+        buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        buffer.append(text);
+    }
+
+    ResultHeader header = {};
+    std::memcpy(header.magic, ResultMagic, sizeof(header.magic));
+    header.version = ResultFormatVersion;
+    header.flags = (withChecksum ? HasChecksum : 0) | (result.success ? Success : 0) |
+                   (result.fromCache ? FromCache : 0) | (result.cancelled ? Cancelled : 0);
+    header.diagnosticCount = static_cast<uint32_t>(result.diagnostics.size());
+    header.phaseCount = static_cast<uint32_t>(result.phases.size());
+    header.stringCount = static_cast<uint32_t>(strings.size());
+    header.stringBytes = stringOffset;
+    header.errorCount = result.errorCount;
+    header.warningCount = result.warningCount;
+    header.compiledOutput = compiledOutput;
+    header.compilationTimeMs = result.compilationTimeMs;
+    header.totalSize = buffer.size() - start;
+    std::memcpy(&buffer[start], &header, sizeof(header));
+
+    if (withChecksum) {
+        header.checksum = computeChecksum(buffer.data() + start, buffer.size() - start);
+        std::memcpy(&buffer[start + ChecksumOffset], &header.checksum, sizeof(header.checksum));
+    }
+}
+
+EncodedResultView::EncodedResultView()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_diagnosticCount(0)
+    , m_phaseCount(0)
+    , m_stringCount(0)
+    , m_phases(nullptr)
+    , m_diagnostics(nullptr)
+    , m_offsets(nullptr)
+    , m_strings(nullptr)
+    , m_stringBytes(0)
+{}
+
+bool EncodedResultView::attach(std::string_view data, bool verifyChecksum) {
+    *this = EncodedResultView();
+
+    ResultHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, ResultMagic, sizeof(header.magic)) != 0 || header.version != ResultFormatVersion ||
+        header.totalSize > data.size()) {
+        return false;
+    }
+
+    uint64_t diagnosticsOffset = sizeof(ResultHeader) + static_cast<uint64_t>(header.phaseCount) * sizeof(PhaseRecord);
+    uint64_t offsetsOffset = diagnosticsOffset + static_cast<uint64_t>(header.diagnosticCount) * sizeof(DiagnosticRecord);
+    uint64_t stringsOffset = offsetsOffset + static_cast<uint64_t>(header.stringCount) * sizeof(uint32_t);
+    if (stringsOffset + header.stringBytes != header.totalSize) {
+        return false;
+    }
+
+    const char* base = data.data();
+    if (verifyChecksum && (header.flags & HasChecksum) != 0 &&
+        computeChecksum(base, static_cast<size_t>(header.totalSize)) != header.checksum) {
+        return false;
+    }
+
+    // Every index is checked once here so that accessors need not
+    const char* offsets = base + offsetsOffset;
+    const char* strings = base + stringsOffset;
+    for (uint32_t i = 0; i < header.stringCount; i++) {
+        uint32_t offset;
+        uint32_t length;
+        std::memcpy(&offset, offsets + i * sizeof(uint32_t), sizeof(offset));
+        if (static_cast<uint64_t>(offset) + sizeof(length) > header.stringBytes) return false;
+        std::memcpy(&length, strings + offset, sizeof(length));
+        if (static_cast<uint64_t>(offset) + sizeof(length) + length > header.stringBytes) return false;
+    }
+    if (header.compiledOutput >= header.stringCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header.phaseCount; i++) {
+        PhaseRecord record;
+        std::memcpy(&record, base + sizeof(ResultHeader) + i * sizeof(PhaseRecord), sizeof(record));
+        if (record.name >= header.stringCount || record.parent < -1 || record.parent >= static_cast<int32_t>(i)) return false;
+    }
+    for (uint32_t i = 0; i < header.diagnosticCount; i++) {
+        DiagnosticRecord record;
+        std::memcpy(&record, base + diagnosticsOffset + i * sizeof(DiagnosticRecord), sizeof(record));
+        if (record.file >= header.stringCount || record.procName >= header.stringCount ||
+            record.message >= header.stringCount || record.severity > static_cast<uint32_t>(DiagnosticMessage::Severity::Info)) {
+            return false;
+        }
+    }
+
+    m_data = base;
+    m_size = static_cast<size_t>(header.totalSize);
+    m_diagnosticCount = header.diagnosticCount;
+    m_phaseCount = header.phaseCount;
+    m_stringCount = header.stringCount;
+    m_phases = base + sizeof(ResultHeader);
+    m_diagnostics = base + diagnosticsOffset;
+    m_offsets = offsets;
+    m_strings = strings;
+    m_stringBytes = header.stringBytes;
+    return true;
+}
+
+namespace {
+    ResultHeader readHeader(const char* data) {
+        ResultHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        return header;
+    }
+}
+
+bool EncodedResultView::success() const { return m_data != nullptr && (readHeader(m_data).flags & Success) != 0; }
+bool EncodedResultView::fromCache() const { return m_data != nullptr && (readHeader(m_data).flags & FromCache) != 0; }
+bool EncodedResultView::cancelled() const { return m_data != nullptr && (readHeader(m_data).flags & Cancelled) != 0; }
+int EncodedResultView::errorCount() const { return m_data != nullptr ? readHeader(m_data).errorCount : 0; }
+int EncodedResultView::warningCount() const { return m_data != nullptr ? readHeader(m_data).warningCount : 0; }
+double EncodedResultView::compilationTimeMs() const { return m_data != nullptr ? readHeader(m_data).compilationTimeMs : 0.0; }
+
+std::string_view EncodedResultView::compiledOutput() const {
+    return m_data != nullptr ? string(readHeader(m_data).compiledOutput) : std::string_view();
+}
+
+std::string_view EncodedResultView::string(uint32_t index) const {
+    uint32_t offset;
+    uint32_t length;
+    std::memcpy(&offset, m_offsets + index * sizeof(uint32_t), sizeof(offset));
+    std::memcpy(&length, m_strings + offset, sizeof(length));
+    return std::string_view(m_strings + offset + sizeof(length), length);
+}
+
+DiagnosticView EncodedResultView::diagnostic(size_t index) const {
+    DiagnosticRecord record;
+    std::memcpy(&record, m_diagnostics + index * sizeof(DiagnosticRecord), sizeof(record));
+    return DiagnosticView(string(record.file), record.line, record.column, string(record.message), string(record.procName),
+                          static_cast<DiagnosticMessage::Severity>(record.severity), record.messageNumber);
+}
+
+PhaseSpan EncodedResultView::phase(size_t index) const {
+    PhaseRecord record;
+    std::memcpy(&record, m_phases + index * sizeof(PhaseRecord), sizeof(record));
+    return PhaseSpan{ std::string(string(record.name)), record.startMs, record.durationMs, record.parent };
+}
+
+CompilationResult EncodedResultView::toResult() const {
+    CompilationResult result;
+    if (m_data == nullptr) {
+        return result;
+    }
+
+    result.success = success();
+    result.fromCache = fromCache();
+    result.cancelled = cancelled();
+    result.errorCount = errorCount();
+    result.warningCount = warningCount();
+    result.compilationTimeMs = compilationTimeMs();
+    result.compiledOutput = std::string(compiledOutput());
+
+    result.phases.reserve(m_phaseCount);
+    for (size_t i = 0; i < m_phaseCount; i++) {
+        result.phases.push_back(phase(i));
+    }
+    result.diagnostics.reserve(m_diagnosticCount, m_diagnosticCount > 0 ? m_stringBytes / m_diagnosticCount : 0);
+    for (size_t i = 0; i < m_diagnosticCount; i++) {
+        result.diagnostics.push_back(diagnostic(i));
+    }
+    return result;
+}
+
+bool decodeCompilationResult(std::string_view data, CompilationResult& result, bool verifyChecksum) {
+    EncodedResultView view;
+    if (!view.attach(data, verifyChecksum)) {
+        return false;
+    }
+    result = view.toResult();
+    return true;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,349 @@
+/*
+ * ResultStore.cpp - Shared, content-addressed store of compile outputs
+ */
+
+#include "../include/ResultStore.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/ContentHash.h"
+#include "../include/FileWriter.h"
+#include "../include/MappedFile.h"
+#include "../include/ResultCodec.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    // Bump when the key material or the entry layout changes
+    constexpr int StoreFormatVersion = 2;
+
+    // Paths under the application's folder become relative to it
+    std::string toPortable(std::string_view file, const fs::path& baseDirectory) {
+        fs::path path = fs::u8path(file);
+        if (file.empty() || !path.is_absolute()) {
+            return std::string(file);
+        }
+        fs::path relative = path.lexically_normal().lexically_relative(baseDirectory);
+        if (relative.empty() || *relative.begin() == "..") {
+            return std::string(file);
+        }
+        return relative.generic_u8string();
+    }
+
+    std::string fromPortable(std::string_view file, const fs::path& baseDirectory) {
+        fs::path path = fs::u8path(file);
+        if (file.empty() || path.is_absolute()) {
+            return std::string(file);
+        }
+        return (baseDirectory / path).lexically_normal().u8string();
+    }
+
+    // An application's diagnostics name a handful of files; each is converted once
+    class PathRebaser {
+    public:
+        using Convert = std::string (*)(std::string_view, const fs::path&);
+
+        PathRebaser(const fs::path& baseDirectory, Convert convert)
+            : m_baseDirectory(baseDirectory)
+            , m_convert(convert)
+        {}
+
+        std::string_view operator()(std::string_view file) {
+            auto found = m_converted.find(file);
+            if (found == m_converted.end()) {
+                found = m_converted.emplace(std::string(file), m_convert(file, m_baseDirectory)).first;
+            }
+            return found->second;
+        }
+
+    private:
+        const fs::path& m_baseDirectory;
+        Convert m_convert;
+        std::map<std::string, std::string, std::less<>> m_converted;
+    };
+
+    fs::path applicationDirectory(const std::string& applicationFile) {
+        return resolvePath(fs::u8path(applicationFile)).lexically_normal().parent_path();
+    }
+}
+
+ResultStore::ResultStore(fs::path directory, uint64_t maxBytes)
+    : m_directory(resolvePath(directory))
+    , m_maxBytes(maxBytes)
+    , m_trackedBytes(0)
+    , m_trackedBytesKnown(false)
+{}
+
+ResultStore::~ResultStore() {
+    ResultStoreStats stats = getStats();
+    if (stats.hits == 0 && stats.misses == 0 && stats.inserts == 0 && stats.evictions == 0) {
+        return;
+    }
+
+    // One short append per process; O_APPEND keeps concurrent lines whole
+    std::ostringstream line;
+    line << stats.hits << ' ' << stats.misses << ' ' << stats.inserts << ' ' << stats.evictions << ' '
+         << stats.evictedBytes << '\n';
+    std::string text = line.str();
+    std::ofstream log(m_directory / "stats.log", std::ios::binary | std::ios::app);
+    log.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+fs::path ResultStore::entryPath(const std::string& key, const char* extension) const {
+    return m_directory / "objects" / key.substr(0, 2) / (key + extension);
+}
+
+bool ResultStore::computeKey(const std::string& applicationFile, const CompilerOptions& options,
+                             const std::string& engineIdentity, std::string& key) {
+    fs::path application = resolvePath(fs::u8path(applicationFile)).lexically_normal();
+    std::vector<fs::path> inputs = discoverApplicationInputs(application);
+    if (inputs.empty()) {
+        return false;
+    }
+
+    // verboseOutput only changes logging, so it is left out of the key
+    fs::path baseDirectory = application.parent_path();
+    std::ostringstream material;
+    material << "csprocompile-store-v" << StoreFormatVersion << "\n"
+             << "tool=" << toolVersion() << "\n"
+             << "engine=" << engineIdentity << "\n"
+             << "input=" << application.filename().generic_u8string() << "\n"
+             << "outputDirectory=" << toPortable(options.outputDirectory, baseDirectory) << "\n"
+             << "checkSyntaxOnly=" << options.checkSyntaxOnly << "\n"
+             << "generateDebugInfo=" << options.generateDebugInfo << "\n";
+    for (const auto& input : inputs) {
+        uint64_t contentHash;
+        if (!hashFile(input, contentHash)) {
+            return false;
+        }
+        material << input.lexically_relative(baseDirectory).generic_u8string() << '\0' << hashToHex(contentHash) << "\n";
+    }
+
+    key = hashToHex(hash64(material.str()));
+    return true;
+}
+
+bool ResultStore::lookup(const std::string& key, const std::string& applicationFile, CompilationResult& result) {
+    fs::path resultPath = entryPath(key, ".result");
+    fs::path baseDirectory = applicationDirectory(applicationFile);
+
+    CompilationResult found;
+    bool hit = false;
+    {
+        MappedFile file;
+        EncodedResultView stored;
+        if (file.open(resultPath) && stored.attach(file.view())) {
+            found.success = stored.success();
+            found.errorCount = stored.errorCount();
+            found.warningCount = stored.warningCount();
+            found.diagnostics.reserve(stored.diagnosticCount());
+            PathRebaser rebase(baseDirectory, fromPortable);
+            for (size_t i = 0; i < stored.diagnosticCount(); i++) {
+                DiagnosticView diag = stored.diagnostic(i);
+                diag.file = rebase(diag.file);
+                found.diagnostics.push_back(diag);
+            }
+            hit = true;
+
+            // The .pen goes back where this checkout's compile would have written it
+            if (!stored.compiledOutput().empty()) {
+                found.compiledOutput = fromPortable(stored.compiledOutput(), baseDirectory);
+                MappedFile compiled;
+                hit = compiled.open(entryPath(key, ".pen")) &&
+                      writeFileIfChanged(fs::u8path(found.compiledOutput), compiled.view()) != FileWriteOutcome::Failed;
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (hit) m_stats.hits++; else m_stats.misses++;
+    }
+    if (!hit) {
+        return false;
+    }
+
+    // Recently used entries are the last to be evicted
+    std::error_code ec;
+    fs::last_write_time(resultPath, fs::file_time_type::clock::now(), ec);
+
+    found.fromCache = true;
+    result = std::move(found);
+    return true;
+}
+
+bool ResultStore::insert(const std::string& key, const std::string& applicationFile, const CompilationResult& result) {
+    fs::path resultPath = entryPath(key, ".result");
+    std::error_code ec;
+    fs::create_directories(resultPath.parent_path(), ec);
+    if (ec) {
+        return false;
+    }
+
+    fs::path baseDirectory = applicationDirectory(applicationFile);
+    CompilationResult portable;
+    portable.success = result.success;
+    portable.errorCount = result.errorCount;
+    portable.warningCount = result.warningCount;
+    portable.diagnostics.reserve(result.diagnostics.size());
+    PathRebaser rebase(baseDirectory, toPortable);
+    for (const auto& diag : result.diagnostics) {
+        DiagnosticView stored = diag;
+        stored.file = rebase(stored.file);
+        portable.diagnostics.push_back(stored);
+    }
+
+    // The .pen first: an entry is visible only once its .result exists
+    uint64_t addedBytes = 0;
+    if (!result.compiledOutput.empty()) {
+        fs::path compiledPath = resolvePath(fs::u8path(result.compiledOutput)).lexically_normal();
+        MappedFile compiled;
+        if (!compiled.open(compiledPath) || !writeFileAtomically(entryPath(key, ".pen"), compiled.view())) {
+            return false;
+        }
+        portable.compiledOutput = toPortable(compiledPath.u8string(), baseDirectory);
+        addedBytes += compiled.view().size();
+    }
+
+    std::string encoded;
+    encodeCompilationResult(encoded, portable);
+    if (!writeFileAtomically(resultPath, encoded)) {
+        return false;
+    }
+    addedBytes += encoded.size();
+
+    // Rewriting an existing key counts its bytes twice, which only brings
+    // the next walk forward
+    bool overCap = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.inserts++;
+        if (m_maxBytes != 0) {
+            m_trackedBytes += addedBytes;
+            overCap = !m_trackedBytesKnown || m_trackedBytes > m_maxBytes;
+        }
+    }
+    if (overCap) {
+        evict();
+    }
+    return true;
+}
+
+void ResultStore::evict() {
+    if (m_maxBytes == 0) {
+        return;
+    }
+
+    struct Entry {
+        fs::file_time_type lastUsed = fs::file_time_type::min();
+        uint64_t bytes = 0;
+        std::vector<fs::path> files;
+        bool complete = false;      // Has its .result
+    };
+
+    // One pass over the objects; a .pen without its .result (a writer
+    // that died, or one still writing) keeps the .pen's own time
+    std::map<std::string, Entry> entries;
+    uint64_t totalBytes = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(m_directory / "objects", ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code fileError;
+        if (!it->is_regular_file(fileError)) continue;
+        fs::path path = it->path();
+        std::string extension = path.extension().string();
+        if (extension != ".result" && extension != ".pen") continue;
+
+        uint64_t bytes = static_cast<uint64_t>(it->file_size(fileError));
+        fs::file_time_type time = it->last_write_time(fileError);
+        if (fileError) continue;
+
+        Entry& entry = entries[path.stem().string()];
+        entry.bytes += bytes;
+        entry.files.push_back(path);
+        if (extension == ".result") {
+            entry.complete = true;
+            entry.lastUsed = time;
+        } else if (!entry.complete) {
+            entry.lastUsed = std::max(entry.lastUsed, time);
+        }
+        totalBytes += bytes;
+    }
+    if (totalBytes <= m_maxBytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_trackedBytes = totalBytes;
+        m_trackedBytesKnown = true;
+        return;
+    }
+
+    std::vector<const Entry*> byAge;
+    for (const auto& item : entries) byAge.push_back(&item.second);
+    std::sort(byAge.begin(), byAge.end(), [](const Entry* a, const Entry* b) { return a->lastUsed < b->lastUsed; });
+
+    uint64_t target = m_maxBytes - m_maxBytes / 10;
+    long long evictions = 0;
+    uint64_t evictedBytes = 0;
+    for (const Entry* entry : byAge) {
+        if (totalBytes <= target) break;
+
+        // The .result goes first, so the entry stops being a hit at once
+        std::vector<fs::path> files = entry->files;
+        std::sort(files.begin(), files.end(), [](const fs::path& a, const fs::path& b) {
+            return (a.extension() == ".result") > (b.extension() == ".result");
+        });
+        for (const auto& file : files) {
+            std::error_code removeError;
+            fs::remove(file, removeError);
+        }
+        totalBytes -= entry->bytes;
+        evictedBytes += entry->bytes;
+        evictions++;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.evictions += evictions;
+    m_stats.evictedBytes += evictedBytes;
+    m_trackedBytes = totalBytes;
+    m_trackedBytesKnown = true;
+}
+
+ResultStoreStats ResultStore::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+ResultStoreStats ResultStore::readTotals() const {
+    ResultStoreStats totals = getStats();
+
+    std::ifstream log(m_directory / "stats.log", std::ios::binary);
+    long long hits, misses, inserts, evictions;
+    uint64_t evictedBytes;
+    while (log >> hits >> misses >> inserts >> evictions >> evictedBytes) {
+        totals.hits += hits;
+        totals.misses += misses;
+        totals.inserts += inserts;
+        totals.evictions += evictions;
+        totals.evictedBytes += evictedBytes;
+    }
+
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(m_directory / "objects", ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code fileError;
+        if (!it->is_regular_file(fileError)) continue;
+        std::string extension = it->path().extension().string();
+        if (extension == ".result") {
+            totals.entryCount++;
+        } else if (extension != ".pen") {
+            continue;
+        }
+        totals.totalBytes += static_cast<uint64_t>(it->file_size(fileError));
+    }
+    return totals;
+}
+
+} // namespace CSProCompiler
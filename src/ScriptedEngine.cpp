@@ -0,0 +1,288 @@
+/*
+ * ScriptedEngine.cpp - Stand-in compiler engine driven by markers in the sources
+ */
+
+#include "../include/ScriptedEngine.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/JsonValue.h"
+#include "../include/PhaseTiming.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    struct Marker {
+        std::string_view keyword;
+        DiagnosticMessage::Severity severity;
+    };
+
+    const Marker Markers[] = {
+        { "@error", DiagnosticMessage::Severity::Error },
+        { "@warning", DiagnosticMessage::Severity::Warning },
+        { "@info", DiagnosticMessage::Severity::Info },
+    };
+
+    std::string_view trimmed(std::string_view text) {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+        return text;
+    }
+
+    bool readFile(const fs::path& path, std::string& text) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+        return true;
+    }
+
+    // "PROC NAME" at the start of a line, case-insensitively
+    bool parseProcName(std::string_view line, std::string& procName) {
+        line = trimmed(line);
+        if (line.size() < 5 || (line[4] != ' ' && line[4] != '\t')) {
+            return false;
+        }
+        for (size_t i = 0; i < 4; i++) {
+            if (std::toupper(static_cast<unsigned char>(line[i])) != "PROC"[i]) {
+                return false;
+            }
+        }
+        std::string_view name = trimmed(line.substr(5));
+        size_t end = 0;
+        while (end < name.size() && (std::isalnum(static_cast<unsigned char>(name[end])) || name[end] == '_')) end++;
+        procName.assign(name.substr(0, end));
+        return !procName.empty();
+    }
+
+    // Lines [firstLine, firstLine + lineCount) of text
+    std::string_view lineRange(std::string_view text, int firstLine, int lineCount) {
+        size_t start = 0;
+        for (int line = 1; line < firstLine && start != std::string_view::npos; line++) {
+            start = text.find('\n', start);
+            if (start != std::string_view::npos) start++;
+        }
+        if (start == std::string_view::npos) {
+            return std::string_view();
+        }
+        size_t end = start;
+        for (int line = 0; line < lineCount && end != std::string_view::npos; line++) {
+            end = text.find('\n', end);
+            if (end != std::string_view::npos) end++;
+        }
+        return text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+    }
+
+    // A CSPro 8 dictionary as parsed JSON; older text dictionaries are
+    // accepted without a document
+    struct ParsedDictionary {
+        JsonValue document;
+    };
+
+    size_t approximateBytes(const JsonValue& value) {
+        size_t bytes = sizeof(JsonValue) + value.asString().capacity();
+        bytes += (value.items().capacity() - value.items().size()) * sizeof(JsonValue);
+        for (const auto& item : value.items()) {
+            bytes += approximateBytes(item);
+        }
+        for (const auto& [name, member] : value.members()) {
+            bytes += sizeof(name) + name.capacity() + approximateBytes(member);
+        }
+        return bytes;
+    }
+
+    std::shared_ptr<const ParsedDictionary> parseDictionary(const fs::path&, std::string_view text, size_t& bytes) {
+        auto dictionary = std::make_shared<ParsedDictionary>();
+        size_t start = text.find_first_not_of(" \t\r\n\xEF\xBB\xBF");
+        if (start != std::string_view::npos && text[start] == '{') {
+            // Throws JsonParseError on a damaged dictionary
+            dictionary->document = JsonValue::parse(text);
+        }
+        bytes = sizeof(ParsedDictionary) + approximateBytes(dictionary->document);
+        return dictionary;
+    }
+
+    void scanSource(const std::string& file, std::string_view text, CompilationResult& result, int firstLine = 1) {
+        std::string procName;
+        int lineNumber = firstLine - 1;
+
+        while (!text.empty()) {
+            size_t lineEnd = text.find('\n');
+            std::string_view line = text.substr(0, lineEnd);
+            text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+            lineNumber++;
+
+            parseProcName(line, procName);
+
+            for (const auto& marker : Markers) {
+                size_t position = line.find(marker.keyword);
+                if (position == std::string_view::npos) {
+                    continue;
+                }
+
+                std::string_view message = line.substr(position + marker.keyword.size());
+                message = trimmed(message.substr(0, message.find('}')));
+
+                result.diagnostics.push_back({ file, lineNumber, static_cast<int>(position) + 1,
+                                               message.empty() ? marker.keyword.substr(1) : message,
+                                               procName, marker.severity });
+                if (marker.severity == DiagnosticMessage::Severity::Error) {
+                    result.errorCount++;
+                } else if (marker.severity == DiagnosticMessage::Severity::Warning) {
+                    result.warningCount++;
+                }
+            }
+        }
+    }
+}
+
+ScriptedEngine::ScriptedEngine(int compileDelayMs, SharedObjectCache* dictionaryCache)
+    : m_compileDelayMs(compileDelayMs)
+    , m_dictionaryCache(dictionaryCache)
+    , m_initialized(false)
+    , m_compileCount(0)
+    , m_compiledUnitCount(0)
+{}
+
+bool ScriptedEngine::initialize() {
+    m_initialized = true;
+    return true;
+}
+
+void ScriptedEngine::shutdown() {
+    m_initialized = false;
+}
+
+CompilationResult ScriptedEngine::compile(const CompilerOptions& options) {
+    CompilationResult result;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    m_compileCount++;
+
+    std::vector<fs::path> inputs = discoverApplicationInputs(resolveInputFile(options));
+    if (inputs.empty()) {
+        result.diagnostics.push_back({ options.inputFile, 0, 0, "Failed to open application", "", DiagnosticMessage::Severity::Error });
+        result.errorCount = 1;
+        return result;
+    }
+
+    PhaseRecorder phases(result.phases);
+    if (m_compileDelayMs > 0) {
+        PhaseScope phase(phases, "full-compile");
+        options.cancellation.sleepFor(std::chrono::milliseconds(m_compileDelayMs));
+    }
+    if (options.cancellation.isCancelled()) {
+        result.cancelled = true;
+        return result;
+    }
+
+    PhaseScope dictionaryPhase(phases, "load-dictionaries");
+    for (const auto& input : inputs) {
+        if (input.extension() == ".dcf" && !loadDictionary(input)) {
+            result.diagnostics.push_back({ input.u8string(), 0, 0, "Invalid dictionary", "", DiagnosticMessage::Severity::Error });
+            result.errorCount++;
+        }
+    }
+    dictionaryPhase.end();
+
+    PhaseScope scanPhase(phases, "scan-markers");
+    std::string text;
+    for (const auto& input : inputs) {
+        std::string file = input.u8string();
+        auto overlay = options.sourceOverlays.find(file);
+        if (overlay != options.sourceOverlays.end()) {
+            scanSource(file, overlay->second, result);
+        } else if (readFile(input, text)) {
+            scanSource(file, text, result);
+        }
+    }
+    scanPhase.end();
+
+    result.success = (result.errorCount == 0);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    result.compilationTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    return result;
+}
+
+bool ScriptedEngine::loadDictionary(const fs::path& file) const {
+    if (m_dictionaryCache != nullptr) {
+        return m_dictionaryCache->get<ParsedDictionary>(file, parseDictionary) != nullptr;
+    }
+
+    std::string text;
+    size_t bytes;
+    try {
+        return readFile(file, text) && parseDictionary(file, text, bytes) != nullptr;
+    }
+    catch (const JsonParseError&) {
+        return false;
+    }
+}
+
+CompilationResult ScriptedEngine::compileUnits(const CompilerOptions& options, const std::vector<LogicUnit>& units) {
+    CompilationResult result;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    m_compileCount++;
+    m_compiledUnitCount += static_cast<long long>(units.size());
+
+    // Each file is read once; the simulated cost is the units' share of it
+    std::map<std::string, std::string> diskTexts;
+    std::map<std::string, std::string_view> fileTexts;
+    std::vector<std::string_view> unitTexts;
+    size_t unitBytes = 0;
+    size_t totalBytes = 0;
+    for (const auto& unit : units) {
+        auto known = fileTexts.find(unit.file);
+        if (known == fileTexts.end()) {
+            std::string_view text;
+            auto overlay = options.sourceOverlays.find(unit.file);
+            if (overlay != options.sourceOverlays.end()) {
+                text = overlay->second;
+            } else {
+                std::string& contents = diskTexts[unit.file];
+                readFile(fs::u8path(unit.file), contents);
+                text = contents;
+            }
+            known = fileTexts.emplace(unit.file, text).first;
+            totalBytes += text.size();
+        }
+        unitTexts.push_back(lineRange(known->second, unit.startLine, unit.lineCount));
+        unitBytes += unitTexts.back().size();
+    }
+
+    PhaseRecorder phases(result.phases);
+    if (m_compileDelayMs > 0 && totalBytes > 0) {
+        PhaseScope phase(phases, "unit-compile");
+        double share = std::min(1.0, static_cast<double>(unitBytes) / static_cast<double>(totalBytes));
+        options.cancellation.sleepFor(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(m_compileDelayMs * share)));
+    }
+    if (options.cancellation.isCancelled()) {
+        result.cancelled = true;
+        return result;
+    }
+
+    PhaseScope scanPhase(phases, "scan-markers");
+    for (size_t i = 0; i < units.size(); i++) {
+        scanSource(units[i].file, unitTexts[i], result, units[i].startLine);
+    }
+    scanPhase.end();
+
+    result.success = (result.errorCount == 0);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    result.compilationTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    return result;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,161 @@
+/*
+ * SharedObjectCache.cpp - Parsed input files shared between compiles
+ */
+
+#include "../include/SharedObjectCache.h"
+#include "../include/ContentHash.h"
+#include "../include/MappedFile.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+SharedObjectCache::SharedObjectCache(size_t maxBytes)
+    : m_maxBytes(maxBytes)
+    , m_useClock(0)
+{}
+
+std::shared_ptr<const void> SharedObjectCache::getObject(const fs::path& file, std::type_index type, const ObjectLoader& load) {
+    // Hashing the mapped file is far cheaper than parsing it
+    fs::path path = resolvePath(file).lexically_normal();
+    MappedFile contents;
+    if (!contents.open(path)) {
+        return nullptr;
+    }
+    Key key(path.u8string(), hash64(contents.view()), type);
+
+    std::promise<std::shared_ptr<const void>> loading;
+    std::shared_future<std::shared_ptr<const void>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_entries.find(key);
+        if (found != m_entries.end()) {
+            found->second.lastUse = ++m_useClock;
+            if (found->second.loaded) {
+                m_stats.hits++;
+                return found->second.object.get();
+            }
+            pending = found->second.object;
+        } else {
+            Entry& entry = m_entries[key];
+            entry.object = loading.get_future().share();
+            entry.lastUse = ++m_useClock;
+            m_stats.misses++;
+        }
+    }
+
+    // Another thread is loading this entry
+    if (pending.valid()) {
+        std::shared_ptr<const void> object = pending.get();
+        if (object) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.hits++;
+        }
+        return object;
+    }
+
+    size_t bytes = 0;
+    std::shared_ptr<const void> object;
+    try {
+        object = load(path, contents.view(), bytes);
+    }
+    catch (...) {
+        object = nullptr;
+    }
+    loading.set_value(object);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_entries.find(key);
+    if (!object) {
+        // Not kept, so a fixed file is loaded again
+        m_stats.failedLoads++;
+        if (found != m_entries.end() && !found->second.loaded) {
+            m_entries.erase(found);
+        }
+        return nullptr;
+    }
+    if (found != m_entries.end() && !found->second.loaded) {
+        found->second.bytes = bytes;
+        found->second.loaded = true;
+        m_stats.bytes += bytes;
+        m_stats.peakBytes = std::max(m_stats.peakBytes, m_stats.bytes);
+        evictLocked();
+    }
+    return object;
+}
+
+void SharedObjectCache::evictLocked() {
+    if (m_maxBytes == 0 || m_stats.bytes <= m_maxBytes) {
+        return;
+    }
+
+    std::vector<std::map<Key, Entry>::iterator> byAge;
+    for (auto entry = m_entries.begin(); entry != m_entries.end(); ++entry) {
+        if (entry->second.loaded) byAge.push_back(entry);
+    }
+    std::sort(byAge.begin(), byAge.end(), [](const auto& a, const auto& b) {
+        return a->second.lastUse < b->second.lastUse;
+    });
+
+    // The newest entry stays even when it alone is over the cap
+    for (size_t i = 0; i + 1 < byAge.size() && m_stats.bytes > m_maxBytes; i++) {
+        m_stats.bytes -= byAge[i]->second.bytes;
+        m_stats.evictions++;
+        m_entries.erase(byAge[i]);
+    }
+}
+
+void SharedObjectCache::invalidate(const fs::path& file) {
+    std::string path = resolvePath(file).lexically_normal().u8string();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Entries in the middle of a load are left to finish; their key has the old digest anyway
+    for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+        if (entry->second.loaded && std::get<0>(entry->first) == path) {
+            m_stats.bytes -= entry->second.bytes;
+            m_stats.invalidations++;
+            entry = m_entries.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+}
+
+void SharedObjectCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+        if (entry->second.loaded) {
+            m_stats.bytes -= entry->second.bytes;
+            m_stats.invalidations++;
+            entry = m_entries.erase(entry);
+        } else {
+            ++entry;
+        }
+    }
+}
+
+void SharedObjectCache::setMaxBytes(size_t maxBytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxBytes = maxBytes;
+    evictLocked();
+}
+
+SharedObjectCacheStats SharedObjectCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SharedObjectCacheStats stats = m_stats;
+    stats.entryCount = 0;
+    for (const auto& entry : m_entries) {
+        if (entry.second.loaded) stats.entryCount++;
+    }
+    return stats;
+}
+
+SharedObjectCache& sharedDictionaryCache() {
+    static SharedObjectCache cache;
+    return cache;
+}
+
+} // namespace CSProCompiler
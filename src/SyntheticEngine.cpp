@@ -0,0 +1,172 @@
+/*
+ * SyntheticEngine.cpp - Stand-in compiler engine with generated diagnostics
+ */
+
+#include "../include/SyntheticEngine.h"
+#include "../include/DiagnosticConverter.h"
+#include "../include/PhaseTiming.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace CSProCompiler {
+
+namespace {
+    // Texts modeled on CSProDesigner.mgf; some carry non-ASCII characters
+    // so the UTF-8 conversion is not all on the ASCII fast path
+    const wchar_t* const MessageTemplates[] = {
+        L"Expecting 'then'",
+        L"Expecting 'endif'",
+        L"Expecting 'do'",
+        L"Expecting right parenthesis ')'",
+        L"Invalid right parenthesis ')' with no matching left parenthesis '('",
+        L"Invalid string expression",
+        L"Variable 'DÉPARTEMENT' is not declared in the dictionary",
+        L"Función desconocida 'calcular_edad'",
+    };
+
+    constexpr size_t MessageTemplateCount = sizeof(MessageTemplates) / sizeof(MessageTemplates[0]);
+
+    uint64_t nextRandom(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+}
+
+SyntheticEngine::SyntheticEngine(SyntheticEngineConfig config)
+    : m_config(config)
+    , m_initialized(false)
+{}
+
+bool SyntheticEngine::initialize() {
+    if (m_initialized) {
+        return true;
+    }
+
+    if (m_config.initializeDelayMs > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_config.initializeDelayMs));
+    }
+
+    generate();
+    m_initialized = true;
+    return true;
+}
+
+void SyntheticEngine::shutdown() {
+    m_unitNames.clear();
+    m_procNames.clear();
+    m_messages.clear();
+    m_initialized = false;
+}
+
+void SyntheticEngine::generate() {
+    uint64_t state = m_config.seed;
+
+    m_unitNames.clear();
+    for (int i = 0; i < std::max(m_config.compilationUnitCount, 1); i++) {
+        m_unitNames.push_back(L"C:/Surveys/Household/Unit" + std::to_wstring(i) + L".apc");
+    }
+
+    m_procNames.clear();
+    for (int i = 0; i < std::max(m_config.procCount, 1); i++) {
+        m_procNames.push_back(L"HH_Q" + std::to_wstring(i));
+    }
+
+    m_messages.clear();
+    m_messages.reserve(static_cast<size_t>(std::max(m_config.diagnosticCount, 0)));
+    for (int i = 0; i < m_config.diagnosticCount; i++) {
+        Message message;
+        message.text = MessageTemplates[nextRandom(state) % MessageTemplateCount];
+        while (message.text.size() < static_cast<size_t>(m_config.messageLength)) {
+            message.text += L" near token '" + std::to_wstring(nextRandom(state) % 10000) + L"'";
+        }
+        message.unitIndex = nextRandom(state) % m_unitNames.size();
+        message.procIndex = nextRandom(state) % m_procNames.size();
+        message.line = 1 + static_cast<int>(nextRandom(state) % 5000);
+        message.column = 1 + static_cast<int>(nextRandom(state) % 120);
+
+        double draw = static_cast<double>(nextRandom(state) >> 11) / static_cast<double>(1ULL << 53);
+        message.severity = draw < m_config.warningRatio ? DiagnosticMessage::Severity::Warning
+                                                        : DiagnosticMessage::Severity::Error;
+        m_messages.push_back(std::move(message));
+    }
+}
+
+CompilationResult SyntheticEngine::compile(const CompilerOptions& options) {
+    return compileInternal(options, nullptr);
+}
+
+CompilationResult SyntheticEngine::compileStreaming(const CompilerOptions& options, IDiagnosticSink& sink) {
+    return compileInternal(options, &sink);
+}
+
+CompilationResult SyntheticEngine::compileInternal(const CompilerOptions& options, IDiagnosticSink* sink) {
+    CompilationResult result;
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    if (!m_initialized && !initialize()) {
+        return result;
+    }
+
+    PhaseRecorder phases(result.phases);
+    if (m_config.compileDelayMs > 0) {
+        PhaseScope phase(phases, "full-compile");
+        options.cancellation.sleepFor(std::chrono::milliseconds(m_config.compileDelayMs));
+    }
+    if (options.cancellation.isCancelled()) {
+        result.cancelled = true;
+        return result;
+    }
+
+    // Mirrors the SDK loop in CompilerInterface.cpp
+    PhaseScope convertPhase(phases, "convert-messages");
+    DiagnosticConverter converter(options.inputFile);
+    if (sink == nullptr) {
+        result.diagnostics.reserve(m_messages.size());
+    }
+
+    DiagnosticMessage msg;
+    for (const auto& message : m_messages) {
+        ParserMessageFields fields;
+        fields.formattedText = "Logic - Parser Message";
+        fields.messageText = message.text;
+        fields.procName = m_procNames[message.procIndex];
+        fields.compilationUnitName = m_unitNames[message.unitIndex];
+        fields.line = message.line;
+        fields.column = message.column;
+        fields.severity = message.severity;
+
+        if (message.severity == DiagnosticMessage::Severity::Error) {
+            result.errorCount++;
+        } else {
+            result.warningCount++;
+        }
+
+        converter.convert(fields, msg);
+        if (sink != nullptr) {
+            sink->onDiagnostic(msg);
+        } else {
+            result.diagnostics.push_back(msg);
+        }
+    }
+    convertPhase.end();
+
+    result.success = (result.errorCount == 0);
+    if (result.success && !options.checkSyntaxOnly) {
+        std::filesystem::path outputPath = std::filesystem::u8path(options.inputFile);
+        outputPath.replace_extension(".pen");
+        if (!options.outputDirectory.empty()) {
+            outputPath = std::filesystem::u8path(options.outputDirectory) / outputPath.filename();
+        }
+        result.compiledOutput = outputPath.u8string();
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    result.compilationTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    return result;
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,123 @@
+/*
+ * TextEncoding.cpp - UTF-8 <-> wide string conversion
+ */
+
+#include "../include/TextEncoding.h"
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr char32_t ReplacementCharacter = 0xFFFD;
+
+    inline void encodeCodePoint(std::string& out, char32_t codePoint) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    inline void appendWideCodePoint(std::wstring& out, char32_t codePoint) {
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (codePoint >= 0x10000) {
+                codePoint -= 0x10000;
+                out += static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+                out += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+                return;
+            }
+        }
+        out += static_cast<wchar_t>(codePoint);
+    }
+}
+
+void appendUtf8(std::string& out, std::wstring_view text) {
+    out.reserve(out.size() + text.size());
+
+    for (size_t i = 0; i < text.size(); i++) {
+        char32_t codePoint = static_cast<char32_t>(text[i]);
+
+        // Plain ASCII dominates logic messages and names
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+            continue;
+        }
+
+        if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+            if (i + 1 < text.size()) {
+                char32_t low = static_cast<char32_t>(text[i + 1]);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    i++;
+                    encodeCodePoint(out, codePoint);
+                    continue;
+                }
+            }
+            codePoint = ReplacementCharacter;
+        }
+        else if ((codePoint >= 0xDC00 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF) {
+            codePoint = ReplacementCharacter;
+        }
+
+        encodeCodePoint(out, codePoint);
+    }
+}
+
+void appendWide(std::wstring& out, std::string_view utf8) {
+    out.reserve(out.size() + utf8.size());
+
+    size_t i = 0;
+    while (i < utf8.size()) {
+        unsigned char lead = static_cast<unsigned char>(utf8[i]);
+
+        if (lead < 0x80) {
+            out += static_cast<wchar_t>(lead);
+            i++;
+            continue;
+        }
+
+        size_t length;
+        char32_t codePoint;
+        if ((lead & 0xE0) == 0xC0) { length = 2; codePoint = lead & 0x1F; }
+        else if ((lead & 0xF0) == 0xE0) { length = 3; codePoint = lead & 0x0F; }
+        else if ((lead & 0xF8) == 0xF0) { length = 4; codePoint = lead & 0x07; }
+        else {
+            appendWideCodePoint(out, ReplacementCharacter);
+            i++;
+            continue;
+        }
+
+        bool valid = i + length <= utf8.size();
+        for (size_t k = 1; valid && k < length; k++) {
+            unsigned char continuation = static_cast<unsigned char>(utf8[i + k]);
+            if ((continuation & 0xC0) != 0x80) {
+                valid = false;
+            } else {
+                codePoint = (codePoint << 6) | (continuation & 0x3F);
+            }
+        }
+
+        // Reject overlong forms, surrogates and out-of-range values
+        static const char32_t minimumForLength[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if (!valid || codePoint < minimumForLength[length] || codePoint > 0x10FFFF ||
+            (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            appendWideCodePoint(out, ReplacementCharacter);
+            i++;
+            continue;
+        }
+
+        appendWideCodePoint(out, codePoint);
+        i += length;
+    }
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,56 @@
+/*
+ * WorkingDirectory.cpp - Path resolution that does not depend on the CWD
+ */
+
+#include "../include/WorkingDirectory.h"
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    std::mutex& workingDirectoryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+}
+
+const fs::path& initialWorkingDirectory() {
+    static const fs::path directory = []() {
+        std::error_code ec;
+        fs::path current = fs::current_path(ec);
+        return ec ? fs::path() : current;
+    }();
+    return directory;
+}
+
+fs::path resolvePath(const fs::path& path, const fs::path& baseDirectory) {
+    if (path.is_absolute()) {
+        return path.lexically_normal();
+    }
+    fs::path base = baseDirectory.is_absolute() ? baseDirectory : initialWorkingDirectory() / baseDirectory;
+    return (base / path).lexically_normal();
+}
+
+fs::path resolveInputFile(const CompilerOptions& options) {
+    return resolvePath(fs::u8path(options.inputFile), fs::u8path(options.baseDirectory));
+}
+
+ScopedWorkingDirectory::ScopedWorkingDirectory(const fs::path& directory)
+    : m_lock(workingDirectoryMutex())
+    , m_previous(initialWorkingDirectory())
+{
+    std::error_code ec;
+    fs::path current = fs::current_path(ec);
+    if (!ec) {
+        m_previous = current;
+    }
+    fs::current_path(resolvePath(directory));
+}
+
+ScopedWorkingDirectory::~ScopedWorkingDirectory() {
+    std::error_code ec;
+    fs::current_path(m_previous, ec);
+}
+
+} // namespace CSProCompiler
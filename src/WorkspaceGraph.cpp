@@ -0,0 +1,277 @@
+/*
+ * WorkspaceGraph.cpp - Which applications of a workspace depend on which files
+ */
+
+#include "../include/WorkspaceGraph.h"
+#include "../include/ApplicationInputs.h"
+#include "../include/ContentHash.h"
+#include "../include/FileWriter.h"
+#include "../include/MappedFile.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+namespace CSProCompiler {
+
+namespace {
+    constexpr char GraphMagic[4] = { 'C', 'W', 'S', 'G' };
+    constexpr uint32_t GraphFormatVersion = 1;
+
+    // Fields are in host byte order, like the other binary state files:
+    // the header, then every file, then every application as indexes
+    // into the files
+    struct GraphHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t fileCount;
+        uint32_t applicationCount;
+    };
+
+    struct FileEntry {
+        uint64_t size;
+        int64_t time;
+        uint64_t hash;
+        uint32_t pathLength;        // UTF-8 path follows
+        uint32_t reserved;
+    };
+
+    struct ApplicationEntry {
+        uint32_t nameLength;        // Name follows, then inputCount file indexes
+        uint32_t inputCount;
+    };
+
+    static_assert(sizeof(GraphHeader) == 16, "graph header must not be padded");
+    static_assert(sizeof(FileEntry) == 32, "graph file entries must not be padded");
+    static_assert(sizeof(ApplicationEntry) == 8, "graph application entries must not be padded");
+
+    bool isApplicationFile(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return ext == ".ent" || ext == ".bch" || ext == ".pff";
+    }
+
+    // Reads count bytes from the front of data
+    bool take(std::string_view& data, void* out, size_t count) {
+        if (data.size() < count) return false;
+        std::memcpy(out, data.data(), count);
+        data.remove_prefix(count);
+        return true;
+    }
+}
+
+fs::path WorkspaceGraph::defaultGraphPath() {
+    return initialWorkingDirectory() / ".csprocompile" / "workspace.graph";
+}
+
+bool WorkspaceGraph::load(const fs::path& graphFile) {
+    m_files.clear();
+    m_applications.clear();
+    m_changedFiles.clear();
+
+    MappedFile file;
+    if (!file.open(graphFile)) {
+        return false;
+    }
+    std::string_view data = file.view();
+
+    GraphHeader header;
+    if (!take(data, &header, sizeof(header)) || std::memcmp(header.magic, GraphMagic, sizeof(header.magic)) != 0 ||
+        header.version != GraphFormatVersion) {
+        return false;
+    }
+
+    std::vector<fs::path> paths;
+    std::map<fs::path, FileRecord> files;
+    for (uint32_t i = 0; i < header.fileCount; i++) {
+        FileEntry entry;
+        if (!take(data, &entry, sizeof(entry)) || data.size() < entry.pathLength) {
+            return false;
+        }
+        paths.push_back(fs::u8path(data.substr(0, entry.pathLength)));
+        data.remove_prefix(entry.pathLength);
+        files[paths.back()] = { entry.size, entry.time, entry.hash };
+    }
+
+    std::map<fs::path, Application> applications;
+    for (uint32_t i = 0; i < header.applicationCount; i++) {
+        ApplicationEntry entry;
+        if (!take(data, &entry, sizeof(entry)) || data.size() < entry.nameLength || entry.inputCount == 0) {
+            return false;
+        }
+        Application application;
+        application.name = std::string(data.substr(0, entry.nameLength));
+        data.remove_prefix(entry.nameLength);
+        for (uint32_t j = 0; j < entry.inputCount; j++) {
+            uint32_t index;
+            if (!take(data, &index, sizeof(index)) || index >= paths.size()) {
+                return false;
+            }
+            application.inputs.push_back(paths[index]);
+        }
+        fs::path key = application.inputs.front();
+        applications[key] = std::move(application);
+    }
+
+    m_files = std::move(files);
+    m_applications = std::move(applications);
+    return true;
+}
+
+bool WorkspaceGraph::save(const fs::path& graphFile) const {
+    GraphHeader header = {};
+    std::memcpy(header.magic, GraphMagic, sizeof(header.magic));
+    header.version = GraphFormatVersion;
+    header.fileCount = static_cast<uint32_t>(m_files.size());
+    header.applicationCount = static_cast<uint32_t>(m_applications.size());
+
+    std::string image(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::map<fs::path, uint32_t> indexes;
+    for (const auto& [path, record] : m_files) {
+        std::string name = path.u8string();
+        FileEntry entry = { record.size, record.time, record.hash, static_cast<uint32_t>(name.size()), 0 };
+        image.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        image.append(name);
+        indexes.emplace(path, static_cast<uint32_t>(indexes.size()));
+    }
+    for (const auto& [path, application] : m_applications) {
+        ApplicationEntry entry = { static_cast<uint32_t>(application.name.size()), static_cast<uint32_t>(application.inputs.size()) };
+        image.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        image.append(application.name);
+        for (const auto& input : application.inputs) {
+            uint32_t index = indexes.at(input);
+            image.append(reinterpret_cast<const char*>(&index), sizeof(index));
+        }
+    }
+
+    std::error_code ec;
+    fs::create_directories(graphFile.parent_path(), ec);
+    return writeFileAtomically(graphFile, image);
+}
+
+WorkspaceScanStats WorkspaceGraph::refresh(const std::vector<std::string>& applicationFiles) {
+    WorkspaceScanStats stats;
+    std::map<fs::path, FileRecord> files;
+    std::set<fs::path> changed;
+    std::set<fs::path> missing;
+
+    // Stats each file once per refresh, shared dictionaries included;
+    // false when the file is gone
+    auto visit = [&](const fs::path& path) -> bool {
+        if (files.count(path) > 0) return true;
+        if (missing.count(path) > 0) return false;
+
+        std::error_code ec;
+        uintmax_t size = fs::file_size(path, ec);
+        fs::file_time_type time = ec ? fs::file_time_type() : fs::last_write_time(path, ec);
+        if (ec) {
+            missing.insert(path);
+            return false;
+        }
+
+        FileRecord record;
+        record.size = static_cast<uint64_t>(size);
+        record.time = static_cast<int64_t>(time.time_since_epoch().count());
+
+        auto known = m_files.find(path);
+        if (known != m_files.end() && known->second.size == record.size && known->second.time == record.time) {
+            record.hash = known->second.hash;
+        } else {
+            if (!hashFile(path, record.hash)) {
+                missing.insert(path);
+                return false;
+            }
+            stats.hashedFileCount++;
+            if (known == m_files.end() || known->second.hash != record.hash || known->second.size != record.size) {
+                changed.insert(path);
+            }
+        }
+        files[path] = record;
+        return true;
+    };
+
+    std::map<fs::path, Application> applications;
+    for (const auto& name : applicationFiles) {
+        fs::path path = resolvePath(fs::u8path(name)).lexically_normal();
+        if (applications.count(path) > 0) continue;
+
+        // An input that disappeared changes the application as much as an edit
+        auto known = m_applications.find(path);
+        bool rediscover = known == m_applications.end();
+        bool lostInput = false;
+        if (!rediscover) {
+            for (const auto& input : known->second.inputs) {
+                if (!visit(input)) {
+                    lostInput = true;
+                } else if (isApplicationFile(input) && changed.count(input) > 0) {
+                    rediscover = true;
+                }
+            }
+            rediscover = rediscover || lostInput;
+        }
+
+        Application application;
+        application.name = name;
+        if (rediscover) {
+            application.inputs = discoverApplicationInputs(path);
+            stats.rediscoveredCount++;
+        } else {
+            application.inputs = known->second.inputs;
+        }
+
+        // Inputs that cannot be read drop out; a new application counts as changed throughout
+        std::vector<fs::path> inputs;
+        for (const auto& input : application.inputs) {
+            if (visit(input)) inputs.push_back(input);
+        }
+        if (inputs.empty() || inputs.front() != path) {
+            continue;
+        }
+        if (known == m_applications.end() || lostInput) {
+            changed.insert(path);
+        }
+        application.inputs = std::move(inputs);
+        applications[path] = std::move(application);
+    }
+
+    // Files no longer used by any application are forgotten
+    std::map<fs::path, FileRecord> used;
+    for (const auto& [path, application] : applications) {
+        for (const auto& input : application.inputs) {
+            used.insert(*files.find(input));
+        }
+    }
+
+    m_files = std::move(used);
+    m_applications = std::move(applications);
+    m_changedFiles = std::move(changed);
+
+    stats.applicationCount = static_cast<int>(m_applications.size());
+    stats.changedFileCount = static_cast<int>(m_changedFiles.size());
+    return stats;
+}
+
+std::vector<std::string> WorkspaceGraph::affectedBy(const std::vector<fs::path>& files) const {
+    std::set<fs::path> targets;
+    for (const auto& file : files) {
+        targets.insert(resolvePath(file).lexically_normal());
+    }
+
+    std::vector<std::string> affected;
+    for (const auto& [path, application] : m_applications) {
+        if (std::any_of(application.inputs.begin(), application.inputs.end(),
+                        [&targets](const fs::path& input) { return targets.count(input) > 0; })) {
+            affected.push_back(application.name);
+        }
+    }
+    std::sort(affected.begin(), affected.end());
+    return affected;
+}
+
+std::vector<std::string> WorkspaceGraph::changedApplications() const {
+    return affectedBy(std::vector<fs::path>(m_changedFiles.begin(), m_changedFiles.end()));
+}
+
+} // namespace CSProCompiler
@@ -0,0 +1,147 @@
+/*
+ * ConcurrencyTests.cpp - Engines compiling in parallel on separate threads,
+ * and the working directory guard they share
+ */
+
+#include "TestHarness.h"
+#include "../include/ScriptedEngine.h"
+#include "../include/WorkingDirectory.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace CSProCompiler;
+using namespace CSProCompiler::Testing;
+namespace fs = std::filesystem;
+
+namespace {
+    // Application a carries a + 1 warnings, so any cross-talk between threads shows
+    std::vector<fs::path> writeApplications(const fs::path& directory, int count) {
+        std::vector<fs::path> directories;
+        for (int a = 0; a < count; a++) {
+            fs::path application = directory / ("app" + std::to_string(a));
+            fs::create_directories(application);
+            std::string logic = "PROC GLOBAL\n";
+            for (int w = 0; w <= a; w++) {
+                logic += "{ @warning application " + std::to_string(a) + " }\n";
+            }
+            std::ofstream(application / "App.apc", std::ios::binary) << logic;
+            std::ofstream(application / "App.ent", std::ios::binary) << "[Files]\nApplication=App.apc\n";
+            directories.push_back(application);
+        }
+        return directories;
+    }
+
+    int countWarningMarkers(std::istream& logic) {
+        std::string line;
+        int warnings = 0;
+        while (std::getline(logic, line)) {
+            if (line.find("@warning") != std::string::npos) warnings++;
+        }
+        return warnings;
+    }
+}
+
+TEST_CASE("parallel engines compile by relative path without cross-talk") {
+    TemporaryDirectory directory("csprocompile-concurrency-test");
+    constexpr int applications = 8;
+    constexpr int compilesPerThread = 32;
+    std::vector<fs::path> directories = writeApplications(directory.path(), applications);
+    int threadCount = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+
+    std::atomic<int> mismatches(0);
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            ScriptedEngine engine;
+            if (!engine.initialize()) {
+                failures++;
+                return;
+            }
+            for (int i = 0; i < compilesPerThread; i++) {
+                int a = (t + i) % applications;
+                CompilerOptions options;
+                options.inputFile = "App.ent";
+                options.baseDirectory = directories[a].u8string();
+                CompilationResult result = engine.compile(options);
+                if (result.warningCount != a + 1) mismatches++;
+
+                // The SDK path reads relative files under the guard
+                ScopedWorkingDirectory workingDirectory(directories[a]);
+                std::ifstream logic("App.apc");
+                if (countWarningMarkers(logic) != a + 1) mismatches++;
+            }
+            engine.shutdown();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(failures == 0);
+    CHECK(mismatches == 0);
+    CHECK(fs::current_path() == initialWorkingDirectory());
+}
+
+TEST_CASE("the guard restores the working directory when an exception passes") {
+    TemporaryDirectory directory("csprocompile-concurrency-test");
+    fs::path before = fs::current_path();
+    try {
+        ScopedWorkingDirectory workingDirectory(directory.path());
+        CHECK(fs::equivalent(fs::current_path(), directory.path()));
+        throw std::runtime_error("engine failure");
+    }
+    catch (const std::runtime_error&) {
+    }
+    CHECK(fs::current_path() == before);
+
+    // A folder that cannot be entered throws without changing anything or
+    // keeping the lock
+    bool threw = false;
+    try {
+        ScopedWorkingDirectory workingDirectory(directory.path() / "missing");
+    }
+    catch (const fs::filesystem_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(fs::current_path() == before);
+    {
+        ScopedWorkingDirectory workingDirectory(directory.path());
+    }
+    CHECK(fs::current_path() == before);
+}
+
+TEST_CASE("relative paths resolve the same while another thread holds the guard") {
+    TemporaryDirectory directory("csprocompile-concurrency-test");
+    fs::path expected = resolvePath("App.ent", directory.path());
+    fs::path expectedInitial = resolvePath("App.ent");
+
+    std::atomic<bool> entered(false);
+    std::atomic<bool> release(false);
+    std::thread holder([&]() {
+        ScopedWorkingDirectory workingDirectory(directory.path());
+        entered = true;
+        while (!release) std::this_thread::yield();
+    });
+    while (!entered) std::this_thread::yield();
+
+    CHECK(resolvePath("App.ent", directory.path()) == expected);
+    CHECK(resolvePath("App.ent") == expectedInitial);
+    CompilerOptions options;
+    options.inputFile = "App.ent";
+    CHECK(resolveInputFile(options) == expectedInitial);
+
+    release = true;
+    holder.join();
+    CHECK(fs::current_path() == initialWorkingDirectory());
+}
+
+int main() {
+    // Captured before any guard changes the working directory
+    initialWorkingDirectory();
+    return runTests();
+}
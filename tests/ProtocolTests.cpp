@@ -0,0 +1,354 @@
+/*
+ * ProtocolTests.cpp - Hostile input on the wire: job and result paths that
+ * leave the batch folder in distributed builds, and damaged or oversized
+ * Language Server Protocol frames
+ */
+
+#include "TestHarness.h"
+#include "../include/DistributedCompiler.h"
+#include "../include/LanguageServer.h"
+#include "../include/ResultCodec.h"
+#include "../include/ScriptedEngine.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace CSProCompiler;
+using namespace CSProCompiler::Testing;
+namespace fs = std::filesystem;
+
+namespace {
+    // Input of a known size generated as it is read, so a frame of more
+    // than a gigabyte costs no memory: head, then fillSize spaces, then tail
+    class GeneratedInput : public std::streambuf {
+    public:
+        GeneratedInput(std::string head, uint64_t fillSize, std::string tail)
+            : m_head(std::move(head)), m_fillSize(fillSize), m_tail(std::move(tail)), m_position(0), m_buffer(1 << 16)
+        {}
+
+    protected:
+        int_type underflow() override {
+            uint64_t total = m_head.size() + m_fillSize + m_tail.size();
+            if (m_position >= total) {
+                return traits_type::eof();
+            }
+            size_t count = 0;
+            while (count < m_buffer.size() && m_position < total) {
+                if (m_position < m_head.size()) {
+                    m_buffer[count] = m_head[static_cast<size_t>(m_position)];
+                } else if (m_position < m_head.size() + m_fillSize) {
+                    size_t run = static_cast<size_t>(std::min<uint64_t>(m_buffer.size() - count,
+                                                                        m_head.size() + m_fillSize - m_position));
+                    std::memset(m_buffer.data() + count, ' ', run);
+                    count += run;
+                    m_position += run;
+                    continue;
+                } else {
+                    m_buffer[count] = m_tail[static_cast<size_t>(m_position - m_head.size() - m_fillSize)];
+                }
+                count++;
+                m_position++;
+            }
+            setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + count);
+            return traits_type::to_int_type(m_buffer[0]);
+        }
+
+    private:
+        std::string m_head;
+        uint64_t m_fillSize;
+        std::string m_tail;
+        uint64_t m_position;
+        std::vector<char> m_buffer;
+    };
+
+    std::string frame(const std::string& body) {
+        return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    const std::string initializeRequest = frame(R"({"jsonrpc":"2.0","id":1,"method":"initialize","params":{}})");
+    const std::string shutdownAndExit = frame(R"({"jsonrpc":"2.0","id":2,"method":"shutdown"})") +
+                                        frame(R"({"jsonrpc":"2.0","method":"exit"})");
+
+    int serveLanguageServer(std::istream& in, std::string& output) {
+        ScriptedEngine engine;
+        LanguageServer server(engine);
+        std::ostringstream out;
+        int exitCode = server.serve(in, out);
+        output = out.str();
+        return exitCode;
+    }
+}
+
+TEST_CASE("an oversized LSP frame is skipped and the stream stays framed") {
+    uint64_t oversized = (uint64_t(1) << 30) + 1;
+    GeneratedInput input("Content-Length: " + std::to_string(oversized) + "\r\n\r\n", oversized,
+                         initializeRequest + shutdownAndExit);
+    std::istream in(&input);
+    std::string output;
+    CHECK(serveLanguageServer(in, output) == 0);
+    CHECK(output.find("-32700") != std::string::npos);
+    CHECK(output.find("Content-Length exceeds") != std::string::npos);
+    CHECK(output.find("\"capabilities\"") != std::string::npos);
+}
+
+TEST_CASE("an LSP length beyond any stream ends the session") {
+    std::istringstream in("Content-Length: 99999999999999999999999\r\n\r\n" + initializeRequest);
+    std::string output;
+    CHECK(serveLanguageServer(in, output) != 0);
+    CHECK(output.find("\"capabilities\"") == std::string::npos);
+}
+
+TEST_CASE("malformed and truncated LSP frames") {
+    // Bodies that are not JSON are answered with a parse error, then serving continues
+    std::istringstream garbage(frame("{\"jsonrpc\":") + frame("\xff\xfe") + initializeRequest + shutdownAndExit);
+    std::string output;
+    CHECK(serveLanguageServer(garbage, output) == 0);
+    CHECK(output.find("-32700") != std::string::npos);
+    CHECK(output.find("\"capabilities\"") != std::string::npos);
+
+    // A body cut short by the end of input is not handled
+    std::string truncated = initializeRequest.substr(0, initializeRequest.size() - 5);
+    std::istringstream cut(truncated);
+    CHECK(serveLanguageServer(cut, output) != 0);
+    CHECK(output.find("\"capabilities\"") == std::string::npos);
+
+    // Headers without a length are ignored
+    std::istringstream headerless("Content-Type: application/vscode-jsonrpc\r\n\r\n" + initializeRequest + shutdownAndExit);
+    CHECK(serveLanguageServer(headerless, output) == 0);
+    CHECK(output.find("\"capabilities\"") != std::string::npos);
+}
+
+TEST_CASE("initialize reports this build's version") {
+    std::istringstream in(initializeRequest + shutdownAndExit);
+    std::string output;
+    CHECK(serveLanguageServer(in, output) == 0);
+    CHECK(output.find(std::string("\"version\":\"") + toolVersion() + "\"") != std::string::npos);
+}
+
+#ifndef _WIN32
+
+namespace {
+    // The distributed build protocol, as documented in DistributedCompiler.h/.cpp
+    constexpr uint32_t HelloMessage = 1;
+    constexpr uint32_t JobMessage = 2;
+    constexpr uint32_t NeedMessage = 3;
+    constexpr uint32_t ResultMessage = 5;
+    constexpr uint32_t FailureMessage = 6;
+
+    struct FrameHeader {
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t length;
+    };
+
+    void appendU32(std::string& data, uint32_t value) { data.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void appendU64(std::string& data, uint64_t value) { data.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void appendText(std::string& data, const std::string& text) { appendU32(data, static_cast<uint32_t>(text.size())); data += text; }
+    void appendBytes(std::string& data, const std::string& bytes) { appendU64(data, bytes.size()); data += bytes; }
+
+    bool sendFrame(int fd, uint32_t type, const std::string& payload) {
+        FrameHeader header = { type, 0, payload.size() };
+        std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+        data += payload;
+        return ::send(fd, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size());
+    }
+
+    bool receiveAll(int fd, char* data, size_t length) {
+        while (length > 0) {
+            ssize_t received = ::recv(fd, data, length, 0);
+            if (received <= 0) return false;
+            data += received;
+            length -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+    bool receiveFrame(int fd, uint32_t& type, std::string& payload) {
+        FrameHeader header;
+        if (!receiveAll(fd, reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        type = header.type;
+        payload.resize(static_cast<size_t>(header.length));
+        return receiveAll(fd, payload.data(), payload.size());
+    }
+
+    std::string hello() {
+        std::string payload;
+        appendU32(payload, 1);
+        return payload;
+    }
+
+    int connectLoopback(int port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    // A listening loopback socket on a free port
+    int listenLoopback(int& port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 1) != 0 ||
+            ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            if (fd >= 0) ::close(fd);
+            return -1;
+        }
+        port = ntohs(address.sin_port);
+        return fd;
+    }
+
+    std::string job(const std::string& application, const std::vector<std::string>& inputs) {
+        std::string payload;
+        appendU32(payload, 0);
+        appendText(payload, application);
+        appendU32(payload, static_cast<uint32_t>(inputs.size()));
+        for (const auto& input : inputs) {
+            appendText(payload, input);
+            appendU64(payload, 1);
+            appendU64(payload, 1);
+        }
+        return payload;
+    }
+
+    // Runs a one-application batch against a stand-in worker that answers
+    // every job with a result whose compiled .pen is to go to compiledOutput
+    CompilationResult runAgainstHostileWorker(const fs::path& application, const std::string& compiledOutput) {
+        int port = 0;
+        int listenFd = listenLoopback(port);
+        if (listenFd < 0) {
+            return CompilationResult();
+        }
+        std::thread worker([&]() {
+            int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0) return;
+            uint32_t type;
+            std::string payload;
+            if (receiveFrame(fd, type, payload) && sendFrame(fd, HelloMessage, hello())) {
+                while (receiveFrame(fd, type, payload) && type == JobMessage) {
+                    std::string need;
+                    appendU32(need, 0);
+                    CompilationResult result;
+                    result.success = true;
+                    result.compiledOutput = compiledOutput;
+                    std::string encoded;
+                    encodeCompilationResult(encoded, result);
+                    std::string reply;
+                    appendBytes(reply, encoded);
+                    appendBytes(reply, "compiled");
+                    if (!sendFrame(fd, NeedMessage, need) || !sendFrame(fd, ResultMessage, reply)) break;
+                }
+            }
+            ::close(fd);
+        });
+
+        DistributedOptions options;
+        options.workers.push_back({ "127.0.0.1", port });
+        options.maxAttempts = 1;
+        options.resultTimeoutSeconds = 30;
+        DistributedCompiler distributed(options);
+        CompileTimeHistory history;
+        BatchReport report = distributed.run({ application.u8string() }, history);
+        worker.join();
+        ::close(listenFd);
+        return report.items.empty() ? CompilationResult() : report.items.front().result;
+    }
+
+    bool hasMessage(const CompilationResult& result, const std::string& text) {
+        for (const auto& diag : result.diagnostics) {
+            if (diag.message.find(text) != std::string_view::npos) return true;
+        }
+        return false;
+    }
+}
+
+TEST_CASE("a build worker rejects job paths outside its tree") {
+    TemporaryDirectory directory("csprocompile-protocol-test");
+    BuildWorker worker([]() { return std::make_unique<ScriptedEngine>(); }, directory.path() / "worker");
+    std::string error;
+    REQUIRE(worker.listen({ "127.0.0.1", 0 }, error));
+    std::thread serving([&]() { worker.serve(); });
+
+    int fd = connectLoopback(worker.getPort());
+    uint32_t type = 0;
+    std::string payload;
+    bool greeted = fd >= 0 && sendFrame(fd, HelloMessage, hello()) && receiveFrame(fd, type, payload) && type == HelloMessage;
+    CHECK(greeted);
+
+    std::string outside = (directory.path() / "outside" / "App.ent").u8string();
+    std::vector<std::pair<std::string, std::vector<std::string>>> hostile = {
+        { "../outside/App.ent", { "../outside/App.ent" } },
+        { "app/../../outside/App.ent", { "app/App.ent" } },
+        { outside, { outside } },
+        { "app/App.ent", { "app/App.ent", "../../outside/App.apc" } },
+        { "app/App.ent", { "app/App.ent", outside } },
+        { "app/App.ent", {} },
+    };
+    for (const auto& [application, inputs] : hostile) {
+        if (!greeted) break;
+        REQUIRE(sendFrame(fd, JobMessage, job(application, inputs)));
+        REQUIRE(receiveFrame(fd, type, payload));
+        CHECK(type == FailureMessage);
+    }
+
+    // A job cut short is malformed too, and the connection stays usable
+    if (greeted) {
+        std::string truncated = job("app/App.ent", { "app/App.ent" });
+        truncated.resize(truncated.size() - 4);
+        REQUIRE(sendFrame(fd, JobMessage, truncated));
+        REQUIRE(receiveFrame(fd, type, payload));
+        CHECK(type == FailureMessage);
+    }
+
+    if (fd >= 0) ::close(fd);
+    worker.stop();
+    serving.join();
+    CHECK(!fs::exists(directory.path() / "outside"));
+    CHECK(worker.getStats().jobs == 0);
+    CHECK(worker.getStats().filesReceived == 0);
+}
+
+TEST_CASE("a coordinator rejects result paths outside the batch folder") {
+    TemporaryDirectory directory("csprocompile-protocol-test");
+    fs::path applicationDirectory = directory.path() / "batch" / "app";
+    fs::create_directories(applicationDirectory);
+    std::ofstream(applicationDirectory / "App.apc", std::ios::binary) << "PROC GLOBAL\n";
+    std::ofstream(applicationDirectory / "App.ent", std::ios::binary) << "[Files]\nApplication=App.apc\n";
+    fs::path application = applicationDirectory / "App.ent";
+
+    fs::path escaped = directory.path() / "escaped.pen";
+    for (const std::string& compiledOutput : { std::string("../../escaped.pen"), std::string("../escaped.pen"), escaped.u8string() }) {
+        CompilationResult result = runAgainstHostileWorker(application, compiledOutput);
+        CHECK(!result.success);
+        CHECK(hasMessage(result, "outside the batch folder"));
+        CHECK(!fs::exists(escaped));
+        CHECK(!fs::exists(directory.path() / "batch" / "escaped.pen"));
+    }
+
+    // The same worker naming a path inside the folder is obeyed
+    CompilationResult result = runAgainstHostileWorker(application, "App.pen");
+    CHECK(result.success);
+    CHECK(fs::exists(applicationDirectory / "App.pen"));
+}
+
+#endif
+
+int main() {
+    return runTests();
+}
@@ -0,0 +1,258 @@
+/*
+ * ResultCodecTests.cpp - Round trips of the binary result encoding, and
+ * damaged encodings in memory and in .result files
+ */
+
+#include "TestHarness.h"
+#include "../include/ResultCache.h"
+#include "../include/ResultCodec.h"
+#include "../include/ResultStore.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+using namespace CSProCompiler;
+using namespace CSProCompiler::Testing;
+namespace fs = std::filesystem;
+
+namespace {
+    CompilationResult makeResult() {
+        CompilationResult result;
+        result.success = false;
+        result.errorCount = 2;
+        result.warningCount = 1;
+        result.compilationTimeMs = 12.5;
+        result.fromCache = true;
+        result.compiledOutput = "/work/Survey/Survey.pen";
+        result.diagnostics.push_back({ "/work/Survey/Survey.apc", 10, 4, "Expecting 'endif'", "Q01", DiagnosticMessage::Severity::Error, 94 });
+        result.diagnostics.push_back({ "/work/Survey/Survey.apc", 22, 1, "Variable not used", "Q02", DiagnosticMessage::Severity::Warning, 0 });
+        result.diagnostics.push_back({ "/work/Survey/Survey.apc", 30, 7, "Expecting 'endif'", "Q01", DiagnosticMessage::Severity::Error, 94 });
+        result.diagnostics.push_back({ "/work/Survey/Médias.apc", 1, 1, "Ünïcode ✓", "", DiagnosticMessage::Severity::Info, 0 });
+        result.phases.push_back({ "compile", 0.0, 12.5, -1 });
+        result.phases.push_back({ "parse", 0.5, 8.0, 0 });
+        return result;
+    }
+
+    bool sameDiagnostic(const DiagnosticView& a, const DiagnosticView& b) {
+        return a.file == b.file && a.line == b.line && a.column == b.column && a.message == b.message &&
+               a.procName == b.procName && a.severity == b.severity && a.messageNumber == b.messageNumber;
+    }
+
+    bool sameResult(const CompilationResult& a, const CompilationResult& b) {
+        if (a.success != b.success || a.errorCount != b.errorCount || a.warningCount != b.warningCount ||
+            a.compilationTimeMs != b.compilationTimeMs || a.fromCache != b.fromCache || a.cancelled != b.cancelled ||
+            a.compiledOutput != b.compiledOutput || a.diagnostics.size() != b.diagnostics.size() ||
+            a.phases.size() != b.phases.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.diagnostics.size(); i++) {
+            if (!sameDiagnostic(a.diagnostics[i], b.diagnostics[i])) return false;
+        }
+        for (size_t i = 0; i < a.phases.size(); i++) {
+            const PhaseSpan& x = a.phases[i];
+            const PhaseSpan& y = b.phases[i];
+            if (x.name != y.name || x.startMs != y.startMs || x.durationMs != y.durationMs || x.parent != y.parent) return false;
+        }
+        return true;
+    }
+
+    // Touches every string a view hands out, as a reader would
+    size_t readEverything(const EncodedResultView& view) {
+        size_t bytes = view.compiledOutput().size();
+        for (size_t i = 0; i < view.diagnosticCount(); i++) {
+            DiagnosticView diag = view.diagnostic(i);
+            bytes += diag.file.size() + diag.message.size() + diag.procName.size();
+        }
+        for (size_t i = 0; i < view.phaseCount(); i++) {
+            bytes += view.phase(i).name.size();
+        }
+        return bytes;
+    }
+
+    std::string readFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const fs::path& path, const std::string& contents) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+    }
+}
+
+TEST_CASE("round trip with and without a checksum") {
+    CompilationResult original = makeResult();
+    for (bool withChecksum : { true, false }) {
+        std::string encoded;
+        encodeCompilationResult(encoded, original, withChecksum);
+        CompilationResult decoded;
+        REQUIRE(decodeCompilationResult(encoded, decoded));
+        CHECK(sameResult(original, decoded));
+    }
+}
+
+TEST_CASE("round trip of an empty and a cancelled result") {
+    CompilationResult empty;
+    empty.success = true;
+    std::string encoded;
+    encodeCompilationResult(encoded, empty);
+    CompilationResult decoded;
+    REQUIRE(decodeCompilationResult(encoded, decoded));
+    CHECK(sameResult(empty, decoded));
+
+    CompilationResult cancelled;
+    cancelled.cancelled = true;
+    encoded.clear();
+    encodeCompilationResult(encoded, cancelled);
+    REQUIRE(decodeCompilationResult(encoded, decoded));
+    CHECK(decoded.cancelled);
+    CHECK(!decoded.success);
+}
+
+TEST_CASE("view reads in place and reports its size") {
+    CompilationResult original = makeResult();
+    std::string buffer = "prefix";
+    encodeCompilationResult(buffer, original);
+    buffer += "trailing bytes of the next record";
+
+    std::string_view encoded(buffer);
+    encoded.remove_prefix(6);
+    EncodedResultView view;
+    REQUIRE(view.attach(encoded));
+    CHECK(view.encodedSize() < encoded.size());
+    CHECK(view.diagnosticCount() == original.diagnostics.size());
+    CHECK(view.phaseCount() == original.phases.size());
+    CHECK(view.errorCount() == 2);
+    CHECK(view.compiledOutput() == original.compiledOutput);
+    for (size_t i = 0; i < view.diagnosticCount(); i++) {
+        CHECK(sameDiagnostic(view.diagnostic(i), original.diagnostics[i]));
+    }
+    CHECK(sameResult(original, view.toResult()));
+}
+
+TEST_CASE("every truncation is rejected") {
+    for (bool withChecksum : { true, false }) {
+        std::string encoded;
+        encodeCompilationResult(encoded, makeResult(), withChecksum);
+        for (size_t length = 0; length < encoded.size(); length++) {
+            EncodedResultView view;
+            CHECK(!view.attach(std::string_view(encoded.data(), length)));
+            CHECK(!view.isValid());
+        }
+    }
+}
+
+TEST_CASE("the checksum catches every flipped byte") {
+    std::string encoded;
+    encodeCompilationResult(encoded, makeResult());
+    for (size_t i = 0; i < encoded.size(); i++) {
+        std::string damaged = encoded;
+        damaged[i] = static_cast<char>(damaged[i] ^ 0x5a);
+        CompilationResult decoded;
+        CHECK(!decodeCompilationResult(damaged, decoded));
+    }
+}
+
+TEST_CASE("other versions and magic are rejected") {
+    std::string encoded;
+    encodeCompilationResult(encoded, makeResult(), false);
+
+    std::string otherVersion = encoded;
+    uint32_t version = ResultFormatVersion + 1;
+    std::memcpy(&otherVersion[4], &version, sizeof(version));
+    CompilationResult decoded;
+    CHECK(!decodeCompilationResult(otherVersion, decoded));
+
+    std::string otherMagic = encoded;
+    otherMagic[0] = 'X';
+    CHECK(!decodeCompilationResult(otherMagic, decoded));
+}
+
+TEST_CASE("damage without a checksum never reads outside the data") {
+    // Whatever attach() accepts must stay inside the buffer; a copy sized
+    // exactly to the encoding lets sanitizers see any overrun
+    std::string encoded;
+    encodeCompilationResult(encoded, makeResult(), false);
+    std::mt19937 random(20240611);
+    for (int round = 0; round < 20000; round++) {
+        std::string damaged = encoded;
+        int flips = 1 + static_cast<int>(random() % 4);
+        for (int f = 0; f < flips; f++) {
+            damaged[random() % damaged.size()] = static_cast<char>(random());
+        }
+        std::vector<char> exact(damaged.begin(), damaged.end());
+        EncodedResultView view;
+        if (view.attach(std::string_view(exact.data(), exact.size()), false)) {
+            CHECK(view.encodedSize() <= exact.size());
+            readEverything(view);
+        }
+    }
+}
+
+TEST_CASE("a damaged .result cache file is a miss") {
+    TemporaryDirectory directory("csprocompile-codec-test");
+    fs::path application = directory.path() / "App.ent";
+    writeFile(directory.path() / "App.apc", "PROC GLOBAL\n");
+    writeFile(application, "[Files]\nApplication=App.apc\n");
+
+    ResultCache cache(application.u8string());
+    CompilerOptions options;
+    options.inputFile = application.u8string();
+    std::string key;
+    REQUIRE(cache.computeKey(options, "test", key));
+    CompilationResult original = makeResult();
+    original.fromCache = false;
+    REQUIRE(cache.store(key, original));
+
+    CompilationResult found;
+    REQUIRE(cache.lookup(key, found));
+    CHECK(found.diagnostics.size() == original.diagnostics.size());
+
+    std::string stored = readFile(cache.getCachePath());
+    REQUIRE(!stored.empty());
+    for (size_t length : { size_t(0), size_t(10), stored.size() / 2, stored.size() - 1 }) {
+        writeFile(cache.getCachePath(), stored.substr(0, length));
+        CHECK(!cache.lookup(key, found));
+    }
+    std::string flipped = stored;
+    flipped[flipped.size() - 3] ^= 0x20;
+    writeFile(cache.getCachePath(), flipped);
+    CHECK(!cache.lookup(key, found));
+    writeFile(cache.getCachePath(), std::string(stored.size(), '\xff'));
+    CHECK(!cache.lookup(key, found));
+}
+
+TEST_CASE("a damaged store entry is a miss") {
+    TemporaryDirectory directory("csprocompile-codec-test");
+    fs::path application = directory.path() / "App.ent";
+    writeFile(directory.path() / "App.apc", "PROC GLOBAL\n");
+    writeFile(application, "[Files]\nApplication=App.apc\n");
+
+    CompilerOptions options;
+    options.inputFile = application.u8string();
+    std::string key;
+    REQUIRE(ResultStore::computeKey(application.u8string(), options, "test", key));
+    CompilationResult original = makeResult();
+    original.compiledOutput.clear();
+
+    ResultStore store(directory.path() / "store", 1024 * 1024);
+    REQUIRE(store.insert(key, application.u8string(), original));
+    CompilationResult found;
+    REQUIRE(store.lookup(key, application.u8string(), found));
+    CHECK(found.diagnostics.size() == original.diagnostics.size());
+
+    fs::path entry = directory.path() / "store" / "objects" / key.substr(0, 2) / (key + ".result");
+    std::string stored = readFile(entry);
+    REQUIRE(!stored.empty());
+    writeFile(entry, stored.substr(0, stored.size() / 2));
+    CHECK(!store.lookup(key, application.u8string(), found));
+    std::string flipped = stored;
+    flipped[stored.size() / 2] ^= 0x01;
+    writeFile(entry, flipped);
+    CHECK(!store.lookup(key, application.u8string(), found));
+    CHECK(store.getStats().misses == 2);
+}
+
+int main() {
+    return runTests();
+}
@@ -0,0 +1,185 @@
+/*
+ * StateFileTests.cpp - Truncated and corrupted binary state files: message
+ * catalogs (.mgc), the workspace graph and the compile time history
+ */
+
+#include "TestHarness.h"
+#include "../include/DistributedCompiler.h"
+#include "../include/MessageCatalog.h"
+#include "../include/WorkspaceGraph.h"
+#include <fstream>
+#include <iterator>
+
+using namespace CSProCompiler;
+using namespace CSProCompiler::Testing;
+namespace fs = std::filesystem;
+
+namespace {
+    std::string readFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Rewrites the file in place, keeping its write time, so only the contents tell it apart
+    void replaceContents(const fs::path& path, const std::string& contents) {
+        std::error_code ec;
+        fs::file_time_type time = fs::last_write_time(path, ec);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+        fs::last_write_time(path, time, ec);
+    }
+
+    // Damaged variants of a state file: truncations, flipped bytes and garbage
+    std::vector<std::string> damagedCopies(const std::string& original) {
+        std::vector<std::string> copies;
+        for (size_t length : { size_t(0), size_t(3), size_t(16), original.size() / 2, original.size() - 1 }) {
+            if (length < original.size()) copies.push_back(original.substr(0, length));
+        }
+        for (size_t position : { size_t(0), size_t(4), size_t(8), size_t(12) }) {
+            if (position < original.size()) {
+                std::string flipped = original;
+                flipped[position] = static_cast<char>(flipped[position] ^ 0x7f);
+                copies.push_back(flipped);
+            }
+        }
+        copies.push_back(std::string(original.size(), '\xff'));
+        return copies;
+    }
+}
+
+TEST_CASE("a damaged .mgc falls back to the message text") {
+    TemporaryDirectory directory("csprocompile-state-test");
+    fs::path messageFile = directory.path() / "Messages.mgf";
+    std::ofstream(messageFile, std::ios::binary) << "Language=EN\n94 Expecting 'endif'\n95 Expecting 'enddo'\n";
+    fs::path catalogFile = MessageCatalog::catalogPathFor(messageFile);
+
+    size_t count = 0;
+    std::string error;
+    REQUIRE(MessageCatalog::compile(messageFile, catalogFile, "EN", count, error));
+    CHECK(count == 2);
+    {
+        MessageCatalog catalog;
+        REQUIRE(catalog.open(messageFile));
+        CHECK(catalog.isPrecompiled());
+        CHECK(catalog.lookup(94) == "Expecting 'endif'");
+    }
+
+    std::string compiled = readFile(catalogFile);
+    for (const auto& damaged : damagedCopies(compiled)) {
+        replaceContents(catalogFile, damaged);
+        MessageCatalog catalog;
+        REQUIRE(catalog.open(messageFile));
+        CHECK(catalog.lookup(94) == "Expecting 'endif'");
+        CHECK(catalog.lookup(95) == "Expecting 'enddo'");
+        CHECK(catalog.lookup(96).empty());
+    }
+}
+
+TEST_CASE("a damaged .mgc without its text is refused or stays in bounds") {
+    TemporaryDirectory directory("csprocompile-state-test");
+    fs::path messageFile = directory.path() / "Messages.mgf";
+    std::ofstream(messageFile, std::ios::binary) << "Language=EN\n94 Expecting 'endif'\n95 Expecting 'enddo'\n";
+    fs::path catalogFile = MessageCatalog::catalogPathFor(messageFile);
+    size_t count = 0;
+    std::string error;
+    REQUIRE(MessageCatalog::compile(messageFile, catalogFile, "EN", count, error));
+    std::string compiled = readFile(catalogFile);
+    fs::remove(messageFile);
+
+    // Past the header, damage can only make lookups miss
+    for (size_t position = 48; position < compiled.size(); position++) {
+        std::string damaged = compiled;
+        damaged[position] = static_cast<char>(damaged[position] ^ 0xff);
+        replaceContents(catalogFile, damaged);
+        MessageCatalog catalog;
+        if (catalog.open(messageFile)) {
+            for (int number = 90; number < 100; number++) {
+                std::string_view text = catalog.lookup(number);
+                CHECK(text.size() <= compiled.size());
+            }
+        }
+    }
+    for (size_t length : { size_t(0), size_t(47), compiled.size() - 1 }) {
+        replaceContents(catalogFile, compiled.substr(0, length));
+        MessageCatalog catalog;
+        CHECK(!catalog.open(messageFile));
+    }
+}
+
+TEST_CASE("a damaged workspace graph starts from nothing") {
+    TemporaryDirectory directory("csprocompile-state-test");
+    fs::path application = directory.path() / "App.ent";
+    std::ofstream(directory.path() / "App.apc", std::ios::binary) << "PROC GLOBAL\n";
+    std::ofstream(directory.path() / "App.dcf", std::ios::binary) << "[Dictionary]\n";
+    std::ofstream(application, std::ios::binary) << "[Files]\nApplication=App.apc\nDictionary=App.dcf\n";
+    std::vector<std::string> applications = { application.u8string() };
+    fs::path graphFile = directory.path() / "workspace.graph";
+    {
+        WorkspaceGraph graph;
+        graph.refresh(applications);
+        REQUIRE(graph.save(graphFile));
+    }
+    {
+        WorkspaceGraph graph;
+        REQUIRE(graph.load(graphFile));
+        graph.refresh(applications);
+        CHECK(graph.changedApplications().empty());
+    }
+
+    std::string saved = readFile(graphFile);
+    for (const auto& damaged : damagedCopies(saved)) {
+        replaceContents(graphFile, damaged);
+        WorkspaceGraph graph;
+        if (!graph.load(graphFile)) {
+            CHECK(graph.applicationCount() == 0);
+        }
+        // Loaded or not, a refresh must find the application and its dictionary
+        graph.refresh(applications);
+        CHECK(graph.applicationCount() == 1);
+        CHECK(graph.affectedBy({ directory.path() / "App.dcf" }).size() == 1);
+    }
+}
+
+TEST_CASE("a damaged compile time history is ignored") {
+    TemporaryDirectory directory("csprocompile-state-test");
+    fs::path historyFile = directory.path() / "compile-times";
+    {
+        CompileTimeHistory history;
+        history.record("/work/A/A.ent", { 120.0, "127.0.0.1:9000" });
+        history.record("/work/B/B.ent", { 80.0, "" });
+        REQUIRE(history.save(historyFile));
+    }
+    {
+        CompileTimeHistory history;
+        REQUIRE(history.load(historyFile));
+        CompileTime time;
+        REQUIRE(history.lookup("/work/A/A.ent", time));
+        CHECK(time.milliseconds == 120.0);
+        CHECK(time.worker == "127.0.0.1:9000");
+    }
+
+    std::string saved = readFile(historyFile);
+    for (const auto& damaged : damagedCopies(saved)) {
+        replaceContents(historyFile, damaged);
+        CompileTimeHistory history;
+        history.record("/work/C/C.ent", { 1.0, "" });
+        CompileTime time;
+        if (!history.load(historyFile)) {
+            CHECK(!history.lookup("/work/A/A.ent", time));
+            CHECK(!history.lookup("/work/C/C.ent", time));
+        }
+    }
+
+    // A count far beyond the data must not be trusted
+    std::string inflated = saved;
+    inflated[8] = '\xff';
+    inflated[9] = '\xff';
+    inflated[10] = '\xff';
+    inflated[11] = '\x7f';
+    replaceContents(historyFile, inflated);
+    CompileTimeHistory history;
+    CHECK(!history.load(historyFile));
+}
+
+int main() {
+    return runTests();
+}
@@ -0,0 +1,120 @@
+/*
+ * TestHarness.h - Minimal test cases and checks for the unit tests
+ *
+ * Each test program defines its cases with TEST_CASE and runs them all
+ * from main() with runTests(). CHECK records a failure and carries on, so
+ * one run reports everything that broke; REQUIRE also ends the case.
+ * The programs are registered with ctest when BUILD_TESTS is on.
+ */
+
+#ifndef CSPRO_TEST_HARNESS_H
+#define CSPRO_TEST_HARNESS_H
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace CSProCompiler {
+namespace Testing {
+
+struct TestCase {
+    const char* name;
+    std::function<void()> body;
+};
+
+inline std::vector<TestCase>& registeredTests() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+inline int& failureCount() {
+    static int count = 0;
+    return count;
+}
+
+// Thrown by REQUIRE to abandon the rest of a case
+struct RequireFailed {};
+
+struct TestRegistration {
+    TestRegistration(const char* name, std::function<void()> body) {
+        registeredTests().push_back({ name, std::move(body) });
+    }
+};
+
+inline void reportFailure(const char* expression, const char* file, int line) {
+    std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+    failureCount()++;
+}
+
+// A fresh directory under the system temp folder, removed with the object
+class TemporaryDirectory {
+public:
+    explicit TemporaryDirectory(const std::string& prefix) {
+        std::error_code ec;
+        m_path = std::filesystem::temp_directory_path(ec) / (prefix + "-" + std::to_string(
+            std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::filesystem::create_directories(m_path, ec);
+    }
+
+    ~TemporaryDirectory() {
+        std::error_code ec;
+        std::filesystem::remove_all(m_path, ec);
+    }
+
+    TemporaryDirectory(const TemporaryDirectory&) = delete;
+    TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+    const std::filesystem::path& path() const { return m_path; }
+
+private:
+    std::filesystem::path m_path;
+};
+
+// Runs every registered case; the exit code is 1 when any check failed
+inline int runTests() {
+    for (const auto& test : registeredTests()) {
+        int failuresBefore = failureCount();
+        try {
+            test.body();
+        }
+        catch (const RequireFailed&) {
+        }
+        catch (const std::exception& ex) {
+            std::cerr << test.name << ": unexpected exception: " << ex.what() << std::endl;
+            failureCount()++;
+        }
+        std::cout << (failureCount() == failuresBefore ? "pass  " : "FAIL  ") << test.name << std::endl;
+    }
+    return failureCount() == 0 ? 0 : 1;
+}
+
+} // namespace Testing
+} // namespace CSProCompiler
+
+#define CSPRO_TEST_CONCAT_INNER(a, b) a##b
+#define CSPRO_TEST_CONCAT(a, b) CSPRO_TEST_CONCAT_INNER(a, b)
+
+#define TEST_CASE(name) \
+    static void CSPRO_TEST_CONCAT(testCase, __LINE__)(); \
+    static ::CSProCompiler::Testing::TestRegistration CSPRO_TEST_CONCAT(testRegistration, __LINE__)( \
+        name, CSPRO_TEST_CONCAT(testCase, __LINE__)); \
+    static void CSPRO_TEST_CONCAT(testCase, __LINE__)()
+
+#define CHECK(expression) \
+    do { \
+        if (!(expression)) ::CSProCompiler::Testing::reportFailure(#expression, __FILE__, __LINE__); \
+    } while (false)
+
+#define REQUIRE(expression) \
+    do { \
+        if (!(expression)) { \
+            ::CSProCompiler::Testing::reportFailure(#expression, __FILE__, __LINE__); \
+            throw ::CSProCompiler::Testing::RequireFailed(); \
+        } \
+    } while (false)
+
+#endif // CSPRO_TEST_HARNESS_H